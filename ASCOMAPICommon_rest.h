@@ -7,6 +7,7 @@ File to be included into relevant device REST setup
 #include "JSONHelperFunctions.h"
 
 //PUT /{DeviceType}/{DeviceNumber}/Action Invokes the specified device-specific action.
+//Action=MoveETA, Parameters=filter number or empty for the filter being moved to - returns the predicted msecs to get there.
 void handleAction(void);
 //PUT /{DeviceType}/{DeviceNumber}/CommandBlind Transmits an arbitrary string to the device
 void handleCommandBlind(void);
@@ -35,20 +36,36 @@ void handleAction(void)
     String message;
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
     JsonObject& root = jsonBuffer.createObject();
     
-    if ( connectedClient != clientID) 
+    if ( fw->connectedClient != clientID) 
     {
-      jsonResponseBuilder( root, clientID, transID, "Action", 0x400, "Action not available for 'not connected' client." );
+      alpacaResponseBuilder( root, clientID, transID, F("Action"), 0x400, F("Action not available for 'not connected' client.") );
       root["Value"]= "";
       root.printTo(message);
       server.send(400, "application/json", message);      
     }
+    else if ( server.arg("Action").equalsIgnoreCase( "MoveETA" ) )
+    {
+      PGM_P errMsg = PSTR("");
+      uint32_t etaMs = 0;
+      String param = server.arg("Parameters");
+      int filterId = ( param.length() > 0 )? param.toInt() : -1;
+      int errNum = fwGetMoveEta( fw, filterId, &etaMs, &errMsg );
+
+      alpacaResponseBuilder( root, clientID, transID, F("Action"), errNum, FPSTR( errMsg ) );
+      root["Value"]= String( etaMs );
+      root.printTo(message);
+      server.send(200, "application/json", message);
+    }
     else
     {    
-      jsonResponseBuilder( root, clientID, transID, "Action", 0x400, "Not implemented" );
+      alpacaResponseBuilder( root, clientID, transID, F("Action"), 0x40C, F("Not implemented") );
       root["Value"]= "";
       root.printTo(message);
       server.send(200, "application/json", message);
@@ -61,19 +78,22 @@ void handleCommandBlind(void)
     String message;
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);       
     JsonObject& root = jsonBuffer.createObject();
-    if ( connectedClient != clientID) 
+    if ( fw->connectedClient != clientID) 
     {
-      jsonResponseBuilder( root, clientID, transID, "Action", 0x400, "Action not available for 'not connected' client." );
+      alpacaResponseBuilder( root, clientID, transID, F("Action"), 0x400, F("Action not available for 'not connected' client.") );
       root["Value"]= "";
       root.printTo(message);
       server.send(400, "application/json", message);      
     }
     else
     {
-      jsonResponseBuilder( root, clientID, transID, "Action", 0x400, "Not implemented" );
+      alpacaResponseBuilder( root, clientID, transID, F("Action"), 0x400, F("Not implemented") );
       root["Value"]= "";
       root.printTo(message);
       server.send(200, "application/json", message);
@@ -86,19 +106,22 @@ void handleCommandBool(void)
     String message;
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
     JsonObject& root = jsonBuffer.createObject();
-    if ( connectedClient != clientID) 
+    if ( fw->connectedClient != clientID) 
     {
-      jsonResponseBuilder( root, clientID, transID, "Action", 0x400, "Action not available for 'not connected' client." );
+      alpacaResponseBuilder( root, clientID, transID, F("Action"), 0x400, F("Action not available for 'not connected' client.") );
       root["Value"]= "";
       root.printTo(message);
       server.send(400, "application/json", message);      
     }
     else
     {
-      jsonResponseBuilder( root, clientID, transID, "CommandBool", 0x400, "Not implemented" );
+      alpacaResponseBuilder( root, clientID, transID, F("CommandBool"), 0x400, F("Not implemented") );
       root["Value"]= false; 
       root.printTo(message);   
       server.send(200, "application/json", message);
@@ -115,17 +138,20 @@ void handleCommandString(void)
     JsonObject& root = jsonBuffer.createObject();
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
     
-    if ( connectedClient != clientID) 
+    if ( fw->connectedClient != clientID) 
     {
-      jsonResponseBuilder( root, clientID, transID, "Action", 0x400, "Action not available for 'not connected' client." );
+      alpacaResponseBuilder( root, clientID, transID, F("Action"), 0x400, F("Action not available for 'not connected' client.") );
       root["Value"]= "";
       root.printTo(message);
       server.send(200, "application/json", message);      
     }
     else
     {
-      jsonResponseBuilder( root, clientID, transID, "CommandBool", 0x400, "Not implemented" );
+      alpacaResponseBuilder( root, clientID, transID, F("CommandBool"), 0x400, F("Not implemented") );
       root["Value"]= false; 
       root.printTo(message);   
       server.send(200, "application/json", message);
@@ -136,87 +162,46 @@ void handleCommandString(void)
 void handleConnected(void)
 {
     String message;
+    PGM_P errMsg = PSTR("");
+    int errNum = 0;
+    bool connect = false;
     int outputCode = 200;
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
     JsonObject& root = jsonBuffer.createObject();
     
     if ( server.method() == HTTP_PUT )
     { 
-       DEBUGSL1( "Entered handleConnected::PUT" );
+       DEBUGSL1( F("Entered handleConnected::PUT") );
+      if( sendReplayedResponse( clientID, transID ) )
+        return;
 
-      //dont like the logic here - if its already connected for this client we should refuse a connect. 
-      if( server.arg("Connected") && server.arg("Connected").equalsIgnoreCase("true" ) )
-      { //setting to true 
-        if ( connected )//already true
-        {
-          if( clientID == connectedClient )
-          {
-          DEBUGSL1( "Entered handleConnected::PUT::True::already connected - benign error" );        
-            //Check error numbers
-            jsonResponseBuilder( root, clientID, transID, "Connected", 0, "Setting connected when already connected" );        
-            root["Value"]= connected;    
-            root.printTo(message);
-            outputCode = 200;
-          }
-          else
-          {
-          DEBUGSL1( "Entered handleConnected::PUT::True::already connected but not by this client - error" );        
-            //Check error numbers
-            jsonResponseBuilder( root, clientID, transID, "Connected", 0x402, "Setting connected when already connected by different client" );        
-            root["Value"]= connected;    
-            root.printTo(message);
-            outputCode = 400;            
-          }
-        }
-        else //OK
-        {  
-          DEBUGSL1( "Entered handleConnected::PUT::True::setting connected - OK" );
-          connected = true;
-          connectedClient = clientID;
-          jsonResponseBuilder( root, clientID, transID, "Connected", 0, "Setting connected OK" );        
-          root["Value"]= false;    
-          root.printTo(message);
-          outputCode = 200;          
-        }
-      }
-      else //set to false
-      {
-        if ( connected ) //
-        {
-          DEBUGSL1( "Entered handleConnected::PUT::False::set unconnected - OK" );
-          connected = false; //OK   
-          connectedClient = -1;       
-          jsonResponseBuilder( root, clientID, transID, "Connected", 0, "Disconnected OK" );        
-          root["Value"]= false;    
-          root.printTo(message);
-          outputCode = 200;
-        }
-        else
-        {
-          //Check error numbers
-          DEBUGSL1( "Entered handleConnected::PUT::False::not already connected - error" );
-          jsonResponseBuilder( root, clientID, transID, "Connected", 0x403, "Setting 'connected' to false when aready false" );        
-          root["Value"]= false; 
-          root.printTo(message);   
-          outputCode = 400;
-        }
-      }
+      connect = server.arg("Connected").equalsIgnoreCase("true");
+      errNum = fwSetConnected( fw, clientID, connect, &errMsg );
+      DEBUGS1( F("handleConnected::PUT: ") );DEBUGSL1( FPSTR( errMsg ) );
+      alpacaResponseBuilder( root, clientID, transID, F("Connected"), errNum, FPSTR( errMsg ) );        
+      root["Value"]= fw->connected;    
+      root.printTo(message);
+      outputCode = ( errNum == 0 )? 200 : 400;
+      storeReplayResponse( clientID, transID, 200, message );
     }
     else if ( server.method() == HTTP_GET )
     {
       //Check error numbers
-      jsonResponseBuilder( root, clientID, transID, "Connected", 0, "" );        
-      root["Value"]= connected;
+      alpacaResponseBuilder( root, clientID, transID, F("Connected"), 0, "" );        
+      root["Value"]= fw->connected;
       root.printTo(message);
       outputCode = 200;
     }
     else
     {
-      jsonResponseBuilder( root, clientID, transID, "Connected", 0x40B, "Unexpected request method" );        
-      root["Value"]= connected;      
+      alpacaResponseBuilder( root, clientID, transID, F("Connected"), 0x40B, F("Unexpected request method") );        
+      root["Value"]= fw->connected;      
       root.printTo(message);
       outputCode = 200;
     }
@@ -229,14 +214,21 @@ void handleConnected(void)
 void handleDescriptionGet(void)
 {
     String message;
+    uint32_t startCycles = ESP.getCycleCount();
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
+    if( sendCachedResponse( &fw->responseCache, CACHE_DESCRIPTION, clientID, transID ) )
+      return;
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
     JsonObject& root = jsonBuffer.createObject();
-    jsonResponseBuilder( root, clientID, transID, "Description", 0, "" );    
-    root["Value"]= Description;    
+    alpacaResponseBuilder( root, clientID, transID, F("Description"), 0, "" );    
+    root["Value"]= FPSTR( Description );    
     root.printTo(message);
+    storeCachedResponse( &fw->responseCache, CACHE_DESCRIPTION, "application/json", message, ESP.getCycleCount() - startCycles );
     server.send(200, "application/json", message);
     return ;
 }
@@ -244,14 +236,21 @@ void handleDescriptionGet(void)
 void handleDriverInfoGet(void)
 {
     String message;
+    uint32_t startCycles = ESP.getCycleCount();
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
+    if( sendCachedResponse( &fw->responseCache, CACHE_DRIVERINFO, clientID, transID ) )
+      return;
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
     JsonObject& root = jsonBuffer.createObject();
-    jsonResponseBuilder( root, clientID, transID, "DriverInfo", 0, "" );    
-    root["Value"]= Description;    
+    alpacaResponseBuilder( root, clientID, transID, F("DriverInfo"), 0, "" );    
+    root["Value"]= FPSTR( DriverInfo );    
     root.printTo(message);
+    storeCachedResponse( &fw->responseCache, CACHE_DRIVERINFO, "application/json", message, ESP.getCycleCount() - startCycles );
     server.send(200, "application/json", message);
     return ;
 }
@@ -259,14 +258,21 @@ void handleDriverInfoGet(void)
 void handleDriverVersionGet(void)
 {
     String message;
+    uint32_t startCycles = ESP.getCycleCount();
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
+    if( sendCachedResponse( &fw->responseCache, CACHE_DRIVERVERSION, clientID, transID ) )
+      return;
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
     JsonObject& root = jsonBuffer.createObject();
-    jsonResponseBuilder( root, clientID, transID, "DriverVersion", 0, "" );    
-    root["Value"]= DriverVersion;    
+    alpacaResponseBuilder( root, clientID, transID, F("DriverVersion"), 0, "" );    
+    root["Value"]= FPSTR( DriverVersion );    
     root.printTo(message);
+    storeCachedResponse( &fw->responseCache, CACHE_DRIVERVERSION, "application/json", message, ESP.getCycleCount() - startCycles );
     server.send(200, "application/json", message);
     return ;
 }
@@ -274,14 +280,21 @@ void handleDriverVersionGet(void)
 void handleNameGet(void)
 {
     String message;
+    uint32_t startCycles = ESP.getCycleCount();
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
+    if( sendCachedResponse( &fw->responseCache, CACHE_NAME, clientID, transID ) )
+      return;
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
     JsonObject& root = jsonBuffer.createObject();
-    jsonResponseBuilder( root, clientID, transID, "Name", 0, "" );    
-    root["Value"] = DriverName;    
+    alpacaResponseBuilder( root, clientID, transID, F("Name"), 0, "" );    
+    root["Value"] = fw->wheelName;    
     root.printTo(message);
+    storeCachedResponse( &fw->responseCache, CACHE_NAME, "application/json", message, ESP.getCycleCount() - startCycles );
     server.send(200, "application/json", message);
     return ;
 }
@@ -291,11 +304,15 @@ void handleSupportedActionsGet(void)
     String message;
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
     JsonObject& root = jsonBuffer.createObject();
-    jsonResponseBuilder( root, clientID, transID, "SupportedActions", 0, "" );    
-    root["Value"]= "";    //Empty array until otherwise 
+    alpacaResponseBuilder( root, clientID, transID, F("SupportedActions"), 0, "" );    
+    JsonArray& actions = root.createNestedArray("Value");
+    actions.add( "MoveETA" );
     root.printTo(message);
     server.send(200, "application/json", message);
     return ;
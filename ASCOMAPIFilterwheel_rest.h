@@ -20,31 +20,45 @@ void handlePositionGet(void);
 void handlePositionPut(void);
 
 //Additional handlers used for setup webpage.
+//The page itself is static and rendered client-side from the JSON returned by handleConfigGet and the PUT handlers.
 void handleSetup(void);
+void handleConfigGet(void);
+void handleConfigPut(void);
 void handleFocusOffsetsPut( void );
 void handleFilterNamesPut( void );
 void handleHostnamePut( void );
 void handleNamePut( void );
 void handleFilterCountPut( void );
 
+//Non-ASCOM per-device request statistics
+void handleMetricsGet( void );
+void handleHistoryGet( void );
+
 //Local functions
-String& setupFormBuilder( String& htmlForm, String& errMsg );
+void sendConfigResponse( FilterWheel* fw, int responseCode, const String& errMsg );
 
 void handleFocusOffsetsGet(void)
 {
     String message;
+    uint32_t startCycles = ESP.getCycleCount();
     int i = 0;
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
+    if( sendCachedResponse( &fw->responseCache, CACHE_FOCUSOFFSETS, clientID, transID ) )
+      return;
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
 
     JsonObject& root = jsonBuffer.createObject();
-    jsonResponseBuilder( root, clientID, transID, "FocusOffsets", 0, "" );    
+    alpacaResponseBuilder( root, clientID, transID, F("FocusOffsets"), 0, "" );    
     JsonArray& offsets = root.createNestedArray("Value");
-    for ( i=0; i<filtersPerWheel ;i++ )
-      offsets.add( focusOffsets[i]);
+    for ( i=0; i<fw->filtersPerWheel ;i++ )
+      offsets.add( fw->focusOffsets[i]);
     root.printTo(message);
+    storeCachedResponse( &fw->responseCache, CACHE_FOCUSOFFSETS, "text/json", message, ESP.getCycleCount() - startCycles );
     server.send(200, "text/json", message);
     return ;
 }
@@ -52,20 +66,27 @@ void handleFocusOffsetsGet(void)
 void handleFilterNamesGet(void)
 {
     String message;
+    uint32_t startCycles = ESP.getCycleCount();
     int i = 0;
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
+    if( sendCachedResponse( &fw->responseCache, CACHE_NAMES, clientID, transID ) )
+      return;
 
-    DEBUGSL1( "Entered handleFilterNamesGet" );
+    DEBUGSL1( F("Entered handleFilterNamesGet") );
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
     
     JsonObject& root = jsonBuffer.createObject();
     JsonArray& names = root.createNestedArray("Value");
-    jsonResponseBuilder( root, clientID, transID, "FilterNames", 0, "" );    
-    for ( i=0;  i < filtersPerWheel ;i++ )
-      names.add( filterNames[i]);
+    alpacaResponseBuilder( root, clientID, transID, F("FilterNames"), 0, "" );    
+    for ( i=0;  i < fw->filtersPerWheel ;i++ )
+      names.add( fw->filterNames[i]);
     root.printTo(message);
+    storeCachedResponse( &fw->responseCache, CACHE_NAMES, "text/json", message, ESP.getCycleCount() - startCycles );
     server.send(200, "text/json", message);
     return ;  
 }
@@ -73,18 +94,23 @@ void handleFilterNamesGet(void)
 void handlePositionGet(void)
 {
     String message;
-    String strPosition;
-    int filterID = currentFilterId;
+    PGM_P errMsg = PSTR("");
+    int errNum = 0;
+    int filterID = 0;
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
 
-    DEBUGSL1( "Entered handlePositionGet" );
+    DEBUGSL1( F("Entered handlePositionGet") );
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
     
     JsonObject& root = jsonBuffer.createObject();
-    jsonResponseBuilder( root, clientID, transID, "Position get", 0, "" );    
-    root["Value"] = currentFilterId;
+    errNum = fwGetPosition( fw, &filterID, &errMsg );
+    alpacaResponseBuilder( root, clientID, transID, F("Position get"), errNum, FPSTR( errMsg ) );    
+    root["Value"] = filterID;
     root.printTo(message);
     server.send(200, "text/json", message);
     return ;    
@@ -93,78 +119,478 @@ void handlePositionGet(void)
 void handlePositionPut(void)
 {
     String message;
-    String strPosition;
+    PGM_P errMsg = PSTR("");
+    int errNum = 0;
     int responseCode = 200;
-    int filterId = currentFilterId;
     uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
     uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    FilterWheel* fw = requestFilterWheel();
+    if( fw == NULL )
+      return;
+    if( sendReplayedResponse( clientID, transID ) )
+      return;
 
-    DEBUGSL1( "Entered handlePositionPut" );
+    DEBUGSL1( F("Entered handlePositionPut") );
     //JSON data formatter
     DynamicJsonBuffer jsonBuffer(256);
 
     JsonObject& root = jsonBuffer.createObject();
-    if( isMoving )
+    if( server.hasArg("Position") )
     {
-      responseCode = 400;
-      jsonResponseBuilder( root, clientID, transID, "Position put", 0x402, "Filter wheel already moving" );    
-    }
-    else if( server.hasArg("Position") )
-    {
-      strPosition = server.arg("Position");
-      filterId = strPosition.toInt();      
-      jsonResponseBuilder( root, clientID, transID, "Position", 0, "" );    
-      if( filterId >= 0 && filterId < filtersPerWheel && filterId != currentFilterId )
-        targetFilterId = filterId;
-      responseCode = 200;
+      errNum = fwSetPosition( fw, clientID, server.arg("Position").toInt(), &errMsg );
+      alpacaResponseBuilder( root, clientID, transID, F("Position"), errNum, FPSTR( errMsg ) );    
+      responseCode = ( errNum == 0 )? 200 : 400;
     }
     else
     {
       responseCode = 400;
-      jsonResponseBuilder( root, clientID, transID, "Position", 0x402, "Position argument invalidc" );    
+      alpacaResponseBuilder( root, clientID, transID, F("Position"), 0x402, F("Position argument invalid") );    
     }
     root.printTo(message);
+    storeReplayResponse( clientID, transID, responseCode, message );
     server.send(responseCode, "application/json", message);
     return;    
 }
 
 //Non ASCOM functions
 /*
- * String& setupFormBuilder( String& htmlForm )
+ * Setup page - GET / or /filterwheel/{DeviceNumber}/Setup
+ * A single pre-gzipped static asset, the browser caches it and only revalidates against the ETag.
+ */
+void handleSetup(void)
+{
+  if( server.header("If-None-Match").equals( setupPageETag ) )
+  {
+    server.send( 304 );
+    return;
+  }
+  server.sendHeader( "Content-Encoding", "gzip" );
+  server.sendHeader( "Cache-Control", "max-age=86400" );
+  server.sendHeader( "ETag", setupPageETag );
+  server.send_P( 200, "text/html", (PGM_P) setupPageGz, setupPageGzLength );
+  return;
+}
+
+//GET /filterwheel/{DeviceNumber}/Config - settings used to fill in the setup page
+void handleConfigGet(void)
+{
+  FilterWheel* fw = requestFilterWheel();
+  if( fw == NULL )
+    return;
+  sendConfigResponse( fw, 200, "" );
+}
+
+/*
+ * PUT /filterwheel/{DeviceNumber}/Config - change several settings in one transaction
+ * Body is a JSON document with any of WheelName, FilterCount, Names[], FocusOffsets[], SlewMode ( "Full" or "Half" ), ApproachSteps
+ * StepInterval ( msecs between steps ) and Backlash ( full steps taken up when the wheel turns round, 0 for none ).
+ * Everything is validated and staged before anything is applied, the change is then committed to EEPROM once.
+ * Names and FocusOffsets must have one entry per filter, after any change of FilterCount.
+ */
+void handleConfigPut(void)
+{
+  String errMsg = "";
+  FilterConfig cfg;
+  int filterCount = 0;
+  int slewMode = 0;
+  int powerProfile = -1;
+  int i=0;
+
+  DEBUGSL1( F("Entered handleConfigPut") );
+  FilterWheel* fw = requestFilterWheel();
+  if( fw == NULL )
+    return;
+
+  //JSON data parser
+  DynamicJsonBuffer jsonBuffer(1024);
+  JsonObject& root = jsonBuffer.parseObject( server.arg("plain") );
+  if( !root.success() )
+  {
+    sendConfigResponse( fw, 400, F("Config: request body is not a JSON object") );
+    return;
+  }
+  if( fw->motion.isMoving() || focuserBusy( &fw->focuser ) )
+  {
+    sendConfigResponse( fw, 400, F("Config: filter wheel moving") );
+    return;
+  }
+
+  //Validate everything up front
+  filterCount = fw->filtersPerWheel;
+  if( root.containsKey("FilterCount") )
+  {
+    filterCount = root["FilterCount"].as<int>();
+    if( !root["FilterCount"].is<int>() || filterCount <= 0 || filterCount >= MAX_FILTER_COUNT )
+      errMsg = F("Config: FilterCount out of range");
+  }
+  if( root.containsKey("WheelName") )
+  {
+    const char* name = root["WheelName"].as<const char*>();
+    if( name == NULL || strlen( name ) == 0 || strlen( name ) >= MAX_NAME_LENGTH )
+      errMsg = F("Config: WheelName missing or too long");
+  }
+  if( root.containsKey("Names") )
+  {
+    JsonArray& names = root["Names"];
+    if( !names.success() || (int) names.size() != filterCount )
+      errMsg = F("Config: Names must have one entry per filter");
+    else
+    {
+      for ( i=0; i < filterCount; i++ )
+      {
+        const char* name = names[i].as<const char*>();
+        if( name == NULL || strlen( name ) == 0 || strlen( name ) >= MAX_NAME_LENGTH )
+          errMsg = F("Config: filter name missing or too long");
+      }
+    }
+  }
+  if( root.containsKey("FocusOffsets") )
+  {
+    JsonArray& offsets = root["FocusOffsets"];
+    if( !offsets.success() || (int) offsets.size() != filterCount )
+      errMsg = F("Config: FocusOffsets must have one entry per filter");
+    else
+    {
+      for ( i=0; i < filterCount; i++ )
+      {
+        if( !offsets[i].is<int>() || offsets[i].as<int>() < 0 || offsets[i].as<int>() >= stepsPerRevolution )
+          errMsg = F("Config: focus offset out of range");
+      }
+    }
+  }
+  if( root.containsKey("SlewMode") )
+  {
+    const char* mode = root["SlewMode"].as<const char*>();
+    slewMode = ( mode == NULL )? 0 : ( strcasecmp( mode, "Full" ) == 0 )? STEP_FULL : ( strcasecmp( mode, "Half" ) == 0 )? STEP_HALF : 0;
+    if( slewMode == 0 )
+      errMsg = F("Config: SlewMode must be Full or Half");
+  }
+  if( root.containsKey("ApproachSteps") )
+  {
+    if( !root["ApproachSteps"].is<int>() || root["ApproachSteps"].as<int>() < 0 || root["ApproachSteps"].as<int>() > stepsPerRevolution/2 )
+      errMsg = F("Config: ApproachSteps out of range");
+  }
+  if( root.containsKey("StepInterval") )
+  {
+    if( !root["StepInterval"].is<int>() || root["StepInterval"].as<int>() < minStepIntervalMs || root["StepInterval"].as<int>() > maxStepIntervalMs )
+      errMsg = F("Config: StepInterval out of range");
+  }
+  if( root.containsKey("Backlash") )
+  {
+    if( !root["Backlash"].is<int>() || root["Backlash"].as<int>() < 0 || root["Backlash"].as<int>() > maxBacklashSteps )
+      errMsg = F("Config: Backlash out of range");
+  }
+  if( root.containsKey("PowerProfile") )
+  {
+    powerProfile = powerProfileFromName( root["PowerProfile"].as<const char*>() );
+    if( powerProfile < 0 )
+      errMsg = F("Config: PowerProfile must be Performance, Balanced or LowPower");
+  }
+  if( root.containsKey("FocuserEnabled") && !root["FocuserEnabled"].is<bool>() )
+    errMsg = F("Config: FocuserEnabled must be true or false");
+  if( root.containsKey("FocuserRelative") && !root["FocuserRelative"].is<bool>() )
+    errMsg = F("Config: FocuserRelative must be true or false");
+  if( root.containsKey("FocuserHost") )
+  {
+    const char* host = root["FocuserHost"].as<const char*>();
+    if( host == NULL || strlen( host ) >= MAX_NAME_LENGTH )
+      errMsg = F("Config: FocuserHost missing or too long");
+  }
+  if( root.containsKey("FocuserPort") )
+  {
+    if( !root["FocuserPort"].is<int>() || root["FocuserPort"].as<int>() <= 0 || root["FocuserPort"].as<int>() > 65535 )
+      errMsg = F("Config: FocuserPort out of range");
+  }
+  if( root.containsKey("FocuserDevice") )
+  {
+    if( !root["FocuserDevice"].is<int>() || root["FocuserDevice"].as<int>() < 0 || root["FocuserDevice"].as<int>() > 255 )
+      errMsg = F("Config: FocuserDevice out of range");
+  }
+  if( errMsg.length() > 0 )
+  {
+    DEBUGSL1( errMsg );
+    sendConfigResponse( fw, 400, errMsg );
+    return;
+  }
+
+  //Stage the new settings
+  if( !stageFilterConfig( fw, &cfg, filterCount ) )
+  {
+    sendConfigResponse( fw, 500, F("Config: out of memory") );
+    return;
+  }
+  if( root.containsKey("WheelName") )
+    strcpy( cfg.wheelName, root["WheelName"].as<const char*>() );
+  if( root.containsKey("Names") )
+  {
+    JsonArray& names = root["Names"];
+    for ( i=0; i < filterCount; i++ )
+      strcpy( cfg.filterNames[i], names[i].as<const char*>() );
+  }
+  if( root.containsKey("FocusOffsets") )
+  {
+    JsonArray& offsets = root["FocusOffsets"];
+    for ( i=0; i < filterCount; i++ )
+      cfg.focusOffsets[i] = offsets[i].as<int>();
+  }
+
+  //Apply and commit once
+  commitFilterConfig( fw, &cfg );
+  if( root.containsKey("SlewMode") )
+    fw->motion.setSlewMode( slewMode );
+  if( root.containsKey("ApproachSteps") )
+    fw->motion.setApproachSteps( root["ApproachSteps"].as<int>() );
+  if( root.containsKey("StepInterval") )
+    fw->motion.setStepInterval( root["StepInterval"].as<int>() );
+  if( root.containsKey("Backlash") )
+    fw->motion.setBacklash( root["Backlash"].as<int>() );
+  if( powerProfile >= 0 )
+    setPowerProfile( powerProfile );
+  if( root.containsKey("FocuserEnabled") )
+    fw->focuser.enabled = root["FocuserEnabled"].as<bool>();
+  if( root.containsKey("FocuserRelative") )
+    fw->focuser.relative = root["FocuserRelative"].as<bool>();
+  if( root.containsKey("FocuserHost") )
+    strcpy( fw->focuser.host, root["FocuserHost"].as<const char*>() );
+  if( root.containsKey("FocuserPort") )
+    fw->focuser.port = (uint16_t) root["FocuserPort"].as<int>();
+  if( root.containsKey("FocuserDevice") )
+    fw->focuser.device = (uint8_t) root["FocuserDevice"].as<int>();
+  //Looked up here rather than on a move, and reconnected to on the next move
+  if( root.containsKey("FocuserEnabled") || root.containsKey("FocuserHost") || root.containsKey("FocuserPort") )
+    applyFocuserSettings( &fw->focuser );
+  saveToEeprom();
+  sendConfigResponse( fw, 200, "" );
+  DEBUGSL1( F("Exited handleConfigPut") );
+}
+
+/*
+ * Reply to a setup request with the wheel's current settings, so the page can update its fields in place.
+ */
+void sendConfigResponse( FilterWheel* fw, int responseCode, const String& errMsg )
+{
+  String message;
+  int i=0;
+  //JSON data formatter
+  DynamicJsonBuffer jsonBuffer(512);
+  JsonObject& root = jsonBuffer.createObject();
+  root["Hostname"] = hostname;
+  root["WheelName"] = fw->wheelName;
+  root["FilterCount"] = fw->filtersPerWheel;
+  root["MaxFilterCount"] = MAX_FILTER_COUNT;
+  root["SlewMode"] = ( fw->motion.getSlewMode() == STEP_FULL )? "Full" : "Half";
+  root["ApproachSteps"] = fw->motion.getApproachSteps();
+  root["HalfStepping"] = fw->hardware.hasHalfStep();
+  root["StepInterval"] = fw->motion.getStepInterval();
+  root["Backlash"] = fw->motion.getBacklash();
+  root["PowerProfile"] = powerProfileName( powerState.profile );
+  root["EncoderCounts"] = fw->encoder.countsPerRev;
+  root["FocuserEnabled"] = fw->focuser.enabled;
+  root["FocuserHost"] = fw->focuser.host;
+  root["FocuserPort"] = fw->focuser.port;
+  root["FocuserDevice"] = fw->focuser.device;
+  root["FocuserRelative"] = fw->focuser.relative;
+  JsonArray& names = root.createNestedArray("Names");
+  JsonArray& offsets = root.createNestedArray("FocusOffsets");
+  for ( i=0; i < fw->filtersPerWheel; i++ )
+  {
+    names.add( fw->filterNames[i] );
+    offsets.add( fw->focusOffsets[i] );
+  }
+  root["ErrorMessage"] = errMsg;
+  root.printTo(message);
+  fw->setupBytesSent += message.length();
+  server.send( responseCode, "application/json", message );
+}
+
+/*
+ * Request statistics for a wheel - GET /filterwheel/{DeviceNumber}/Metrics
+ * Latency is the time spent in handleClient for requests addressed to the wheel.
  */
- void handleSetup(void)
- {
-  String output = "";
-  String err = "";
-  output = setupFormBuilder( output, err );
-  server.send(200, "text/html", output );
+void handleMetricsGet( void )
+{
+  String message;
+  int i=0;
+  FilterWheel* fw = requestFilterWheel();
+  if( fw == NULL )
+    return;
+  //JSON data formatter
+  DynamicJsonBuffer jsonBuffer(256);
+  JsonObject& root = jsonBuffer.createObject();
+  root["DeviceNumber"] = fw->deviceNumber;
+  root["Requests"] = fw->requestCount;
+  root["RequestMicrosMean"] = ( fw->requestCount > 0 )? ( fw->requestMicrosTotal / fw->requestCount ) : 0;
+  root["RequestMicrosMax"] = fw->requestMicrosMax;
+  root["CacheHits"] = fw->responseCache.hits;
+  root["CacheMisses"] = fw->responseCache.misses;
+  root["CacheHitRate"] = ( fw->responseCache.hits + fw->responseCache.misses > 0 )? 
+                         ( (float) fw->responseCache.hits / ( fw->responseCache.hits + fw->responseCache.misses ) ) : 0.0;
+  root["CacheCyclesSaved"] = (double) fw->responseCache.cyclesSaved;
+  root["SetupBytesSent"] = fw->setupBytesSent;
+  root["EepromCommits"] = eepromCommits;
+  root["StepPosition"] = fw->motion.getPosition();
+  root["StepModeChanges"] = fw->motion.getStepModeChanges();
+  root["EtaErrorMs"] = fw->etaErrorMs;
+  root["EtaMaxErrorMs"] = fw->etaMaxErrorMs;
+  if( fw->focuser.enabled )
+  {
+    root["FocuserMoves"] = fw->focuser.moves;
+    root["FocuserErrors"] = fw->focuser.errors;
+    root["FocuserLastError"] = fw->focuser.lastError;
+    root["FocuserLastMs"] = fw->focuser.lastDurationMs;
+    root["FocuserConnects"] = fw->focuser.connects;
+    root["FocuserSuspended"] = fw->focuser.suspended;
+    root["ChangeLastMs"] = fw->lastChangeMs;
+    root["ChangeSavedMs"] = fw->lastChangeSavedMs;
+  }
+  if( fw->encoder.countsPerRev > 0 )
+  {
+    root["EncoderPosition"] = encoderMicrosteps( &fw->encoder );
+    root["EncoderError"] = fw->encoder.lastError;
+    root["EncoderMaxError"] = fw->encoder.maxError;
+    root["EncoderCorrections"] = fw->encoder.corrections;
+    root["EncoderFaults"] = fw->encoder.faults;
+    root["EncoderGlitches"] = fw->encoder.glitches;
+  }
+  //Rate limiting counts are for the whole server
+  root["Admitted"] = admittedCount;
+  root["AdmittedExempt"] = exemptCount;
+  root["Rejected"] = rejectedCount;
+  root["EventsProcessed"] = eventQueue.processed;
+  root["EventQueueHighWater"] = eventQueue.highWater;
+  root["EventQueueOverflows"] = eventQueue.overflows;
+  root["Replays"] = replayCache.replays;
+  root["IsMoving"] = fw->motion.isMoving();
+  //Power profile in use and request handling time under each
+  root["PowerProfile"] = powerProfileName( powerState.profile );
+  root["PowerActive"] = powerState.active;
+  root["PowerSwitchMicrosMax"] = powerState.switchMicrosMax;
+  JsonObject& profiles = root.createNestedObject("PowerProfiles");
+  for ( i=0; i < POWER_PROFILE_COUNT; i++ )
+  {
+    PowerStats* stats = &powerState.stats[i];
+    JsonObject& profile = profiles.createNestedObject( powerProfileName( i ) );
+    profile["Requests"] = stats->requests;
+    profile["RequestMicrosMean"] = ( stats->requests > 0 )? ( stats->requestMicrosTotal / stats->requests ) : 0;
+    profile["RequestMicrosMax"] = stats->requestMicrosMax;
+    profile["Wakes"] = stats->wakes;
+  }
+  root["FreeHeap"] = ESP.getFreeHeap();
+  root["MaxFreeBlock"] = ESP.getMaxFreeBlockSize();
+  root["HeapFragmentation"] = ESP.getHeapFragmentation();
+  root["RamStatic"] = ramReport.staticRam;
+  root["HeapAtBoot"] = ramReport.bootHeap;
+  root["MaxBlockAtBoot"] = ramReport.bootMaxBlock;
+  root["HeapIdleMin"] = ramReport.idleHeapMin;
+  root["MaxBlockIdleMin"] = ramReport.idleMaxBlockMin;
+  root.printTo(message);
+  server.send(200, "application/json", message);
   return;
- }
+}
+
+/*
+ * Move history for a wheel - GET /filterwheel/{DeviceNumber}/History?Page=0&PageSize=20
+ * Records are newest first. Pairs has the duration percentiles of every from/to filter pair in the journal.
+ */
+void handleHistoryGet( void )
+{
+  String message;
+  MoveRecord* record = NULL;
+  //Static - 384 bytes is too much for the loop's 4K stack
+  static uint8_t pairs[JOURNAL_SIZE];
+  static uint16_t durations[JOURNAL_SIZE];
+  int pageSize = 20;
+  int page = 0;
+  int pairCount = 0;
+  int held = 0;
+  int count = 0;
+  int i=0, j=0;
+  FilterWheel* fw = requestFilterWheel();
+  if( fw == NULL )
+    return;
+
+  if( server.hasArg("Page") )
+    page = max( (int) server.arg("Page").toInt(), 0 );
+  if( server.hasArg("PageSize") )
+    pageSize = constrain( (int) server.arg("PageSize").toInt(), 1, 32 );
+
+  //JSON data formatter
+  DynamicJsonBuffer jsonBuffer(2048);
+  JsonObject& root = jsonBuffer.createObject();
+  JsonArray& records = root.createNestedArray("Records");
+  for ( i=0; ( record = journalRecord( i ) ) != NULL; i++ )
+  {
+    if( record->device != fw->deviceNumber )
+      continue;
+    if( held >= page * pageSize && held < ( page + 1 ) * pageSize )
+    {
+      JsonObject& entry = records.createNestedObject();
+      entry["Time"] = record->timestamp;
+      entry["From"] = record->filters >> 4;
+      entry["To"] = record->filters & 0x0F;
+      entry["Steps"] = record->steps;
+      entry["Direction"] = ( record->flags & JOURNAL_DIRN_CCW )? "CCW" : "CW";
+      entry["DurationMs"] = record->durationCs * 10;
+      entry["Backlash"] = record->backlash;
+      entry["ClientID"] = record->clientID;
+      entry["HalfStepSlew"] = ( record->flags & JOURNAL_HALF_SLEW ) != 0;
+      entry["EncoderCorrected"] = ( record->flags & JOURNAL_ENCODER_FIXED ) != 0;
+      entry["EncoderFault"] = ( record->flags & JOURNAL_ENCODER_FAULT ) != 0;
+    }
+    held++;
+    //note each filter pair once
+    for ( j=0; j < pairCount && pairs[j] != record->filters; j++ )
+      ;
+    if( j == pairCount )
+      pairs[pairCount++] = record->filters;
+  }
+  root["DeviceNumber"] = fw->deviceNumber;
+  root["Total"] = held;
+  root["Page"] = page;
+  root["PageSize"] = pageSize;
+
+  JsonArray& stats = root.createNestedArray("Pairs");
+  for ( i=0; i < pairCount; i++ )
+  {
+    count = journalDurations( (uint8_t) fw->deviceNumber, pairs[i], durations, JOURNAL_SIZE );
+    JsonObject& pair = stats.createNestedObject();
+    pair["From"] = pairs[i] >> 4;
+    pair["To"] = pairs[i] & 0x0F;
+    pair["Count"] = count;
+    pair["P50Ms"] = durations[ ( count - 1 ) * 50 / 100 ] * 10;
+    pair["P90Ms"] = durations[ ( count - 1 ) * 90 / 100 ] * 10;
+    pair["MaxMs"] = durations[ count - 1 ] * 10;
+  }
+  root.printTo(message);
+  server.send(200, "application/json", message);
+}
 
 //server.on("/FilterWheel/*/Hostname", HTTP_PUT, handleHostnamePut );
 void handleHostnamePut( void ) 
 {
   int i=0;
-  String form;
   String errMsg;
   int namesFoundCount = 0;
   String newName;
   
   debugURI( errMsg );
   DEBUGSL1 (errMsg);
-  DEBUGSL1( "Entered handleHostnamePut" );
+  DEBUGSL1( F("Entered handleHostnamePut") );
+  FilterWheel* fw = requestFilterWheel();
+  if( fw == NULL )
+    return;
   
   //throw error message
   if( server.hasArg("hostname"))
   {
     newName = server.arg("hostname");
-    DEBUGS1( "new hostname:" );DEBUGSL1( newName );
+    DEBUGS1( F("new hostname:") );DEBUGSL1( newName );
   }
   if( newName != NULL && newName.length() != 0 &&  newName.length() < MAX_NAME_LENGTH )
   {
     //save new hostname and cause reboot - requires eeprom read at setup to be in place.  
     strcpy( hostname, newName.c_str() );
-    server.send( 200, "text/html", "rebooting!" ); 
+    sendConfigResponse( fw, 200, F("Rebooting with new hostname") );
 
     //Write to EEprom
     saveToEeprom();
@@ -172,10 +598,9 @@ void handleHostnamePut( void )
   }
   else
   {
-    errMsg = "handleHostnamePut: Error handling new hostname";
+    errMsg = F("handleHostnamePut: Error handling new hostname");
     DEBUGSL1( errMsg );
-    form = setupFormBuilder( form, errMsg );
-    server.send( 200, "text/html", form ); 
+    sendConfigResponse( fw, 400, errMsg );
   }
 }
 
@@ -183,110 +608,48 @@ void handleHostnamePut( void )
 void handleFilterCountPut( void ) 
 {
   int i=0;
-  String form;
   String errMsg;
   int newfiltercount = 0;
   String newName;
+  FilterConfig cfg;
 
   debugURI( errMsg );
   DEBUGSL1 (errMsg);
-  DEBUGSL1( "Entered handlefiltercountPut" );
+  DEBUGSL1( F("Entered handlefiltercountPut") );
+  FilterWheel* fw = requestFilterWheel();
+  if( fw == NULL )
+    return;
   
   //throw error message
   if( server.hasArg("filtersPerWheel"))
   {
     newfiltercount = server.arg("filtersPerWheel").toInt();
-    DEBUGS1( "new filtercount:" );DEBUGSL1( newfiltercount );
+    DEBUGS1( F("new filtercount:") );DEBUGSL1( newfiltercount );
   }
 
- /*
- * if new filter count > old
- *  copy all the old into the new and add default names
- * if new filter count < old
- *  copy the reduced set of existing filter names in.
- * 
- */
-  if ( newfiltercount != filtersPerWheel && newfiltercount > 0 && newfiltercount < MAX_FILTER_COUNT )
+  if ( newfiltercount != fw->filtersPerWheel && newfiltercount > 0 && newfiltercount < MAX_FILTER_COUNT && 
+       stageFilterConfig( fw, &cfg, newfiltercount ) )
   {
-    DEBUGS1( "Re-sizing & re-allocating filter array" );DEBUGSL1( newfiltercount );
-    //Manage the filter names & memory allocation
-    char** newFilterNames = (char**) calloc( sizeof(char**), (size_t) newfiltercount );
-    int* newFilterOffsets = (int*) calloc( sizeof(int), (size_t) newfiltercount );
-    int* newFilterPositions = (int*) calloc( sizeof(int), (size_t) newfiltercount );
-    
-    if( newfiltercount < filtersPerWheel )
-    {
-      for ( i=0; i< newfiltercount; i++ ) //loop and copy the existing ones into the new array
-      {
-          newFilterNames[i] = (char*) calloc( sizeof( char ), (size_t) MAX_NAME_LENGTH );
-          memcpy ( newFilterNames[i], filterNames[i], MAX_NAME_LENGTH );
-          free ( filterNames[i] ); 
-          newFilterOffsets[i] = focusOffsets[i];          
-      }
-      //Clear down whats left
-      for ( ; i < filtersPerWheel; i++ )
-      {
-        filterNames[i] = NULL;
-        free ( filterNames );        
-      }
-    }
-    else //newfiltercount > old 
-    {
-      //replace the old
-      for ( i=0; i < filtersPerWheel; i++ ) //loop and copy the existing ones into the new array
-      {
-          newFilterNames[i] = (char*) calloc( sizeof( char ), MAX_NAME_LENGTH );
-          strcpy ( newFilterNames[i], filterNames[i] );
-          free ( filterNames[i] ); 
-          newFilterOffsets[i] = focusOffsets[i];          
-      }
-      //provide defaults for the additional
-      for( ; i< newfiltercount; i++ )
-      {
-          String temp = String("filter_");
-          temp.concat( String(i) );
-          
-          newFilterNames[i] = (char*) calloc( sizeof( char ), (size_t) MAX_NAME_LENGTH );
-          strcpy ( newFilterNames[i], temp.c_str() );
-          newFilterOffsets[i] = 0;          
-      }
-    }
-    
-    //Update positions
-    for ( i=0; i< newfiltercount; i++)
-    {
-      newFilterPositions[i] = i* stepsPerRevolution/newfiltercount;
-    }
-    
-    //Clear the old memory down
-    free( filterNames );
-    free( focusOffsets );
-    free( filterPositions );
-    
-    //update the globals 
-    filtersPerWheel = newfiltercount;
-    filterNames = newFilterNames;  
-    focusOffsets = newFilterOffsets;
-    filterPositions = newFilterPositions;//TODO
+    DEBUGS1( F("Re-sizing & re-allocating filter array") );DEBUGSL1( newfiltercount );
+    commitFilterConfig( fw, &cfg );
     
     //Write to EEprom
     saveToEeprom();
+    sendConfigResponse( fw, 200, "" );
   }
   else
   {
-    errMsg = "handlefiltercountPut: Error handling new filtercount";
+    errMsg = F("handlefiltercountPut: Error handling new filtercount");
     DEBUGSL1( errMsg );
-    form = setupFormBuilder( form, errMsg );
-    server.send( 200, "text/html", form ); 
+    sendConfigResponse( fw, 400, errMsg );
   }
-  DEBUGSL1( "Exiting handlefiltercountPut" );
+  DEBUGSL1( F("Exiting handlefiltercountPut") );
 }
 
 //  server.on("/FilterWheel/*/Wheelname", HTTP_PUT, handleNamePut );
 void handleNamePut( void) 
 {
   int i=0;
-  String form;
   String errMsg;
   int namesFoundCount = 0;
   String newName;
@@ -294,32 +657,33 @@ void handleNamePut( void)
   
   debugURI( errMsg );
   DEBUGSL1 (errMsg);
-  DEBUGSL1( "Entered handlewheelnamePut" );
+  DEBUGSL1( F("Entered handlewheelnamePut") );
+  FilterWheel* fw = requestFilterWheel();
+  if( fw == NULL )
+    return;
   
   if( server.hasArg("wheelname"))
   {
     newName = server.arg("wheelname");
-    DEBUGS1( "new wheelname:" );DEBUGSL1( newName );
+    DEBUGS1( F("new wheelname:") );DEBUGSL1( newName );
     if( newName != NULL && newName.length() != 0 &&  newName.length() < MAX_NAME_LENGTH )
     {
       //save new hostname and cause reboot - requires eeprom read at setup to be in place.  
-      strcpy( wheelName, newName.c_str() );
-      DEBUGS1( "new wheelname:" );DEBUGSL1( wheelName );
+      strcpy( fw->wheelName, newName.c_str() );
+      invalidateResponseCache( &fw->responseCache );
+      DEBUGS1( F("new wheelname:") );DEBUGSL1( fw->wheelName );
       //Write to EEprom
       saveToEeprom();
       
-      errMsg = "";
-      form = setupFormBuilder( form, errMsg );
-      server.send( 200, "text/html", form ); 
+      sendConfigResponse( fw, 200, "" );
       success = true;
     }
   }
   if ( !success ) 
   {
     DEBUGSL1( errMsg );
-    errMsg = "handlenamePut: Error handling new wheel name";
-    form = setupFormBuilder( form, errMsg );
-    server.send( 200, "text/html", form ); 
+    errMsg = F("handlenamePut: Error handling new wheel name");
+    sendConfigResponse( fw, 400, errMsg );
   }
   return;
 }
@@ -333,14 +697,16 @@ void handleFilterNamesPut(void)
   int i=0;
   const String nameStub = "filterName";
   String name;
-  String form;
   String localName;
   String errMsg;
   int namesFoundCount = 0;
   
   debugURI( errMsg );
   DEBUGSL1 (errMsg);
-  DEBUGSL1( "Entered handleFilterNamesPut");
+  DEBUGSL1( F("Entered handleFilterNamesPut"));
+  FilterWheel* fw = requestFilterWheel();
+  if( fw == NULL )
+    return;
   do
   {
     name = nameStub + i;
@@ -350,27 +716,29 @@ void handleFilterNamesPut(void)
       //I don't care if you call two filters the same... 
       if ( localName != NULL && localName.length() != 0 && localName.length() < MAX_NAME_LENGTH )
       {
-        memcpy( filterNames[i], localName.c_str(), localName.length() * sizeof(char)  );
+        strcpy( fw->filterNames[i], localName.c_str() );
         namesFoundCount++;
       }
     }  
-  }while ( i < filtersPerWheel );
+    i++;
+  }while ( i < fw->filtersPerWheel );
+  if( namesFoundCount > 0 )
+    invalidateResponseCache( &fw->responseCache );
   
-  if ( namesFoundCount != filtersPerWheel )
+  if ( namesFoundCount != fw->filtersPerWheel )
   {
     //throw error message
-    errMsg = "UpdateFilterNames:Not enough named filternames found in request body";
-    DEBUGSL1( "Not enough named filternames found");
-    form = setupFormBuilder( form, errMsg );
-    server.send( 200, "text/html", form );
+    errMsg = F("UpdateFilterNames:Not enough named filternames found in request body");
+    DEBUGSL1( F("Not enough named filternames found"));
+    sendConfigResponse( fw, 400, errMsg );
   }
   else
   {
-    errMsg = String("");
-    form = setupFormBuilder( form, errMsg );
-    server.send( 200, "text/html", form );
+    //Write to EEprom
+    saveToEeprom();
+    sendConfigResponse( fw, 200, "" );
   }
-  DEBUGSL1( "Exited handleFilterNamesPut");
+  DEBUGSL1( F("Exited handleFilterNamesPut"));
   return;
 }
 
@@ -380,14 +748,16 @@ void handleFocusOffsetsPut(void)
   const String nameStub = "filterOffset";
   String name;
   String errMsg;
-  String form;
   int namesFoundCount = 0;
   int localOffset = 0;
   
   debugURI(errMsg);
   DEBUGSL1 (errMsg);
-  DEBUGSL1( "Entered handleOffsetsPut" );
-  for ( i= 0; i< filtersPerWheel; i++ )
+  DEBUGSL1( F("Entered handleOffsetsPut") );
+  FilterWheel* fw = requestFilterWheel();
+  if( fw == NULL )
+    return;
+  for ( i= 0; i< fw->filtersPerWheel; i++ )
   {
     name = nameStub + i;
     if( server.hasArg(name) )
@@ -395,144 +765,29 @@ void handleFocusOffsetsPut(void)
       localOffset = server.arg(name).toInt();
       if ( localOffset < stepsPerRevolution && localOffset >= 0 )
       {
-        focusOffsets[i] = localOffset;
+        fw->focusOffsets[i] = localOffset;
         namesFoundCount++;
       }
     }  
   }
+  if( namesFoundCount > 0 )
+    invalidateResponseCache( &fw->responseCache );
   
-  if ( namesFoundCount != filtersPerWheel )
+  if ( namesFoundCount != fw->filtersPerWheel )
   {
     //throw error message
-    String errMsg = "Update filter names:Not enough filter offsets found in request body";
-    DEBUGSL1( "Update filter names:Not enough named filter offsets found");
-    form = setupFormBuilder( form, errMsg );
-    server.send( 200, "text/html", form );
+    String errMsg = F("Update filter names:Not enough filter offsets found in request body");
+    DEBUGSL1( F("Update filter names:Not enough named filter offsets found"));
+    sendConfigResponse( fw, 400, errMsg );
   }
   else
   {
-    errMsg = String("");
-    form = setupFormBuilder( form, errMsg );  
-    server.send( 200, "text/html", form );
+    //Write to EEprom
+    saveToEeprom();
+    sendConfigResponse( fw, 200, "" );
   }
-  DEBUGSL1( "Exited handleFilteroffsetsPut");
+  DEBUGSL1( F("Exited handleFilteroffsetsPut"));
   return;
 }
 
-/*
- * Handler for setup dialog - issue call to <hostname>/setup and receive a webpage
- * Fill in form and submit and handler for each form button will store the variables and return the same page.
- optimise to something like this:
- https://circuits4you.com/2018/02/04/esp8266-ajax-update-part-of-web-page-without-refreshing/
- Bear in mind HTML standard doesn't support use of PUT in forms and changes it to GET so arguments get sent in plain sight as 
- part of the URL.
- */
-String& setupFormBuilder( String& htmlForm, String& errMsg )
-{
-  int i=0;
-  
-  htmlForm = "<html><head></head><meta></meta><body>\n";
-  if( errMsg != NULL && errMsg.length() > 0 ) 
-  {
-    htmlForm +="<div class=\"errorHeader\" bgcolor='A02222'><b>";
-    htmlForm.concat( errMsg );
-    htmlForm += "</b></div>";
-  }
-  //Hostname
-  htmlForm += "<h1> Enter new hostname for filter wheel</h1>\n";
-  htmlForm += "<form action=\"http://";
-  htmlForm.concat( hostname );
-  htmlForm += "/filterwheel/0/Hostname\" method=\"PUT\" id=\"hostname\" >\n";
-  htmlForm += "Changing the hostname will cause the filter to reboot and may change the address!\n<br>";
-  htmlForm += "<input type=\"text\" name=\"hostname\" value=\"";
-  htmlForm.concat( hostname );
-  htmlForm += "\">\n";
-  htmlForm += "<input type=\"submit\" value=\"submit\">\n</form>\n";
-  
-  //Wheelname
-  htmlForm += "<h1> Enter new descriptive name for filter wheel</h1>\n";
-  htmlForm += "<form action=\"http://";
-  htmlForm.concat( wheelName );
-  htmlForm += "/filterwheel/0/Wheelname\" method=\"PUT\" id=\"wheelname\" >\n";
-  htmlForm += "<input type=\"text\" name=\"wheelname\" value=\"";
-  htmlForm.concat( wheelName );
-  htmlForm += "\">\n";
-  htmlForm += "<input type=\"submit\" value=\"submit\">\n</form>\n";
-  
-  //Number of filters
-  htmlForm += "<h1> Enter number of filters in wheel</h1>\n";
-  htmlForm += "<form action=\"http://";
-  htmlForm.concat(hostname);
-  htmlForm += "/filterwheel/0/FilterCount\" method=\"PUT\" id=\"filtercount\" >\n";
-  htmlForm += "<input type=\"text\" name=\"filtersPerWheel\" value=\"";
-  htmlForm.concat( filtersPerWheel );
-  htmlForm += "\">\n";
-  htmlForm += "<input type=\"submit\" value=\"submit\">\n</form>\n";
-  
-  //Filter names by position
-  htmlForm += "<h1> Enter filter name for each filter </h1>\n";
-  htmlForm += "<form action=\"http://";
-  htmlForm.concat(hostname);
-  htmlForm += "/filterwheel/0/FilterNames\" method=\"PUT\" id=\"filternames\" >\n";
-  htmlForm += "<ol>\n";
-  for ( i=0; i< filtersPerWheel; i++ )
-  {
-    htmlForm += "<li>Filter name <input type=\"text\" name=\"filtername_";
-    htmlForm.concat( i);
-    htmlForm += "\" value=\"" + String(filterNames[i]) + "\"></li>\n";
-  }
-  htmlForm += "</ol>\n";
-  htmlForm += "<input type=\"submit\" value=\"submit\">\n</form>\n";
-  
-  //Filter focus offsets by position
-  htmlForm += "<h1> Enter focuser offset for each filter </h1>\n";
-  htmlForm += "<form action=\"http://";
-  htmlForm.concat(hostname);
-  htmlForm += "/filterwheel/0/FocusOffsets\" method=\"PUT\" id=\"offsets\">\n";
-  htmlForm += "<ol>\n";
-  for ( i=0; i< filtersPerWheel; i++ )
-  {
-    htmlForm += "<li> Filter <input type=\"text\" name=\"focusoffset_";
-    htmlForm.concat(i);
-    htmlForm += "\" value=\"";
-    htmlForm.concat( focusOffsets[i] );
-    htmlForm += "\"></li>\n";
-  }
-  htmlForm += "</ol>\n";
-  htmlForm += "<input type=\"submit\" value=\"submit\">\n</form>\n";
-  htmlForm += "</body>\n</html>\n";
-
-/*  source html used.
-<html>
-<head></head>
-<meta></meta>
-<body>
-<h1> Enter filter Name for each filter </h1>
-<form action="ESPFwl01/Names" id="Names">
-<ol>
-<li>Filter Name <input type="text" name="filterName0" value="L" ></li>
-<li>Filter Name <input type="text" name="filterName1" value="B" ></li>
-<li>Filter Name <input type="text" name="filterName2" value="G" ></li>
-<li>Filter Name <input type="text" name="filterName3" value="R" ></li>
-<li>Filter Name <input type="text" name="filterName4" value="C" ></li>
-</ol>
-<input type="submit" value="submit" >
-</form>
-
-<h1> Enter focus offset for each filter </h1>
-<form action="ESPFwl01/Offsets" id="Offsets">
-<ol>
-<li>Filter Offset <input type="number" name="filterOffset0" value="0" min="0" max="2048"></li>
-<li>Filter Offset <input type="number" name="filterOffset1" value=20 min="0" max="2048" > </li>
-<li>Filter Offset <input type="number" name="filterOffset2" value=2048*2/5 min="0" max="2048" ></li>
-<li>Filter Offset <input type="number" name="filterOffset3" value=2048*3/5 min="0" max="2048" ></li>
-<li>Filter Offset <input type="number" name="filterOffset4" value=2048*4/5 min="0" max="2048"  ></li>
-</ol>
-<input type="submit" value="submit">
-</form>
-</body>
-</html>
-*/
- return htmlForm;
-}
 #endif
@@ -0,0 +1,79 @@
+/*
+File to be included into relevant device REST setup
+ALPACA management API - describes this server and the devices configured on it.
+*/
+//Assumes Use of ARDUINO ESP8266WebServer for entry handlers
+#if !defined _ASCOMAPI_Management
+#define _ASCOMAPI_Management
+#include "JSONHelperFunctions.h"
+
+//GET /management/apiversions Supported Alpaca API versions
+void handleAPIversions(void);
+//GET /management/v1/description Summary information about this device server
+void handleAPIDescription(void);
+//GET /management/v1/configureddevices The devices available on this server, built from the filter wheel registry
+void handleAPIconfiguredDevices(void);
+
+void handleAPIversions(void)
+{
+    String message;
+    uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
+    uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    //JSON data formatter
+    DynamicJsonBuffer jsonBuffer(256);
+    JsonObject& root = jsonBuffer.createObject();
+    alpacaResponseBuilder( root, clientID, transID, F("apiversions"), 0, "" );
+    JsonArray& versions = root.createNestedArray("Value");
+    versions.add( 1 );
+    root.printTo(message);
+    server.send(200, "application/json", message);
+    return;
+}
+
+void handleAPIDescription(void)
+{
+    String message;
+    uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
+    uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    //JSON data formatter
+    DynamicJsonBuffer jsonBuffer(256);
+    JsonObject& root = jsonBuffer.createObject();
+    alpacaResponseBuilder( root, clientID, transID, F("description"), 0, "" );
+    JsonObject& value = root.createNestedObject("Value");
+    value["ServerName"] = hostname;
+    value["Manufacturer"] = F("Skybadger");
+    value["ManufacturerVersion"] = FPSTR( DriverVersion );
+    value["Location"] = "";
+    root.printTo(message);
+    server.send(200, "application/json", message);
+    return;
+}
+
+void handleAPIconfiguredDevices(void)
+{
+    String message;
+    int i=0;
+    char uniqueID[MAX_NAME_LENGTH];
+    uint32_t clientID = (uint32_t)server.arg("ClientID").toInt();
+    uint32_t transID = (uint32_t)server.arg("ClientTransactionID").toInt();
+    //JSON data formatter
+    DynamicJsonBuffer jsonBuffer(256 * FILTERWHEEL_COUNT);
+    JsonObject& root = jsonBuffer.createObject();
+    alpacaResponseBuilder( root, clientID, transID, F("configureddevices"), 0, "" );
+    JsonArray& devices = root.createNestedArray("Value");
+    for ( i=0; i < FILTERWHEEL_COUNT; i++ )
+    {
+      FilterWheel* fw = &filterWheels[i];
+      JsonObject& device = devices.createNestedObject();
+      //Unique per chip and device number
+      snprintf( uniqueID, MAX_NAME_LENGTH, "%08X-fwl-%d", ESP.getChipId(), fw->deviceNumber );
+      device["DeviceName"] = fw->wheelName;
+      device["DeviceType"] = "FilterWheel";
+      device["DeviceNumber"] = fw->deviceNumber;
+      device["UniqueID"] = jsonBuffer.strdup( uniqueID );
+    }
+    root.printTo(message);
+    server.send(200, "application/json", message);
+    return;
+}
+#endif
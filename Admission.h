@@ -0,0 +1,90 @@
+/*
+ Per-client rate limiting for the REST handlers.
+ Each ClientID gets a token bucket - a burst of ADMISSION_BURST requests, refilled at one token every ADMISSION_REFILL_MS.
+ Requests over the limit are turned away with a short 429 before any JSON is built, so a client polling hard
+ costs little. This is rate limiting only - requests are still served in the order they arrive, nothing is reordered.
+ Requests from a wheel's connected client are exempt, so the controlling client is never turned away by its own polling.
+ Buckets are kept in a small table, the least recently seen client is dropped when it is full.
+*/
+#if !defined _ADMISSION_H_
+#define _ADMISSION_H_
+
+const int ADMISSION_CLIENT_SLOTS = 8;
+const int ADMISSION_BURST = 10;
+const int ADMISSION_REFILL_MS = 100; //10 requests/sec sustained per client
+
+struct ClientBucket
+{
+  bool inUse;
+  uint32_t clientID;
+  uint16_t tokens;
+  uint32_t lastRefill;
+  uint32_t lastSeen;
+};
+ClientBucket clientBuckets[ADMISSION_CLIENT_SLOTS];
+
+uint32_t admittedCount = 0;
+uint32_t exemptCount = 0;
+uint32_t rejectedCount = 0;
+
+ClientBucket* findClientBucket( uint32_t clientID, uint32_t now );
+bool admitRequest( uint32_t clientID, bool exempt );
+
+ClientBucket* findClientBucket( uint32_t clientID, uint32_t now )
+{
+  ClientBucket* oldest = &clientBuckets[0];
+  int i=0;
+
+  for ( i=0; i < ADMISSION_CLIENT_SLOTS; i++ )
+  {
+    if( clientBuckets[i].inUse && clientBuckets[i].clientID == clientID )
+      return &clientBuckets[i];
+    if( !clientBuckets[i].inUse )
+      oldest = &clientBuckets[i];
+    else if( oldest->inUse && ( now - clientBuckets[i].lastSeen ) > ( now - oldest->lastSeen ) )
+      oldest = &clientBuckets[i];
+  }
+
+  //New client - take a free slot or the least recently seen one
+  oldest->inUse = true;
+  oldest->clientID = clientID;
+  oldest->tokens = ADMISSION_BURST;
+  oldest->lastRefill = now;
+  return oldest;
+}
+
+/*
+ * Returns true if the request from clientID may be handled.
+ * exempt is set for requests from the connected client, which aren't limited.
+ */
+bool admitRequest( uint32_t clientID, bool exempt )
+{
+  uint32_t now = millis();
+  uint32_t refill = 0;
+  ClientBucket* bucket = NULL;
+
+  if( exempt )
+  {
+    exemptCount++;
+    return true;
+  }
+
+  bucket = findClientBucket( clientID, now );
+  bucket->lastSeen = now;
+  refill = ( now - bucket->lastRefill ) / ADMISSION_REFILL_MS;
+  if( refill > 0 )
+  {
+    bucket->tokens = min( (uint32_t) ADMISSION_BURST, bucket->tokens + refill );
+    bucket->lastRefill += refill * ADMISSION_REFILL_MS;
+  }
+
+  if( bucket->tokens == 0 )
+  {
+    rejectedCount++;
+    return false;
+  }
+  bucket->tokens--;
+  admittedCount++;
+  return true;
+}
+#endif
@@ -0,0 +1,269 @@
+/*
+ Compact binary control protocol on BINARY_PROTOCOL_PORT, TCP and UDP, alongside the REST API.
+ For scripted sequencing where HTTP and JSON round trips dominate the filter changeover time.
+ Every request and reply is one 14 byte little-endian BinaryFrame. Commands go through the same command layer
+ ( FWCommands.h ) as the REST handlers, so the ASCOM client lock applies - connect with CMD_CONNECT first.
+ A client that set a position is sent a CMD_MOVE_COMPLETE frame, on the same connection or to the same UDP address,
+ when that move ends.
+
+ Commands                value in request        value in reply
+ CMD_GET_POSITION        -                       current filter, -1 while changing
+ CMD_SET_POSITION        filter                  requested filter
+ CMD_GET_STATE           -                       current filter, flags set
+ CMD_CONNECT             1 connect, 0 disconnect 1 if connected
+ CMD_ECHO                any                     the same value, device not checked
+ CMD_MOVE_COMPLETE       ( server to client )    current filter, flags set
+ Replies echo the command, device, ClientID and TransactionID. error is the ASCOM error number.
+ CMD_ECHO does no work, so a client timing it sees the network and the radio - the first echo after an idle spell
+ includes the radio waking from the power profile's sleep ( test/wake_latency.py ).
+*/
+#if !defined _BINARYPROTOCOL_H_
+#define _BINARYPROTOCOL_H_
+
+const uint16_t BINARY_PROTOCOL_PORT = 4030;
+const int BINARY_MAX_CLIENTS = 2;
+const uint8_t BINARY_MAGIC = 0xFB;
+
+enum binaryCommands { CMD_GET_POSITION = 1, CMD_SET_POSITION = 2, CMD_GET_STATE = 3, CMD_CONNECT = 4, CMD_ECHO = 5, CMD_MOVE_COMPLETE = 0x81 };
+
+//Reply flags
+#define BINARY_FLAG_MOVING         0x01
+#define BINARY_FLAG_CONNECTED      0x02
+#define BINARY_FLAG_ENCODER_FAULT  0x04
+#define BINARY_FLAG_UPDATING       0x08
+
+struct __attribute__((packed)) BinaryFrame
+{
+  uint8_t  magic;
+  uint8_t  command;
+  uint8_t  device;
+  uint8_t  flags;
+  uint32_t clientID;
+  uint16_t transID;
+  int16_t  value;
+  uint16_t error;
+};
+
+struct BinaryClient
+{
+  WiFiClient client;
+  uint8_t rxBuffer[ sizeof( BinaryFrame ) ];
+  int rxCount;
+  uint8_t notifyMask;   //devices with a move this client asked for
+};
+
+//UDP sender waiting for each wheel's move to complete
+struct BinaryUdpNotify
+{
+  bool pending;
+  IPAddress address;
+  uint16_t port;
+  uint32_t clientID;
+  uint16_t transID;
+};
+
+WiFiServer binaryServer( BINARY_PROTOCOL_PORT );
+WiFiUDP binaryUdp;
+BinaryClient binaryClients[BINARY_MAX_CLIENTS];
+BinaryUdpNotify binaryUdpNotify[FILTERWHEEL_COUNT];
+uint32_t binaryFrames = 0;
+
+void beginBinaryProtocol( void );
+void handleBinaryProtocol( void );
+bool executeBinaryFrame( BinaryFrame* request, BinaryFrame* reply );
+uint8_t binaryFlags( FilterWheel* fw );
+void notifyMoveComplete( FilterWheel* fw );
+
+void beginBinaryProtocol( void )
+{
+  int i=0;
+  for ( i=0; i < BINARY_MAX_CLIENTS; i++ )
+  {
+    binaryClients[i].rxCount = 0;
+    binaryClients[i].notifyMask = 0;
+  }
+  for ( i=0; i < FILTERWHEEL_COUNT; i++ )
+    binaryUdpNotify[i].pending = false;
+  binaryServer.begin();
+  binaryServer.setNoDelay( true );
+  binaryUdp.begin( BINARY_PROTOCOL_PORT );
+}
+
+uint8_t binaryFlags( FilterWheel* fw )
+{
+  uint8_t flags = 0;
+  if( fw->motion.isMoving() || fw->targetFilterId != fw->currentFilterId || focuserBusy( &fw->focuser ) )
+    flags |= BINARY_FLAG_MOVING;
+  if( fw->connected )
+    flags |= BINARY_FLAG_CONNECTED;
+  if( fw->encoder.fault )
+    flags |= BINARY_FLAG_ENCODER_FAULT;
+  if( isUpdating() )
+    flags |= BINARY_FLAG_UPDATING;
+  return flags;
+}
+
+/*
+ * Run one request and fill in the reply.
+ * Returns true if the request started a move the sender should be told about when it ends.
+ */
+bool executeBinaryFrame( BinaryFrame* request, BinaryFrame* reply )
+{
+  FilterWheel* fw = getFilterWheel( request->device );
+  PGM_P errMsg = PSTR("");
+  int filterId = 0;
+  bool moveStarted = false;
+
+  binaryFrames++;
+  *reply = *request;
+  reply->flags = 0;
+  reply->error = 0;
+  if( request->command == CMD_ECHO )
+  {
+    if( fw != NULL )
+      reply->flags = binaryFlags( fw );
+    return false;
+  }
+  if( fw == NULL )
+  {
+    reply->error = 0x400;
+    return false;
+  }
+
+  switch( request->command )
+  {
+    case CMD_GET_POSITION:
+      reply->error = fwGetPosition( fw, &filterId, &errMsg );
+      reply->value = filterId;
+      break;
+    case CMD_SET_POSITION:
+      reply->error = fwSetPosition( fw, request->clientID, request->value, &errMsg );
+      moveStarted = ( reply->error == 0 && fw->targetFilterId != fw->currentFilterId );
+      break;
+    case CMD_GET_STATE:
+      reply->error = fwGetPosition( fw, &filterId, &errMsg );
+      reply->value = filterId;
+      break;
+    case CMD_CONNECT:
+      reply->error = fwSetConnected( fw, request->clientID, request->value != 0, &errMsg );
+      reply->value = fw->connected;
+      break;
+    default:
+      reply->error = 0x400; //Not implemented
+      break;
+  }
+  reply->flags = binaryFlags( fw );
+  return moveStarted;
+}
+
+/*
+ * Service the binary protocol - called each time round the loop.
+ * Accepts new connections, then answers complete frames from each TCP client and any waiting UDP datagram.
+ */
+void handleBinaryProtocol( void )
+{
+  BinaryFrame request;
+  BinaryFrame reply;
+  BinaryClient* bc = NULL;
+  WiFiClient newClient;
+  int available = 0;
+  int i=0;
+
+  if( binaryServer.hasClient() )
+  {
+    newClient = binaryServer.available();
+    for ( i=0; i < BINARY_MAX_CLIENTS && binaryClients[i].client.connected(); i++ )
+      ;
+    if( i < BINARY_MAX_CLIENTS )
+    {
+      binaryClients[i].client = newClient;
+      binaryClients[i].client.setNoDelay( true );
+      binaryClients[i].rxCount = 0;
+      binaryClients[i].notifyMask = 0;
+    }
+    else
+      newClient.stop(); //No free slots
+  }
+
+  for ( i=0; i < BINARY_MAX_CLIENTS; i++ )
+  {
+    bc = &binaryClients[i];
+    if( !bc->client.connected() )
+      continue;
+    while( ( available = bc->client.available() ) > 0 )
+    {
+      bc->rxCount += bc->client.read( &bc->rxBuffer[bc->rxCount], min( available, (int) sizeof( BinaryFrame ) - bc->rxCount ) );
+      if( bc->rxCount < (int) sizeof( BinaryFrame ) )
+        break;
+      bc->rxCount = 0;
+      memcpy( &request, bc->rxBuffer, sizeof( BinaryFrame ) );
+      if( request.magic != BINARY_MAGIC )
+      {
+        bc->client.stop(); //Out of step - the client has to reconnect
+        break;
+      }
+      if( executeBinaryFrame( &request, &reply ) )
+        bc->notifyMask |= ( 1 << request.device );
+      bc->client.write( (const uint8_t*) &reply, sizeof( BinaryFrame ) );
+    }
+  }
+
+  if( binaryUdp.parsePacket() == sizeof( BinaryFrame ) )
+  {
+    binaryUdp.read( (uint8_t*) &request, sizeof( BinaryFrame ) );
+    if( request.magic == BINARY_MAGIC )
+    {
+      if( executeBinaryFrame( &request, &reply ) )
+      {
+        BinaryUdpNotify* notify = &binaryUdpNotify[request.device];
+        notify->pending = true;
+        notify->address = binaryUdp.remoteIP();
+        notify->port = binaryUdp.remotePort();
+        notify->clientID = request.clientID;
+        notify->transID = request.transID;
+      }
+      binaryUdp.beginPacket( binaryUdp.remoteIP(), binaryUdp.remotePort() );
+      binaryUdp.write( (const uint8_t*) &reply, sizeof( BinaryFrame ) );
+      binaryUdp.endPacket();
+    }
+  }
+}
+
+//Tell the binary clients waiting on this wheel that its move has ended
+void notifyMoveComplete( FilterWheel* fw )
+{
+  BinaryFrame frame;
+  BinaryUdpNotify* notify = &binaryUdpNotify[fw->deviceNumber];
+  uint8_t mask = ( 1 << fw->deviceNumber );
+  int i=0;
+
+  frame.magic = BINARY_MAGIC;
+  frame.command = CMD_MOVE_COMPLETE;
+  frame.device = (uint8_t) fw->deviceNumber;
+  frame.flags = binaryFlags( fw );
+  frame.value = fw->currentFilterId;
+  frame.error = ( fw->encoder.fault )? 0x500 : 0;
+
+  for ( i=0; i < BINARY_MAX_CLIENTS; i++ )
+  {
+    if( ( binaryClients[i].notifyMask & mask ) == 0 )
+      continue;
+    binaryClients[i].notifyMask &= ~mask;
+    if( !binaryClients[i].client.connected() )
+      continue;
+    frame.clientID = fw->requestClientID;
+    frame.transID = 0;
+    binaryClients[i].client.write( (const uint8_t*) &frame, sizeof( BinaryFrame ) );
+  }
+
+  if( notify->pending )
+  {
+    notify->pending = false;
+    frame.clientID = notify->clientID;
+    frame.transID = notify->transID;
+    binaryUdp.beginPacket( notify->address, notify->port );
+    binaryUdp.write( (const uint8_t*) &frame, sizeof( BinaryFrame ) );
+    binaryUdp.endPacket();
+  }
+}
+#endif
@@ -4,7 +4,7 @@
    in order to provide a user button-interface through the i2c expander chip. 
    AS of 22/ Feb 2019 this now implements the ASCOM REST api for a filterwheel natively and adds a 
    user setup html page which ASCOM doesn't provide unless you use a native asCOM driver as initial setup. 
-   Specified filterWheel default ID as zero since we will only ever handle the one filterwheel for this hostname/address. 
+   Each stepper/pin set is registered as a separate filterwheel device number ( see FWDevice.h ), all served by the one web server. 
    For testing, bear in mind that while browsers can't provide a manual put action, neither can curl 
    run from the windows command-line without wrapping the arguments in quotes due to windows interpreting the "&" character as an additional command. 
    Enable the debug http core setting in arduino instead to get access to all the inline request args as debug output.
@@ -26,7 +26,7 @@ To test:
  
 Dependencies
 Arduino JSON library 5.13 ( moving to 6 is a big change) 
-Expressif ESP8266 board library for arduino - configured for v2.5
+Expressif ESP8266 board library for arduino - configured for v2.5, v2.6 or later needed for UriBraces device number routing
 ESP8266WebServer
 
 ESP8266-12 Huzzah
@@ -65,31 +65,57 @@ Clients and drivers must expect incoming API parameter keys to have any casing.
 #include "DebugSerial.h"
 
 //Manage different pinout variants of the ESP8266
+#define NO_PIN -1
 #define __ESP8266_12
 #ifdef __ESP8266_12
+#define FILTERWHEEL_COUNT 2
 #define DIRN_PIN 4
 #define STEP_PIN 5
 #define ENABLE_PIN 2
-#define HALF_STEP_PIN 7
+//Second wheel's stepper controller - pins not shared with the buttons
+#define DIRN_PIN_1 12
+#define STEP_PIN_1 16
+//GPIO0 ( and GPIO2, wheel 0's enable ) are boot strap pins and must be high at reset or the ESP8266 boots into the
+//flash loader. No other GPIO is free, so they carry the active low enables, which are high - drivers off - at boot.
+//Each needs a 10k pull-up to 3.3V, and the driver's EN input must not pull it low: the A4988 and DRV8825 carriers
+//pull EN low by default, take that resistor off or buffer the line.
+#define ENABLE_PIN_1 0
+#define HALF_STEP_PIN_1 NO_PIN
+//GPIO6-11 drive the SPI flash and must never be used. No other GPIO is free, so wheel 0 steps in full steps only -
+//wire the driver's half step line here if a pin is freed up ( e.g. GPIO1 without debug serial ). Adaptive half stepping
+//needs that hardware change, see the readme.
+#define HALF_STEP_PIN NO_PIN
+#define ENCODER_PIN 3             //Wheel 0 only
+#define ENCODER_COUNTS_PER_REV 0  //Slots on the encoder disc, 0 if no encoder is fitted
 #define BUTN_A_PIN 13
 #define BUTN_B_PIN 14
 #define BUTN_C_PIN 15
 #else // __ESP8266_01
+#define FILTERWHEEL_COUNT 1
 #define DIRN_PIN 2
 #define STEP_PIN 3
+#define ENABLE_PIN 0
+#define HALF_STEP_PIN NO_PIN
+#define ENCODER_PIN NO_PIN
+#define ENCODER_COUNTS_PER_REV 0
 #endif
 
-//Define direction constants 
-#define DIRN_CW 0
-#define DIRN_CCW 1
+//Direction and step mode constants, motion planning
+#include "MotionEngine.h"
+
+//Binary TCP/UDP control protocol alongside the REST API - comment out to serve REST only
+#define BINARY_PROTOCOL
 
 #include <Esp.h> //used for restart
 #include <ESP8266WiFi.h>
 #include <ESP8266WiFiAP.h>
 #include <ESP8266WiFiGeneric.h>
+//Non-blocking TCP client for the focus offset link - https://github.com/me-no-dev/ESPAsyncTCP
+#include <ESPAsyncTCP.h>
 //https://links2004.github.io/Arduino/d3/d58/class_e_s_p8266_web_server.html
 #include <ESP8266WebServer.h>
-#include <ESP8266HTTPUpdateServer.h>
+#include <uri/UriBraces.h>
+#include <Updater.h>
 #include <ArduinoJson.h>
 #include <EEPROM.h>
 #include <EEPROMAnything.h>
@@ -119,14 +145,13 @@ char* hostname = NULL;
 char* thisID = NULL;
 
 //ASCOM variables 
-unsigned int transactionId;
-unsigned int connectedClient = -1;
-bool connected = false;
-const String DriverName = "Skybadger.ESPFilterWheel";
-const String DriverVersion = "0.0.1";
-const String DriverInfo = "Skybadger.ESPFilterWheel RESTful native device. ";
-const String Description = "Skybadger ESP2866-based wireless ASCOM filter wheel";
-const String InterfaceVersion = "2";
+unsigned int transactionId = 0;
+//Constant text is kept in flash - read it with FPSTR()
+const char DriverName[] PROGMEM = "Skybadger.ESPFilterWheel";
+const char DriverVersion[] PROGMEM = "0.0.1";
+const char DriverInfo[] PROGMEM = "Skybadger.ESPFilterWheel RESTful native device. ";
+const char Description[] PROGMEM = "Skybadger ESP2866-based wireless ASCOM filter wheel";
+const char InterfaceVersion[] PROGMEM = "2";
 
 //States to move through - when this is moved to a state machine
 enum filterDriverStates { FILTER_IDLE, FILTER_MOVING, FILTER_BL_PRE, FILTER_BL_POST, FILTER_ERR };
@@ -135,61 +160,81 @@ int filterState = FILTER_IDLE;
 //Filterwheel filter information
 const int FilterNameLengthLimit = MAX_NAME_LENGTH;
 const int defaultFiltersPerWheel = 5;
-const int stepsPerRevolution = 2048; //Determined by hardware
-
-int targetFilterId = 0; //next requested position - updated into current when we get there
-int currentFilterId = 0;
-int targetDistance = 0;
-int filtersPerWheel = defaultFiltersPerWheel; 
-int newfiltersPerWheel = 0; //used when the number of filters is updated. 
-int defaultFilterPositions[defaultFiltersPerWheel] = { 0, stepsPerRevolution/5, stepsPerRevolution*2/5, stepsPerRevolution*3/5, stepsPerRevolution*4/5 };
-int*   filterPositions = NULL;
-int*   focusOffsets    = NULL;
-char*  wheelName       = NULL;
-char** filterNames     = NULL ;
+const int stepsPerRevolution = 2048; //Full steps, determined by hardware. Filter positions are in full steps.
+const int microstepsPerRevolution = stepsPerRevolution * MICROSTEPS_PER_STEP;
+const int defaultApproachSteps = 8;  //full steps from the target to finish in half steps
+const int stepIntervalMs = 10;       //default, with an encoder fitted the wheel can be run faster
+const int minStepIntervalMs = 1;
+const int maxStepIntervalMs = 50;
+const int maxBacklashSteps = 100;    //full steps of slack taken up when the wheel turns round
 
 //Go to target, wind out in a single direction and then wind back in to target once complete so always approach from a single direction
-bool backlashEnabled = false;
 enum backlashStates { WINDING_OUT, WINDING_IN }; 
  
 //Basic stepper info - update based on your stepper and number of filters. 
-// Assumes filters are evenly spaced.
-int stepPosition  = 0;
-int backlash = 25;
-int stepDirn = DIRN_CW;
-volatile int stepFlag = 0;
-volatile boolean newButtonFlag = 0;
-bool isMoving = false;
-volatile int t2Flag = 0;
+// Assumes filters are evenly spaced. Per-wheel position and motion state lives in FWDevice.h
 int16_t home = 0;
+uint32_t buttonEvents = 0;
+uint32_t timeoutEvents = 0;
 
 // Create an instance of the server
 // specify the port to listen on as an argument
 ESP8266WebServer server(80);
-ESP8266HTTPUpdateServer updater;
 
 //Hardware device system functions - reset/restart etc
 EspClass device;
-ETSTimer timer;
 ETSTimer timoutTimer;
 
+//Interrupt and timer events to the loop
+#include "EventQueue.h"
+//Stepper motion engine and its GPIO driver
+#include "GpioStepper.h"
+//Closed loop position check from the GPIO3 encoder
+#include "WheelEncoder.h"
+//Move history
+#include "MoveJournal.h"
+//Static RAM and heap headroom
+#include "RamReport.h"
+//WiFi sleep modes
+#include "PowerProfile.h"
+//Per-device state and the registry of filter wheels served here
+#include "Admission.h"
+#include "ReplayCache.h"
+#include "ResponseCache.h"
+//Focus offsets applied on an Alpaca focuser during filter changes
+#include "FocuserLink.h"
+#include "FWDevice.h"
+//Firmware update with SHA-256 verification
+#include "FWUpdate.h"
+//Device commands shared by the REST and binary handlers
+#include "FWCommands.h"
+#if defined BINARY_PROTOCOL
+#include <WiFiUdp.h>
+#include "BinaryProtocol.h"
+#endif
+
 //local functions
-void onTimer(void);
-void onTimeoutTimer(void);
-void backlashCompensate(void);
-void enableStepper( boolean );
-void step( void);
+void onTimeoutTimer( void* pArg );
+void pulseCounter( void );
+void processEvents( void );
+void updateFilterWheel( FilterWheel* fw );
+void startMove( FilterWheel* fw, int fromId, int toId, uint32_t clientID );
+void endMove( FilterWheel* fw, int encoderCheck );
+void changeComplete( FilterWheel* fw );
 void setup(void);
 void setDefaults(void);
-void updateStepDirection(bool direction); //false = 0 = reverse, true = forward = 1
 
 //Declarations - web handlers
 // REST URL handling
 #include "FWEeprom.h"
 //Device Driver common functions
 #include "ASCOMAPICommon_rest.h"
+//Pre-gzipped setup page
+#include "SetupPage.h"
 //ASCOM Filterwheel REST API specific functions
-#include "ASCOMAPIfilterwheel_rest.h"
+#include "ASCOMAPIFilterwheel_rest.h"
+//ASCOM Alpaca management API
+#include "ASCOMAPIManagement_rest.h"
 
 //others
 void handleRootReset(void);
@@ -202,295 +247,332 @@ void setup_wifi()
   WiFi.mode(WIFI_STA);
   WiFi.hostname(hostname);
   WiFi.begin( ssid1, password1 );
-  Serial.print("Connecting");
+  Serial.print(F("Connecting"));
   while (WiFi.status() != WL_CONNECTED) 
   {
     delay(500);//Thisdelay is essentially for the DHCP response. Shouldn't be required for static config.
-    Serial.print(".");
+    Serial.print(F("."));
     if ( zz++ > 400 )
        device.restart();
   }
     //WiFi.setDNS( badgerDNS, gatewayDNS );
-  Serial.println("WiFi connected");
-  Serial.printf("SSID: %s, Signal strength %i dBm \n\r", WiFi.SSID().c_str(), WiFi.RSSI() );
-  Serial.printf("Hostname: %s\n\r",       WiFi.hostname().c_str() );
-  Serial.printf("IP address: %s\n\r",     WiFi.localIP().toString().c_str() );
-  Serial.printf("DNS address 0: %s\n\r",  WiFi.dnsIP(0).toString().c_str() );
-  Serial.printf("DNS address 1: %s\n\r",  WiFi.dnsIP(1).toString().c_str() );
+  Serial.println(F("WiFi connected"));
+  Serial.printf_P(PSTR("SSID: %s, Signal strength %i dBm \n\r"), WiFi.SSID().c_str(), WiFi.RSSI() );
+  Serial.printf_P(PSTR("Hostname: %s\n\r"),       WiFi.hostname().c_str() );
+  Serial.printf_P(PSTR("IP address: %s\n\r"),     WiFi.localIP().toString().c_str() );
+  Serial.printf_P(PSTR("DNS address 0: %s\n\r"),  WiFi.dnsIP(0).toString().c_str() );
+  Serial.printf_P(PSTR("DNS address 1: %s\n\r"),  WiFi.dnsIP(1).toString().c_str() );
   Serial.println();
 
-  //Setup sleep parameters
-  //WiFi.mode(WIFI_NONE_SLEEP);
-  //wifi_set_sleep_type(LIGHT_SLEEP_T);
-  wifi_set_sleep_type(NONE_SLEEP_T);
+  //Setup sleep parameters from the power profile - start awake
+  setPowerProfile( powerState.profile );
 
 }
 
 void setup()
 {
   int i=0;
-  
+
   // put your setup code here, to run once:
   Serial.begin( 115200, SERIAL_8N1, SERIAL_TX_ONLY);
   Serial.println();
-  Serial.println("ESP stepper starting:uses step and direction only.");
+  Serial.println(F("ESP stepper starting:uses step and direction only."));
   gdbstub_init();
 
   delay(2000);
   //Start NTP client
   configTime(TZ_SEC, DST_SEC, timeServer1, timeServer2, timeServer3 );
 
+  //Register the filter wheels hosted on this controller - sets up each wheel's stepper pins
+  initFilterWheel( &filterWheels[0], 0, DIRN_PIN, STEP_PIN, ENABLE_PIN, HALF_STEP_PIN );
+#if FILTERWHEEL_COUNT > 1
+  initFilterWheel( &filterWheels[1], 1, DIRN_PIN_1, STEP_PIN_1, ENABLE_PIN_1, HALF_STEP_PIN_1 );
+#endif
   
   //Read stored settings
-  EEPROM.begin(512);  
+  initPowerState( POWER_PERFORMANCE );
+  EEPROM.begin( EEPROM_SIZE );  
   setupFromEeprom();
-   
-  //filterwheel hardware setup
-  pinMode(DIRN_PIN, OUTPUT);
-  pinMode(STEP_PIN, OUTPUT);
-  pinMode(ENABLE_PIN, OUTPUT);
-  digitalWrite( DIRN_PIN, DIRN_CW );
-  digitalWrite( STEP_PIN, LOW);
-  digitalWrite( ENABLE_PIN, HIGH); //Active low.
 
+#if defined JOURNAL_LITTLEFS
+  LittleFS.begin();
+#endif
+
+  //Encoder starts from the restored position
+  beginWheelEncoder( &filterWheels[0].encoder, ENCODER_PIN, ENCODER_COUNTS_PER_REV );
+  syncWheelEncoder( &filterWheels[0].encoder, filterWheels[0].motion.getPosition() );
+   
   setup_wifi();
+
+  //Focus offset links from the stored settings - the focuser is looked up now the network is up
+  for ( i=0; i < FILTERWHEEL_COUNT; i++ )
+    applyFocuserSettings( &filterWheels[i].focuser );
   
   //Web server handler functions 
   server.onNotFound(handlerNotFound);
-
-  //Common ASCOM handlers
-  server.on("/api/v1/filterwheel/0/action",           HTTP_PUT, handleAction );
-  server.on("/api/v1/filterwheel/0/commandblind",     HTTP_PUT, handleCommandBlind );
-  server.on("/api/v1/filterwheel/0/commandbool",      HTTP_PUT, handleCommandBool );
-  server.on("/api/v1/filterwheel/0/commandastring",   HTTP_GET, handleCommandString );
-  server.on("/api/v1/filterwheel/0/connected", handleConnected );
-  server.on("/api/v1/filterwheel/0/description",      HTTP_GET, handleDescriptionGet );
-  server.on("/api/v1/filterwheel/0/driverinfo",       HTTP_GET, handleDriverInfoGet );
-  server.on("/api/v1/filterwheel/0/driveraersion",    HTTP_GET, handleDriverVersionGet );
-  server.on("/api/v1/filterwheel/0/name",             HTTP_GET, handleNameGet );
-  server.on("/api/v1/filterwheel/0/supportedactions", HTTP_GET, handleSupportedActionsGet );
+  //Sees every request before the routes do
+  server.addHandler( &requestProbe );
+
+  //Common ASCOM handlers - {} is the device number, resolved by requestFilterWheel() in each handler
+  server.on(UriBraces("/api/v1/filterwheel/{}/action"),           HTTP_PUT, handleAction );
+  server.on(UriBraces("/api/v1/filterwheel/{}/commandblind"),     HTTP_PUT, handleCommandBlind );
+  server.on(UriBraces("/api/v1/filterwheel/{}/commandbool"),      HTTP_PUT, handleCommandBool );
+  server.on(UriBraces("/api/v1/filterwheel/{}/commandastring"),   HTTP_GET, handleCommandString );
+  server.on(UriBraces("/api/v1/filterwheel/{}/connected"), handleConnected );
+  server.on(UriBraces("/api/v1/filterwheel/{}/description"),      HTTP_GET, handleDescriptionGet );
+  server.on(UriBraces("/api/v1/filterwheel/{}/driverinfo"),       HTTP_GET, handleDriverInfoGet );
+  server.on(UriBraces("/api/v1/filterwheel/{}/driveraersion"),    HTTP_GET, handleDriverVersionGet );
+  server.on(UriBraces("/api/v1/filterwheel/{}/name"),             HTTP_GET, handleNameGet );
+  server.on(UriBraces("/api/v1/filterwheel/{}/supportedactions"), HTTP_GET, handleSupportedActionsGet );
 
   //Filterwheel specific handlers
   server.on("/", HTTP_GET, handleSetup);
-  server.on("/api/v1/filterwheel/0/Names",        HTTP_GET, handleFilterNamesGet );
-  server.on("/api/v1/filterwheel/0/FocusOffsets", HTTP_GET, handleFocusOffsetsGet );
-  server.on("/api/v1/filterwheel/0/Position",     HTTP_PUT, handlePositionPut ); 
-  server.on("/api/v1/filterwheel/0/Position",     HTTP_GET, handlePositionGet ); 
+  server.on(UriBraces("/api/v1/filterwheel/{}/Names"),        HTTP_GET, handleFilterNamesGet );
+  server.on(UriBraces("/api/v1/filterwheel/{}/FocusOffsets"), HTTP_GET, handleFocusOffsetsGet );
+  server.on(UriBraces("/api/v1/filterwheel/{}/Position"),     HTTP_PUT, handlePositionPut ); 
+  server.on(UriBraces("/api/v1/filterwheel/{}/Position"),     HTTP_GET, handlePositionGet ); 
   
-  //Setup webpage handlers - HTML forms don't support PUT - use GET instead.
-  //Modern web browsers (chrome) will turn a put into a get. 
-  //Change this to PUT once initial test complete.
-  //Currently actually different URLs since different case. 
-  //For a filter wheel, only required PUT is position
-  server.on("/filterwheel/0/FilterNames",  HTTP_GET, handleFilterNamesPut );
-  server.on("/filterwheel/0/Hostname",     HTTP_GET, handleHostnamePut );
-  server.on("/filterwheel/0/Wheelname",    HTTP_GET, handleNamePut );
-  server.on("/filterwheel/0/FilterCount",  HTTP_GET, handleFilterCountPut );
-  server.on("/filterwheel/0/FocusOffsets", HTTP_GET, handleFocusOffsetsPut );
+  //Management API - lists the wheels in the registry
+  server.on("/management/apiversions",             HTTP_GET, handleAPIversions );
+  server.on("/management/v1/description",          HTTP_GET, handleAPIDescription );
+  server.on("/management/v1/configureddevices",    HTTP_GET, handleAPIconfiguredDevices );
+
+  //Setup webpage handlers - the page is static and PUTs each form with fetch(), 
+  //every handler replies with the updated config as JSON. 
+  server.on(UriBraces("/filterwheel/{}/Setup"),        HTTP_GET, handleSetup );
+  server.on(UriBraces("/filterwheel/{}/Config"),       HTTP_GET, handleConfigGet );
+  server.on(UriBraces("/filterwheel/{}/Config"),       HTTP_PUT, handleConfigPut );
+  server.on(UriBraces("/filterwheel/{}/FilterNames"),  HTTP_PUT, handleFilterNamesPut );
+  server.on(UriBraces("/filterwheel/{}/Hostname"),     HTTP_PUT, handleHostnamePut );
+  server.on(UriBraces("/filterwheel/{}/Wheelname"),    HTTP_PUT, handleNamePut );
+  server.on(UriBraces("/filterwheel/{}/FilterCount"),  HTTP_PUT, handleFilterCountPut );
+  server.on(UriBraces("/filterwheel/{}/FocusOffsets"), HTTP_PUT, handleFocusOffsetsPut );
+  server.on(UriBraces("/filterwheel/{}/Metrics"),      HTTP_GET, handleMetricsGet );
+  server.on(UriBraces("/filterwheel/{}/History"),      HTTP_GET, handleHistoryGet );
   
-  //setup interrupt-based 'soft' alarm handler for software stepping
-  ets_timer_setfn( &timer, onTimer, NULL ); 
-  ets_timer_setfn( &timeoutTImer, onTimeoutTimer, NULL ); 
+  ets_timer_setfn( &timoutTimer, onTimeoutTimer, NULL ); 
   //ets_timer_arm_new( &timer, 4000, 1/*repeat*/, 0);//the last arg indicates usecs(1)  rather than msecs (0). 
  
-  //Start web server
-  updater.setup( &server);
+  //Firmware update handlers
+  server.on("/update",        HTTP_GET,  handleUpdateForm );
+  server.on("/update",        HTTP_POST, handleUpdateDone, handleUpdateUpload );
+  server.on("/update/status", HTTP_GET,  handleUpdateStatusGet );
+
+  //Start web server - keep the header needed to revalidate the cached setup page
+  const char* headerKeys[] = { "If-None-Match" };
+  server.collectHeaders( headerKeys, 1 );
   server.begin();
+#if defined BINARY_PROTOCOL
+  beginBinaryProtocol();
+#endif
 
-  DEBUGSL1( "setup complete");
+  recordBootRam();
+  DEBUGSL1( F("setup complete"));
 }
 
 /*
-  Interrupt handler function captures button press changes pulses from user buttons and flags to main loop to process. 
-  Do this by capturing time of interrupt, waiting until after timeout msecs and checking again.
+  Interrupt handler function captures button press changes pulses from user buttons and queues them to the main loop to process. 
+  The event carries the time of the interrupt, for debouncing against the next one.
+  Not attached while GPIO3 is used for the encoder.
   https://github.com/esp8266/esp8266-wiki/wiki/gpio-registers
 */
-void pulseCounter(void)
+void ICACHE_RAM_ATTR pulseCounter(void)
 {
- //if edge rising, capture counter
+ //if edge falling, queue it
  byte signalDirection = GPIP(3); //READ_PERI_REG( 0x60000318, PulseCounterPin );
  if ( signalDirection == 0 ) 
- {
-    startTime =  ESP.getCycleCount();
-    //set flag.
-    newButtonFlag = 1;
- }
+   pushEvent( EVENT_BUTTON, 0 );
 }
 
-//Interrupt handler for async event timer
-void onTimeoutTimer( void )
+//Handler for async event timer
+void onTimeoutTimer( void* pArg )
 {
-  timeoutFlag = true;
+  pushEventFromTask( EVENT_TIMEOUT, 0 );
 }
 
-void onTimer( void* pArg )
+/*
+ * Drain the event queue in batches and hand each event to its wheel.
+ */
+void processEvents( void )
 {
-  if ( stepFlag >= 0 )
-	  stepFlag++;
-  else 
-	  stepFlag = 1;
+  Event batch[EVENT_BATCH_SIZE];
+  FilterWheel* fw = NULL;
+  int count = 0;
+  int i=0;
+
+  while ( ( count = drainEvents( batch, EVENT_BATCH_SIZE ) ) > 0 )
+  {
+    for ( i=0; i < count; i++ )
+    {
+      fw = getFilterWheel( batch[i].source );
+      switch( batch[i].type )
+      {
+        case EVENT_STEP_TICK:
+          if( fw != NULL )
+            fw->hardware.deliverTick();
+          break;
+        case EVENT_BUTTON:  //No button actions yet
+          buttonEvents++;
+          break;
+        case EVENT_TIMEOUT:
+          timeoutEvents++;
+          break;
+        default:
+          break;
+      }
+    }
+  }
 }
 
 void loop()
 {
-	String outbuf;
-  long int nowTime = system_get_time();
-  long int indexTime = startTime - nowTime;
+  uint32_t requestStart = 0;
+  bool moving = false;
+  bool activity = false;
+  int i=0;
   
   // Main code here, to run repeatedly:
-  //frequency timing test goes here - use system clock counter
-#if defined DEBUGLOOP
-  if( isMoving && stepFlag ) 
+  processEvents();
+  for ( i=0; i < FILTERWHEEL_COUNT; i++ )
   {
-    DEBUGS1 ( "Position:");
-    DEBUGSL2( stepPosition, DEC );
-    DEBUGS1 ( "Dirn: "); 
-    DEBUGSL1( (stepDirn == DIRN_CW)? "DIRN_CW": "DIRN_CCW" );
-    DEBUGSL2( targetDistance, DEC );
-
-    if ( targetDistance == 0 ) //May need to decelerate
-    {
-       DEBUGSL1 ( "Distance to selected filter is zero, halting"); 
-       currentFilterId = targetFilterId;
-       enableStepper(false);
-    }
-    else 
-    {
-      step();  
-    }
+    updateFilterWheel( &filterWheels[i] );
+    moving |= filterWheels[i].motion.isMoving();
   }
-  else if ( !isMoving )
+  if ( !moving )
   {
-    stepFlag = 0; //reset when start moving or disable the timer when not in use.
-    if ( stepPosition != filterPositions[currentFilterId ] )
-    {
-      //Detected change required due to offset from desired position.
-      DEBUGSL1 ( "Detected position offset - setting up move"); 
-      targetDistance = filterPositions[currentFilterId] - stepPosition;
-    }
-    else if ( targetFilterId != currentFilterId )
-    {
-      DEBUGSL1 ( "Detected new filter specified - setting up move"); 
-
-      //case 0 - increasing by less than 3 - CW
-      //2->4 800->1600 targetDistance = 800, stepcount = 1600
-      //case 1 - increasing by 3 or more   - CCW
-      //1->4 400->1600 targetDistance = 1200->-800, stepcount = 1600 CW 
-      //case 2 - decreasing by less than 3 - CCW
-      //4->2 1600->800 targetDistance = -800, stepcount = 800 CCW
-      //case 3 - decreasing by 3 or more   - CW
-      //4->1 1600->400 targetDistance = -1200->800, stepcount = 400 CW
-      //4->0 1600->2048/0 targetDistance = -1600->400, stepcount = 0 CW
-      targetDistance = filterPositions[targetFilterId] - stepPosition;
-    }
-    if( targetDistance > 0 )
-      stepDirn = DIRN_CW; 
-    else
-      stepDirn = DIRN_CCW;       
-    targetDistance = abs(targetDistance);
-    
-    if ( targetDistance > stepsPerRevolution/2 )
-    {
-      DEBUGSL1 ( "Reversing direction to minimise move to selected filter"); 
-      targetDistance = abs(stepsPerRevolution - targetDistance);
-      stepDirn = ( stepDirn == DIRN_CW )? DIRN_CCW : DIRN_CW;//reverse direction
-    }
-    updateStepDirection( stepDirn );
-    
-    //update isMoving flag to indicate a move has been requested. Catch next time around.
-    if ( targetDistance != 0 )
-      enableStepper(true);     
+    flushJournal();
+    sampleIdleRam();
   }
-#endif
+
   //If there are any client connections - handle them.
+  //Time the request against the wheel it addressed, handlers set requestWheel as they resolve it.
+  //Any request at all is activity for the power profile.
+  requestWheel = NULL;
+  requestSeen = false;
+  requestStart = micros();
   server.handleClient();
+  if ( requestWheel != NULL )
+    recordRequestTime( requestWheel, micros() - requestStart );
+  if ( requestSeen )
+    recordPowerRequestTime( micros() - requestStart );
+  activity = moving || requestSeen;
+#if defined BINARY_PROTOCOL
+  uint32_t frames = binaryFrames;
+  handleBinaryProtocol();
+  activity |= ( binaryFrames != frames );
+#endif
+  updatePower( activity );
  }
 
+/*
+ * Per-wheel motion processing - let the wheel's motion engine step, otherwise set up the next move.
+ */
+void updateFilterWheel( FilterWheel* fw )
+{
+  //A focus offset finishing after the wheel completes the change
+  if( updateFocuserLink( &fw->focuser ) && !fw->motion.isMoving() && fw->targetFilterId == fw->currentFilterId )
+    changeComplete( fw );
 
-  void enableStepper( boolean enable )
-  {
-      DEBUGSL1("------------------------------------");
-      DEBUGSL1( "Position:"); DEBUGSL2( stepPosition, DEC );
-      DEBUGSL1( "Dirn: ");  DEBUGSL1( (stepDirn == DIRN_CW)? "DIRN_CW": "DIRN_CCW" );
-      DEBUGSL1( "Distance: ");DEBUGSL2( targetDistance, DEC );
-      DEBUGSL1("------------------------------------");
-
-    //stop/start the timer
-	  if (enable)
-	  {
-		  DEBUGSL1 ("Enabling stepper");
-		  ets_timer_arm_new(&timer, 10, 1, 0);
-      digitalWrite( ENABLE_PIN, LOW );
-      stepFlag = 0;
-      isMoving = true;
-	  }
-	  else
-	  {
-      DEBUGSL1 ("Disabling stepper");      
-      ets_timer_disarm(&timer);
-      timer1_disable();
-      digitalWrite( ENABLE_PIN, HIGH );
-      isMoving = false;
-	  }
-  }
-  
-  void step(void)
+  if( fw->motion.isMoving() ) 
   {
-    //toggle step line
-    digitalWrite(STEP_PIN, LOW);
-    delayMicroseconds(100);
-    digitalWrite(STEP_PIN, HIGH);
-    delayMicroseconds(100);
-    digitalWrite(STEP_PIN, LOW);
-    
-    //Book-keeping of position and distance. 
-    if ( stepDirn == DIRN_CW)
-    {
-        stepPosition++;
-    }
-    else
+#if defined DEBUGLOOP
+    DEBUGS1 ( F("Position:"));
+    DEBUGSL2( fw->motion.getPosition(), DEC );
+    DEBUGS1 ( F("Dirn: ")); 
+    DEBUGSL1( (fw->motion.getDirection() == DIRN_CW)? F("DIRN_CW"): F("DIRN_CCW") );
+    DEBUGSL2( fw->motion.getDistanceToGo(), DEC );
+#endif
+    if ( fw->motion.update() )
     {
-        stepPosition--;
+      DEBUGSL1 ( F("Distance to selected filter is zero, halting")); 
+      fw->currentFilterId = fw->targetFilterId;
+      endMove( fw, checkWheelEncoder( &fw->encoder, &fw->motion, true ) );
     }
-    targetDistance--;
-
-    //keep count in range 0-stepsPerRevolution
-    stepPosition += stepsPerRevolution;
-    stepPosition %= stepsPerRevolution;
-    
-    stepFlag--;
+    else if ( checkWheelEncoder( &fw->encoder, &fw->motion, false ) == ENCODER_FAULT )
+      endMove( fw, ENCODER_FAULT );
+  }
+  else if ( fw->encoder.fault )
+  {
+    //Wheel slipped - hold until the client asks for a position again
   }
+  else if ( fw->motion.getPosition() != fw->filterPositions[fw->currentFilterId ] * MICROSTEPS_PER_STEP )
+  {
+    //Detected change required due to offset from desired position.
+    DEBUGSL1 ( F("Detected position offset - setting up move")); 
+    fw->motion.moveTo( fw->filterPositions[fw->currentFilterId] * MICROSTEPS_PER_STEP );
+    startMove( fw, fw->currentFilterId, fw->currentFilterId, 0 );
+  }
+  else if ( fw->targetFilterId != fw->currentFilterId )
+  {
+    DEBUGSL1 ( F("Detected new filter specified - setting up move")); 
+    fw->motion.moveTo( fw->filterPositions[fw->targetFilterId] * MICROSTEPS_PER_STEP );
+    startMove( fw, fw->currentFilterId, fw->targetFilterId, fw->requestClientID );
+  }
+}
+
+//Note the start of a move for the journal
+void startMove( FilterWheel* fw, int fromId, int toId, uint32_t clientID )
+{
+  fw->moveStartMs = millis();
+  fw->moveFromId = fromId;
+  fw->moveToId = toId;
+  fw->moveSteps = fw->motion.getDistanceToGo();
+  fw->moveClientID = clientID;
+  fw->moveEtaMs = fw->motion.remainingMs();
+}
+
+//Journal the move that has just ended
+void endMove( FilterWheel* fw, int encoderCheck )
+{
+  uint8_t flags = 0;
+  uint32_t durationMs = millis() - fw->moveStartMs;
+
+  fw->wheelMs = durationMs;
 
-  void updateStepDirection( bool direction )
+  //Track how well the motion profile predicts the move - not meaningful for a move stopped on an encoder fault
+  if( encoderCheck != ENCODER_FAULT )
   {
-  	//Setup DIRN line
-  	digitalWrite(DIRN_PIN, direction );
-  	delayMicroseconds(200);
+    fw->etaErrorMs = (int) durationMs - (int) fw->moveEtaMs;
+    if( abs( fw->etaErrorMs ) > fw->etaMaxErrorMs )
+      fw->etaMaxErrorMs = abs( fw->etaErrorMs );
   }
+  if( fw->motion.getDirection() == DIRN_CCW )
+    flags |= JOURNAL_DIRN_CCW;
+  if( fw->motion.getSlewMode() == STEP_HALF )
+    flags |= JOURNAL_HALF_SLEW;
+  if( encoderCheck == ENCODER_CORRECTED )
+    flags |= JOURNAL_ENCODER_FIXED;
+  else if( encoderCheck == ENCODER_FAULT )
+    flags |= JOURNAL_ENCODER_FAULT;
+  recordMove( (uint8_t) fw->deviceNumber, fw->moveFromId, fw->moveToId, fw->moveSteps, 
+              (int) durationMs, fw->motion.getBacklashUsed(), fw->moveClientID, flags );
+  if( !focuserBusy( &fw->focuser ) )
+    changeComplete( fw );
+}
 
-void backlashCompensate()
+//Wheel and any focus offset have both finished
+void changeComplete( FilterWheel* fw )
 {
-  /*
-   * The point of backlash compensation is to always come at the final position from the same direction. 
-   * So we overshoot or undershoot by the backlash amount to ensure approaching from the same direction.
-   */
-  if (backlashEnabled)
+  uint32_t changeMs = 0;
+
+  if( fw->focuserInChange )
   {
-    if( stepDirn == DIRN_CW )
-    {
-      targetDistance -= backlash;
-      stepDirn = DIRN_CCW;
-    }
-    else
-    {
-      targetDistance -= backlash;
-      stepDirn = DIRN_CCW;
-    }
-    targetDistance += stepsPerRevolution;
-    targetDistance = targetDistance % stepsPerRevolution;
+    //Time saved against running the wheel and then the focuser
+    fw->focuserInChange = false;
+    changeMs = millis() - fw->changeStartMs;
+    fw->lastChangeMs = changeMs;
+    fw->lastChangeSavedMs = (int) ( fw->wheelMs + fw->focuser.lastDurationMs ) - (int) changeMs;
   }
+#if defined BINARY_PROTOCOL
+  //Only once the wheel is on the filter asked for ( or stopped by a fault ) - not at the end of a correcting move
+  //made on the way, or of a move that an encoder correction still has to finish
+  if( fw->encoder.fault ||
+      ( fw->currentFilterId == fw->targetFilterId &&
+        fw->motion.getPosition() == fw->filterPositions[fw->targetFilterId] * MICROSTEPS_PER_STEP ) )
+    notifyMoveComplete( fw );
+#endif
 }
-  
+
 /*
  * Reset the device - Non-ASCOM call
  */
@@ -501,9 +583,9 @@ void backlashCompensate()
     DynamicJsonBuffer jsonBuffer(256);
 
     JsonObject& root = jsonBuffer.createObject();
-    root["messageType"] = "Alert";
-    root["message"]= "Esp8266 Resetting";
-    Serial.println( "Server resetting" );
+    root["messageType"] = F("Alert");
+    root["message"]= F("Esp8266 Resetting");
+    Serial.println( F("Server resetting") );
     root.printTo(message);
     server.send(200, "application/json", message);
     device.restart();
@@ -521,9 +603,9 @@ void handlerNotFound()
   DynamicJsonBuffer jsonBuffer(256);
 
   JsonObject& root = jsonBuffer.createObject();
-  jsonResponseBuilder( root, clientID, transID, "HandlerNotFound", 0x500, "No REST handler found for argument - check ASCOM filterwheel v2 specification" );    
+  alpacaResponseBuilder( root, clientID, transID, F("HandlerNotFound"), 0x500, F("No REST handler found for argument - check ASCOM filterwheel v2 specification") );    
   JsonObject& err = root.createNestedObject("ErrorMessage");
-  err["Value"] = "Filter wheel REST handler not found or parameters incomplete";
+  err["Value"] = F("Filter wheel REST handler not found or parameters incomplete");
   DEBUGSL1( message );
   root.printTo(message);
   server.send( 400, "text/json", message);
@@ -0,0 +1,87 @@
+/*
+ Timestamped events from interrupts and timers to the main loop.
+ A single-producer/single-consumer ring - the producers only write head, the loop only writes tail, so neither side takes a lock.
+ The GPIO interrupts can pre-empt the soft timer callbacks but not each other, so the timer callbacks push with
+ interrupts held off for the few instructions it takes - that keeps to one producer at a time.
+ The loop drains the queue in batches each time round, a full queue drops the event and counts it.
+*/
+#if !defined _EVENTQUEUE_H_
+#define _EVENTQUEUE_H_
+
+const uint32_t EVENT_QUEUE_SIZE = 64; //power of two
+const int EVENT_BATCH_SIZE = 16;
+
+enum eventTypes { EVENT_STEP_TICK, EVENT_BUTTON, EVENT_TIMEOUT };
+
+struct Event
+{
+  uint8_t type;
+  uint8_t source;   //filter wheel device number where it applies
+  uint32_t cycles;  //ESP.getCycleCount() when raised
+};
+
+struct EventQueue
+{
+  Event events[EVENT_QUEUE_SIZE];
+  volatile uint32_t head;       //next slot to write - producer only
+  volatile uint32_t tail;       //next slot to read - consumer only
+  volatile uint32_t overflows;
+  uint32_t highWater;
+  uint32_t processed;
+};
+EventQueue eventQueue;
+
+bool ICACHE_RAM_ATTR pushEvent( uint8_t type, uint8_t source );
+bool pushEventFromTask( uint8_t type, uint8_t source );
+int drainEvents( Event* batch, int maxEvents );
+
+//Push from an interrupt handler
+bool ICACHE_RAM_ATTR pushEvent( uint8_t type, uint8_t source )
+{
+  uint32_t head = eventQueue.head;
+  Event* event = NULL;
+
+  if( ( head - eventQueue.tail ) >= EVENT_QUEUE_SIZE )
+  {
+    eventQueue.overflows++;
+    return false;
+  }
+  event = &eventQueue.events[ head & ( EVENT_QUEUE_SIZE - 1 ) ];
+  event->type = type;
+  event->source = source;
+  event->cycles = ESP.getCycleCount();
+  __sync_synchronize(); //event written before it is published
+  eventQueue.head = head + 1;
+  return true;
+}
+
+//Push from a soft timer callback or the loop, which an interrupt could otherwise pre-empt part way through
+bool pushEventFromTask( uint8_t type, uint8_t source )
+{
+  uint32_t savedPS = xt_rsil(15);
+  bool pushed = pushEvent( type, source );
+  xt_wsr_ps( savedPS );
+  return pushed;
+}
+
+/*
+ * Copy up to maxEvents pending events into batch and release their slots.
+ * Returns the number copied.
+ */
+int drainEvents( Event* batch, int maxEvents )
+{
+  uint32_t tail = eventQueue.tail;
+  uint32_t pending = eventQueue.head - tail;
+  int count = 0;
+
+  __sync_synchronize(); //read head before the events it published
+  if( pending > eventQueue.highWater )
+    eventQueue.highWater = pending;
+  for ( count=0; count < maxEvents && (uint32_t) count < pending; count++ )
+    batch[count] = eventQueue.events[ ( tail + count ) & ( EVENT_QUEUE_SIZE - 1 ) ];
+  __sync_synchronize(); //events copied before their slots are released
+  eventQueue.tail = tail + count;
+  eventQueue.processed += count;
+  return count;
+}
+#endif
@@ -0,0 +1,127 @@
+/*
+ Filter wheel command layer shared by the REST handlers and the binary protocol.
+ Each command applies the ASCOM client lock and returns the ASCOM error number, 0 on success, with a message for the reply.
+ The messages are kept in flash - callers read them with FPSTR().
+*/
+#if !defined _FWCOMMANDS_H_
+#define _FWCOMMANDS_H_
+
+int fwSetConnected( FilterWheel* fw, uint32_t clientID, bool connect, PGM_P* errMsg );
+int fwSetPosition( FilterWheel* fw, uint32_t clientID, int filterId, PGM_P* errMsg );
+int fwGetPosition( FilterWheel* fw, int* filterId, PGM_P* errMsg );
+int fwGetMoveEta( FilterWheel* fw, int filterId, uint32_t* etaMs, PGM_P* errMsg );
+
+/*
+ * Connect or disconnect clientID. Only one client can hold the connection,
+ * connecting again from the same client is benign.
+ */
+int fwSetConnected( FilterWheel* fw, uint32_t clientID, bool connect, PGM_P* errMsg )
+{
+  if( connect )
+  {
+    if ( fw->connected )//already true
+    {
+      if( clientID == fw->connectedClient )
+      {
+        *errMsg = PSTR("Setting connected when already connected");
+        return 0;
+      }
+      *errMsg = PSTR("Setting connected when already connected by different client");
+      return 0x402;
+    }
+    fw->connected = true;
+    fw->connectedClient = clientID;
+    *errMsg = PSTR("Setting connected OK");
+    return 0;
+  }
+
+  if ( fw->connected )
+  {
+    fw->connected = false;
+    fw->connectedClient = -1;
+    *errMsg = PSTR("Disconnected OK");
+    return 0;
+  }
+  *errMsg = PSTR("Setting 'connected' to false when aready false");
+  return 0x403;
+}
+
+/*
+ * Request a move to filterId - the move itself is started by the loop.
+ * An out of range filter is ignored. A new request clears an encoder fault.
+ */
+int fwSetPosition( FilterWheel* fw, uint32_t clientID, int filterId, PGM_P* errMsg )
+{
+  *errMsg = PSTR("");
+  if( !fw->connected || clientID != fw->connectedClient )
+  {
+    *errMsg = PSTR("Not connected - set Connected first");
+    return 0x407;
+  }
+  if( fw->motion.isMoving() )
+  {
+    *errMsg = PSTR("Filter wheel already moving");
+    return 0x402;
+  }
+  if( focuserBusy( &fw->focuser ) )
+  {
+    *errMsg = PSTR("Focus offset still moving");
+    return 0x402;
+  }
+  if( isUpdating() )
+  {
+    *errMsg = PSTR("Firmware update in progress");
+    return 0x40B;
+  }
+  if( filterId >= 0 && filterId < fw->filtersPerWheel && ( filterId != fw->currentFilterId || fw->encoder.fault ) )
+  {
+    //the step position was re-synced to the encoder when the fault was raised
+    fw->encoder.fault = false;
+    fw->requestClientID = clientID;
+    fw->targetFilterId = filterId;
+    //the focus offset is queued, it and the wheel both start on the next pass of the loop
+    fw->changeStartMs = millis();
+    fw->focuserInChange = startFocuserOffset( &fw->focuser, fw->focusOffsets[filterId] - fw->focusOffsets[fw->currentFilterId], clientID );
+  }
+  return 0;
+}
+
+//-1 until the wheel and any focus offset have finished moving, as Alpaca expects while moving
+int fwGetPosition( FilterWheel* fw, int* filterId, PGM_P* errMsg )
+{
+  *filterId = fw->currentFilterId;
+  if( fw->motion.isMoving() || fw->targetFilterId != fw->currentFilterId || focuserBusy( &fw->focuser ) )
+    *filterId = -1;
+  *errMsg = PSTR("");
+  if( fw->encoder.fault )
+  {
+    *errMsg = PSTR("Encoder position error - wheel slipped, set Position to recover");
+    return 0x500;
+  }
+  return 0;
+}
+
+/*
+ * Predicted msecs until the wheel is at filterId, or at the filter it is heading for if filterId is -1.
+ * While moving that is the time left in the move, plus the move on from its target to filterId.
+ */
+int fwGetMoveEta( FilterWheel* fw, int filterId, uint32_t* etaMs, PGM_P* errMsg )
+{
+  *etaMs = 0;
+  *errMsg = PSTR("");
+  if( filterId < 0 )
+    filterId = fw->targetFilterId;
+  if( filterId >= fw->filtersPerWheel )
+  {
+    *errMsg = PSTR("Filter number out of range");
+    return 0x401;
+  }
+
+  if( fw->motion.isMoving() )
+    *etaMs = fw->motion.remainingMs() + 
+             fw->motion.estimateMoveMs( fw->filterPositions[fw->moveToId] * MICROSTEPS_PER_STEP, fw->filterPositions[filterId] * MICROSTEPS_PER_STEP );
+  else
+    *etaMs = fw->motion.estimateMoveMs( fw->motion.getPosition(), fw->filterPositions[filterId] * MICROSTEPS_PER_STEP );
+  return 0;
+}
+#endif
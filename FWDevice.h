@@ -0,0 +1,269 @@
+/*
+ Per-device state for each filter wheel hosted by this controller.
+ All wheels share the one network stack and web server - the handlers look up the wheel
+ addressed by the {DeviceNumber} element of the request URI in the registry below.
+*/
+#if !defined _FWDEVICE_H_
+#define _FWDEVICE_H_
+
+struct FilterWheel
+{
+  int deviceNumber;
+
+  //This wheel's stepper controller and the motion engine driving it
+  GpioStepper hardware;
+  MotionEngine motion;
+  WheelEncoder encoder;
+  FocuserLink focuser;
+
+  //ASCOM client lock - only the connected client may change state
+  bool connected;
+  unsigned int connectedClient;
+
+  //Filter information
+  char*  wheelName;
+  int    filtersPerWheel;
+  int*   filterPositions;
+  int*   focusOffsets;
+  char** filterNames;
+
+  //Motion
+  int targetFilterId; //next requested position - updated into current when we get there
+  int currentFilterId;
+  uint32_t requestClientID; //ClientID of the last Position request
+
+  //Move in progress, recorded in the journal when it ends
+  uint32_t moveStartMs;
+  int moveFromId;
+  int moveToId;
+  int moveSteps;
+  uint32_t moveClientID;
+  uint32_t moveEtaMs;       //predicted duration when it started
+  int etaErrorMs;           //last move's measured less predicted duration
+  int etaMaxErrorMs;
+
+  //Filter change - the wheel move and the focus offset run together
+  uint32_t changeStartMs;
+  uint32_t wheelMs;
+  bool focuserInChange;
+  uint32_t lastChangeMs;
+  int lastChangeSavedMs;    //wheel time + focuser time - change time
+
+  //Serialised responses for properties that only change on re-configuration
+  ResponseCache responseCache;
+
+  //Request statistics - time spent in handleClient for requests addressed to this wheel
+  uint32_t requestCount;
+  uint32_t requestMicrosTotal;
+  uint32_t requestMicrosMax;
+  uint32_t setupBytesSent;  //setup page config responses
+};
+
+/*
+ Per-filter settings staged for a re-configuration. Built and validated completely before
+ commitFilterConfig() swaps them into the wheel, so a rejected change leaves the wheel untouched.
+*/
+struct FilterConfig
+{
+  char   wheelName[MAX_NAME_LENGTH];
+  int    filtersPerWheel;
+  char** filterNames;
+  int*   focusOffsets;
+  int*   filterPositions;
+};
+
+FilterWheel filterWheels[FILTERWHEEL_COUNT];
+
+//Wheel addressed by the request currently being handled, used to attribute request latency.
+FilterWheel* requestWheel = NULL;
+
+FilterWheel* getFilterWheel( int deviceNumber );
+FilterWheel* requestFilterWheel( void );
+void initFilterWheel( FilterWheel* fw, int deviceNumber, int dirnPin, int stepPin, int enablePin, int halfStepPin );
+void recordRequestTime( FilterWheel* fw, uint32_t elapsed );
+bool stageFilterConfig( FilterWheel* fw, FilterConfig* cfg, int filterCount );
+void commitFilterConfig( FilterWheel* fw, FilterConfig* cfg );
+void freeFilterConfig( FilterConfig* cfg );
+
+FilterWheel* getFilterWheel( int deviceNumber )
+{
+  if( deviceNumber < 0 || deviceNumber >= FILTERWHEEL_COUNT )
+    return NULL;
+  return &filterWheels[deviceNumber];
+}
+
+/*
+ * Resolve the {DeviceNumber} path argument of the current request and apply admission control.
+ * Sends the Alpaca 'invalid device number' response, or a 429 if the client is over its rate, and returns NULL
+ * if the request shouldn't be handled.
+ */
+FilterWheel* requestFilterWheel( void )
+{
+  FilterWheel* fw = NULL;
+  String deviceArg = server.pathArg(0);
+  uint32_t clientID = 0;
+  bool exempt = false;
+
+  if( deviceArg.length() > 0 && isDigit( deviceArg.charAt(0) ) )
+    fw = getFilterWheel( deviceArg.toInt() );
+
+  if( fw == NULL )
+  {
+    DEBUGS1( F("requestFilterWheel: invalid device number ") );DEBUGSL1( deviceArg );
+    server.send_P( 400, PSTR("text/plain"), PSTR("Invalid device number") );
+    return NULL;
+  }
+  requestWheel = fw;
+
+  //The controlling client is never held back, whether changing state or polling it
+  clientID = (uint32_t) server.arg("ClientID").toInt();
+  exempt = fw->connected && clientID == fw->connectedClient;
+  if( !admitRequest( clientID, exempt ) )
+  {
+    server.sendHeader( "Retry-After", "1" );
+    server.send_P( 429, PSTR("text/plain"), PSTR("Too many requests") );
+    return NULL;
+  }
+  return fw;
+}
+
+void initFilterWheel( FilterWheel* fw, int deviceNumber, int dirnPin, int stepPin, int enablePin, int halfStepPin )
+{
+  fw->deviceNumber = deviceNumber;
+  fw->hardware.begin( (uint8_t) deviceNumber, dirnPin, stepPin, enablePin, halfStepPin );
+  fw->motion.begin( &fw->hardware, microstepsPerRevolution, stepIntervalMs );
+  fw->motion.setApproachSteps( defaultApproachSteps );
+  fw->motion.setBacklash( 0 );
+  initWheelEncoder( &fw->encoder );
+  initFocuserLink( &fw->focuser );
+  fw->connected = false;
+  fw->connectedClient = -1;
+  fw->wheelName = NULL;
+  fw->filtersPerWheel = defaultFiltersPerWheel;
+  fw->filterPositions = NULL;
+  fw->focusOffsets = NULL;
+  fw->filterNames = NULL;
+  fw->targetFilterId = 0;
+  fw->currentFilterId = 0;
+  fw->requestClientID = 0;
+  fw->moveStartMs = 0;
+  fw->moveFromId = 0;
+  fw->moveToId = 0;
+  fw->moveSteps = 0;
+  fw->moveClientID = 0;
+  fw->moveEtaMs = 0;
+  fw->etaErrorMs = 0;
+  fw->etaMaxErrorMs = 0;
+  fw->changeStartMs = 0;
+  fw->wheelMs = 0;
+  fw->focuserInChange = false;
+  fw->lastChangeMs = 0;
+  fw->lastChangeSavedMs = 0;
+  fw->requestCount = 0;
+  fw->requestMicrosTotal = 0;
+  fw->requestMicrosMax = 0;
+  fw->setupBytesSent = 0;
+  initResponseCache( &fw->responseCache );
+}
+
+void recordRequestTime( FilterWheel* fw, uint32_t elapsed )
+{
+  fw->requestCount++;
+  fw->requestMicrosTotal += elapsed;
+  if( elapsed > fw->requestMicrosMax )
+    fw->requestMicrosMax = elapsed;
+}
+/*
+ * Copy the wheel's current settings into cfg, re-sized to filterCount.
+ * Filters beyond the current count get default names and zero offsets, positions are spaced evenly.
+ * Returns false if the memory couldn't be allocated.
+ */
+bool stageFilterConfig( FilterWheel* fw, FilterConfig* cfg, int filterCount )
+{
+  int i=0;
+
+  strncpy( cfg->wheelName, fw->wheelName, MAX_NAME_LENGTH - 1 );
+  cfg->wheelName[MAX_NAME_LENGTH - 1] = '\0';
+  cfg->filtersPerWheel = filterCount;
+  cfg->filterNames = (char**) calloc( sizeof(char*), (size_t) filterCount );
+  cfg->focusOffsets = (int*) calloc( sizeof(int), (size_t) filterCount );
+  cfg->filterPositions = (int*) calloc( sizeof(int), (size_t) filterCount );
+  if( cfg->filterNames == NULL || cfg->focusOffsets == NULL || cfg->filterPositions == NULL )
+  {
+    freeFilterConfig( cfg );
+    return false;
+  }
+
+  for ( i=0; i < filterCount; i++ )
+  {
+    cfg->filterNames[i] = (char*) calloc( sizeof(char), (size_t) MAX_NAME_LENGTH );
+    if( cfg->filterNames[i] == NULL )
+    {
+      freeFilterConfig( cfg );
+      return false;
+    }
+    if( i < fw->filtersPerWheel )
+    {
+      strcpy( cfg->filterNames[i], fw->filterNames[i] );
+      cfg->focusOffsets[i] = fw->focusOffsets[i];
+    }
+    else
+    {
+      snprintf( cfg->filterNames[i], MAX_NAME_LENGTH, "filter_%d", i );
+      cfg->focusOffsets[i] = 0;
+    }
+    //Keep the stored positions unless the wheel is re-sized
+    if( filterCount == fw->filtersPerWheel )
+      cfg->filterPositions[i] = fw->filterPositions[i];
+    else
+      cfg->filterPositions[i] = i * stepsPerRevolution / filterCount;
+  }
+  return true;
+}
+
+//Swap the staged settings into the wheel and release the old ones - cfg is left empty.
+void commitFilterConfig( FilterWheel* fw, FilterConfig* cfg )
+{
+  FilterConfig old;
+
+  old.filtersPerWheel = fw->filtersPerWheel;
+  old.filterNames = fw->filterNames;
+  old.focusOffsets = fw->focusOffsets;
+  old.filterPositions = fw->filterPositions;
+
+  strcpy( fw->wheelName, cfg->wheelName );
+  fw->filtersPerWheel = cfg->filtersPerWheel;
+  fw->filterNames = cfg->filterNames;
+  fw->focusOffsets = cfg->focusOffsets;
+  fw->filterPositions = cfg->filterPositions;
+  if( fw->currentFilterId >= fw->filtersPerWheel )
+    fw->currentFilterId = 0;
+  if( fw->targetFilterId >= fw->filtersPerWheel )
+    fw->targetFilterId = fw->currentFilterId;
+  invalidateResponseCache( &fw->responseCache );
+
+  cfg->filterNames = NULL;
+  cfg->focusOffsets = NULL;
+  cfg->filterPositions = NULL;
+  freeFilterConfig( &old );
+}
+
+void freeFilterConfig( FilterConfig* cfg )
+{
+  int i=0;
+  if( cfg->filterNames != NULL )
+  {
+    for ( i=0; i < cfg->filtersPerWheel; i++ )
+    {
+      if( cfg->filterNames[i] != NULL )
+        free( cfg->filterNames[i] );
+    }
+    free( cfg->filterNames );
+  }
+  if( cfg->focusOffsets != NULL ) free( cfg->focusOffsets );
+  if( cfg->filterPositions != NULL ) free( cfg->filterPositions );
+  cfg->filterNames = NULL;
+  cfg->focusOffsets = NULL;
+  cfg->filterPositions = NULL;
+}
+#endif
@@ -1,49 +1,112 @@
 #if !defined _FWEEPROM_H_
 #define _FWEEPROM_H_
+/*
+ EEPROM layout
+ 0         : '#' init byte
+ 1         : hostname
+ FW_EEPROM_POWER_ADDR : power profile byte, in the last byte clear of the device blocks
+ FW_EEPROM_BASE + n * FW_EEPROM_BLOCK_SIZE : settings block for filter wheel device n
+ Device 0's block starts where the wheel name always has so existing stored settings are kept.
+ Motion settings are at a fixed offset in the block, after the space used by MAX_FILTER_COUNT filters.
+ */
+const int FW_EEPROM_BASE = 1 + MAX_NAME_LENGTH;
+const int FW_EEPROM_BLOCK_SIZE = 480; //MAX_FILTER_COUNT filters need 363 bytes, the rest is spare.
+const int FW_EEPROM_MOTION_OFFSET = 400; //slew mode byte, approach steps, step interval byte, backlash byte
+const int FW_EEPROM_FOCUSER_OFFSET = 410; //enabled byte, relative byte, port, device byte, host
+const int EEPROM_SIZE = 1024;
+const int FW_EEPROM_POWER_ADDR = EEPROM_SIZE - 1;
+
+//Number of flash commits since boot - each one rewrites the whole EEPROM sector.
+uint32_t eepromCommits = 0;
+
 void setDefaults(void );
+void setDeviceDefaults( FilterWheel* fw );
 void saveToEeprom( void );
+void saveDeviceToEeprom( FilterWheel* fw );
 void setupFromEeprom( void );
+void setupDeviceFromEeprom( FilterWheel* fw );
 
 void setDefaults()
 {
   int i=0;
-  DEBUGSL1( "setDefaults: entered");
-  
+  DEBUGSL1( F("setDefaults: entered"));
+
   //hostname, wheelname is assumed to be the same as hostname
+  if( hostname != NULL ) free( hostname );
   hostname = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
   memcpy( hostname, defaultHostname, MAX_NAME_LENGTH * sizeof(char) );
-  DEBUGS1( "hostname:  ");DEBUGSL1( hostname );
-  
-  wheelName = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
-  memcpy( wheelName, defaultHostname, MAX_NAME_LENGTH * sizeof(char) );
-  DEBUGS1( "wheelName:  ");DEBUGSL1(  wheelName );
+  DEBUGS1( F("hostname:  "));DEBUGSL1( hostname );
 
+  if( thisID != NULL ) free( thisID );
   thisID = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
   memcpy( thisID, defaultHostname, MAX_NAME_LENGTH * sizeof(char) );
-  DEBUGS1( "MQTT ID:  ");DEBUGSL1( thisID );
-    
+  DEBUGS1( F("MQTT ID:  "));DEBUGSL1( thisID );
+
+  powerState.profile = POWER_PERFORMANCE;
+
+  for ( i=0; i < FILTERWHEEL_COUNT; i++ )
+    setDeviceDefaults( &filterWheels[i] );
+
+  DEBUGSL1( F("setDefaults: exiting") );
+}
+
+void setDeviceDefaults( FilterWheel* fw )
+{
+  int i=0;
+  DEBUGS1( F("setDeviceDefaults: entered for device "));DEBUGSL1( fw->deviceNumber );
+
+  //wheelname defaults to the hostname, with the device number appended for additional wheels
+  if( fw->wheelName != NULL ) free( fw->wheelName );
+  fw->wheelName = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
+  memcpy( fw->wheelName, defaultHostname, MAX_NAME_LENGTH * sizeof(char) );
+  if( fw->deviceNumber > 0 )
+    snprintf( fw->wheelName, MAX_NAME_LENGTH, "%s_%d", defaultHostname, fw->deviceNumber );
+  DEBUGS1( F("wheelName:  "));DEBUGSL1( fw->wheelName );
+
   //filternames and filter offsets
-  filterNames = (char**) calloc( sizeof(char*), (unsigned) defaultFiltersPerWheel );
-  focusOffsets = (int*)  calloc( sizeof(int),   (unsigned) defaultFiltersPerWheel );
-  filterPositions = (int*) calloc( sizeof(int), (unsigned) defaultFiltersPerWheel );
+  if ( fw->filterNames != NULL )
+  {
+    for ( i=0; i < fw->filtersPerWheel; i++ )
+    {
+      if( fw->filterNames[i] != NULL )
+        free( fw->filterNames[i] );
+    }
+    free( fw->filterNames );
+  }
+  if( fw->focusOffsets != NULL ) free( fw->focusOffsets );
+  if( fw->filterPositions != NULL ) free( fw->filterPositions );
+
+  fw->filtersPerWheel = defaultFiltersPerWheel;
+  fw->filterNames = (char**) calloc( sizeof(char*), (unsigned) defaultFiltersPerWheel );
+  fw->focusOffsets = (int*)  calloc( sizeof(int),   (unsigned) defaultFiltersPerWheel );
+  fw->filterPositions = (int*) calloc( sizeof(int), (unsigned) defaultFiltersPerWheel );
   for ( i=0; i< defaultFiltersPerWheel ; i++ )
   {
-    filterNames[i] = (char*) malloc( sizeof(char) * MAX_NAME_LENGTH);
-    focusOffsets[i] = 0;
-    filterPositions[i] = i* ((2048)/defaultFiltersPerWheel);
+    fw->filterNames[i] = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
+    fw->focusOffsets[i] = 0;
+    fw->filterPositions[i] = i* ((stepsPerRevolution)/defaultFiltersPerWheel);
     String thing = "filter_";
     thing.concat(i);
-    memcpy( filterNames[i], thing.c_str(), thing.length() * sizeof(char) );
-    DEBUGS1( "setDefaults: filterNames ");
-    DEBUGSL1(  filterNames[i] );
-    DEBUGS1( "setDefaults: filterOffsets ");
-    DEBUGSL1( focusOffsets[i] );
-    DEBUGS1( "setDefaults: filterPositions: ");
-    DEBUGSL1( filterPositions[i] );
-
+    memcpy( fw->filterNames[i], thing.c_str(), thing.length() * sizeof(char) );
+    DEBUGS1( F("setDefaults: filterNames "));
+    DEBUGSL1(  fw->filterNames[i] );
+    DEBUGS1( F("setDefaults: filterOffsets "));
+    DEBUGSL1( fw->focusOffsets[i] );
+    DEBUGS1( F("setDefaults: filterPositions: "));
+    DEBUGSL1( fw->filterPositions[i] );
   }
-  
- DEBUGSL1( "setDefaults: exiting" );
+  fw->currentFilterId = 0;
+  fw->targetFilterId = 0;
+  fw->motion.setPosition( fw->filterPositions[0] * MICROSTEPS_PER_STEP );
+  fw->motion.setSlewMode( STEP_FULL );
+  fw->motion.setApproachSteps( defaultApproachSteps );
+  fw->motion.setStepInterval( stepIntervalMs );
+  fw->motion.setBacklash( 0 );
+  fw->focuser.enabled = false;
+  fw->focuser.relative = false;
+  fw->focuser.port = FOCUS_DEFAULT_PORT;
+  fw->focuser.device = 0;
+  fw->focuser.host[0] = '\0';
 }
 
 void saveToEeprom( void )
@@ -51,69 +114,108 @@ void saveToEeprom( void )
   int i = 0;
   int eepromAddr = 1;
 
-  DEBUGSL1( "savetoEeprom: Entered ");
-  
+  DEBUGSL1( F("savetoEeprom: Entered "));
+
   //hostname
   EEPROMWriteString( eepromAddr = 1, hostname, MAX_NAME_LENGTH );
-  eepromAddr += MAX_NAME_LENGTH;  
-  DEBUGS1( "Written hostname: ");DEBUGSL1( hostname );
+  eepromAddr += MAX_NAME_LENGTH;
+  DEBUGS1( F("Written hostname: "));DEBUGSL1( hostname );
+
+  EEPROM.write( FW_EEPROM_POWER_ADDR, (byte) powerState.profile );
+
+  //per-device settings blocks
+  for ( i=0; i < FILTERWHEEL_COUNT; i++ )
+    saveDeviceToEeprom( &filterWheels[i] );
+
+  EEPROMWriteAnything( eepromAddr=0, byte('#') );
+  DEBUGSL1( F("saveToEeprom: exiting "));
+
+  EEPROM.commit();
+  eepromCommits++;
+
+#if defined DEBUG_EEPROM
+  //Test readback of contents
+  char ch;
+  String input;
+  for (i=0; i< 512 ; i++ )
+  {
+    ch = (char) EEPROM.read( i );
+    if ( ch == '\0' )
+      ch = '_';
+    input.concat( ch );
+  }
+
+  Serial.printf_P( PSTR("EEPROM contents: %s \n"), input.c_str() );
+#endif
+}
+
+void saveDeviceToEeprom( FilterWheel* fw )
+{
+  int i = 0;
+  int slewMode = 0;
+  int approachSteps = 0;
+  int eepromAddr = FW_EEPROM_BASE + ( fw->deviceNumber * FW_EEPROM_BLOCK_SIZE );
+
+  DEBUGS1( F("saveDeviceToEeprom: device "));DEBUGSL1( fw->deviceNumber );
 
   //wheel name
-  EEPROMWriteString( eepromAddr, wheelName, MAX_NAME_LENGTH );
+  EEPROMWriteString( eepromAddr, fw->wheelName, MAX_NAME_LENGTH );
   eepromAddr += MAX_NAME_LENGTH;
-  DEBUGS1( "Written wheelName: ");DEBUGSL1( wheelName );
-  
+  DEBUGS1( F("Written wheelName: "));DEBUGSL1( fw->wheelName );
+
   //current filter selected
-  EEPROMWriteAnything( eepromAddr, currentFilterId ); 
-  eepromAddr += sizeof( currentFilterId );
-  DEBUGS1( "Written currentFilterId: ");DEBUGSL1( currentFilterId );
-  
+  EEPROMWriteAnything( eepromAddr, fw->currentFilterId );
+  eepromAddr += sizeof( fw->currentFilterId );
+  DEBUGS1( F("Written currentFilterId: "));DEBUGSL1( fw->currentFilterId );
+
   //number of filters
-  EEPROMWriteAnything( eepromAddr, filtersPerWheel ); 
-  eepromAddr += sizeof(filtersPerWheel);
-  DEBUGS1( "Written filtersPerWheel: "); DEBUGSL1( filtersPerWheel );
-  
+  EEPROMWriteAnything( eepromAddr, fw->filtersPerWheel );
+  eepromAddr += sizeof( fw->filtersPerWheel );
+  DEBUGS1( F("Written filtersPerWheel: ")); DEBUGSL1( fw->filtersPerWheel );
+
   //positions
-  for ( i=0; i < filtersPerWheel; i++ )
+  for ( i=0; i < fw->filtersPerWheel; i++ )
   {
-     EEPROMWriteAnything( eepromAddr, filterPositions[i] ); 
-     eepromAddr += sizeof(filterPositions[i]);
-     DEBUGS1( "Written filterPositions[]: "); DEBUGSL1( filterPositions[i] );
+     EEPROMWriteAnything( eepromAddr, fw->filterPositions[i] );
+     eepromAddr += sizeof( fw->filterPositions[i] );
+     DEBUGS1( F("Written filterPositions[]: ")); DEBUGSL1( fw->filterPositions[i] );
   }
-  
+
   //focus offsets
-  for ( i=0; i < filtersPerWheel; i++ )
+  for ( i=0; i < fw->filtersPerWheel; i++ )
   {
-    EEPROMWriteAnything( eepromAddr, focusOffsets[i] ); 
-    eepromAddr += sizeof(focusOffsets[i]);
-    DEBUGS1( "Written focusOffsets[]: ");DEBUGSL1( focusOffsets[i] );
+    EEPROMWriteAnything( eepromAddr, fw->focusOffsets[i] );
+    eepromAddr += sizeof( fw->focusOffsets[i] );
+    DEBUGS1( F("Written focusOffsets[]: "));DEBUGSL1( fw->focusOffsets[i] );
   }
-  
+
   //filtername length/filter name - handle local vs global string references. Could go out of scope.
-  for ( i=0; i < filtersPerWheel; i++ )
+  for ( i=0; i < fw->filtersPerWheel; i++ )
   {
-     EEPROMWriteString( eepromAddr, filterNames[i], MAX_NAME_LENGTH ); 
+     EEPROMWriteString( eepromAddr, fw->filterNames[i], MAX_NAME_LENGTH );
      eepromAddr += (MAX_NAME_LENGTH * sizeof(char) );
-     DEBUGS1( "Written filterNames[]: ");DEBUGSL1( filterNames[i] );
+     DEBUGS1( F("Written filterNames[]: "));DEBUGSL1( fw->filterNames[i] );
   }
-  
-  EEPROMWriteAnything( eepromAddr=0, byte('#') );
-  DEBUGSL1( "saveToEeprom: exiting ");
-
-  EEPROM.commit();
 
-  //Test readback of contents
-  char ch;
-  String input;
-  for (i=0; i< 512 ; i++ )
-  {
-    ch = (char) EEPROM.read( i );
-    if ( ch == '\0' )
-      ch = '_';
-    input.concat( ch );
-  }
+  //motion settings
+  eepromAddr = FW_EEPROM_BASE + ( fw->deviceNumber * FW_EEPROM_BLOCK_SIZE ) + FW_EEPROM_MOTION_OFFSET;
+  slewMode = fw->motion.getSlewMode();
+  approachSteps = fw->motion.getApproachSteps();
+  EEPROM.write( eepromAddr, (byte) slewMode );
+  EEPROMWriteAnything( eepromAddr + 1, approachSteps );
+  EEPROM.write( eepromAddr + 1 + sizeof( approachSteps ), (byte) fw->motion.getStepInterval() );
+  EEPROM.write( eepromAddr + 2 + sizeof( approachSteps ), (byte) fw->motion.getBacklash() );
+  DEBUGS1( F("Written slewMode: "));DEBUGSL1( slewMode );
+  DEBUGS1( F("Written approachSteps: "));DEBUGSL1( approachSteps );
 
-  Serial.printf( "EEPROM contents: %s \n", input.c_str() );
+  //focuser link
+  eepromAddr = FW_EEPROM_BASE + ( fw->deviceNumber * FW_EEPROM_BLOCK_SIZE ) + FW_EEPROM_FOCUSER_OFFSET;
+  EEPROM.write( eepromAddr, (byte) fw->focuser.enabled );
+  EEPROM.write( eepromAddr + 1, (byte) fw->focuser.relative );
+  EEPROMWriteAnything( eepromAddr + 2, fw->focuser.port );
+  EEPROM.write( eepromAddr + 2 + sizeof( fw->focuser.port ), fw->focuser.device );
+  EEPROMWriteString( eepromAddr + 3 + sizeof( fw->focuser.port ), fw->focuser.host, MAX_NAME_LENGTH );
+  DEBUGS1( F("Written focuser host: "));DEBUGSL1( fw->focuser.host );
 }
 
 void setupFromEeprom()
@@ -121,94 +223,161 @@ void setupFromEeprom()
   int eepromAddr = 0;
   byte bTemp = 0;
   int i=0;
-    
-  DEBUGSL1( "setUpFromEeprom: Entering ");
-  
+
+  DEBUGSL1( F("setUpFromEeprom: Entering "));
+
   //Setup internal variables - read from EEPROM.
   bTemp = EEPROM.read( eepromAddr );
-  DEBUGS1( "Read init byte: ");DEBUGSL1( (char) bTemp );
+  DEBUGS1( F("Read init byte: "));DEBUGSL1( (char) bTemp );
   if ( (byte) bTemp != '#' ) //initialise
   {
     setDefaults();
     saveToEeprom();
-    DEBUGSL1( "Failed to find init byte - wrote defaults ");
+    DEBUGSL1( F("Failed to find init byte - wrote defaults "));
     return;
-  }    
-    
-  //hostname - directly into variable array 
+  }
+
+  //hostname - directly into variable array
   if( hostname != NULL ) free (hostname);
   hostname = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
   i = EEPROMReadString( eepromAddr=1, hostname, MAX_NAME_LENGTH );
   eepromAddr += MAX_NAME_LENGTH;
-  DEBUGS1( "Read hostname: ");DEBUGSL1( hostname );
+  DEBUGS1( F("Read hostname: "));DEBUGSL1( hostname );
 
   //MQTT ID  - copy hostname
   if( thisID != NULL ) free (thisID);
   thisID = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
   strcpy( thisID, hostname );
-  DEBUGS1( "Read MQTT ID: ");DEBUGSL1( thisID );
+  DEBUGS1( F("Read MQTT ID: "));DEBUGSL1( thisID );
+
+  //power profile - an unset byte reads back as 0xFF, initPowerState() falls back to Performance
+  initPowerState( EEPROM.read( FW_EEPROM_POWER_ADDR ) );
+  DEBUGS1( F("Read power profile: "));DEBUGSL1( powerProfileName( powerState.profile ) );
+
+  for ( i=0; i < FILTERWHEEL_COUNT; i++ )
+    setupDeviceFromEeprom( &filterWheels[i] );
+}
+
+void setupDeviceFromEeprom( FilterWheel* fw )
+{
+  int eepromAddr = FW_EEPROM_BASE + ( fw->deviceNumber * FW_EEPROM_BLOCK_SIZE );
+  int filterCount = 0;
+  int slewMode = 0;
+  int approachSteps = 0;
+  int stepInterval = 0;
+  int backlash = 0;
+  byte bTemp = 0;
+  int i=0;
 
-  //wheel name 
-  if( wheelName != NULL ) free (wheelName);
-  wheelName = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
-  i = EEPROMReadString( eepromAddr, wheelName, MAX_NAME_LENGTH );
+  DEBUGS1( F("setupDeviceFromEeprom: Entering for device "));DEBUGSL1( fw->deviceNumber );
+
+  //Check the block has been written before - a wheel added since the last save won't have been.
+  EEPROMReadAnything( eepromAddr + MAX_NAME_LENGTH + sizeof(fw->currentFilterId), filterCount );
+  if( filterCount <= 0 || filterCount > MAX_FILTER_COUNT )
+  {
+    DEBUGSL1( F("No valid settings block found - using defaults "));
+    setDeviceDefaults( fw );
+    return;
+  }
+
+  //wheel name
+  if( fw->wheelName != NULL ) free( fw->wheelName );
+  fw->wheelName = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
+  i = EEPROMReadString( eepromAddr, fw->wheelName, MAX_NAME_LENGTH );
   eepromAddr += MAX_NAME_LENGTH;
-  DEBUGS1( "Read wheelName: ");DEBUGSL1( wheelName );
-  
+  DEBUGS1( F("Read wheelName: "));DEBUGSL1( fw->wheelName );
+
   //current filter id
-  EEPROMReadAnything( eepromAddr, currentFilterId ); 
-  eepromAddr += sizeof(currentFilterId);
-  DEBUGS1( "Read currentFilterId: ");DEBUGSL1( currentFilterId );
-  
-  //number of filters
-  EEPROMReadAnything( eepromAddr, filtersPerWheel ); 
-  eepromAddr += sizeof( filtersPerWheel );
-  if( filtersPerWheel >12 )
-    filtersPerWheel = 5; //default
-  DEBUGS1( "Read filtersPerWheel: ");DEBUGSL1( filtersPerWheel );
-  
+  EEPROMReadAnything( eepromAddr, fw->currentFilterId );
+  eepromAddr += sizeof( fw->currentFilterId );
+  DEBUGS1( F("Read currentFilterId: "));DEBUGSL1( fw->currentFilterId );
+
+  //number of filters - release the old per-filter arrays before re-sizing
+  if ( fw->filterNames != NULL )
+  {
+    for ( i=0; i < fw->filtersPerWheel; i++ )
+    {
+      if( fw->filterNames[i] != NULL )
+        free( fw->filterNames[i] );
+    }
+    free( fw->filterNames );
+  }
+  EEPROMReadAnything( eepromAddr, fw->filtersPerWheel );
+  eepromAddr += sizeof( fw->filtersPerWheel );
+  DEBUGS1( F("Read filtersPerWheel: "));DEBUGSL1( fw->filtersPerWheel );
+  if( fw->currentFilterId < 0 || fw->currentFilterId >= fw->filtersPerWheel )
+    fw->currentFilterId = 0;
+
   //positions
-  if( filterPositions != NULL) free( filterPositions);
-  filterPositions = (int*) calloc( filtersPerWheel, sizeof(int) );  
-  for ( i=0; i < filtersPerWheel; i++ )
+  if( fw->filterPositions != NULL ) free( fw->filterPositions );
+  fw->filterPositions = (int*) calloc( fw->filtersPerWheel, sizeof(int) );
+  for ( i=0; i < fw->filtersPerWheel; i++ )
   {
-     EEPROMReadAnything( eepromAddr, filterPositions[i] ); 
-     eepromAddr += sizeof( filterPositions[i] );
-     DEBUGS1( "Read filterPositions[] ");DEBUGSL1( filterPositions[i] );
+     EEPROMReadAnything( eepromAddr, fw->filterPositions[i] );
+     eepromAddr += sizeof( fw->filterPositions[i] );
+     DEBUGS1( F("Read filterPositions[] "));DEBUGSL1( fw->filterPositions[i] );
   }
-  
-  //stepPosition - should always be at the step Position for the current filter ID. 
-  stepPosition = filterPositions[currentFilterId];
-  targetFilterId = currentFilterId;
-      
+
+  //stepPosition - should always be at the step Position for the current filter ID.
+  fw->motion.setPosition( fw->filterPositions[fw->currentFilterId] * MICROSTEPS_PER_STEP );
+  fw->targetFilterId = fw->currentFilterId;
+
   //focus offsets
-  if( focusOffsets != NULL ) free(focusOffsets);
-  focusOffsets = (int*) calloc( filtersPerWheel, sizeof(int) );  
-  for ( i=0; i < filtersPerWheel; i++ )
+  if( fw->focusOffsets != NULL ) free( fw->focusOffsets );
+  fw->focusOffsets = (int*) calloc( fw->filtersPerWheel, sizeof(int) );
+  for ( i=0; i < fw->filtersPerWheel; i++ )
   {
-     EEPROMReadAnything( eepromAddr, focusOffsets[i] ); 
-     eepromAddr += sizeof(focusOffsets[i]);
-     DEBUGS1( "Read focusOffsets[] ");DEBUGSL1( focusOffsets[i] );
+     EEPROMReadAnything( eepromAddr, fw->focusOffsets[i] );
+     eepromAddr += sizeof( fw->focusOffsets[i] );
+     DEBUGS1( F("Read focusOffsets[] "));DEBUGSL1( fw->focusOffsets[i] );
   }
-  
-  //filtername length/filter name 
-  if ( filterNames != NULL ) 
+
+  //filtername length/filter name
+  fw->filterNames = (char**) calloc( sizeof(char*), fw->filtersPerWheel );
+  for ( i=0; i < fw->filtersPerWheel; i++ )
   {
-    for ( i=0; filtersPerWheel; i++ )
-    {
-      if( filterNames[i] != NULL ) 
-        free( filterNames[i]);
-    }
-    free( filterNames);
+     fw->filterNames[i] = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
+     EEPROMReadString( eepromAddr, fw->filterNames[i], MAX_NAME_LENGTH  );
+     eepromAddr += (MAX_NAME_LENGTH * sizeof(char));
+     DEBUGS1( F("Read filterNames[] "));DEBUGSL1( fw->filterNames[i] );
   }
-  filterNames = (char**) calloc( sizeof(char*), filtersPerWheel );
-  for ( i=0; i < filtersPerWheel; i++ )
+
+  //motion settings - blocks saved before these were added hold erased bytes here
+  eepromAddr = FW_EEPROM_BASE + ( fw->deviceNumber * FW_EEPROM_BLOCK_SIZE ) + FW_EEPROM_MOTION_OFFSET;
+  slewMode = EEPROM.read( eepromAddr );
+  EEPROMReadAnything( eepromAddr + 1, approachSteps );
+  stepInterval = EEPROM.read( eepromAddr + 1 + sizeof( approachSteps ) );
+  backlash = EEPROM.read( eepromAddr + 2 + sizeof( approachSteps ) );
+  if( slewMode != STEP_FULL && slewMode != STEP_HALF )
+    slewMode = STEP_FULL;
+  if( approachSteps < 0 || approachSteps > stepsPerRevolution/2 )
+    approachSteps = defaultApproachSteps;
+  if( stepInterval < minStepIntervalMs || stepInterval > maxStepIntervalMs )
+    stepInterval = stepIntervalMs;
+  if( backlash > maxBacklashSteps )
+    backlash = 0;
+  fw->motion.setSlewMode( slewMode );
+  fw->motion.setStepInterval( stepInterval );
+  fw->motion.setApproachSteps( approachSteps );
+  fw->motion.setBacklash( backlash );
+  DEBUGS1( F("Read slewMode: "));DEBUGSL1( slewMode );
+  DEBUGS1( F("Read approachSteps: "));DEBUGSL1( approachSteps );
+  DEBUGS1( F("Read stepInterval: "));DEBUGSL1( stepInterval );
+  DEBUGS1( F("Read backlash: "));DEBUGSL1( backlash );
+
+  //focuser link - left off unless the block was written with it
+  eepromAddr = FW_EEPROM_BASE + ( fw->deviceNumber * FW_EEPROM_BLOCK_SIZE ) + FW_EEPROM_FOCUSER_OFFSET;
+  bTemp = EEPROM.read( eepromAddr );
+  if( bTemp == 0 || bTemp == 1 )
   {
-     filterNames[i] = (char*) calloc( sizeof(char), MAX_NAME_LENGTH );
-     EEPROMReadString( eepromAddr, filterNames[i], MAX_NAME_LENGTH  );
-     eepromAddr += (MAX_NAME_LENGTH * sizeof(char));
-     DEBUGS1( "Read filterNames[] ");DEBUGSL1( filterNames[i] );
+    fw->focuser.enabled = ( bTemp == 1 );
+    fw->focuser.relative = ( EEPROM.read( eepromAddr + 1 ) == 1 );
+    EEPROMReadAnything( eepromAddr + 2, fw->focuser.port );
+    fw->focuser.device = EEPROM.read( eepromAddr + 2 + sizeof( fw->focuser.port ) );
+    EEPROMReadString( eepromAddr + 3 + sizeof( fw->focuser.port ), fw->focuser.host, MAX_NAME_LENGTH );
+    fw->focuser.host[MAX_NAME_LENGTH-1] = '\0';
   }
- DEBUGS1( "setupFromEeprom: exiting having read " );DEBUGS1( eepromAddr );DEBUGSL1( " bytes." );
+  DEBUGS1( F("Read focuser host: "));DEBUGSL1( fw->focuser.host );
+  DEBUGS1( F("setupDeviceFromEeprom: exiting at address ") );DEBUGSL1( eepromAddr );
 }
 #endif
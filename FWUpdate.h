@@ -0,0 +1,190 @@
+/*
+ Firmware update over HTTP, replacing ESP8266HTTPUpdateServer.
+ The image is streamed straight into the update partition as it arrives and hashed on the way through.
+ The partition is only switched once the SHA-256 supplied with the request matches, otherwise the update is abandoned.
+ Gzip compressed images ( gzip -9 firmware.bin ) are accepted as-is - the core's Updater recognises them and eboot
+ inflates the image as it copies it into place at the next boot, so only the compressed size crosses the WiFi link.
+ Updates are refused while any wheel is moving, and wheel moves are refused while an update is being received.
+
+ curl -F "image=@firmware.bin.gz" "http://espFwl01/update?sha256=`sha256sum firmware.bin.gz | cut -d' ' -f1`"
+*/
+#if !defined _FWUPDATE_H_
+#define _FWUPDATE_H_
+#include <bearssl/bearssl_hash.h>
+
+enum updateStates { UPDATE_IDLE, UPDATE_RECEIVING, UPDATE_COMPLETE, UPDATE_FAILED };
+const char updateStateIdle[] PROGMEM = "Idle";
+const char updateStateReceiving[] PROGMEM = "Receiving";
+const char updateStateComplete[] PROGMEM = "Complete";
+const char updateStateFailed[] PROGMEM = "Failed";
+const char* const updateStateNames[] PROGMEM = { updateStateIdle, updateStateReceiving, updateStateComplete, updateStateFailed };
+
+struct FirmwareUpdate
+{
+  int state;
+  bool compressed;
+  uint32_t bytesReceived;
+  uint32_t expectedSize;  //optional size= argument, used for progress
+  uint32_t startTime;
+  uint32_t elapsed;       //msecs from first to last byte
+  char expectedHash[65];
+  String errMsg;
+  br_sha256_context hash;
+};
+FirmwareUpdate firmwareUpdate;
+
+const char updateForm[] PROGMEM = R"=====(<html><head></head><body>
+<h1>Firmware update</h1>
+<form method="POST" enctype="multipart/form-data" id="update" onsubmit="this.action='/update?sha256='+document.getElementById('sha256').value.trim()+'&size='+document.getElementById('image').files[0].size;">
+Image ( .bin or gzip compressed .bin.gz ) <input type="file" name="image" id="image"><br>
+SHA-256 of the image <input type="text" name="sha256" id="sha256" size="64"><br>
+<input type="submit" value="update">
+</form>
+<p>Progress: /update/status</p>
+</body></html>)=====";
+
+void handleUpdateForm(void);
+void handleUpdateStatusGet(void);
+void handleUpdateUpload(void);
+void handleUpdateDone(void);
+bool isUpdating(void);
+void updateFailed( const String& errMsg );
+
+bool isUpdating( void )
+{
+  return firmwareUpdate.state == UPDATE_RECEIVING;
+}
+
+void updateFailed( const String& errMsg )
+{
+  DEBUGS1( F("Firmware update failed: ") );DEBUGSL1( errMsg );
+  if( firmwareUpdate.state == UPDATE_RECEIVING )
+    Update.end( false ); //Abandons the written image - the boot partition is unchanged
+  firmwareUpdate.state = UPDATE_FAILED;
+  firmwareUpdate.errMsg = errMsg;
+  firmwareUpdate.elapsed = millis() - firmwareUpdate.startTime;
+}
+
+//GET /update
+void handleUpdateForm( void )
+{
+  server.send_P( 200, "text/html", updateForm );
+}
+
+//GET /update/status - progress of the current or last update
+void handleUpdateStatusGet( void )
+{
+  String message;
+  //JSON data formatter
+  DynamicJsonBuffer jsonBuffer(256);
+  JsonObject& root = jsonBuffer.createObject();
+  root["State"] = FPSTR( pgm_read_ptr( &updateStateNames[firmwareUpdate.state] ) );
+  root["BytesReceived"] = firmwareUpdate.bytesReceived;
+  root["ExpectedSize"] = firmwareUpdate.expectedSize;
+  root["Percent"] = ( firmwareUpdate.expectedSize > 0 )? ( firmwareUpdate.bytesReceived * 100 ) / firmwareUpdate.expectedSize : 0;
+  root["Compressed"] = firmwareUpdate.compressed;
+  root["ElapsedMs"] = ( firmwareUpdate.state == UPDATE_RECEIVING )? millis() - firmwareUpdate.startTime : firmwareUpdate.elapsed;
+  root["ErrorMessage"] = firmwareUpdate.errMsg;
+  root.printTo(message);
+  server.send(200, "application/json", message);
+}
+
+/*
+ * Upload handler - called for each chunk of the multipart body.
+ * The sha256 and size arguments come from the query string since form fields aren't available until the upload is complete.
+ */
+void handleUpdateUpload( void )
+{
+  HTTPUpload& upload = server.upload();
+  uint8_t digest[32];
+  char hexDigest[65];
+  int i=0;
+
+  switch( upload.status )
+  {
+    case UPLOAD_FILE_START:
+      DEBUGS1( F("Firmware update starting: ") );DEBUGSL1( upload.filename );
+      firmwareUpdate.state = UPDATE_IDLE;
+      firmwareUpdate.compressed = false;
+      firmwareUpdate.bytesReceived = 0;
+      firmwareUpdate.expectedSize = server.arg("size").toInt();
+      firmwareUpdate.startTime = millis();
+      firmwareUpdate.elapsed = 0;
+      firmwareUpdate.errMsg = "";
+      for ( i=0; i < FILTERWHEEL_COUNT; i++ )
+      {
+        if( filterWheels[i].motion.isMoving() )
+        {
+          updateFailed( F("Filter wheel moving - update refused") );
+          return;
+        }
+      }
+      if( server.arg("sha256").length() != 64 )
+      {
+        updateFailed( F("sha256 argument missing or invalid") );
+        return;
+      }
+      strcpy( firmwareUpdate.expectedHash, server.arg("sha256").c_str() );
+      if( !Update.begin( ( ESP.getFreeSketchSpace() - 0x1000 ) & 0xFFFFF000 ) )
+      {
+        updateFailed( Update.getErrorString() );
+        return;
+      }
+      br_sha256_init( &firmwareUpdate.hash );
+      firmwareUpdate.state = UPDATE_RECEIVING;
+      break;
+
+    case UPLOAD_FILE_WRITE:
+      if( firmwareUpdate.state != UPDATE_RECEIVING )
+        return;
+      if( firmwareUpdate.bytesReceived == 0 && upload.currentSize >= 2 )
+        firmwareUpdate.compressed = ( upload.buf[0] == 0x1F && upload.buf[1] == 0x8B );
+      br_sha256_update( &firmwareUpdate.hash, upload.buf, upload.currentSize );
+      if( Update.write( upload.buf, upload.currentSize ) != upload.currentSize )
+      {
+        updateFailed( Update.getErrorString() );
+        return;
+      }
+      firmwareUpdate.bytesReceived += upload.currentSize;
+      break;
+
+    case UPLOAD_FILE_END:
+      if( firmwareUpdate.state != UPDATE_RECEIVING )
+        return;
+      br_sha256_out( &firmwareUpdate.hash, digest );
+      for ( i=0; i < 32; i++ )
+        sprintf( &hexDigest[i*2], "%02x", digest[i] );
+      if( strcasecmp( hexDigest, firmwareUpdate.expectedHash ) != 0 )
+      {
+        updateFailed( String( F("SHA-256 mismatch, received image hashes to ") ) + hexDigest );
+        return;
+      }
+      //Hash verified - only now mark the new image for installation
+      if( !Update.end( true ) )
+      {
+        updateFailed( Update.getErrorString() );
+        return;
+      }
+      firmwareUpdate.state = UPDATE_COMPLETE;
+      firmwareUpdate.elapsed = millis() - firmwareUpdate.startTime;
+      DEBUGS1( F("Firmware update verified, bytes: ") );DEBUGSL1( firmwareUpdate.bytesReceived );
+      break;
+
+    default:
+      updateFailed( F("Upload aborted") );
+      break;
+  }
+}
+
+//POST /update - called once the upload has completed
+void handleUpdateDone( void )
+{
+  handleUpdateStatusGet();
+  if( firmwareUpdate.state == UPDATE_COMPLETE )
+  {
+    Serial.println( F("Firmware updated - restarting") );
+    delay( 100 );
+    device.restart();
+  }
+}
+#endif
@@ -0,0 +1,483 @@
+/*
+ Runs a filter's focus offset on an Alpaca focuser alongside the wheel move, so the two don't happen back to back.
+ The Position command starts the offset change - the new filter's offset less the current one's - as it starts the wheel,
+ and the filter change isn't complete until both have finished.
+ The command only queues the offset, it makes no network calls - the requests are all made from the loop, each written
+ and its reply collected over the following passes. The focuser's name is looked up when the settings are applied, not
+ on a move. The connection ( ESPAsyncTCP's AsyncClient ) is opened without waiting - the loop polls it for up to
+ FOCUS_CONNECT_TIMEOUT_MS and sends the request once it is open - and kept open between requests. A request on a kept
+ connection the focuser had already closed is sent again once on a new one. Replies arrive through the client's data
+ callback and are framed by their Content-Length, by chunked transfer coding or by the focuser closing the connection.
+ An absolute focuser is read for its position and moved to position + offset change, a relative one is moved by the change,
+ then IsMoving is polled until the focuser stops. After FOCUS_MAX_FAILURES failed moves in a row the link is suspended
+ until the focuser settings are applied again. The receive buffer is only allocated while the link is enabled.
+*/
+#if !defined _FOCUSERLINK_H_
+#define _FOCUSERLINK_H_
+
+const int FOCUS_RX_SIZE = 512;
+const uint32_t FOCUS_CONNECT_TIMEOUT_MS = 1000;
+const uint32_t FOCUS_REPLY_TIMEOUT_MS = 2000;
+const uint32_t FOCUS_POLL_MS = 100;
+const uint32_t FOCUS_MOVE_TIMEOUT_MS = 120000;
+const uint16_t FOCUS_DEFAULT_PORT = 80;
+const int FOCUS_MAX_FAILURES = 3;
+
+enum focuserStates { FOCUS_IDLE, FOCUS_START, FOCUS_READ_POSITION, FOCUS_MOVE, FOCUS_POLL_WAIT, FOCUS_POLL };
+enum focuserReplies { FOCUS_REPLY_PENDING, FOCUS_REPLY_OK, FOCUS_REPLY_FAILED };
+
+struct FocuserLink
+{
+  //Settings
+  bool enabled;
+  bool relative;          //focuser moves by a step count rather than to a position
+  char host[MAX_NAME_LENGTH];
+  uint16_t port;
+  uint8_t device;         //focuser's Alpaca device number
+
+  //Connection
+  IPAddress address;
+  bool resolved;          //address looked up from host
+  bool reused;            //request in flight went on a connection kept from an earlier one
+  bool closed;            //the connection in use has closed or failed to open
+  bool sendQueued;        //request waiting on the connection to open
+  AsyncClient client;
+
+  //Move in progress
+  int state;
+  int delta;              //offset change, focuser steps
+  uint32_t clientID;      //requests are made for the client that asked for the filter
+  uint32_t transID;
+  uint32_t startMs;
+  uint32_t requestMs;     //when the request in flight was sent, or the next poll is due
+  bool put;               //request in flight, kept to send it again
+  const char* property;
+  int position;
+  char* rx;               //FOCUS_RX_SIZE while enabled, the request is formatted here before it is sent
+  int rxCount;
+
+  //Statistics
+  uint32_t moves;
+  uint32_t errors;
+  uint32_t connects;
+  uint32_t lastDurationMs;
+  int lastError;          //Alpaca error number, or 0x500 if the focuser couldn't be reached
+  int failures;           //failed moves in a row
+  bool suspended;         //given up on after FOCUS_MAX_FAILURES
+};
+
+void initFocuserLink( FocuserLink* fl );
+bool focuserBusy( FocuserLink* fl );
+void applyFocuserSettings( FocuserLink* fl );
+bool startFocuserOffset( FocuserLink* fl, int delta, uint32_t clientID );
+bool updateFocuserLink( FocuserLink* fl );
+bool connectFocuser( FocuserLink* fl );
+void onFocuserData( void* arg, AsyncClient* client, void* data, size_t length );
+void onFocuserDisconnect( void* arg, AsyncClient* client );
+bool sendFocuserRequest( FocuserLink* fl, bool put, const char* property, int position );
+bool writeFocuserRequest( FocuserLink* fl );
+const char* focuserReplyHeader( const char* rx, const char* end, PGM_P name );
+int focuserChunks( char* body, bool decode );
+int readFocuserReply( FocuserLink* fl, int* value );
+void endFocuserMove( FocuserLink* fl, int error );
+
+void initFocuserLink( FocuserLink* fl )
+{
+  fl->enabled = false;
+  fl->relative = false;
+  fl->host[0] = '\0';
+  fl->port = FOCUS_DEFAULT_PORT;
+  fl->device = 0;
+  fl->resolved = false;
+  fl->reused = false;
+  fl->closed = true;
+  fl->sendQueued = false;
+  fl->client.onData( onFocuserData, fl );
+  fl->client.onDisconnect( onFocuserDisconnect, fl );
+  fl->state = FOCUS_IDLE;
+  fl->delta = 0;
+  fl->clientID = 0;
+  fl->transID = 0;
+  fl->startMs = 0;
+  fl->requestMs = 0;
+  fl->put = false;
+  fl->property = NULL;
+  fl->position = 0;
+  fl->rx = NULL;
+  fl->rxCount = 0;
+  fl->moves = 0;
+  fl->errors = 0;
+  fl->connects = 0;
+  fl->lastDurationMs = 0;
+  fl->lastError = 0;
+  fl->failures = 0;
+  fl->suspended = false;
+}
+
+bool focuserBusy( FocuserLink* fl )
+{
+  return fl->state != FOCUS_IDLE;
+}
+
+/*
+ * The focuser settings have been set - drop the connection and look the focuser up once, here rather than on a move.
+ * Allocates the receive buffer when the link is enabled and frees it when it isn't. Clears a suspended link.
+ */
+void applyFocuserSettings( FocuserLink* fl )
+{
+  fl->client.close( true );
+  fl->resolved = false;
+  fl->failures = 0;
+  fl->suspended = false;
+  if( !fl->enabled )
+  {
+    free( fl->rx );
+    fl->rx = NULL;
+    return;
+  }
+  if( fl->rx == NULL )
+    fl->rx = (char*) malloc( FOCUS_RX_SIZE );
+  if( fl->host[0] != '\0' )
+  {
+    fl->resolved = ( WiFi.hostByName( fl->host, fl->address ) == 1 );
+    if( !fl->resolved )
+    {
+      DEBUGS1( F("Focuser: can't resolve ") );DEBUGSL1( fl->host );
+    }
+  }
+}
+
+/*
+ * Queue a focuser move by delta steps, the loop makes the requests. Returns true if a move was queued -
+ * false if the link is off or suspended or there is nothing to move. A focuser that can't be reached ends the move
+ * from the loop.
+ */
+bool startFocuserOffset( FocuserLink* fl, int delta, uint32_t clientID )
+{
+  if( !fl->enabled || fl->suspended || fl->rx == NULL || delta == 0 || fl->host[0] == '\0' || focuserBusy( fl ) )
+    return false;
+
+  fl->delta = delta;
+  fl->clientID = clientID;
+  fl->startMs = millis();
+  fl->moves++;
+  fl->state = FOCUS_START;
+  DEBUGS1( F("Focuser offset queued: ") );DEBUGSL1( delta );
+  return true;
+}
+
+/*
+ * Loop processing - collect the reply to the request in flight and send the next one.
+ * Returns true when the focuser move has just ended, whether it succeeded or not.
+ */
+bool updateFocuserLink( FocuserLink* fl )
+{
+  int value = 0;
+  int reply = FOCUS_REPLY_PENDING;
+
+  if( fl->state == FOCUS_IDLE )
+    return false;
+  if( ( millis() - fl->startMs ) > FOCUS_MOVE_TIMEOUT_MS )
+  {
+    DEBUGSL1( F("Focuser offset timed out") );
+    endFocuserMove( fl, 0x500 );
+    return true;
+  }
+
+  if( fl->sendQueued )
+  {
+    //Waiting on the connection to open
+    if( fl->client.connected() )
+      return !writeFocuserRequest( fl );
+    if( fl->closed || ( millis() - fl->requestMs ) > FOCUS_CONNECT_TIMEOUT_MS )
+    {
+      DEBUGS1( F("Focuser: can't connect to ") );DEBUGSL1( fl->host );
+      endFocuserMove( fl, 0x500 );
+      return true;
+    }
+    return false;
+  }
+
+  if( fl->state == FOCUS_START )
+  {
+    if( fl->relative )
+    {
+      fl->state = FOCUS_MOVE;
+      return !sendFocuserRequest( fl, true, "move", fl->delta );
+    }
+    fl->state = FOCUS_READ_POSITION;
+    return !sendFocuserRequest( fl, false, "position", 0 );
+  }
+
+  if( fl->state == FOCUS_POLL_WAIT )
+  {
+    if( ( millis() - fl->requestMs ) < FOCUS_POLL_MS )
+      return false;
+    fl->state = FOCUS_POLL;
+    if( !sendFocuserRequest( fl, false, "ismoving", 0 ) )
+      return true;
+    return false;
+  }
+
+  reply = readFocuserReply( fl, &value );
+  if( reply == FOCUS_REPLY_PENDING )
+    return false;
+  if( reply == FOCUS_REPLY_FAILED )
+    return true;
+
+  switch( fl->state )
+  {
+    case FOCUS_READ_POSITION:
+      fl->state = FOCUS_MOVE;
+      if( !sendFocuserRequest( fl, true, "move", value + fl->delta ) )
+        return true;
+      break;
+    case FOCUS_MOVE:
+      fl->state = FOCUS_POLL_WAIT;
+      fl->requestMs = millis();
+      break;
+    case FOCUS_POLL:
+      if( value == 0 )
+      {
+        endFocuserMove( fl, 0 );
+        return true;
+      }
+      fl->state = FOCUS_POLL_WAIT;
+      fl->requestMs = millis();
+      break;
+  }
+  return false;
+}
+
+//Start opening a connection to the looked up focuser - updateFocuserLink() sends the request once it is open
+bool connectFocuser( FocuserLink* fl )
+{
+  fl->client.close( true );
+  fl->closed = false;
+  if( !fl->resolved )
+    return false;
+  if( !fl->client.connect( fl->address, fl->port ) )
+    return false;
+  fl->client.setNoDelay( true );
+  fl->connects++;
+  return true;
+}
+
+//Collect the reply as it arrives, anything past the buffer is dropped
+void onFocuserData( void* arg, AsyncClient* client, void* data, size_t length )
+{
+  FocuserLink* fl = (FocuserLink*) arg;
+  int count = 0;
+
+  if( fl->rx == NULL )
+    return;
+  count = min( (int) length, FOCUS_RX_SIZE - 1 - fl->rxCount );
+  memcpy( &fl->rx[fl->rxCount], data, count );
+  fl->rxCount += count;
+  fl->rx[fl->rxCount] = '\0';
+}
+
+void onFocuserDisconnect( void* arg, AsyncClient* client )
+{
+  ( (FocuserLink*) arg )->closed = true;
+}
+
+/*
+ * Send one Alpaca request, on the kept connection if the focuser hasn't closed it, otherwise once a new one opens.
+ * Ends the move on failure.
+ */
+bool sendFocuserRequest( FocuserLink* fl, bool put, const char* property, int position )
+{
+  fl->transID++;
+  fl->requestMs = millis();
+  fl->put = put;
+  fl->property = property;
+  fl->position = position;
+  fl->reused = fl->client.connected();
+  if( fl->reused )
+    return writeFocuserRequest( fl );
+  if( !connectFocuser( fl ) )
+  {
+    DEBUGS1( F("Focuser: can't connect to ") );DEBUGSL1( fl->host );
+    endFocuserMove( fl, 0x500 );
+    return false;
+  }
+  fl->sendQueued = true;
+  return true;
+}
+
+//Format the request in the receive buffer and write it, the client copies it. Ends the move on failure.
+bool writeFocuserRequest( FocuserLink* fl )
+{
+  char path[64];
+  char params[64];
+  int length = 0;
+
+  fl->sendQueued = false;
+  snprintf_P( path, sizeof( path ), PSTR("/api/v1/focuser/%u/%s"), fl->device, fl->property );
+  if( fl->put )
+  {
+    snprintf_P( params, sizeof( params ), PSTR("Position=%d&ClientID=%u&ClientTransactionID=%u"), fl->position, fl->clientID, fl->transID );
+    length = snprintf_P( fl->rx, FOCUS_RX_SIZE, PSTR("PUT %s HTTP/1.1\r\nHost: %s\r\n"
+                         "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %u\r\n\r\n%s"),
+                         path, fl->host, (unsigned) strlen( params ), params );
+  }
+  else
+  {
+    snprintf_P( params, sizeof( params ), PSTR("ClientID=%u&ClientTransactionID=%u"), fl->clientID, fl->transID );
+    length = snprintf_P( fl->rx, FOCUS_RX_SIZE, PSTR("GET %s?%s HTTP/1.1\r\nHost: %s\r\n\r\n"), path, params, fl->host );
+  }
+  fl->requestMs = millis();
+  if( fl->client.write( fl->rx, min( length, FOCUS_RX_SIZE - 1 ) ) == 0 )
+  {
+    DEBUGSL1( F("Focuser: can't send") );
+    endFocuserMove( fl, 0x500 );
+    return false;
+  }
+  fl->rxCount = 0;
+  fl->rx[0] = '\0';
+  return true;
+}
+
+//Value of a reply header, NULL if the reply up to end doesn't have it
+const char* focuserReplyHeader( const char* rx, const char* end, PGM_P name )
+{
+  size_t length = strlen_P( name );
+  const char* line = strstr( rx, "\r\n" );
+
+  while( line != NULL && line < end )
+  {
+    line += 2;
+    if( strncasecmp_P( line, name, length ) == 0 && line[length] == ':' )
+    {
+      line += length + 1;
+      while( *line == ' ' )
+        line++;
+      return line;
+    }
+    line = strstr( line, "\r\n" );
+  }
+  return NULL;
+}
+
+/*
+ * Walk a chunked reply body. Returns its length once the last chunk is in, -1 before then.
+ * decode joins the chunks up in place.
+ */
+int focuserChunks( char* body, bool decode )
+{
+  char* in = body;
+  char* out = body;
+  char* line = NULL;
+  long size = 0;
+
+  while( ( line = strstr( in, "\r\n" ) ) != NULL )
+  {
+    size = strtol( in, NULL, 16 );
+    in = line + 2;
+    if( size <= 0 )
+    {
+      //Last chunk, then any trailers up to a blank line
+      if( strncmp( in, "\r\n", 2 ) != 0 && strstr( in, "\r\n\r\n" ) == NULL )
+        return -1;
+      if( decode )
+        *out = '\0';
+      return out - body;
+    }
+    if( (long) strlen( in ) < size + 2 )
+      return -1;
+    if( decode )
+      memmove( out, in, size );
+    out += size;
+    in += size + 2;
+  }
+  return -1;
+}
+
+/*
+ * Check what has arrived of the reply. Once it is complete - all of its Content-Length, its last chunk, or the focuser
+ * has closed the connection - check the status and the Alpaca ErrorNumber and return the Value - a boolean Value reads
+ * as 0 or 1. The connection is kept for the next request unless the focuser is closing it. A failed reply ends the move.
+ */
+int readFocuserReply( FocuserLink* fl, int* value )
+{
+  char* body = NULL;
+  const char* header = NULL;
+  const char* status = NULL;
+  bool complete = false;
+  bool chunked = false;
+  bool closed = false;
+
+  body = strstr( fl->rx, "\r\n\r\n" );
+  if( body != NULL && ( header = focuserReplyHeader( fl->rx, body, PSTR("Content-Length") ) ) != NULL )
+    complete = ( &fl->rx[fl->rxCount] - ( body + 4 ) ) >= atoi( header );
+  else if( body != NULL && ( header = focuserReplyHeader( fl->rx, body, PSTR("Transfer-Encoding") ) ) != NULL &&
+           strncasecmp_P( header, PSTR("chunked"), 7 ) == 0 )
+  {
+    chunked = true;
+    complete = ( focuserChunks( body + 4, false ) >= 0 );
+  }
+  closed = fl->closed;
+
+  if( !complete && !closed && fl->rxCount < FOCUS_RX_SIZE - 1 )
+  {
+    if( ( millis() - fl->requestMs ) < FOCUS_REPLY_TIMEOUT_MS )
+      return FOCUS_REPLY_PENDING;
+    DEBUGSL1( F("Focuser: no reply") );
+    endFocuserMove( fl, 0x500 );
+    return FOCUS_REPLY_FAILED;
+  }
+  if( closed && fl->rxCount == 0 && fl->reused )
+  {
+    //The focuser closed the kept connection before this request reached it
+    DEBUGSL1( F("Focuser: connection closed, reconnecting") );
+    return ( sendFocuserRequest( fl, fl->put, fl->property, fl->position ) )? FOCUS_REPLY_PENDING : FOCUS_REPLY_FAILED;
+  }
+  if( !complete || strncmp( fl->rx, "HTTP/1.0", 8 ) == 0 ||
+      ( ( header = focuserReplyHeader( fl->rx, body, PSTR("Connection") ) ) != NULL && strncasecmp_P( header, PSTR("close"), 5 ) == 0 ) )
+    fl->client.close( true );
+  if( chunked && complete )
+    focuserChunks( body + 4, true );
+
+  //Any HTTP version, the status code is what matters
+  status = strchr( fl->rx, ' ' );
+  if( strncmp( fl->rx, "HTTP/", 5 ) != 0 || status == NULL || atoi( status + 1 ) != 200 || body == NULL )
+  {
+    DEBUGS1( F("Focuser: request failed ") );DEBUGSL1( fl->rx );
+    endFocuserMove( fl, 0x500 );
+    return FOCUS_REPLY_FAILED;
+  }
+
+  DynamicJsonBuffer jsonBuffer(256);
+  JsonObject& root = jsonBuffer.parseObject( body + 4 );
+  if( !root.success() || root["ErrorNumber"].as<int>() != 0 )
+  {
+    DEBUGS1( F("Focuser: error reply ") );DEBUGSL1( body + 4 );
+    endFocuserMove( fl, ( root.success() )? root["ErrorNumber"].as<int>() : 0x500 );
+    return FOCUS_REPLY_FAILED;
+  }
+  *value = root["Value"].as<int>();
+  return FOCUS_REPLY_OK;
+}
+
+//The connection is kept for the next move unless the exchange failed. Repeated failures suspend the link.
+void endFocuserMove( FocuserLink* fl, int error )
+{
+  fl->state = FOCUS_IDLE;
+  fl->sendQueued = false;
+  fl->lastDurationMs = millis() - fl->startMs;
+  fl->lastError = error;
+  if( error == 0 )
+  {
+    fl->failures = 0;
+    return;
+  }
+  fl->client.close( true );
+  fl->errors++;
+  if( ++fl->failures >= FOCUS_MAX_FAILURES && !fl->suspended )
+  {
+    DEBUGSL1( F("Focuser: link suspended after repeated failures") );
+    fl->suspended = true;
+  }
+}
+#endif
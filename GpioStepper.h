@@ -0,0 +1,137 @@
+/*
+ StepperHardware for a step/direction driver wired to ESP8266 GPIO pins, timed by an ETSTimer soft alarm.
+ Enable is active low, the optional half step pin selects half steps when high.
+ The timer only queues a step tick event, the loop hands it on to the engine with deliverTick(). Only one tick is
+ queued at a time - a timer fire while one is still waiting is dropped, so a held up loop takes one step when it
+ gets to it rather than a burst, and can't fill the event queue with ticks.
+*/
+#if !defined _GPIOSTEPPER_H_
+#define _GPIOSTEPPER_H_
+#include "MotionEngine.h"
+
+class GpioStepper : public StepperHardware
+{
+  public:
+    GpioStepper( void );
+    void begin( uint8_t source, int dirn, int step, int enable, int halfStep );
+    void setDirection( int dirn );
+    void setEnabled( bool enable );
+    bool hasHalfStep( void ) { return halfStepPin != NO_PIN; }
+    void setStepMode( int mode );
+    void pulse( void );
+    void startTicks( void (*onTick)( void* ), void* arg, uint32_t intervalMs );
+    void stopTicks( void );
+    void deliverTick( void );
+
+  private:
+    static void onTimer( void* arg );
+
+    uint8_t eventSource;  //device number carried by the tick events
+    void (*tickFn)( void* );
+    void* tickArg;
+    int dirnPin;
+    int stepPin;
+    int enablePin;
+    int halfStepPin;  //NO_PIN if the driver is wired for full steps only
+    ETSTimer timer;
+    bool timerArmed;
+    volatile bool tickPending;  //a tick is queued and not yet delivered
+};
+
+GpioStepper::GpioStepper( void )
+{
+  dirnPin = NO_PIN;
+  stepPin = NO_PIN;
+  enablePin = NO_PIN;
+  halfStepPin = NO_PIN;
+  eventSource = 0;
+  tickFn = NULL;
+  tickArg = NULL;
+  timerArmed = false;
+  tickPending = false;
+}
+
+void GpioStepper::begin( uint8_t source, int dirn, int step, int enable, int halfStep )
+{
+  eventSource = source;
+  dirnPin = dirn;
+  stepPin = step;
+  enablePin = enable;
+  halfStepPin = halfStep;
+
+  pinMode( dirnPin, OUTPUT);
+  pinMode( stepPin, OUTPUT);
+  pinMode( enablePin, OUTPUT);
+  digitalWrite( dirnPin, DIRN_CW );
+  digitalWrite( stepPin, LOW);
+  digitalWrite( enablePin, HIGH); //Active low.
+  if( halfStepPin != NO_PIN )
+  {
+    pinMode( halfStepPin, OUTPUT );
+    digitalWrite( halfStepPin, LOW ); //Full steps
+  }
+}
+
+void GpioStepper::setDirection( int dirn )
+{
+  //Setup DIRN line
+  digitalWrite( dirnPin, dirn );
+  delayMicroseconds(200);
+}
+
+void GpioStepper::setEnabled( bool enable )
+{
+  digitalWrite( enablePin, ( enable )? LOW : HIGH );
+}
+
+void GpioStepper::setStepMode( int mode )
+{
+  if( halfStepPin == NO_PIN )
+    return;
+  digitalWrite( halfStepPin, ( mode == STEP_HALF )? HIGH : LOW );
+  delayMicroseconds(200);
+}
+
+void GpioStepper::pulse( void )
+{
+  //toggle step line
+  digitalWrite( stepPin, LOW);
+  delayMicroseconds(100);
+  digitalWrite( stepPin, HIGH);
+  delayMicroseconds(100);
+  digitalWrite( stepPin, LOW);
+}
+
+void GpioStepper::startTicks( void (*onTick)( void* ), void* arg, uint32_t intervalMs )
+{
+  //interrupt-based 'soft' alarm for software stepping
+  stopTicks();
+  tickFn = onTick;
+  tickArg = arg;
+  ets_timer_setfn( &timer, onTimer, this );
+  ets_timer_arm_new( &timer, intervalMs, 1/*repeat*/, 0 );//the last arg indicates usecs(1)  rather than msecs (0).
+  timerArmed = true;
+}
+
+void GpioStepper::stopTicks( void )
+{
+  if( timerArmed )
+    ets_timer_disarm( &timer );
+  timerArmed = false;
+}
+
+//Called from the loop for each queued tick
+void GpioStepper::deliverTick( void )
+{
+  tickPending = false;
+  if( timerArmed && tickFn != NULL )
+    tickFn( tickArg );
+}
+
+void GpioStepper::onTimer( void* arg )
+{
+  GpioStepper* stepper = (GpioStepper*) arg;
+  if( !stepper->tickPending )
+    stepper->tickPending = pushEventFromTask( EVENT_STEP_TICK, stepper->eventSource );
+}
+#endif
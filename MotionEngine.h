@@ -0,0 +1,374 @@
+/*
+ Stepper motion engine for one filter wheel.
+ Plans the shortest way round the wheel to a target, picks the step mode for each pulse and keeps the wheel position in microsteps.
+ The engine has no Arduino dependencies - the pins and the step timer are reached through the StepperHardware interface,
+ so the same code runs against GpioStepper ( GpioStepper.h ) on the ESP8266 or a simulated driver on a host.
+ tick() is called for each step timer tick, update() from the main loop does the stepping and returns true when a move completes.
+ estimateMoveMs() and remainingMs() predict move durations by counting the pulses the same plan would make, one per tick.
+ With backlash set, a move that turns the wheel round first takes up that many full steps of slack in the drive, which
+ turn the motor but not the wheel, so the position isn't changed by them.
+*/
+#if !defined _MOTIONENGINE_H_
+#define _MOTIONENGINE_H_
+#include <stdint.h>
+#include <stdlib.h>
+
+//Define direction constants
+#define DIRN_CW 0
+#define DIRN_CCW 1
+
+//Step modes - the value is the number of microsteps moved by one step pulse in that mode.
+//Positions are tracked in microsteps, the finest resolution the driver offers.
+enum stepModes { STEP_HALF = 1, STEP_FULL = 2 };
+#define MICROSTEPS_PER_STEP STEP_FULL
+
+class StepperHardware
+{
+  public:
+    virtual void setDirection( int dirn ) = 0;
+    virtual void setEnabled( bool enable ) = 0;
+    virtual bool hasHalfStep( void ) = 0;
+    virtual void setStepMode( int mode ) = 0;
+    virtual void pulse( void ) = 0;
+    //Call onTick( arg ) every intervalMs until stopTicks()
+    virtual void startTicks( void (*onTick)( void* ), void* arg, uint32_t intervalMs ) = 0;
+    virtual void stopTicks( void ) = 0;
+};
+
+class MotionEngine
+{
+  public:
+    MotionEngine( void );
+    void begin( StepperHardware* hardware, int microstepsPerRevolution, uint32_t stepIntervalMs );
+    void moveTo( int target );
+    void stop( void );
+    bool update( void );
+    void tick( void );
+    static void onTick( void* arg );
+    uint32_t estimateMoveMs( int from, int target );
+    uint32_t remainingMs( void );
+
+    bool isMoving( void ) { return moving; }
+    int getPosition( void ) { return stepPosition; }
+    void setPosition( int position );
+    int snapToStep( int position );
+    int getDistanceToGo( void ) { return targetDistance; }
+    int getDirection( void ) { return stepDirn; }
+    int getSlewMode( void ) { return slewMode; }
+    void setSlewMode( int mode ) { slewMode = mode; }
+    int getApproachSteps( void ) { return approachSteps; }
+    void setApproachSteps( int steps ) { approachSteps = steps; }
+    int getBacklash( void ) { return backlash; }
+    void setBacklash( int steps ) { backlash = steps; } //from the next move, 0 for none
+    int getBacklashUsed( void ) { return backlashUsed; }
+    uint32_t getStepModeChanges( void ) { return stepModeChanges; }
+    uint32_t getStepInterval( void ) { return stepInterval; }
+    void setStepInterval( uint32_t intervalMs ) { stepInterval = intervalMs; } //from the next move
+
+  private:
+    int planMove( int from, int target, int* dirn );
+    int countPulses( int position, int distance );
+    void enable( bool enable );
+    void step( void );
+    void selectStepMode( void );
+    void setStepMode( int mode );
+
+    StepperHardware* hw;
+    int microstepsPerRev;
+    uint32_t stepInterval;  //msecs between step pulses
+
+    int targetDistance; //microsteps
+    int stepPosition;   //microsteps, 0 to microstepsPerRev
+    int stepDirn;
+    int stepMode;       //mode of the last step pulse
+    int slewMode;       //STEP_FULL to slew in full steps, STEP_HALF to make the whole move in half steps
+    int approachSteps;  //full steps from the target to finish in half steps
+    int backlash;       //full steps of slack taken up on a reversal
+    int backlashUsed;   //full steps added to the current move
+    int slackDistance;  //microsteps of backlash still to take up before the wheel moves
+    bool moving;
+    int stepFlag;       //ticks not yet stepped
+    uint32_t stepModeChanges;
+};
+
+MotionEngine::MotionEngine( void )
+{
+  hw = NULL;
+  microstepsPerRev = 0;
+  stepInterval = 10;
+  targetDistance = 0;
+  stepPosition = 0;
+  stepDirn = DIRN_CW;
+  stepMode = STEP_FULL;
+  slewMode = STEP_FULL;
+  approachSteps = 0;
+  backlash = 0;
+  backlashUsed = 0;
+  slackDistance = 0;
+  moving = false;
+  stepFlag = 0;
+  stepModeChanges = 0;
+}
+
+void MotionEngine::begin( StepperHardware* hardware, int microstepsPerRevolution, uint32_t stepIntervalMs )
+{
+  hw = hardware;
+  microstepsPerRev = microstepsPerRevolution;
+  stepInterval = stepIntervalMs;
+  //Put the driver in the mode the engine last stepped in
+  if( hw->hasHalfStep() )
+    hw->setStepMode( stepMode );
+}
+
+//Only valid while stopped - used to restore the saved position at boot
+void MotionEngine::setPosition( int position )
+{
+  if( moving )
+    return;
+  stepPosition = snapToStep( position );
+}
+
+/*
+ * A position in range 0 to microstepsPerRev, rounded to the nearest full step if the driver can't half step.
+ * A full step driver can only reach even microsteps - an odd position or target would have it step past the target
+ * and back for ever.
+ */
+int MotionEngine::snapToStep( int position )
+{
+  if ( hw != NULL && !hw->hasHalfStep() )
+    position = ( ( position + ( position >= 0 ? 1 : -1 ) * ( MICROSTEPS_PER_STEP / 2 ) ) / MICROSTEPS_PER_STEP ) * MICROSTEPS_PER_STEP;
+  return ( ( position % microstepsPerRev ) + microstepsPerRev ) % microstepsPerRev;
+}
+
+/*
+ * Start a move to target ( microsteps ) the shortest way round the wheel.
+ * Turning round from the last move's direction, the backlash is taken up first.
+ */
+void MotionEngine::moveTo( int target )
+{
+  //case 0 - increasing by less than 3 - CW
+  //2->4 800->1600 targetDistance = 800, stepcount = 1600
+  //case 1 - increasing by 3 or more   - CCW
+  //1->4 400->1600 targetDistance = 1200->-800, stepcount = 1600 CW
+  //case 2 - decreasing by less than 3 - CCW
+  //4->2 1600->800 targetDistance = -800, stepcount = 800 CCW
+  //case 3 - decreasing by 3 or more   - CW
+  //4->1 1600->400 targetDistance = -1200->800, stepcount = 400 CW
+  //4->0 1600->2048/0 targetDistance = -1600->400, stepcount = 0 CW
+  int dirn = stepDirn;
+
+  backlashUsed = 0;
+  slackDistance = 0;
+  targetDistance = planMove( stepPosition, snapToStep( target ), &dirn );
+
+  //Moving is picked up by the next update once the timer has ticked
+  if ( targetDistance != 0 )
+  {
+    if ( dirn != stepDirn && backlash > 0 )
+    {
+      backlashUsed = backlash;
+      slackDistance = backlash * MICROSTEPS_PER_STEP;
+    }
+    stepDirn = dirn;
+    hw->setDirection( stepDirn );
+    enable( true );
+  }
+}
+
+//Stop where we are - the position is kept
+void MotionEngine::stop( void )
+{
+  targetDistance = 0;
+  slackDistance = 0;
+  if( moving )
+    enable( false );
+}
+
+/*
+ * Shortest way round the wheel from one position to another - returns the distance in microsteps and sets dirn.
+ */
+int MotionEngine::planMove( int from, int target, int* dirn )
+{
+  int distance = target - from;
+
+  if( distance > 0 )
+    *dirn = DIRN_CW;
+  else
+    *dirn = DIRN_CCW;
+  distance = abs(distance);
+
+  if ( distance > microstepsPerRev/2 )
+  {
+    //Reverse direction to minimise the move
+    distance = abs(microstepsPerRev - distance);
+    *dirn = ( *dirn == DIRN_CW )? DIRN_CCW : DIRN_CW;
+  }
+  return distance;
+}
+
+/*
+ * Step pulses needed to move distance microsteps starting from position, with the step modes selectStepMode() would pick.
+ */
+int MotionEngine::countPulses( int position, int distance )
+{
+  int halfSteps = 0;
+  int fullSteps = 0;
+
+  if ( distance <= 0 )
+    return 0;
+  if ( !hw->hasHalfStep() )
+    return ( distance + STEP_FULL - 1 ) / STEP_FULL;
+  if ( slewMode == STEP_HALF )
+    return distance;
+
+  //A half step first to reach a full step boundary, full steps to the approach, half steps from there
+  if ( ( position % STEP_FULL ) != 0 )
+  {
+    halfSteps++;
+    distance--;
+  }
+  fullSteps = ( distance - approachSteps * MICROSTEPS_PER_STEP ) / STEP_FULL;
+  if ( fullSteps < 0 )
+    fullSteps = 0;
+  halfSteps += distance - fullSteps * STEP_FULL;
+  return fullSteps + halfSteps;
+}
+
+/*
+ * Predicted duration of a move between two positions ( microsteps ) if it started now.
+ * Each pulse waits for a tick and the move completes on the tick after the last one.
+ */
+uint32_t MotionEngine::estimateMoveMs( int from, int target )
+{
+  int dirn = DIRN_CW;
+  int distance = 0;
+  int slack = 0;
+
+  from = snapToStep( from );
+  distance = planMove( from, snapToStep( target ), &dirn );
+
+  if ( distance == 0 )
+    return 0;
+  //Turning round, a full step pulse for each step of backlash first
+  if ( dirn != stepDirn )
+    slack = backlash;
+  return ( slack + countPulses( from, distance ) + 1 ) * stepInterval;
+}
+
+//Time left in the current move, 0 when stopped
+uint32_t MotionEngine::remainingMs( void )
+{
+  if ( !moving )
+    return 0;
+  return ( slackDistance / STEP_FULL + countPulses( stepPosition, targetDistance ) + 1 ) * stepInterval;
+}
+
+/*
+ * Main loop processing - make the step the timer has asked for.
+ * Returns true when the move has just completed.
+ */
+bool MotionEngine::update( void )
+{
+  if( !moving )
+  {
+    stepFlag = 0; //reset when start moving or disable the timer when not in use.
+    return false;
+  }
+  if( stepFlag == 0 )
+    return false;
+
+  if ( targetDistance <= 0 && slackDistance <= 0 ) //May need to decelerate
+  {
+    enable( false );
+    return true;
+  }
+  step();
+  return false;
+}
+
+//Step timer handler
+void MotionEngine::tick( void )
+{
+  if ( stepFlag >= 0 )
+    stepFlag++;
+  else
+    stepFlag = 1;
+}
+
+void MotionEngine::onTick( void* arg )
+{
+  ( (MotionEngine*) arg )->tick();
+}
+
+void MotionEngine::enable( bool enable )
+{
+  //stop/start the timer
+  if (enable)
+  {
+    hw->startTicks( onTick, this, stepInterval );
+    hw->setEnabled( true );
+    stepFlag = 0;
+    moving = true;
+  }
+  else
+  {
+    hw->stopTicks();
+    hw->setEnabled( false );
+    moving = false;
+  }
+}
+
+void MotionEngine::step( void )
+{
+  //Slack is taken up in full steps, the wheel doesn't move
+  if ( slackDistance > 0 )
+  {
+    setStepMode( STEP_FULL );
+    hw->pulse();
+    slackDistance -= STEP_FULL;
+    stepFlag--;
+    return;
+  }
+  selectStepMode();
+  hw->pulse();
+
+  //Book-keeping of position and distance in microsteps - a full step pulse moves two.
+  if ( stepDirn == DIRN_CW)
+    stepPosition += stepMode;
+  else
+    stepPosition -= stepMode;
+  targetDistance -= stepMode;
+
+  //keep count in range 0-microstepsPerRev
+  stepPosition += microstepsPerRev;
+  stepPosition %= microstepsPerRev;
+
+  stepFlag--;
+}
+
+/*
+ * Pick the mode for the next step pulse - full steps to slew, then half steps for the last approachSteps to land on the target.
+ * Full steps are only taken from a full step boundary and never past the target, so switching modes doesn't lose position.
+ */
+void MotionEngine::selectStepMode( void )
+{
+  int mode = STEP_HALF;
+
+  if ( !hw->hasHalfStep() )
+    mode = STEP_FULL; //Driver fixed at full steps
+  else if ( slewMode == STEP_FULL &&
+            ( stepPosition % STEP_FULL ) == 0 &&
+            targetDistance >= STEP_FULL + ( approachSteps * MICROSTEPS_PER_STEP ) )
+    mode = STEP_FULL;
+  setStepMode( mode );
+}
+
+void MotionEngine::setStepMode( int mode )
+{
+  if ( mode == stepMode || !hw->hasHalfStep() )
+    return;
+  hw->setStepMode( mode );
+  stepMode = mode;
+  stepModeChanges++;
+}
+#endif
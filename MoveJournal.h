@@ -0,0 +1,129 @@
+/*
+ Move history journal - one compact binary record per completed move, kept in a fixed size RAM ring.
+ Recording is a 16 byte copy when the move ends, nothing is formatted or written to flash in the move path.
+ Read back through GET /filterwheel/{DeviceNumber}/History, newest first and paged, with duration percentiles per filter pair.
+ Build with JOURNAL_LITTLEFS defined to also append the records to /journal.bin on LittleFS, in batches while the wheels are idle.
+*/
+#if !defined _MOVEJOURNAL_H_
+#define _MOVEJOURNAL_H_
+#if defined JOURNAL_LITTLEFS
+#include <LittleFS.h>
+#endif
+
+const int JOURNAL_SIZE = 128;         //records, 2K of RAM
+const int JOURNAL_FLUSH_BATCH = 16;   //records per LittleFS append
+const uint32_t JOURNAL_FILE_LIMIT = 64 * 1024;
+
+//Record flags
+#define JOURNAL_DIRN_CCW      0x01
+#define JOURNAL_HALF_SLEW     0x02
+#define JOURNAL_ENCODER_FIXED 0x04  //step position corrected from the encoder
+#define JOURNAL_ENCODER_FAULT 0x08  //move stopped on an encoder error
+
+struct __attribute__((packed)) MoveRecord
+{
+  uint32_t timestamp;   //NTP time, seconds since 1970 - small values if the clock hadn't been set yet
+  uint32_t clientID;    //requesting ClientID, 0 for moves the controller started itself
+  uint16_t durationCs;  //hundredths of a second
+  uint16_t steps;       //microsteps
+  uint8_t  device;
+  uint8_t  filters;     //from filter in the high nibble, to filter in the low nibble
+  uint8_t  backlash;    //full steps of backlash compensation used
+  uint8_t  flags;
+};
+
+struct MoveJournal
+{
+  MoveRecord records[JOURNAL_SIZE];
+  uint32_t count;       //records ever written, the ring holds the last JOURNAL_SIZE
+  uint32_t flushed;     //records written to LittleFS
+};
+MoveJournal moveJournal;
+
+void recordMove( uint8_t device, int fromId, int toId, int steps, int durationMs, int backlash, uint32_t clientID, uint8_t flags );
+MoveRecord* journalRecord( uint32_t index );
+int journalDurations( uint8_t device, uint8_t filters, uint16_t* durations, int maxCount );
+void flushJournal( void );
+
+void recordMove( uint8_t device, int fromId, int toId, int steps, int durationMs, int backlash, uint32_t clientID, uint8_t flags )
+{
+  MoveRecord* record = &moveJournal.records[ moveJournal.count % JOURNAL_SIZE ];
+
+  record->timestamp = (uint32_t) time( nullptr );
+  record->clientID = clientID;
+  record->durationCs = (uint16_t) min( durationMs / 10, 0xFFFF );
+  record->steps = (uint16_t) steps;
+  record->device = device;
+  record->filters = (uint8_t) ( ( fromId << 4 ) | ( toId & 0x0F ) );
+  record->backlash = (uint8_t) backlash;
+  record->flags = flags;
+  moveJournal.count++;
+}
+
+//index 0 is the newest record, NULL once past the oldest one still held
+MoveRecord* journalRecord( uint32_t index )
+{
+  if( index >= moveJournal.count || index >= (uint32_t) JOURNAL_SIZE )
+    return NULL;
+  return &moveJournal.records[ ( moveJournal.count - 1 - index ) % JOURNAL_SIZE ];
+}
+
+/*
+ * Collect the durations ( centiseconds ) of the held moves between one pair of filters, sorted ascending.
+ * Returns the number collected.
+ */
+int journalDurations( uint8_t device, uint8_t filters, uint16_t* durations, int maxCount )
+{
+  MoveRecord* record = NULL;
+  uint16_t value = 0;
+  int count = 0;
+  int i=0, j=0;
+
+  for ( i=0; ( record = journalRecord( i ) ) != NULL && count < maxCount; i++ )
+  {
+    if( record->device != device || record->filters != filters )
+      continue;
+    //insertion sort - at most JOURNAL_SIZE entries
+    value = record->durationCs;
+    for ( j = count; j > 0 && durations[j-1] > value; j-- )
+      durations[j] = durations[j-1];
+    durations[j] = value;
+    count++;
+  }
+  return count;
+}
+
+//Append unflushed records to LittleFS - called from the loop while no wheel is moving
+void flushJournal( void )
+{
+#if defined JOURNAL_LITTLEFS
+  uint32_t pending = moveJournal.count - moveJournal.flushed;
+  File file;
+
+  if( pending < (uint32_t) JOURNAL_FLUSH_BATCH )
+    return;
+  //Records that have already been overwritten in the ring are lost
+  if( pending > (uint32_t) JOURNAL_SIZE )
+    moveJournal.flushed = moveJournal.count - JOURNAL_SIZE;
+
+  file = LittleFS.open( "/journal.bin", "a" );
+  if( !file )
+    return;
+  if( file.size() > JOURNAL_FILE_LIMIT )
+  {
+    file.close();
+    LittleFS.remove( "/journal.old" );
+    LittleFS.rename( "/journal.bin", "/journal.old" );
+    file = LittleFS.open( "/journal.bin", "a" );
+    if( !file )
+      return;
+  }
+  while( moveJournal.flushed < moveJournal.count )
+  {
+    file.write( (const uint8_t*) &moveJournal.records[ moveJournal.flushed % JOURNAL_SIZE ], sizeof( MoveRecord ) );
+    moveJournal.flushed++;
+  }
+  file.close();
+#endif
+}
+#endif
@@ -0,0 +1,157 @@
+/*
+ WiFi power profiles - the radio is shared, so one profile covers the whole controller.
+ Performance never lets the radio sleep.
+ Balanced modem-sleeps while idle and runs the radio at full power from the first request or move until POWER_ACTIVE_HOLD_MS after the last.
+ LowPower does the same with light sleep while idle, waking for every POWER_LISTEN_INTERVAL'th DTIM beacon, and the loop yields between
+ passes so the CPU can sleep too.
+ Request handling time is kept per profile, so the profiles can be compared on the rig. Every request counts, whatever its route -
+ RequestProbe sees them all. The time a request waits for a sleeping radio to hear it doesn't reach the controller, so the wake
+ latency is timed from the client with the binary protocol's CMD_ECHO ( test/wake_latency.py ). switchMicrosMax is only the time
+ spent in the setSleepMode() call, the radio finishes changing mode after it returns.
+*/
+#if !defined _POWERPROFILE_H_
+#define _POWERPROFILE_H_
+
+enum powerProfiles { POWER_PERFORMANCE, POWER_BALANCED, POWER_LOW, POWER_PROFILE_COUNT };
+const char powerProfilePerformance[] PROGMEM = "Performance";
+const char powerProfileBalanced[] PROGMEM = "Balanced";
+const char powerProfileLow[] PROGMEM = "LowPower";
+const char* const powerProfileNames[POWER_PROFILE_COUNT] PROGMEM = { powerProfilePerformance, powerProfileBalanced, powerProfileLow };
+
+const uint32_t POWER_ACTIVE_HOLD_MS = 30000;
+const uint8_t POWER_LISTEN_INTERVAL = 3;  //DTIM beacons between wakes in light sleep
+const uint32_t POWER_IDLE_DELAY_MS = 20;  //loop yield while idle in LowPower
+
+struct PowerStats
+{
+  uint32_t requests;
+  uint32_t requestMicrosTotal;
+  uint32_t requestMicrosMax;
+  uint32_t wakes;               //idle to active changes
+};
+
+struct PowerState
+{
+  int profile;
+  bool active;                  //radio held at full power
+  uint32_t lastActivityMs;
+  uint32_t switchMicrosMax;     //longest setSleepMode() call - not the time the radio takes to change mode
+  PowerStats stats[POWER_PROFILE_COUNT];
+};
+PowerState powerState;
+
+//Set for every request the web server sees, whether or not it resolves a wheel
+bool requestSeen = false;
+
+//Added ahead of the routes, it is asked about every request and never takes one - so requests to the management API,
+//the setup pages and unknown routes are seen as well as the ones that reach a wheel
+class RequestProbe : public RequestHandler
+{
+  public:
+    bool canHandle( HTTPMethod method, const String& uri ) override
+    {
+      (void) method;
+      (void) uri;
+      requestSeen = true;
+      return false;
+    }
+};
+RequestProbe requestProbe;
+
+void initPowerState( int profile );
+const __FlashStringHelper* powerProfileName( int profile );
+int powerProfileFromName( const char* name );
+void setPowerProfile( int profile );
+void applySleepMode( bool active );
+void updatePower( bool activity );
+void recordPowerRequestTime( uint32_t elapsed );
+
+void initPowerState( int profile )
+{
+  memset( &powerState, 0, sizeof( PowerState ) );
+  powerState.profile = ( profile >= 0 && profile < POWER_PROFILE_COUNT )? profile : POWER_PERFORMANCE;
+  powerState.active = true;
+}
+
+//The profile's name, from flash
+const __FlashStringHelper* powerProfileName( int profile )
+{
+  return FPSTR( pgm_read_ptr( &powerProfileNames[profile] ) );
+}
+
+//-1 if the name isn't a profile
+int powerProfileFromName( const char* name )
+{
+  int i=0;
+  for ( i=0; name != NULL && i < POWER_PROFILE_COUNT; i++ )
+  {
+    if( strcasecmp_P( name, (PGM_P) pgm_read_ptr( &powerProfileNames[i] ) ) == 0 )
+      return i;
+  }
+  return -1;
+}
+
+//Switch profile - starts active so a client changing it isn't left waiting on the radio
+void setPowerProfile( int profile )
+{
+  if( profile < 0 || profile >= POWER_PROFILE_COUNT )
+    return;
+  powerState.profile = profile;
+  powerState.lastActivityMs = millis();
+  applySleepMode( true );
+  DEBUGS1( F("Power profile: ") );DEBUGSL1( powerProfileName( profile ) );
+}
+
+void applySleepMode( bool active )
+{
+  uint32_t start = micros();
+  uint32_t elapsed = 0;
+
+  powerState.active = active;
+  if( powerState.profile == POWER_PERFORMANCE || active )
+    WiFi.setSleepMode( WIFI_NONE_SLEEP );
+  else if( powerState.profile == POWER_BALANCED )
+    WiFi.setSleepMode( WIFI_MODEM_SLEEP );
+  else
+    WiFi.setSleepMode( WIFI_LIGHT_SLEEP, POWER_LISTEN_INTERVAL );
+
+  elapsed = micros() - start;
+  if( elapsed > powerState.switchMicrosMax )
+    powerState.switchMicrosMax = elapsed;
+}
+
+/*
+ * Called each time round the loop - activity is a request handled or a wheel moving.
+ */
+void updatePower( bool activity )
+{
+  if( powerState.profile == POWER_PERFORMANCE )
+    return;
+
+  if( activity )
+  {
+    powerState.lastActivityMs = millis();
+    if( !powerState.active )
+    {
+      powerState.stats[powerState.profile].wakes++;
+      applySleepMode( true );
+    }
+    return;
+  }
+
+  if( powerState.active && ( millis() - powerState.lastActivityMs ) > POWER_ACTIVE_HOLD_MS )
+    applySleepMode( false );
+  //Light sleep needs the loop to give up the CPU
+  if( !powerState.active && powerState.profile == POWER_LOW )
+    delay( POWER_IDLE_DELAY_MS );
+}
+
+void recordPowerRequestTime( uint32_t elapsed )
+{
+  PowerStats* stats = &powerState.stats[powerState.profile];
+  stats->requests++;
+  stats->requestMicrosTotal += elapsed;
+  if( elapsed > stats->requestMicrosMax )
+    stats->requestMicrosMax = elapsed;
+}
+#endif
@@ -0,0 +1,55 @@
+/*
+ RAM budget - static RAM from the linker map, then free heap and the largest free block after boot and their low points while idle.
+ Logged at the end of setup and published in Metrics, so the headroom for connections and send buffers can be checked on the device.
+*/
+#if !defined _RAMREPORT_H_
+#define _RAMREPORT_H_
+
+//End of .data, .rodata and .bss in DRAM, the heap starts here - from the core's linker script
+extern "C" char _heap_start;
+const uint32_t DRAM_START = 0x3FFE8000;
+const uint32_t RAM_SAMPLE_MS = 1000;
+
+struct RamReport
+{
+  uint32_t staticRam;
+  uint32_t bootHeap;
+  uint32_t bootMaxBlock;
+  uint32_t idleHeapMin;
+  uint32_t idleMaxBlockMin;
+  uint32_t lastSampleMs;
+};
+RamReport ramReport;
+
+void recordBootRam( void );
+void sampleIdleRam( void );
+
+void recordBootRam( void )
+{
+  ramReport.staticRam = (uint32_t) (uintptr_t) &_heap_start - DRAM_START;
+  ramReport.bootHeap = ESP.getFreeHeap();
+  ramReport.bootMaxBlock = ESP.getMaxFreeBlockSize();
+  ramReport.idleHeapMin = ramReport.bootHeap;
+  ramReport.idleMaxBlockMin = ramReport.bootMaxBlock;
+  ramReport.lastSampleMs = millis();
+  DEBUGS1( F("RAM static: ") );DEBUGS1( ramReport.staticRam );
+  DEBUGS1( F(" free heap: ") );DEBUGS1( ramReport.bootHeap );
+  DEBUGS1( F(" largest block: ") );DEBUGSL1( ramReport.bootMaxBlock );
+}
+
+//Called from the loop while the wheels are idle - walking the heap for the largest block isn't free, so only once a second
+void sampleIdleRam( void )
+{
+  uint32_t value = 0;
+
+  if( ( millis() - ramReport.lastSampleMs ) < RAM_SAMPLE_MS )
+    return;
+  ramReport.lastSampleMs = millis();
+  value = ESP.getFreeHeap();
+  if( value < ramReport.idleHeapMin )
+    ramReport.idleHeapMin = value;
+  value = ESP.getMaxFreeBlockSize();
+  if( value < ramReport.idleMaxBlockMin )
+    ramReport.idleMaxBlockMin = value;
+}
+#endif
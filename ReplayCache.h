@@ -0,0 +1,154 @@
+/*
+ Replay cache for state-changing Alpaca PUTs.
+ A client that times out waiting for a reply retries with the same ClientID and ClientTransactionID - the retry
+ is answered with the stored reply rather than run again, so it can't change state or commit to flash twice.
+ Entries are keyed on the ids, the request URI and the other arguments - a client that reuses an id with new values
+ has sent a new request, which is run. A client only retries its latest request, so each client's new request to a URI
+ replaces its previous one there - otherwise the oldest entry is replaced.
+ Requests without a ClientTransactionID can't be told apart from a retry and are always run.
+ Also numbers the responses - ServerTransactionID is one counter for the whole server, increasing with every response sent.
+*/
+#if !defined _REPLAYCACHE_H_
+#define _REPLAYCACHE_H_
+
+const int REPLAY_CACHE_SIZE = 8;
+
+struct ReplayEntry
+{
+  uint32_t clientID;
+  uint32_t transID;       //0 for an unused entry
+  uint32_t uriHash;
+  uint32_t argsHash;
+  int responseCode;
+  char* body;
+};
+
+struct ReplayCache
+{
+  ReplayEntry entries[REPLAY_CACHE_SIZE];
+  uint32_t next;          //entry to replace
+  uint32_t replays;
+  uint32_t stores;
+};
+ReplayCache replayCache;
+
+uint32_t nextServerTransactionID( void );
+void alpacaResponseBuilder( JsonObject& root, uint32_t clientID, uint32_t transID, const String& name, int errNum, const String& errMsg );
+uint32_t fnvHash( uint32_t hash, const char* text, bool fold );
+uint32_t requestUriHash( void );
+uint32_t requestArgsHash( void );
+bool sendReplayedResponse( uint32_t clientID, uint32_t transID );
+void storeReplayResponse( uint32_t clientID, uint32_t transID, int responseCode, const String& message );
+
+uint32_t nextServerTransactionID( void )
+{
+  return ++transactionId;
+}
+
+//The common response fields, with this server's transaction number
+void alpacaResponseBuilder( JsonObject& root, uint32_t clientID, uint32_t transID, const String& name, int errNum, const String& errMsg )
+{
+  jsonResponseBuilder( root, clientID, transID, name, errNum, errMsg );
+  root["ServerTransactionID"] = nextServerTransactionID();
+}
+
+//FNV-1a, continuing from hash
+uint32_t fnvHash( uint32_t hash, const char* text, bool fold )
+{
+  while( *text != '\0' )
+  {
+    hash ^= (uint8_t) ( ( fold )? tolower( *text ) : *text );
+    text++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+//The request path - keeps the same ids sent to different properties or devices apart
+uint32_t requestUriHash( void )
+{
+  return fnvHash( 2166136261u, server.uri().c_str(), true );
+}
+
+//The argument names and values other than the ids, in the order sent - a retry sends the same request again
+uint32_t requestArgsHash( void )
+{
+  uint32_t hash = 2166136261u;
+  int i=0;
+
+  for ( i=0; i < server.args(); i++ )
+  {
+    String name = server.argName( i );
+    if( name.equalsIgnoreCase( "ClientID" ) || name.equalsIgnoreCase( "ClientTransactionID" ) )
+      continue;
+    hash = fnvHash( hash, name.c_str(), true );
+    hash = fnvHash( hash, "=", false );
+    hash = fnvHash( hash, server.arg( i ).c_str(), false );
+    hash = fnvHash( hash, "&", false );
+  }
+  return hash;
+}
+
+/*
+ * Answer a retried request from the cache.
+ * Returns false if this request hasn't been seen - the caller then runs it and stores the reply.
+ */
+bool sendReplayedResponse( uint32_t clientID, uint32_t transID )
+{
+  uint32_t uriHash = 0;
+  uint32_t argsHash = 0;
+  int i=0;
+
+  if( transID == 0 )
+    return false;
+  uriHash = requestUriHash();
+  argsHash = requestArgsHash();
+  for ( i=0; i < REPLAY_CACHE_SIZE; i++ )
+  {
+    ReplayEntry* entry = &replayCache.entries[i];
+    if( entry->transID == transID && entry->clientID == clientID && entry->uriHash == uriHash && entry->argsHash == argsHash && entry->body != NULL )
+    {
+      DEBUGS1( F("Replaying response to ClientTransactionID ") );DEBUGSL1( transID );
+      replayCache.replays++;
+      server.send( entry->responseCode, "application/json", entry->body );
+      return true;
+    }
+  }
+  return false;
+}
+
+void storeReplayResponse( uint32_t clientID, uint32_t transID, int responseCode, const String& message )
+{
+  ReplayEntry* entry = NULL;
+  uint32_t uriHash = 0;
+  int i=0;
+
+  if( transID == 0 )
+    return;
+  uriHash = requestUriHash();
+  for ( i=0; i < REPLAY_CACHE_SIZE && entry == NULL; i++ )
+  {
+    if( replayCache.entries[i].transID != 0 && replayCache.entries[i].clientID == clientID && replayCache.entries[i].uriHash == uriHash )
+      entry = &replayCache.entries[i];
+  }
+  if( entry == NULL )
+  {
+    entry = &replayCache.entries[ replayCache.next ];
+    replayCache.next = ( replayCache.next + 1 ) % REPLAY_CACHE_SIZE;
+  }
+
+  if( entry->body != NULL )
+    free( entry->body );
+  entry->transID = 0;
+  entry->body = (char*) malloc( message.length() + 1 );
+  if( entry->body == NULL )
+    return;
+  memcpy( entry->body, message.c_str(), message.length() + 1 );
+  entry->clientID = clientID;
+  entry->transID = transID;
+  entry->uriHash = uriHash;
+  entry->argsHash = requestArgsHash();
+  entry->responseCode = responseCode;
+  replayCache.stores++;
+}
+#endif
@@ -0,0 +1,157 @@
+/*
+ Cache of serialised responses for properties that only change when the wheel is re-configured.
+ The body is stored with the transaction id values cut out, and those are spliced back in on a hit
+ so a cached response costs a memcpy rather than a JSON build and print.
+ Entries are tagged with the configuration generation they were built for - the setup handlers bump
+ the generation and stale entries are rebuilt on their next request.
+*/
+#if !defined _RESPONSECACHE_H_
+#define _RESPONSECACHE_H_
+
+enum cachedResponseIds { CACHE_DESCRIPTION, CACHE_DRIVERINFO, CACHE_DRIVERVERSION, CACHE_NAME, CACHE_NAMES, CACHE_FOCUSOFFSETS, CACHE_ENTRY_COUNT };
+
+//Fields whose values differ per request - spliced back into the cached body
+enum spliceFields { SPLICE_CLIENTID, SPLICE_CLIENTTRANSID, SPLICE_SERVERTRANSID, SPLICE_FIELD_COUNT };
+const char* const spliceKeys[SPLICE_FIELD_COUNT] = { "\"ClientID\":", "\"ClientTransactionID\":", "\"ServerTransactionID\":" };
+const int SPLICE_VALUE_LENGTH = 11; //Longest decimal uint32_t plus sign
+
+struct CachedResponse
+{
+  char* body;             //serialised response with the transaction id values removed
+  uint16_t length;
+  const char* contentType;
+  uint8_t spliceCount;
+  uint16_t spliceAt[SPLICE_FIELD_COUNT];   //offsets into body, ascending
+  uint8_t spliceField[SPLICE_FIELD_COUNT];
+  uint32_t generation;    //configuration generation the body was built for
+  uint32_t buildCycles;   //cost of building the response uncached
+};
+
+struct ResponseCache
+{
+  CachedResponse entries[CACHE_ENTRY_COUNT];
+  uint32_t generation;
+  uint32_t hits;
+  uint32_t misses;
+  uint64_t cyclesSaved;
+};
+
+void initResponseCache( ResponseCache* cache );
+void invalidateResponseCache( ResponseCache* cache );
+bool sendCachedResponse( ResponseCache* cache, int id, uint32_t clientID, uint32_t transID );
+void storeCachedResponse( ResponseCache* cache, int id, const char* contentType, const String& message, uint32_t buildCycles );
+
+void initResponseCache( ResponseCache* cache )
+{
+  memset( cache, 0, sizeof( ResponseCache ) );
+  //Start at 1 so no zeroed entry matches
+  cache->generation = 1;
+}
+
+void invalidateResponseCache( ResponseCache* cache )
+{
+  cache->generation++;
+}
+
+/*
+ * Send the cached response for id if it is current, splicing in this request's transaction ids.
+ * Returns false on a miss - the caller then builds the response and stores it.
+ */
+bool sendCachedResponse( ResponseCache* cache, int id, uint32_t clientID, uint32_t transID )
+{
+  uint32_t startCycles = ESP.getCycleCount();
+  CachedResponse* entry = &cache->entries[id];
+  uint32_t value = 0;
+  int from = 0;
+  int out = 0;
+  int i = 0;
+
+  if( entry->body == NULL || entry->generation != cache->generation )
+  {
+    cache->misses++;
+    return false;
+  }
+
+  char response[ entry->length + ( entry->spliceCount * SPLICE_VALUE_LENGTH ) + 1 ];
+  for ( i=0; i < entry->spliceCount; i++ )
+  {
+    memcpy( &response[out], &entry->body[from], entry->spliceAt[i] - from );
+    out += entry->spliceAt[i] - from;
+    from = entry->spliceAt[i];
+    switch( entry->spliceField[i] )
+    {
+      case SPLICE_CLIENTID:      value = clientID; break;
+      case SPLICE_CLIENTTRANSID: value = transID; break;
+      default:                   value = nextServerTransactionID(); break;
+    }
+    out += sprintf( &response[out], "%u", value );
+  }
+  memcpy( &response[out], &entry->body[from], entry->length - from );
+  out += entry->length - from;
+  response[out] = '\0';
+
+  server.send( 200, entry->contentType, response );
+
+  cache->hits++;
+  value = ESP.getCycleCount() - startCycles;
+  if( entry->buildCycles > value )
+    cache->cyclesSaved += entry->buildCycles - value;
+  return true;
+}
+
+/*
+ * Store a freshly built response, recording where each transaction id value sits so it can be replaced.
+ */
+void storeCachedResponse( ResponseCache* cache, int id, const char* contentType, const String& message, uint32_t buildCycles )
+{
+  CachedResponse* entry = &cache->entries[id];
+  const char* text = message.c_str();
+  int valueStart[SPLICE_FIELD_COUNT];
+  int valueEnd[SPLICE_FIELD_COUNT];
+  int order[SPLICE_FIELD_COUNT];
+  int count = 0;
+  int from = 0;
+  int i = 0, j = 0;
+
+  //Locate the value of each transaction field present in the response
+  for ( i=0; i < SPLICE_FIELD_COUNT; i++ )
+  {
+    const char* key = strstr( text, spliceKeys[i] );
+    if( key == NULL )
+      continue;
+    valueStart[i] = ( key - text ) + strlen( spliceKeys[i] );
+    valueEnd[i] = valueStart[i];
+    while( text[ valueEnd[i] ] == '-' || isDigit( text[ valueEnd[i] ] ) )
+      valueEnd[i]++;
+    //insertion sort by position in the body
+    for ( j = count; j > 0 && valueStart[ order[j-1] ] > valueStart[i]; j-- )
+      order[j] = order[j-1];
+    order[j] = i;
+    count++;
+  }
+
+  if( entry->body != NULL )
+    free( entry->body );
+  entry->body = (char*) malloc( message.length() + 1 );
+  if( entry->body == NULL )
+    return;
+
+  entry->length = 0;
+  for ( i=0; i < count; i++ )
+  {
+    memcpy( &entry->body[entry->length], &text[from], valueStart[ order[i] ] - from );
+    entry->length += valueStart[ order[i] ] - from;
+    entry->spliceAt[i] = entry->length;
+    entry->spliceField[i] = order[i];
+    from = valueEnd[ order[i] ];
+  }
+  memcpy( &entry->body[entry->length], &text[from], message.length() - from );
+  entry->length += message.length() - from;
+  entry->body[entry->length] = '\0';
+
+  entry->spliceCount = count;
+  entry->contentType = contentType;
+  entry->generation = cache->generation;
+  entry->buildCycles = buildCycles;
+}
+#endif
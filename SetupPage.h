@@ -0,0 +1,156 @@
+/*
+ setup_form.html, gzip compressed - generated, do not edit. Regenerate after changing setup_form.html with
+ gzip -9 -n -c setup_form.html | xxd -i -n setupPageGz
+ and update the length and ETag ( any value that changes with the content ).
+ 4303 bytes uncompressed.
+*/
+#if !defined _SETUPPAGE_H_
+#define _SETUPPAGE_H_
+const char setupPageETag[] = "\"8afe396ce6d6457c\"";
+const unsigned int setupPageGzLength = 1715;
+const unsigned char setupPageGz[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xa5, 0x57,
+  0x6d, 0x8f, 0xdb, 0x36, 0x12, 0xfe, 0xee, 0x5f, 0x31, 0x51, 0xf2, 0x41,
+  0x42, 0x2c, 0x39, 0xdb, 0xf6, 0x43, 0x2b, 0xdb, 0x0b, 0xa4, 0x9b, 0x4d,
+  0xda, 0x43, 0x93, 0x2c, 0xba, 0xdb, 0x1e, 0x0e, 0x69, 0x50, 0x70, 0x45,
+  0xca, 0xe2, 0x9d, 0x44, 0xea, 0x28, 0xda, 0x5e, 0xd7, 0xf1, 0x7f, 0xef,
+  0x0c, 0x49, 0xd9, 0xd2, 0x26, 0x9b, 0xcb, 0x21, 0x09, 0x12, 0x59, 0xe4,
+  0xcc, 0x33, 0xef, 0x2f, 0x5a, 0x3c, 0x7a, 0xf1, 0xf6, 0xe2, 0xe6, 0x5f,
+  0x57, 0x97, 0x50, 0xd9, 0xa6, 0x3e, 0x9f, 0x2c, 0x1e, 0xa5, 0xe9, 0x04,
+  0xae, 0x85, 0x5d, 0xb7, 0xd0, 0xb2, 0x95, 0x80, 0x52, 0x1b, 0xb0, 0x15,
+  0x3e, 0x65, 0x6d, 0x85, 0x81, 0x6d, 0x25, 0x44, 0x9d, 0x21, 0x81, 0xd9,
+  0x08, 0x0e, 0xad, 0x11, 0xe9, 0xea, 0x2f, 0xd9, 0xb6, 0xf8, 0xbb, 0x34,
+  0xba, 0xf1, 0x8c, 0x57, 0xc8, 0x97, 0x55, 0x90, 0x82, 0x11, 0x2b, 0xa1,
+  0x84, 0x61, 0x56, 0x20, 0x04, 0xb3, 0xc0, 0x4a, 0x82, 0x10, 0x5c, 0x5a,
+  0xa9, 0x56, 0x78, 0x24, 0x3b, 0x82, 0x15, 0xf9, 0x04, 0x08, 0x04, 0xd2,
+  0x1f, 0x20, 0x55, 0x90, 0x16, 0xd0, 0x11, 0xca, 0x9f, 0x28, 0xb9, 0xc9,
+  0x48, 0x2b, 0xf8, 0x00, 0x77, 0x77, 0x1c, 0x52, 0x49, 0xd7, 0x5d, 0x2f,
+  0xe1, 0xd5, 0x5f, 0x13, 0x78, 0x29, 0x45, 0xcd, 0x3b, 0x60, 0xc6, 0xe9,
+  0x57, 0xf7, 0x5a, 0xbc, 0xba, 0xbc, 0x81, 0x99, 0x57, 0xd8, 0xe9, 0x3b,
+  0xdb, 0xab, 0xc3, 0xec, 0x42, 0xab, 0x52, 0xae, 0x80, 0x29, 0x0e, 0x82,
+  0x15, 0x15, 0x19, 0xd6, 0x00, 0x6a, 0x70, 0xf5, 0xdb, 0x0d, 0xdc, 0xb2,
+  0xe2, 0x3f, 0xc0, 0x3a, 0xf8, 0xc7, 0xf5, 0xdb, 0x37, 0x60, 0xb5, 0x33,
+  0xb8, 0x63, 0x8d, 0x00, 0xa1, 0x78, 0xab, 0xa5, 0xb2, 0x13, 0x88, 0xdd,
+  0x61, 0xa5, 0x3b, 0xab, 0xe8, 0xa2, 0x42, 0x6a, 0x69, 0x3b, 0xd0, 0x5b,
+  0x85, 0xbf, 0x15, 0xaf, 0xd1, 0xb0, 0x4e, 0xaa, 0x42, 0xe0, 0x29, 0xda,
+  0x7d, 0xab, 0x35, 0x5e, 0x26, 0x19, 0xdc, 0x20, 0x93, 0x11, 0x6d, 0xbd,
+  0x23, 0x51, 0x84, 0xb0, 0x6e, 0x39, 0xfa, 0x83, 0x43, 0xe1, 0xd5, 0xe9,
+  0xbc, 0x30, 0xe7, 0x6a, 0xa4, 0x30, 0xa2, 0x34, 0xa2, 0xab, 0xf0, 0x5e,
+  0x2a, 0x68, 0x6b, 0x56, 0x88, 0x6c, 0x92, 0xa6, 0x18, 0x96, 0x10, 0x9d,
+  0x4a, 0x30, 0x8e, 0x8f, 0x46, 0x58, 0x06, 0x45, 0xc5, 0x0c, 0x7a, 0x63,
+  0x19, 0xad, 0x6d, 0x99, 0x7e, 0x1f, 0xf5, 0xc7, 0xa4, 0xde, 0x32, 0xda,
+  0x48, 0xb1, 0x6d, 0xb5, 0xb1, 0x11, 0x09, 0xb2, 0x42, 0x21, 0xd9, 0x56,
+  0x72, 0x5b, 0x2d, 0xb9, 0xd8, 0xc8, 0x42, 0xa4, 0xee, 0x85, 0x78, 0xac,
+  0xb4, 0xb5, 0x38, 0x7f, 0x39, 0x88, 0xae, 0x77, 0xf1, 0x62, 0xe6, 0x6f,
+  0x26, 0x8b, 0xce, 0xee, 0xe8, 0x79, 0xab, 0xf9, 0x6e, 0x5f, 0x22, 0x58,
+  0x5a, 0xb2, 0x46, 0xd6, 0xbb, 0xbc, 0x63, 0xaa, 0x4b, 0x3b, 0x61, 0x64,
+  0x39, 0x6f, 0xd8, 0x9d, 0x47, 0xcc, 0xbf, 0x7b, 0x26, 0x1a, 0x7c, 0x35,
+  0x2b, 0xa9, 0xf2, 0x33, 0xd1, 0x1c, 0x26, 0x8f, 0x85, 0x31, 0x7b, 0xf2,
+  0xef, 0xca, 0xe8, 0xb5, 0xe2, 0xf9, 0xe3, 0xe7, 0xcf, 0xbe, 0xc1, 0x3f,
+  0xf3, 0x42, 0xd7, 0xda, 0xe4, 0x8f, 0xcb, 0xb2, 0x9c, 0x3b, 0xd0, 0xad,
+  0x90, 0xab, 0xca, 0xe6, 0xb7, 0xba, 0xe6, 0xf3, 0x96, 0x71, 0x8e, 0x19,
+  0x92, 0x67, 0xdf, 0xf6, 0x08, 0xb9, 0x68, 0x5a, 0xbb, 0xdb, 0x73, 0xd9,
+  0xa1, 0x53, 0x76, 0xb9, 0xd2, 0x4a, 0x1c, 0x26, 0x8b, 0x59, 0x50, 0x6d,
+  0x31, 0x0b, 0x7e, 0x21, 0x1d, 0xf1, 0xc1, 0xe5, 0x06, 0x24, 0x5f, 0x46,
+  0xc8, 0x18, 0x9d, 0x2f, 0x66, 0xf8, 0x4a, 0x66, 0x88, 0x5a, 0x14, 0xd6,
+  0x9d, 0x7b, 0x1f, 0x44, 0xa0, 0x15, 0xfa, 0x50, 0xad, 0xd0, 0x5d, 0xb5,
+  0x66, 0x3c, 0x4e, 0x88, 0xd8, 0x93, 0x9d, 0x4f, 0xd0, 0xd7, 0x67, 0xe7,
+  0x97, 0x8a, 0xbc, 0xa2, 0xc4, 0xf6, 0x14, 0x78, 0xaa, 0x87, 0x61, 0x2d,
+  0xa0, 0xec, 0x33, 0x44, 0xf7, 0xd9, 0x84, 0xd8, 0x3f, 0x05, 0x42, 0xf4,
+  0xed, 0x05, 0x81, 0xfb, 0x4c, 0x1f, 0x64, 0xce, 0x16, 0x13, 0x15, 0x0a,
+  0xb6, 0xee, 0xc4, 0xb0, 0xae, 0x30, 0xe9, 0x7c, 0xd6, 0xb8, 0x04, 0x6d,
+  0xd8, 0x0e, 0xbc, 0x6a, 0x8e, 0x06, 0xdd, 0x81, 0x59, 0xd1, 0x3d, 0x5a,
+  0xdc, 0x1a, 0x14, 0x25, 0x55, 0xbb, 0xb6, 0x60, 0x77, 0x2d, 0xea, 0x6d,
+  0xc5, 0x1d, 0x86, 0xd8, 0x87, 0xbc, 0x3a, 0x49, 0x1e, 0xd1, 0x74, 0xeb,
+  0xdb, 0x46, 0x22, 0xd5, 0x86, 0xd5, 0xeb, 0xd3, 0x2b, 0x79, 0x8d, 0x94,
+  0xfe, 0xc8, 0x52, 0x2e, 0xba, 0xc2, 0xc8, 0xd6, 0xca, 0x8d, 0x80, 0x2f,
+  0xb2, 0xf8, 0x9f, 0x74, 0xf8, 0x29, 0xc1, 0x43, 0xe5, 0xb6, 0x0f, 0x11,
+  0xfd, 0x3f, 0xda, 0xad, 0x9b, 0x5b, 0x7c, 0xe8, 0x32, 0xa8, 0xd3, 0x51,
+  0x91, 0x7c, 0x52, 0x25, 0x9f, 0xce, 0x17, 0x98, 0x70, 0xf6, 0xbe, 0x3c,
+  0x0f, 0xd2, 0xab, 0x15, 0x80, 0xae, 0x84, 0x71, 0x56, 0x44, 0xd0, 0x48,
+  0xb5, 0x8c, 0xce, 0xbe, 0x42, 0xc9, 0xe0, 0xa9, 0xa3, 0xe7, 0x7c, 0xaf,
+  0x71, 0x87, 0x9f, 0xd6, 0xf2, 0x0d, 0x52, 0x76, 0x98, 0x79, 0xba, 0xc6,
+  0xec, 0xd3, 0xf5, 0x57, 0x48, 0xd6, 0x05, 0x26, 0x15, 0xf9, 0xa7, 0xc4,
+  0x0a, 0xfe, 0x9f, 0xc2, 0x89, 0xfa, 0xad, 0x23, 0xfd, 0x1a, 0xe9, 0x3e,
+  0x57, 0xce, 0x27, 0x1b, 0x66, 0x30, 0x73, 0x36, 0xb0, 0xc4, 0x46, 0x59,
+  0xeb, 0x82, 0x59, 0xa9, 0x55, 0xd6, 0x32, 0x5b, 0x91, 0x23, 0xb2, 0x86,
+  0xd9, 0xa2, 0x8a, 0x87, 0x2d, 0xf9, 0x8f, 0x59, 0xfc, 0x07, 0x7f, 0x9a,
+  0xcc, 0x12, 0xf8, 0xf0, 0x01, 0xde, 0x3d, 0x9b, 0x3e, 0x7b, 0x0f, 0xc9,
+  0xbb, 0xb3, 0xf7, 0xf3, 0xc9, 0xa4, 0x5c, 0xab, 0x82, 0xb8, 0xe1, 0x49,
+  0x2c, 0x79, 0xb2, 0xc7, 0xb2, 0xb0, 0x6b, 0xa3, 0x80, 0xa3, 0xbe, 0x0d,
+  0xf6, 0xb1, 0x6c, 0x25, 0xec, 0x65, 0x2d, 0xe8, 0xe7, 0x8f, 0xbb, 0x9f,
+  0x39, 0xd1, 0xcc, 0xe1, 0x30, 0x60, 0xab, 0x65, 0x67, 0x63, 0xd7, 0xdd,
+  0xa7, 0x50, 0xb3, 0x5b, 0x51, 0x4f, 0x5d, 0x30, 0xa6, 0xde, 0x88, 0x6e,
+  0xea, 0x4c, 0x83, 0x64, 0xb2, 0x9f, 0x00, 0x90, 0xd6, 0xba, 0x46, 0xa5,
+  0x9f, 0xc4, 0xc4, 0x90, 0x64, 0xff, 0x5d, 0x0b, 0xb3, 0xbb, 0x76, 0x2d,
+  0x40, 0x9b, 0x38, 0xd2, 0x75, 0x94, 0xcc, 0x91, 0x4e, 0xd7, 0x99, 0x54,
+  0x38, 0xc9, 0x7e, 0xba, 0x79, 0xfd, 0x0b, 0x52, 0x47, 0xd1, 0xdc, 0x31,
+  0x13, 0x5e, 0x86, 0x8c, 0x97, 0xe8, 0x66, 0x14, 0x19, 0x34, 0x88, 0x61,
+  0x33, 0x05, 0x09, 0x09, 0x90, 0x04, 0x2f, 0xa3, 0x96, 0xc8, 0x75, 0xb4,
+  0xa0, 0x30, 0x02, 0x47, 0x40, 0x30, 0x22, 0x8e, 0x6a, 0xe9, 0x85, 0x00,
+  0x92, 0x65, 0x54, 0x33, 0x17, 0xbe, 0x63, 0x23, 0x8b, 0xd3, 0x1f, 0x9e,
+  0x42, 0x04, 0xd1, 0xfc, 0x08, 0xe6, 0x03, 0xf4, 0x30, 0x9e, 0xbb, 0xef,
+  0x21, 0xdd, 0x4b, 0xe6, 0x4c, 0x5e, 0x3a, 0xcb, 0x87, 0xc7, 0x2e, 0x49,
+  0x97, 0x3e, 0x57, 0x9f, 0x82, 0x1c, 0x5e, 0x39, 0xe3, 0xf0, 0x6e, 0x73,
+  0xd4, 0x8c, 0xe1, 0x94, 0x57, 0xfc, 0xa2, 0x92, 0x35, 0x8f, 0x83, 0x0e,
+  0x41, 0x06, 0x7a, 0x67, 0x74, 0x89, 0xd6, 0xba, 0x9b, 0x03, 0xfe, 0x3f,
+  0x8c, 0x4c, 0x57, 0xe9, 0x6d, 0x0c, 0x45, 0xb9, 0x0a, 0xde, 0x7f, 0x12,
+  0xbb, 0x0e, 0x9d, 0xdc, 0x33, 0x1a, 0x09, 0xb2, 0x4b, 0x63, 0xb4, 0x79,
+  0x8d, 0x3d, 0x8f, 0xe6, 0x22, 0x66, 0x88, 0xf7, 0x38, 0x32, 0x1c, 0xdb,
+  0x6b, 0x92, 0xf5, 0xfd, 0xee, 0xa8, 0x2b, 0x31, 0xf6, 0xf7, 0x81, 0xfc,
+  0xd4, 0x9b, 0x92, 0xec, 0xd8, 0x82, 0x46, 0x0c, 0x8e, 0xe2, 0xcd, 0x89,
+  0x63, 0xd8, 0x3a, 0x92, 0xec, 0x5e, 0x7f, 0x18, 0x71, 0x0e, 0x28, 0xbf,
+  0x88, 0x17, 0x87, 0x64, 0xe0, 0x7c, 0xcd, 0xee, 0x06, 0xa4, 0xb8, 0x28,
+  0x9d, 0x11, 0x80, 0x4f, 0xdc, 0x51, 0x57, 0x98, 0xf6, 0xaf, 0x2e, 0x46,
+  0xf4, 0x5a, 0x1e, 0x6f, 0xf1, 0x8d, 0xb0, 0x1c, 0x21, 0x5e, 0xf8, 0x66,
+  0x9b, 0x0c, 0x81, 0x86, 0x15, 0x7e, 0x44, 0x3a, 0x81, 0xf8, 0xab, 0x00,
+  0x33, 0x24, 0x46, 0x8a, 0xbe, 0x4b, 0xde, 0x8b, 0xa0, 0x11, 0x58, 0x20,
+  0x04, 0x8e, 0x9b, 0x46, 0xa5, 0xf9, 0x14, 0xa8, 0xc2, 0xa7, 0x40, 0x63,
+  0x77, 0x54, 0x57, 0xa1, 0x66, 0x4b, 0x41, 0x65, 0x0f, 0xd1, 0x68, 0x17,
+  0x8b, 0x30, 0xd5, 0xa8, 0x53, 0x60, 0x56, 0xbb, 0xdf, 0x1e, 0x62, 0x1f,
+  0x20, 0xf3, 0x23, 0x34, 0x81, 0xe6, 0x1e, 0xda, 0x65, 0x19, 0x8d, 0x78,
+  0x74, 0x67, 0x8e, 0xa4, 0x51, 0x48, 0x96, 0xf4, 0x06, 0x45, 0x46, 0xb9,
+  0x97, 0x4c, 0x59, 0x82, 0x69, 0x58, 0x4b, 0xdf, 0x7c, 0x66, 0xb8, 0x91,
+  0x6c, 0xb7, 0x29, 0x95, 0x75, 0xba, 0x36, 0xb5, 0x50, 0x85, 0xe6, 0x82,
+  0x47, 0x70, 0xc0, 0xbf, 0x89, 0x03, 0xcc, 0x70, 0xb4, 0xaa, 0x61, 0xd9,
+  0x1a, 0x38, 0xb5, 0x1b, 0x93, 0xfd, 0xbb, 0xc3, 0x33, 0xea, 0x2d, 0x63,
+  0x72, 0x4a, 0xe2, 0xfe, 0xa4, 0x70, 0x6d, 0x6d, 0x80, 0x20, 0x08, 0xe1,
+  0x81, 0xb4, 0x8e, 0x7e, 0xf5, 0xce, 0x83, 0x92, 0xe1, 0xce, 0x8b, 0x86,
+  0x92, 0xf1, 0xc2, 0xe1, 0x8f, 0x9d, 0xec, 0x77, 0x91, 0x7d, 0x68, 0xa7,
+  0x88, 0x16, 0xd6, 0x95, 0xc4, 0x67, 0xdf, 0xfc, 0x14, 0x85, 0x08, 0x17,
+  0x5d, 0x8a, 0xa7, 0x5f, 0x6d, 0x29, 0x5a, 0xa3, 0x4e, 0xe8, 0x1b, 0x94,
+  0xef, 0x85, 0x03, 0xd3, 0x9e, 0x1b, 0xc3, 0x76, 0x59, 0x6b, 0xb4, 0xd5,
+  0xe4, 0x38, 0xcc, 0xcb, 0x16, 0x2d, 0xa9, 0x6b, 0x4f, 0x38, 0x6e, 0x81,
+  0xcf, 0xf1, 0x18, 0xbb, 0x20, 0x84, 0x9e, 0x32, 0x1d, 0xd8, 0x2a, 0x07,
+  0x90, 0xb2, 0x57, 0xed, 0x10, 0x74, 0x98, 0xf5, 0xeb, 0x76, 0xdf, 0xa4,
+  0x06, 0xe3, 0x08, 0x85, 0xb8, 0x71, 0x11, 0x36, 0xe0, 0xa5, 0xeb, 0x93,
+  0xc7, 0x42, 0xcd, 0xc9, 0xb3, 0x27, 0x29, 0xe5, 0x40, 0xca, 0x1e, 0x8e,
+  0xc5, 0x9a, 0x43, 0xf9, 0x51, 0x3d, 0x1f, 0x50, 0x32, 0xa5, 0xca, 0xa0,
+  0xb4, 0xf2, 0x87, 0xa1, 0x46, 0x54, 0x2d, 0x6d, 0xd2, 0x3f, 0x2b, 0x9a,
+  0x1b, 0x0f, 0x94, 0x7c, 0x72, 0x0f, 0xde, 0x95, 0xdd, 0x67, 0xe0, 0xc3,
+  0xfd, 0x31, 0x04, 0x43, 0x80, 0x41, 0xa9, 0xe5, 0x0f, 0xeb, 0x37, 0xa2,
+  0x1a, 0xe0, 0x50, 0xbc, 0x62, 0x78, 0xe3, 0x77, 0x21, 0x8f, 0x3a, 0x39,
+  0xe0, 0xdc, 0xbc, 0x1f, 0xd6, 0x30, 0x97, 0x42, 0x68, 0x8f, 0xc3, 0x82,
+  0xdc, 0xdf, 0x0d, 0xe3, 0xe8, 0xb3, 0xc3, 0x05, 0xc1, 0xc5, 0x5f, 0x2b,
+  0x3f, 0xe6, 0x31, 0x30, 0xa3, 0xc4, 0x0e, 0xe3, 0x4c, 0xa0, 0x08, 0xb1,
+  0x41, 0xa4, 0x17, 0xa2, 0x64, 0xeb, 0xda, 0xc6, 0xfd, 0xa0, 0x29, 0xe3,
+  0x10, 0xd1, 0x77, 0x0e, 0x46, 0xf2, 0xf7, 0xa1, 0x4c, 0x60, 0x90, 0xb0,
+  0xf8, 0xb1, 0x35, 0x48, 0xd8, 0xa9, 0xfb, 0xe0, 0xca, 0x3a, 0x6b, 0x70,
+  0x4b, 0x96, 0xe5, 0xee, 0x23, 0x84, 0xa3, 0x76, 0x98, 0x79, 0xa3, 0xe2,
+  0xa6, 0xe2, 0x8c, 0xfa, 0xf9, 0x23, 0xea, 0x4e, 0x3c, 0x20, 0x29, 0x00,
+  0x4d, 0xdd, 0x66, 0xfb, 0xdb, 0xaf, 0xbf, 0x5c, 0x0b, 0x66, 0x8a, 0xea,
+  0x8a, 0x19, 0xd6, 0xa0, 0x37, 0xe9, 0xf0, 0x25, 0x52, 0xbc, 0x60, 0x96,
+  0x9d, 0x44, 0x65, 0x56, 0x5f, 0x3b, 0x8d, 0xe2, 0x24, 0xcc, 0x31, 0xac,
+  0xcf, 0x84, 0x36, 0x93, 0xbe, 0x9d, 0x35, 0x4c, 0xe1, 0x5c, 0x22, 0x77,
+  0xce, 0x36, 0x67, 0x33, 0xaf, 0xf3, 0xda, 0x08, 0xee, 0x0b, 0xb5, 0x8b,
+  0x08, 0xe3, 0x4b, 0x7b, 0xcb, 0x47, 0x94, 0x3c, 0xb8, 0x9a, 0x67, 0xbf,
+  0x53, 0xd0, 0x3f, 0xb5, 0x5f, 0x6c, 0x47, 0xcb, 0x85, 0xfe, 0xcc, 0x2e,
+  0xa0, 0x5b, 0xe2, 0xe8, 0x97, 0x01, 0x7d, 0x9c, 0x5f, 0xdb, 0xec, 0x85,
+  0xd3, 0xd5, 0xa7, 0x51, 0x7f, 0x3b, 0x6e, 0x58, 0x63, 0x1a, 0xea, 0xd7,
+  0xbe, 0x67, 0x1d, 0xcf, 0xc3, 0xd0, 0x24, 0x4e, 0xff, 0xd5, 0x84, 0x9f,
+  0xad, 0xb4, 0xff, 0xdd, 0x63, 0x5c, 0x2e, 0x5d, 0x2b, 0x0b, 0x3a, 0x0c,
+  0xfb, 0xd9, 0x68, 0x6b, 0xd0, 0x83, 0xa5, 0x01, 0xff, 0x7d, 0xa6, 0xc9,
+  0xd1, 0x87, 0x5f, 0x58, 0x3b, 0x17, 0xb3, 0xf0, 0xc9, 0x37, 0xf3, 0x1f,
+  0xc8, 0x7f, 0x03, 0xad, 0x5e, 0x0d, 0x62, 0xcf, 0x10, 0x00, 0x00
+};
+#endif
@@ -0,0 +1,157 @@
+/*
+ Closed loop position check from a slotted disc encoder on GPIO3 ( the serial RX pin - free since Serial is TX only ).
+ The encoder has no direction output, so each pulse is counted in the direction the wheel is being driven.
+ Edges closer together than ENCODER_GLITCH_US are rejected as noise, the rest are counted by the ISR - not queued, so a
+ loop held up long enough to fill the event queue can't lose them.
+ The loop compares the encoder with the motion engine's step position during each move and once it completes:
+ an error within one encoder count is resolution, whole counts up to ENCODER_CORRECT_STEPS are corrected by
+ moving the step position and letting the wheel drive back onto the filter. Anything larger stops the wheel, re-syncs the
+ step position to the encoder and is reported as an ASCOM error until the client requests a new position.
+*/
+#if !defined _WHEELENCODER_H_
+#define _WHEELENCODER_H_
+
+const uint32_t ENCODER_GLITCH_US = 200;
+const int ENCODER_CORRECT_STEPS = 8; //full steps
+
+enum encoderChecks { ENCODER_OK, ENCODER_CORRECTED, ENCODER_FAULT };
+
+struct WheelEncoder
+{
+  int countsPerRev;               //0 if no encoder fitted
+  volatile uint32_t edges;        //written by the ISR
+  volatile uint32_t glitches;
+  volatile uint32_t lastEdgeCycles;
+  uint32_t edgesSeen;             //edges already applied to position
+  int position;                   //encoder counts, 0 to countsPerRev
+  int lastError;                  //microsteps, step position - encoder position
+  int maxError;
+  uint32_t corrections;
+  uint32_t faults;
+  bool fault;
+};
+
+//Only one wheel can have the encoder input, the ISR filters and counts edges for this one.
+WheelEncoder* isrEncoder = NULL;
+uint32_t encoderGlitchCycles = 0;
+
+void initWheelEncoder( WheelEncoder* enc );
+void beginWheelEncoder( WheelEncoder* enc, int pin, int countsPerRev );
+void syncWheelEncoder( WheelEncoder* enc, int stepPosition );
+int encoderMicrosteps( WheelEncoder* enc );
+int checkWheelEncoder( WheelEncoder* enc, MotionEngine* motion, bool moveComplete );
+void ICACHE_RAM_ATTR encoderEdge( void );
+
+void initWheelEncoder( WheelEncoder* enc )
+{
+  enc->countsPerRev = 0;
+  enc->edges = 0;
+  enc->glitches = 0;
+  enc->lastEdgeCycles = 0;
+  enc->edgesSeen = 0;
+  enc->position = 0;
+  enc->lastError = 0;
+  enc->maxError = 0;
+  enc->corrections = 0;
+  enc->faults = 0;
+  enc->fault = false;
+}
+
+void beginWheelEncoder( WheelEncoder* enc, int pin, int countsPerRev )
+{
+  if( pin == NO_PIN || countsPerRev <= 0 )
+    return;
+  enc->countsPerRev = countsPerRev;
+  encoderGlitchCycles = ENCODER_GLITCH_US * ESP.getCpuFreqMHz();
+  isrEncoder = enc;
+  pinMode( pin, INPUT_PULLUP );
+  attachInterrupt( digitalPinToInterrupt( pin ), encoderEdge, RISING );
+}
+
+//Set the encoder position from a step position known to be good - at boot.
+void syncWheelEncoder( WheelEncoder* enc, int stepPosition )
+{
+  if( enc->countsPerRev == 0 )
+    return;
+  enc->edgesSeen = enc->edges;
+  enc->position = ( stepPosition * enc->countsPerRev ) / microstepsPerRevolution;
+}
+
+int encoderMicrosteps( WheelEncoder* enc )
+{
+  return ( enc->position * microstepsPerRevolution ) / enc->countsPerRev;
+}
+
+/*
+ * Apply the edges counted since the last call and compare with the step position.
+ * Called from the loop while the wheel moves and once when the move completes.
+ */
+int checkWheelEncoder( WheelEncoder* enc, MotionEngine* motion, bool moveComplete )
+{
+  uint32_t edges = enc->edges;
+  int delta = (int) ( edges - enc->edgesSeen );
+  int resolution = 0;
+  int error = 0;
+  int counts = 0;
+
+  if( enc->countsPerRev == 0 )
+    return ENCODER_OK;
+
+  enc->edgesSeen = edges;
+  if( motion->getDirection() == DIRN_CW )
+    enc->position += delta;
+  else
+    enc->position -= delta;
+  enc->position = ( ( enc->position % enc->countsPerRev ) + enc->countsPerRev ) % enc->countsPerRev;
+
+  //Shortest way round from the encoder to the step position
+  error = motion->getPosition() - encoderMicrosteps( enc );
+  if( error > microstepsPerRevolution/2 )
+    error -= microstepsPerRevolution;
+  else if( error < -microstepsPerRevolution/2 )
+    error += microstepsPerRevolution;
+  enc->lastError = error;
+  if( abs( error ) > enc->maxError )
+    enc->maxError = abs( error );
+
+  resolution = microstepsPerRevolution / enc->countsPerRev;
+  if( abs( error ) <= resolution )
+    return ENCODER_OK;
+
+  if( abs( error ) > resolution + ENCODER_CORRECT_STEPS * MICROSTEPS_PER_STEP )
+  {
+    DEBUGS1( F("Encoder: position error too large, stopping. Error: ") );DEBUGSL1( error );
+    motion->stop();
+    //Encoder counts rarely fall on a full step - a full step driver must be put on one
+    motion->setPosition( motion->snapToStep( encoderMicrosteps( enc ) ) );
+    enc->fault = true;
+    enc->faults++;
+    return ENCODER_FAULT;
+  }
+
+  //Small errors are only corrected once the wheel has stopped, by whole encoder counts so the sub-count phase is kept.
+  //An odd resolution leaves a full step driver half a step out, so the result is rounded to a full step.
+  if( !moveComplete )
+    return ENCODER_OK;
+  counts = error / resolution;
+  DEBUGS1( F("Encoder: correcting step position by ") );DEBUGSL1( counts * resolution );
+  motion->setPosition( motion->snapToStep( motion->getPosition() - counts * resolution ) );
+  enc->corrections++;
+  return ENCODER_CORRECTED;
+}
+
+//Rising edge on the encoder input - count it unless it follows the last one too closely to be real.
+void ICACHE_RAM_ATTR encoderEdge( void )
+{
+  uint32_t now = ESP.getCycleCount();
+  if( isrEncoder == NULL )
+    return;
+  if( ( now - isrEncoder->lastEdgeCycles ) < encoderGlitchCycles )
+  {
+    isrEncoder->glitches++;
+    return;
+  }
+  isrEncoder->lastEdgeCycles = now;
+  isrEncoder->edges++;
+}
+#endif
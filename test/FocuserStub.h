@@ -0,0 +1,197 @@
+/*
+ Stand-in Alpaca focuser for the focus offset tests and benchmark, served in-process on the virtual clock.
+ It listens like the sketch's servers ( hostPort() of its port ) and is serviced between loop passes, answering
+ GET position, PUT move and GET ismoving for any device number. A move runs at stepsPerSec of virtual time, to the
+ position asked or by it when relative. Replies carry a Content-Length and the connection is kept open, or with
+ CLOSE_EACH are sent with Connection: close, or with HTTP_10 as an HTTP/1.0 reply without a length, ended by closing,
+ or with CHUNKED in two chunks, each written on its own, and the connection kept open.
+ dropConnections() closes the idle connections as a focuser timing them out would, dropNext closes the one the next
+ request arrives on without answering it, as when the focuser closes it while the request is on its way.
+*/
+#if !defined _FOCUSERSTUB_H_
+#define _FOCUSERSTUB_H_
+#include <string>
+#include <vector>
+
+class FocuserStub
+{
+  public:
+    enum Mode { KEEP_ALIVE, CLOSE_EACH, HTTP_10, CHUNKED };
+
+    FocuserStub( uint16_t p, int rate, bool rel ) : server( p ), port( p ), stepsPerSec( rate ), relative( rel ) {}
+
+    void begin( void ) { server.begin(); }
+    uint16_t connectPort( void ) { return hostPort( port ); }
+
+    void service( void )
+    {
+      uint8_t buf[512];
+      int n = 0;
+
+      while( server.hasClient() )
+      {
+        connections.push_back( Connection() );
+        connections.back().client = server.available();
+        accepted++;
+      }
+      for( size_t i = 0; i < connections.size(); )
+      {
+        Connection& c = connections[i];
+        while( ( n = c.client.read( buf, sizeof( buf ) ) ) > 0 )
+          c.rx.append( (const char*) buf, n );
+        while( c.client.connected() && serveRequest( c ) )
+          ;
+        if( !c.client.connected() )
+        {
+          c.client.stop();
+          connections.erase( connections.begin() + i );
+          continue;
+        }
+        i++;
+      }
+    }
+
+    void dropConnections( void )
+    {
+      for( Connection& c : connections )
+        c.client.stop();
+      connections.clear();
+    }
+
+    int position( void )
+    {
+      uint64_t steps = ( host::nowMicros() - moveStartUs ) * stepsPerSec / 1000000;
+      int distance = abs( target - startPosition );
+      if( steps >= (uint64_t) distance )
+        return target;
+      return startPosition + ( ( target > startPosition )? (int) steps : -(int) steps );
+    }
+    bool isMoving( void ) { return position() != target; }
+    uint64_t moveEndUs( void ) { return moveStartUs + (uint64_t) abs( target - startPosition ) * 1000000 / stepsPerSec; }
+
+    Mode mode = KEEP_ALIVE;
+    uint32_t accepted = 0;
+    uint32_t requests = 0;
+    uint32_t moves = 0;
+    int lastMove = 0;           //Position of the last move request
+    bool dropNext = false;      //close the connection the next request arrives on, unanswered
+
+  private:
+    struct Connection
+    {
+      WiFiClient client;
+      std::string rx;
+    };
+
+    WiFiServer server;
+    uint16_t port;
+    int stepsPerSec;
+    bool relative;
+    std::vector<Connection> connections;
+    int startPosition = 0;
+    int target = 0;
+    uint64_t moveStartUs = 0;
+    uint32_t serverTransID = 0;
+
+    static std::string field( const std::string& text, const char* name )
+    {
+      std::string key = std::string( name ) + "=";
+      size_t at = 0;
+      while( ( at = text.find( key, at ) ) != std::string::npos )
+      {
+        if( at == 0 || text[at - 1] == '&' || text[at - 1] == '?' )
+        {
+          at += key.size();
+          return text.substr( at, text.find_first_of( "& ", at ) - at );
+        }
+        at += key.size();
+      }
+      return "";
+    }
+
+    //Answer the first whole request in c.rx, false if there isn't one yet
+    bool serveRequest( Connection& c )
+    {
+      size_t end = c.rx.find( "\r\n\r\n" );
+      size_t length = 0;
+      size_t at = 0;
+      if( end == std::string::npos )
+        return false;
+      std::string head = c.rx.substr( 0, end );
+      if( ( at = head.find( "Content-Length: " ) ) != std::string::npos )
+        length = (size_t) atoi( head.c_str() + at + 16 );
+      if( c.rx.size() < end + 4 + length )
+        return false;
+      std::string body = c.rx.substr( end + 4, length );
+      c.rx.erase( 0, end + 4 + length );
+      requests++;
+
+      std::string line = head.substr( 0, head.find( "\r\n" ) );
+      std::string uri = line.substr( line.find( ' ' ) + 1 );
+      uri = uri.substr( 0, uri.find( ' ' ) );
+      std::string path = uri.substr( 0, uri.find( '?' ) );
+      std::string property = path.substr( path.rfind( '/' ) + 1 );
+      std::string query = ( uri.find( '?' ) != std::string::npos )? uri.substr( uri.find( '?' ) + 1 ) : body;
+      if( dropNext )
+      {
+        //Closed as the request arrives, as a focuser timing out the idle connection would
+        dropNext = false;
+        c.client.stop();
+        return false;
+      }
+      std::string value;
+      if( line.compare( 0, 4, "GET " ) == 0 && property == "position" )
+        value = ",\"Value\":" + std::to_string( position() );
+      else if( line.compare( 0, 4, "GET " ) == 0 && property == "ismoving" )
+        value = std::string( ",\"Value\":" ) + ( isMoving()? "true" : "false" );
+      else if( line.compare( 0, 4, "PUT " ) == 0 && property == "move" )
+        startMove( atoi( field( body, "Position" ).c_str() ) );
+      else
+      {
+        reply( c, "400 Bad Request", "Unknown focuser request" );
+        return true;
+      }
+      reply( c, "200 OK", "{\"ClientTransactionID\":" + field( query, "ClientTransactionID" ) + ",\"ServerTransactionID\":" +
+             std::to_string( ++serverTransID ) + ",\"ErrorNumber\":0,\"ErrorMessage\":\"\"" + value + "}" );
+      return true;
+    }
+
+    void startMove( int p )
+    {
+      int from = position();
+      startPosition = from;
+      target = ( relative )? from + p : p;
+      moveStartUs = host::nowMicros();
+      lastMove = p;
+      moves++;
+    }
+
+    void reply( Connection& c, const char* status, const std::string& body )
+    {
+      std::string out;
+      if( mode == HTTP_10 )
+        out = std::string( "HTTP/1.0 " ) + status + "\r\nContent-Type: application/json\r\n\r\n" + body;
+      else if( mode == CHUNKED )
+      {
+        size_t half = body.size() / 2;
+        out = std::string( "HTTP/1.1 " ) + status + "\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n" +
+              chunk( body.substr( 0, half ) );
+        c.client.write( (const uint8_t*) out.data(), out.size() );
+        out = chunk( body.substr( half ) ) + "0\r\n\r\n";
+      }
+      else
+        out = std::string( "HTTP/1.1 " ) + status + "\r\nContent-Type: application/json\r\nContent-Length: " +
+              std::to_string( body.size() ) + "\r\n" + ( ( mode == CLOSE_EACH )? "Connection: close\r\n" : "" ) + "\r\n" + body;
+      c.client.write( (const uint8_t*) out.data(), out.size() );
+      if( mode == CLOSE_EACH || mode == HTTP_10 )
+        c.client.stop();
+    }
+
+    static std::string chunk( const std::string& data )
+    {
+      char size[16];
+      snprintf( size, sizeof( size ), "%zx\r\n", data.size() );
+      return size + data + "\r\n";
+    }
+};
+#endif
@@ -0,0 +1,129 @@
+/*
+ Deterministic discrete-event simulator for MotionEngine, needing nothing but MotionEngine.h.
+ SimStepper stands in for the driver and step timer: ticks fall every step interval on a microsecond clock, and the
+ main loop that calls update() gets to each tick after a latency drawn from a seeded generator - a short pass most of
+ the time, now and then a long one as when a request is being handled. A late loop drains the ticks that have queued
+ one per pass, as the sketch's loop does. The driver keeps its own position from the pulses it sees, so a test can
+ check the engine's book-keeping against it, and the time between pulses is compared with the step interval.
+*/
+#if !defined _MOTIONSIM_H_
+#define _MOTIONSIM_H_
+#include "../MotionEngine.h"
+#include <stdint.h>
+
+class SimStepper : public StepperHardware
+{
+  public:
+    SimStepper( bool halfStep, int microstepsPerRevolution ) : half( halfStep ), microstepsPerRev( microstepsPerRevolution ) {}
+    void setDirection( int d ) { dirn = d; }
+    void setEnabled( bool e ) { enabled = e; }
+    bool hasHalfStep( void ) { return half; }
+    void setStepMode( int m ) { mode = m; }
+    void pulse( void )
+    {
+      position += ( dirn == DIRN_CW )? mode : -mode;
+      position = ( position + microstepsPerRev ) % microstepsPerRev;
+      pulses++;
+      if( lastPulseUs != UINT64_MAX )
+      {
+        int64_t error = (int64_t) ( nowUs - lastPulseUs ) - (int64_t) intervalUs;
+        if( error < 0 )
+          error = -error;
+        if( (uint64_t) error > worstIntervalErrorUs )
+          worstIntervalErrorUs = error;
+      }
+      lastPulseUs = nowUs;
+    }
+    void startTicks( void (*onTick)( void* ), void* arg, uint32_t intervalMs )
+    {
+      tickFn = onTick;
+      tickArg = arg;
+      intervalUs = (uint64_t) intervalMs * 1000;
+      nextTickUs = nowUs + intervalUs;
+      ticking = true;
+      lastPulseUs = UINT64_MAX;
+    }
+    void stopTicks( void ) { ticking = false; }
+
+    bool half;
+    int microstepsPerRev;
+    int dirn = DIRN_CW;
+    int mode = STEP_FULL;
+    bool enabled = false;
+    int position = 0;          //microsteps, from the pulses seen
+    bool ticking = false;
+    void (*tickFn)( void* ) = NULL;
+    void* tickArg = NULL;
+    uint64_t intervalUs = 0;
+    uint64_t nextTickUs = 0;
+    uint64_t nowUs = 0;
+    uint64_t lastPulseUs = UINT64_MAX;
+    uint64_t pulses = 0;
+    uint64_t worstIntervalErrorUs = 0;
+};
+
+struct MotionSim
+{
+  SimStepper hw;
+  MotionEngine engine;
+  uint32_t passUs = 50;          //a loop pass with nothing else to do
+  uint32_t busyUs = 0;           //a pass that handles a request
+  uint32_t busyPerMille = 0;     //how often a pass is busy
+  uint64_t seed = 0x9E3779B97F4A7C15ull;
+  uint64_t moves = 0;
+
+  MotionSim( bool halfStep, int microstepsPerRevolution, uint32_t stepIntervalMs )
+    : hw( halfStep, microstepsPerRevolution )
+  {
+    engine.begin( &hw, microstepsPerRevolution, stepIntervalMs );
+  }
+
+  uint32_t random( void )
+  {
+    //xorshift64
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return (uint32_t) ( seed >> 32 );
+  }
+
+  uint32_t passLength( void )
+  {
+    if( busyPerMille > 0 && ( random() % 1000 ) < busyPerMille )
+      return busyUs;
+    return 1 + random() % passUs;
+  }
+
+  //Run a move to completion, returns the simulated time it took in microseconds
+  uint64_t moveTo( int target )
+  {
+    uint64_t start = hw.nowUs;
+    uint64_t loopUs = hw.nowUs;
+    engine.moveTo( target );
+    moves++;
+    while( engine.isMoving() )
+    {
+      //The timer fires, the loop gets to it when its current pass ends
+      uint64_t tickUs = hw.nextTickUs;
+      hw.nextTickUs += hw.intervalUs;
+      hw.tickFn( hw.tickArg );
+      if( loopUs < tickUs )
+        loopUs = tickUs;
+      loopUs += passLength();
+      hw.nowUs = loopUs;
+      uint64_t pulses = hw.pulses;
+      engine.update();
+      //Ticks that queued while the loop was busy are stepped one per pass until the next tick is due
+      while( engine.isMoving() && hw.pulses != pulses && loopUs + passUs < hw.nextTickUs )
+      {
+        pulses = hw.pulses;
+        loopUs += passUs;
+        hw.nowUs = loopUs;
+        engine.update();
+      }
+    }
+    hw.nowUs = loopUs;
+    return hw.nowUs - start;
+  }
+};
+#endif
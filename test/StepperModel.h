@@ -0,0 +1,143 @@
+/*
+ A step/direction driver and motor watching one wheel's pins through host::pinHook.
+ Each rising edge on the step pin while enabled moves the commanded position by one microstep in half step mode or
+ two in full step mode. The rotor follows the commanded position as a damped spring - advance() integrates it - and
+ holds where it is when the driver is disabled, so a move that ends while the rotor still rings ends off target.
+ Positions are microsteps, unwrapped.
+ A slotted disc encoder can be fitted - each slot edge the commanded position crosses raises the encoder pin's
+ interrupt, with an optional contact bounce. missPulses makes the motor slip, ignoring that many pulses.
+*/
+#if !defined _STEPPERMODEL_H_
+#define _STEPPERMODEL_H_
+#include <math.h>
+
+struct StepperModel
+{
+  int dirnPin = NO_PIN;
+  int stepPin = NO_PIN;
+  int enablePin = NO_PIN;
+  int halfStepPin = NO_PIN;
+  double naturalHz = 40.0;
+  double damping = 0.1;
+
+  bool enabled = false;
+  bool stepHigh = false;
+  long commanded = 0;
+  double rotor = 0.0;
+  double velocity = 0.0;   //microsteps/s
+  uint32_t pulses = 0;
+  uint32_t halfPulses = 0;
+
+  int microstepsPerRev = 4096;
+  int encoderPin = NO_PIN;
+  int encoderCounts = 0;
+  bool encoderBounce = false;
+  uint32_t encoderEdges = 0;
+  int missPulses = 0;
+  uint32_t missed = 0;
+
+  static StepperModel*& attached( void )
+  {
+    static StepperModel* model = NULL;
+    return model;
+  }
+
+  static void onPin( uint8_t pin, uint8_t value )
+  {
+    StepperModel* m = attached();
+    if( m == NULL )
+      return;
+    if( pin == m->enablePin )
+      m->enabled = ( value == LOW );
+    else if( pin == m->stepPin )
+    {
+      if( value == HIGH && !m->stepHigh && m->enabled )
+        m->pulse();
+      m->stepHigh = ( value == HIGH );
+    }
+  }
+
+  void attach( int dirn, int step, int enable, int halfStep, long position )
+  {
+    dirnPin = dirn;
+    stepPin = step;
+    enablePin = enable;
+    halfStepPin = halfStep;
+    reset( position );
+    attached() = this;
+    host::pinHook = onPin;
+  }
+
+  void reset( long position )
+  {
+    commanded = position;
+    rotor = position;
+    velocity = 0.0;
+    pulses = 0;
+    halfPulses = 0;
+  }
+
+  void fitEncoder( int pin, int counts )
+  {
+    encoderPin = pin;
+    encoderCounts = counts;
+  }
+
+  int slot( long position ) const
+  {
+    return (int) ( ( ( ( position % microstepsPerRev ) + microstepsPerRev ) % microstepsPerRev ) * encoderCounts / microstepsPerRev );
+  }
+
+  void pulse( void )
+  {
+    bool half = ( halfStepPin != NO_PIN && digitalRead( halfStepPin ) == HIGH );
+    int size = half? STEP_HALF : STEP_FULL;
+    long before = commanded;
+    pulses++;
+    halfPulses += half;
+    if( missPulses > 0 )
+    {
+      missPulses--;
+      missed++;
+      return;
+    }
+    commanded += ( digitalRead( dirnPin ) == DIRN_CW )? size : -size;
+    if( encoderCounts > 0 && slot( before ) != slot( commanded ) )
+    {
+      encoderEdges++;
+      hostRaiseInterrupt( encoderPin, HIGH );
+      hostRaiseInterrupt( encoderPin, LOW );
+      if( encoderBounce )
+      {
+        hostRaiseInterrupt( encoderPin, HIGH );
+        hostRaiseInterrupt( encoderPin, LOW );
+      }
+    }
+  }
+
+  //Let the rotor follow for us microseconds
+  void advance( uint32_t us )
+  {
+    const double w = 2.0 * M_PI * naturalHz;
+    double dt = 0.0;
+    if( !enabled )
+    {
+      velocity = 0.0;
+      return;
+    }
+    while( us > 0 )
+    {
+      dt = std::min( us, (uint32_t) 50 ) / 1e6;
+      velocity += ( -w * w * ( rotor - commanded ) - 2.0 * damping * w * velocity ) * dt;
+      rotor += velocity * dt;
+      us -= std::min( us, (uint32_t) 50 );
+    }
+  }
+
+  long wrapped( int microstepsPerRev ) const
+  {
+    return ( ( commanded % microstepsPerRev ) + microstepsPerRev ) % microstepsPerRev;
+  }
+  double error( void ) const { return rotor - commanded; }
+};
+#endif
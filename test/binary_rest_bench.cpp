@@ -0,0 +1,247 @@
+/*
+ Round trips over the loopback sockets to the sketch's REST API and to the binary protocol ( BinaryProtocol.h ).
+ The client writes a request, the sketch's loop is run until the reply is in, and the host time and the bytes on the
+ wire are recorded - a new connection per REST request, as the server closes each one, one held TCP connection and
+ UDP datagrams for the binary frames. Host times show the relative cost of the parsing and the socket work, not the
+ ESP8266's own.
+ Then a filter change on the virtual clock: the REST client polls Position every 100ms, the binary client waits for
+ the move complete frame, and the time from the end of the move to the client knowing is compared. A change that
+ starts with a correcting move must send the frame once, when the wheel is on the new filter.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include <chrono>
+#include <algorithm>
+
+const int ROUND_TRIPS = 2000;
+const uint32_t CLIENT_ID = 1;
+const uint32_t REST_POLL_US = 100000;
+const IPAddress LOOPBACK( 127, 0, 0, 1 );
+
+FilterWheel* fw = &filterWheels[0];
+uint16_t transID = 0;
+
+struct Stats
+{
+  std::vector<double> us;
+  uint64_t bytes = 0;
+};
+
+double percentile( std::vector<double> v, int pc )
+{
+  std::sort( v.begin(), v.end() );
+  return v[ ( v.size() - 1 ) * pc / 100 ];
+}
+
+void report( const char* name, const Stats& s )
+{
+  printf( "binary vs rest: %-22s p50 %7.1f us, p99 %7.1f us, %5.0f bytes a round trip\n",
+          name, percentile( s.us, 50 ), percentile( s.us, 99 ), (double) s.bytes / s.us.size() );
+}
+
+//One REST request on its own connection, the reply is everything up to the server closing it
+std::string restRoundTrip( HTTPMethod method, const String& uri, const std::string& body, Stats* stats )
+{
+  std::string raw = ESP8266WebServer::hostBuildRequest( method, uri, body );
+  std::string reply;
+  WiFiClient client;
+  uint8_t buf[1024];
+  int n = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  CHECK( client.connect( LOOPBACK, hostPort( 80 ) ) );
+  client.write( (const uint8_t*) raw.data(), raw.size() );
+  while( client.connected() )
+  {
+    hostLoopPass();
+    while( ( n = client.read( buf, sizeof( buf ) ) ) > 0 )
+      reply.append( (const char*) buf, n );
+  }
+  if( stats != NULL )
+  {
+    stats->us.push_back( std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - start ).count() );
+    stats->bytes += raw.size() + reply.size();
+  }
+  return reply;
+}
+
+BinaryFrame requestFrame( uint8_t command, int16_t value )
+{
+  BinaryFrame frame;
+  frame.magic = BINARY_MAGIC;
+  frame.command = command;
+  frame.device = 0;
+  frame.flags = 0;
+  frame.clientID = CLIENT_ID;
+  frame.transID = ++transID;
+  frame.value = value;
+  frame.error = 0;
+  return frame;
+}
+
+BinaryFrame tcpRoundTrip( WiFiClient& client, uint8_t command, int16_t value, Stats* stats )
+{
+  BinaryFrame request = requestFrame( command, value );
+  BinaryFrame reply;
+  int count = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  client.write( (const uint8_t*) &request, sizeof( request ) );
+  while( count < (int) sizeof( reply ) )
+  {
+    hostLoopPass();
+    count += client.read( (uint8_t*) &reply + count, sizeof( reply ) - count );
+  }
+  if( stats != NULL )
+  {
+    stats->us.push_back( std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - start ).count() );
+    stats->bytes += sizeof( request ) + sizeof( reply );
+  }
+  CHECK_EQ( reply.transID, request.transID );
+  return reply;
+}
+
+BinaryFrame udpRoundTrip( WiFiUDP& udp, uint8_t command, int16_t value, Stats* stats )
+{
+  BinaryFrame request = requestFrame( command, value );
+  BinaryFrame reply;
+
+  auto start = std::chrono::steady_clock::now();
+  udp.beginPacket( LOOPBACK, hostPort( BINARY_PROTOCOL_PORT ) );
+  udp.write( (const uint8_t*) &request, sizeof( request ) );
+  udp.endPacket();
+  do
+    hostLoopPass();
+  while( udp.parsePacket() != sizeof( reply ) );
+  udp.read( (uint8_t*) &reply, sizeof( reply ) );
+  if( stats != NULL )
+  {
+    stats->us.push_back( std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - start ).count() );
+    stats->bytes += sizeof( request ) + sizeof( reply );
+  }
+  CHECK_EQ( reply.transID, request.transID );
+  return reply;
+}
+
+String positionUri( void )
+{
+  return String( "/api/v1/filterwheel/0/Position?ClientID=" ) + CLIENT_ID + "&ClientTransactionID=" + ( ++transID );
+}
+
+//Loop passes until the wheel is on the filter, returns the virtual time it got there
+uint64_t settled( void )
+{
+  return ( !fw->motion.isMoving() && fw->targetFilterId == fw->currentFilterId )? host::nowMicros() : 0;
+}
+
+int main( void )
+{
+  Stats restGet, restPut, tcpGet, tcpPut, udpGet;
+  WiFiClient tcp;
+  WiFiUDP udp;
+  BinaryFrame reply;
+  std::string body;
+  int i = 0;
+
+  hostBoot();
+  CHECK( tcp.connect( LOOPBACK, hostPort( BINARY_PROTOCOL_PORT ) ) );
+  tcp.setNoDelay( true );
+  CHECK( udp.begin( BINARY_PROTOCOL_PORT + 1 ) );
+  reply = tcpRoundTrip( tcp, CMD_CONNECT, 1, NULL );
+  CHECK_EQ( reply.error, 0 );
+  CHECK_EQ( reply.value, 1 );
+
+  //The connected client is not rate limited, and setting the filter the wheel is on doesn't move it
+  for( i = 0; i < ROUND_TRIPS; i++ )
+  {
+    body = restRoundTrip( HTTP_GET, positionUri(), "", &restGet );
+    CHECK( body.find( "200 OK" ) != std::string::npos );
+    body = restRoundTrip( HTTP_PUT, String( "/api/v1/filterwheel/0/Position" ), "ClientID=1&ClientTransactionID=" +
+                          std::to_string( ++transID ) + "&Position=0", &restPut );
+    CHECK( body.find( "200 OK" ) != std::string::npos );
+    reply = tcpRoundTrip( tcp, CMD_GET_POSITION, 0, &tcpGet );
+    CHECK_EQ( reply.value, 0 );
+    reply = tcpRoundTrip( tcp, CMD_SET_POSITION, 0, &tcpPut );
+    CHECK_EQ( reply.error, 0 );
+    reply = udpRoundTrip( udp, CMD_GET_POSITION, 0, &udpGet );
+    CHECK_EQ( reply.value, 0 );
+  }
+  report( "REST GET Position", restGet );
+  report( "REST PUT Position", restPut );
+  report( "TCP frame get position", tcpGet );
+  report( "TCP frame set position", tcpPut );
+  report( "UDP frame get position", udpGet );
+  CHECK( percentile( tcpGet.us, 50 ) < percentile( restGet.us, 50 ) );
+  CHECK( tcpGet.bytes * 10 < restGet.bytes );
+
+  //A filter change, finding out it has ended by polling over REST
+  uint64_t polls = 0;
+  uint64_t nextPoll = 0;
+  uint64_t arrived = 0;
+  uint64_t known = 0;
+  body = restRoundTrip( HTTP_PUT, String( "/api/v1/filterwheel/0/Position" ), "ClientID=1&ClientTransactionID=" +
+                        std::to_string( ++transID ) + "&Position=2", NULL );
+  CHECK( body.find( "\"ErrorNumber\":0" ) != std::string::npos );
+  nextPoll = host::nowMicros() + REST_POLL_US;
+  while( known == 0 )
+  {
+    hostLoopPass();
+    if( arrived == 0 )
+      arrived = settled();
+    if( host::nowMicros() < nextPoll )
+      continue;
+    nextPoll += REST_POLL_US;
+    polls++;
+    body = restRoundTrip( HTTP_GET, positionUri(), "", NULL );
+    if( body.find( "\"Value\":2" ) != std::string::npos )
+      known = host::nowMicros();
+  }
+  CHECK( arrived != 0 && known >= arrived );
+  printf( "binary vs rest: filter change over REST known %6.1f ms after the wheel stopped, %llu polls\n",
+          ( known - arrived ) / 1000.0, (unsigned long long) polls );
+  uint64_t restLag = known - arrived;
+
+  //The same change back, waiting for the move complete frame
+  BinaryFrame complete;
+  int count = 0;
+  arrived = 0;
+  reply = tcpRoundTrip( tcp, CMD_SET_POSITION, 0, NULL );
+  CHECK_EQ( reply.error, 0 );
+  CHECK( reply.flags & BINARY_FLAG_MOVING );
+  while( count < (int) sizeof( complete ) )
+  {
+    hostLoopPass();
+    if( arrived == 0 )
+      arrived = settled();
+    count += tcp.read( (uint8_t*) &complete + count, sizeof( complete ) - count );
+  }
+  known = host::nowMicros();
+  CHECK_EQ( complete.command, CMD_MOVE_COMPLETE );
+  CHECK_EQ( complete.value, 0 );
+  CHECK( arrived != 0 && known >= arrived );
+  printf( "binary vs rest: filter change over TCP  known %6.1f ms after the wheel stopped, 0 polls\n",
+          ( known - arrived ) / 1000.0 );
+  CHECK( known - arrived < restLag );
+
+  //Knocked off the filter as the change is asked for, the wheel makes a correcting move before the change - the frame waits for the change
+  uint32_t moves = moveJournal.count;
+  count = 0;
+  reply = tcpRoundTrip( tcp, CMD_SET_POSITION, 2, NULL );
+  CHECK_EQ( reply.error, 0 );
+  fw->motion.setPosition( fw->motion.getPosition() + 20 * MICROSTEPS_PER_STEP );
+  while( count < (int) sizeof( complete ) )
+  {
+    hostLoopPass();
+    count += tcp.read( (uint8_t*) &complete + count, sizeof( complete ) - count );
+  }
+  CHECK_EQ( moveJournal.count, moves + 2 );
+  CHECK_EQ( complete.command, CMD_MOVE_COMPLETE );
+  CHECK_EQ( complete.value, 2 );
+  CHECK_EQ( complete.clientID, CLIENT_ID );
+  CHECK( settled() != 0 );
+  CHECK_EQ( fw->motion.getPosition(), fw->filterPositions[2] * MICROSTEPS_PER_STEP );
+  //Sent once, the mask cleared
+  hostRunFor( 100 );
+  CHECK_EQ( tcp.available(), 0 );
+  return testResult( "binary_rest_bench" );
+}
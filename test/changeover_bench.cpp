@@ -0,0 +1,176 @@
+/*
+ Filter changeover time with focus offsets, on the virtual clock against the stand-in focuser ( FocuserStub.h ).
+ The same random changes are run twice: with the focus offset link on, the focuser moving alongside the wheel and the
+ change timed from the Position PUT to Position reading the new filter, then with the link off as a client has to do
+ it - the wheel change timed the same way, then the focuser moved to the new filter's offset over its own connection
+ and IsMoving polled every FOCUS_POLL_MS until it stops. Reports both, the time saved and the sketch's own
+ ChangeSavedMs, which compares the change with the wheel's and focuser's times added up.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include "FocuserStub.h"
+
+const int CHANGES = 20;
+const uint16_t FOCUSER_PORT = 4100;
+const int FOCUSER_STEPS_PER_SEC = 250;
+const IPAddress LOOPBACK( 127, 0, 0, 1 );
+
+FilterWheel* fw = &filterWheels[0];
+FocuserStub focuser( FOCUSER_PORT, FOCUSER_STEPS_PER_SEC, false );
+uint32_t transID = 0;
+uint32_t seed = 88172645;
+
+uint32_t random32( void )
+{
+  //xorshift32
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+void pass( void )
+{
+  focuser.service();
+  hostLoopPass();
+}
+
+void configure( const std::string& json )
+{
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  CHECK_EQ( server.hostRequest( HTTP_PUT, "/filterwheel/0/Config", json, "application/json" ).code, 200 );
+}
+
+int position( void )
+{
+  PGM_P errMsg = PSTR("");
+  int filterId = 0;
+  fwGetPosition( fw, &filterId, &errMsg );
+  return filterId;
+}
+
+//Virtual ms from the Position PUT to Position reading the filter
+uint32_t changeFilter( int filterId )
+{
+  char body[96];
+  snprintf( body, sizeof( body ), "ClientID=1&ClientTransactionID=%u&Position=%d", ++transID, filterId );
+  uint64_t start = host::nowMicros();
+  CHECK_EQ( server.hostRequest( HTTP_PUT, "/api/v1/filterwheel/0/Position", body ).code, 200 );
+  while( position() != filterId )
+    pass();
+  return (uint32_t) ( ( host::nowMicros() - start ) / 1000 );
+}
+
+//One Alpaca request to the focuser on the client's kept connection, returns the reply's Value
+long long focuserRequest( WiFiClient& client, bool put, const char* property, int value )
+{
+  char params[96];
+  char request[256];
+  std::string reply;
+  uint8_t buf[512];
+  size_t end = std::string::npos;
+  int n = 0;
+
+  if( put )
+  {
+    snprintf( params, sizeof( params ), "Position=%d&ClientID=2&ClientTransactionID=%u", value, ++transID );
+    snprintf( request, sizeof( request ), "PUT /api/v1/focuser/0/%s HTTP/1.1\r\nHost: focuser\r\n"
+              "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %zu\r\n\r\n%s", property, strlen( params ), params );
+  }
+  else
+    snprintf( request, sizeof( request ), "GET /api/v1/focuser/0/%s?ClientID=2&ClientTransactionID=%u HTTP/1.1\r\nHost: focuser\r\n\r\n",
+              property, ++transID );
+  client.write( (const uint8_t*) request, strlen( request ) );
+  while( end == std::string::npos || reply.size() < end + 4 + atoi( reply.c_str() + reply.find( "Content-Length: " ) + 16 ) )
+  {
+    pass();
+    while( ( n = client.read( buf, sizeof( buf ) ) ) > 0 )
+      reply.append( (const char*) buf, n );
+    end = reply.find( "\r\n\r\n" );
+  }
+  CHECK( reply.compare( 0, 12, "HTTP/1.1 200" ) == 0 );
+  std::string body = reply.substr( end + 4 );
+  if( body.find( "\"Value\":true" ) != std::string::npos )
+    return 1;
+  return jsonField( body, "Value" );
+}
+
+//Virtual ms for a client to move the focuser to position and see it stop
+uint32_t moveFocuser( WiFiClient& client, int position )
+{
+  uint64_t start = host::nowMicros();
+  focuserRequest( client, true, "move", position );
+  do
+  {
+    uint64_t next = host::nowMicros() + FOCUS_POLL_MS * 1000;
+    while( host::nowMicros() < next )
+      pass();
+  }
+  while( focuserRequest( client, false, "ismoving", 0 ) != 0 );
+  return (uint32_t) ( ( host::nowMicros() - start ) / 1000 );
+}
+
+int main( void )
+{
+  PGM_P errMsg = PSTR("");
+  std::string offsets;
+  int sequence[CHANGES];
+  int offset[MAX_FILTER_COUNT];
+  uint64_t parallelMs = 0, wheelMs = 0, focuserMs = 0;
+  long long savedMs = 0;
+  int filter = 0;
+  int i = 0;
+
+  hostBoot();
+  focuser.begin();
+  CHECK_EQ( fwSetConnected( fw, 1, true, &errMsg ), 0 );
+  for( i = 0; i < fw->filtersPerWheel; i++ )
+  {
+    offset[i] = ( i * 2 ) % fw->filtersPerWheel * 200;
+    offsets += ( ( i > 0 )? "," : "" ) + std::to_string( offset[i] );
+  }
+  for( i = 0; i < CHANGES; i++ )
+  {
+    filter = ( filter + 1 + random32() % ( fw->filtersPerWheel - 1 ) ) % fw->filtersPerWheel;
+    sequence[i] = filter;
+  }
+  configure( "{\"FocusOffsets\":[" + offsets + "],\"FocuserEnabled\":true,\"FocuserHost\":\"127.0.0.1\",\"FocuserPort\":" +
+             std::to_string( focuser.connectPort() ) + ",\"FocuserRelative\":false}" );
+  int startFilter = fw->currentFilterId;
+
+  //Wheel and focuser together
+  for( i = 0; i < CHANGES; i++ )
+  {
+    parallelMs += changeFilter( sequence[i] );
+    CHECK_EQ( focuser.position(), offset[sequence[i]] );
+    CHECK_EQ( fw->focuser.lastError, 0 );
+    savedMs += fw->lastChangeSavedMs;
+  }
+  printf( "changeover: %d changes with the focus offset link, %u focuser connection%s\n", CHANGES, focuser.accepted,
+          ( focuser.accepted == 1 )? "" : "s" );
+
+  //Back to the start with the link off, then the wheel and the client moving the focuser after it
+  configure( "{\"FocuserEnabled\":false}" );
+  changeFilter( startFilter );
+  WiFiClient client;
+  CHECK( client.connect( LOOPBACK, focuser.connectPort() ) );
+  client.setNoDelay( true );
+  moveFocuser( client, offset[startFilter] );
+  for( i = 0; i < CHANGES; i++ )
+  {
+    wheelMs += changeFilter( sequence[i] );
+    focuserMs += moveFocuser( client, offset[sequence[i]] );
+    CHECK_EQ( focuser.position(), offset[sequence[i]] );
+  }
+
+  uint64_t sequentialMs = wheelMs + focuserMs;
+  printf( "changeover: wheel then focuser  mean %6.0f ms ( wheel %6.0f ms, focuser %6.0f ms )\n",
+          (double) sequentialMs / CHANGES, (double) wheelMs / CHANGES, (double) focuserMs / CHANGES );
+  printf( "changeover: together            mean %6.0f ms\n", (double) parallelMs / CHANGES );
+  printf( "changeover: saved               mean %6.0f ms a change, %4.1f%%, sketch's ChangeSavedMs mean %6.0f ms\n",
+          (double) ( (long long) sequentialMs - (long long) parallelMs ) / CHANGES,
+          100.0 * ( (double) sequentialMs - (double) parallelMs ) / sequentialMs, (double) savedMs / CHANGES );
+  CHECK( parallelMs < sequentialMs );
+  CHECK( savedMs > 0 );
+  return testResult( "changeover_bench" );
+}
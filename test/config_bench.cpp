@@ -0,0 +1,120 @@
+/*
+ A setup change of wheel name, filter count, names and offsets made the old way, as four form PUTs, against one
+ JSON PUT to /filterwheel/{n}/Config. Reports requests, bytes on the wire, EEPROM commits and handling time per change,
+ and a modelled WiFi time from the round trips and the flash sector writes.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include <chrono>
+
+const int CHANGES = 2000;
+const uint32_t WIFI_RTT_US = 15000;        //request to reply on a quiet network
+const uint32_t EEPROM_COMMIT_US = 45000;   //sector erase and rewrite
+
+struct Totals
+{
+  uint32_t requests = 0;
+  uint64_t bytes = 0;
+  uint32_t failed = 0;
+  uint64_t hostNs = 0;
+};
+
+void send( Totals* t, HTTPMethod method, const char* uri, const std::string& body, const char* contentType )
+{
+  //Spaced out so the rate limit isn't reached
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  std::string raw = ESP8266WebServer::hostBuildRequest( method, uri, body, contentType );
+  auto start = std::chrono::steady_clock::now();
+  server.hostQueue( raw );
+  server.handleClient();
+  t->hostNs += std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+  const ESP8266WebServer::Response& r = server.hostLastResponse();
+  t->requests++;
+  t->bytes += raw.size() + r.body.size();
+  if( r.code != 200 )
+    t->failed++;
+}
+
+int filterCount( int change ) { return 4 + ( change % 2 ); }
+
+void changeByForms( Totals* t, int change )
+{
+  std::string body;
+  int count = filterCount( change );
+  send( t, HTTP_PUT, "/filterwheel/0/FilterCount", "filtersPerWheel=" + std::to_string( count ), "application/x-www-form-urlencoded" );
+  send( t, HTTP_PUT, "/filterwheel/0/Wheelname", "wheelname=W" + std::to_string( change ), "application/x-www-form-urlencoded" );
+  for( int i = 0; i < count; i++ )
+    body += ( i ? "&" : "" ) + std::string( "filterName" ) + std::to_string( i ) + "=F" + std::to_string( change + i );
+  send( t, HTTP_PUT, "/filterwheel/0/FilterNames", body, "application/x-www-form-urlencoded" );
+  body.clear();
+  for( int i = 0; i < count; i++ )
+    body += ( i ? "&" : "" ) + std::string( "filterOffset" ) + std::to_string( i ) + "=" + std::to_string( ( change + i ) % 100 );
+  send( t, HTTP_PUT, "/filterwheel/0/FocusOffsets", body, "application/x-www-form-urlencoded" );
+}
+
+void changeByConfig( Totals* t, int change )
+{
+  int count = filterCount( change );
+  std::string body = "{\"WheelName\":\"W" + std::to_string( change ) + "\",\"FilterCount\":" + std::to_string( count ) + ",\"Names\":[";
+  for( int i = 0; i < count; i++ )
+    body += ( i ? ",\"F" : "\"F" ) + std::to_string( change + i ) + "\"";
+  body += "],\"FocusOffsets\":[";
+  for( int i = 0; i < count; i++ )
+    body += ( i ? "," : "" ) + std::to_string( ( change + i ) % 100 );
+  body += "]}";
+  send( t, HTTP_PUT, "/filterwheel/0/Config", body, "application/json" );
+}
+
+//The change landed completely
+bool applied( int change )
+{
+  FilterWheel* fw = &filterWheels[0];
+  int count = filterCount( change );
+  if( fw->filtersPerWheel != count || String( fw->wheelName ) != ( "W" + std::to_string( change ) ).c_str() )
+    return false;
+  for( int i = 0; i < count; i++ )
+    if( String( fw->filterNames[i] ) != ( "F" + std::to_string( change + i ) ).c_str() || fw->focusOffsets[i] != ( change + i ) % 100 )
+      return false;
+  return true;
+}
+
+void report( const char* name, const Totals& t, uint32_t commits )
+{
+  double modelledMs = ( (double) t.requests * WIFI_RTT_US + (double) commits * EEPROM_COMMIT_US ) / 1000.0 / CHANGES;
+  printf( "config: %-12s %.1f requests, %5.0f bytes, %.2f EEPROM commits, %6.1f us handling, %5.1f ms modelled per change, %u failed\n",
+          name, (double) t.requests / CHANGES, (double) t.bytes / CHANGES, (double) commits / CHANGES,
+          t.hostNs / 1000.0 / CHANGES, modelledMs, t.failed );
+}
+
+int main( void )
+{
+  Totals forms, config;
+  uint32_t commits = 0;
+  uint32_t formCommits = 0;
+  uint32_t configCommits = 0;
+  int formsApplied = 0;
+  int configApplied = 0;
+
+  hostBoot();
+  for( int change = 0; change < CHANGES * 2; change += 2 )
+  {
+    commits = eepromCommits;
+    changeByForms( &forms, change );
+    formCommits += eepromCommits - commits;
+    formsApplied += applied( change );
+
+    //Each request changes every setting
+    commits = eepromCommits;
+    changeByConfig( &config, change + 1 );
+    configCommits += eepromCommits - commits;
+    configApplied += applied( change + 1 );
+  }
+
+  report( "four forms", forms, formCommits );
+  report( "Config PUT", config, configCommits );
+  CHECK_EQ( formsApplied, CHANGES );
+  CHECK_EQ( configApplied, CHANGES );
+  CHECK_EQ( config.failed, 0 );
+  CHECK_EQ( configCommits, CHANGES );
+  return testResult( "config_bench" );
+}
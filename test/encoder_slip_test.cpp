@@ -0,0 +1,141 @@
+/*
+ Closed loop checking of wheel 0 with a simulated slotted disc encoder ( StepperModel.h ) and a motor made to slip.
+ With 585 slots ( 7 microsteps a count ) a slip of a few steps is corrected when the move ends and the wheel driven back
+ onto the filter, a larger one stops the wheel with an ASCOM error until a new position is set. With 12 slots
+ ( 341 microsteps a count ) the re-sync after a fault lands between full steps unless it is rounded.
+ The wheel is full step only, so every position the engine takes must be a whole step, and it must not hunt.
+ Contact bounce on the encoder is rejected as glitches.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include "StepperModel.h"
+
+StepperModel model;
+FilterWheel* fw = &filterWheels[0];
+
+void fitEncoder( int counts )
+{
+  initWheelEncoder( &fw->encoder );
+  beginWheelEncoder( &fw->encoder, ENCODER_PIN, counts );
+  model.attach( DIRN_PIN, STEP_PIN, ENABLE_PIN, HALF_STEP_PIN, fw->motion.getPosition() );
+  model.microstepsPerRev = microstepsPerRevolution;
+  model.fitEncoder( ENCODER_PIN, counts );
+  syncWheelEncoder( &fw->encoder, fw->motion.getPosition() );
+}
+
+//Put the wheel where the engine thinks it is, as homing would
+void rehome( void )
+{
+  model.reset( fw->motion.getPosition() );
+  syncWheelEncoder( &fw->encoder, fw->motion.getPosition() );
+}
+
+//Ask for a filter, slipping on the way, and let the loop settle.
+//Slips are only injected from a settled, fault free wheel so they fall in the move to the filter.
+void changeFilter( int filter, int slipPulses )
+{
+  const char* errMsg = "";
+  CHECK_EQ( fwSetPosition( fw, 1, filter, &errMsg ), 0 );
+  CHECK( hostRunUntil( []() { return fw->motion.isMoving(); }, 1000 ) );
+  model.missPulses = slipPulses;
+  //Through any correcting move, or until a fault stops the wheel
+  CHECK( hostRunUntil( []() { return fw->encoder.fault ||
+    ( !fw->motion.isMoving() && fw->motion.getPosition() == fw->filterPositions[fw->currentFilterId] * MICROSTEPS_PER_STEP ); }, 60000 ) );
+  //A fault can stop the wheel before it has slipped it all
+  model.missPulses = 0;
+  if( !fw->encoder.fault )
+    CHECK_EQ( fw->currentFilterId, filter );
+}
+
+int physicalError( void )
+{
+  int error = (int) model.wrapped( microstepsPerRevolution ) - fw->filterPositions[fw->currentFilterId] * MICROSTEPS_PER_STEP;
+  if( error > microstepsPerRevolution / 2 )
+    error -= microstepsPerRevolution;
+  else if( error < -microstepsPerRevolution / 2 )
+    error += microstepsPerRevolution;
+  return abs( error );
+}
+
+//The wheel stays where it is - no hunting round an unreachable position
+void checkSettled( void )
+{
+  uint32_t pulses = model.pulses;
+  hostRunFor( 5000 );
+  CHECK_EQ( model.pulses, pulses );
+  CHECK( !fw->motion.isMoving() );
+  CHECK_EQ( fw->motion.getPosition() % MICROSTEPS_PER_STEP, 0 );
+}
+
+int main( void )
+{
+  const char* errMsg = "";
+  int filterId = 0;
+  int resolution = 0;
+
+  hostBoot();
+  fwSetConnected( fw, 1, true, &errMsg );
+
+  //Fine encoder, 7 microsteps a count
+  fitEncoder( 585 );
+  resolution = microstepsPerRevolution / 585;
+  changeFilter( 1, 0 );
+  CHECK_EQ( fw->encoder.corrections, 0 );
+  CHECK_EQ( fw->encoder.faults, 0 );
+  CHECK_EQ( physicalError(), 0 );
+
+  //A 4 step slip on the way to 2454 leaves the encoder one count out - corrected by an odd 7 microsteps,
+  //rounded to a full step, and the wheel driven back onto the filter
+  changeFilter( 3, 4 );
+  CHECK_EQ( model.missed, 4 );
+  CHECK_EQ( fw->encoder.corrections, 1 );
+  CHECK_EQ( fw->encoder.faults, 0 );
+  CHECK( physicalError() <= resolution );
+  CHECK_EQ( fwGetPosition( fw, &filterId, &errMsg ), 0 );
+  checkSettled();
+
+  //A 30 step slip stops the wheel, Position reports the fault until a new position is set
+  changeFilter( 0, 30 );
+  CHECK_EQ( fw->encoder.faults, 1 );
+  CHECK( fw->encoder.fault );
+  CHECK_EQ( fwGetPosition( fw, &filterId, &errMsg ), 0x500 );
+  checkSettled();
+  changeFilter( 2, 0 );
+  CHECK( !fw->encoder.fault );
+  CHECK_EQ( fwGetPosition( fw, &filterId, &errMsg ), 0 );
+  CHECK( physicalError() <= resolution );
+  checkSettled();
+
+  //Contact bounce is filtered out
+  model.encoderBounce = true;
+  uint32_t edges = model.encoderEdges;
+  uint32_t corrections = fw->encoder.corrections;
+  changeFilter( 4, 0 );
+  CHECK( model.encoderEdges > edges );
+  CHECK_EQ( fw->encoder.glitches, model.encoderEdges - edges );
+  CHECK_EQ( fw->encoder.corrections, corrections );
+  CHECK( physicalError() <= resolution );
+  model.encoderBounce = false;
+
+  //Coarse encoder, 341.33 microsteps a count. A fault re-syncs to the encoder, and leaving filter 3 ( 2454, in the
+  //count starting at 2389 ) that is an odd microstep unless rounded
+  fitEncoder( 12 );
+  resolution = microstepsPerRevolution / 12;
+  const int moves[][2] = { { 3, 0 }, { 3, 1 }, { 1, 3 } };
+  for( const auto& move : moves )
+  {
+    int faults = fw->encoder.faults;
+    changeFilter( move[0], 0 );
+    rehome();
+    changeFilter( move[1], 250 );
+    CHECK_EQ( fw->encoder.faults, faults + 1 );
+    checkSettled();
+    //The re-synced position is the encoder's to within a step
+    int error = abs( (int) model.wrapped( microstepsPerRevolution ) - fw->motion.getPosition() );
+    CHECK( std::min( error, microstepsPerRevolution - error ) <= resolution + MICROSTEPS_PER_STEP );
+  }
+  changeFilter( 0, 0 );
+  CHECK( !fw->encoder.fault );
+  checkSettled();
+  return testResult( "encoder_slip_test" );
+}
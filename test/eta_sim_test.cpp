@@ -0,0 +1,138 @@
+/*
+ MoveETA against measured filter changes on the virtual clock. Random changes on wheel 0 are asked for through the
+ REST API, the MoveETA action is asked first for the time to the new filter and again part way through the move for
+ the time left, and the host times the change from the PUT to Position reporting the new filter.
+ Loop passes vary in length, now and then a long one as when a request is being handled, so the step ticks are
+ stepped late by up to a pass. Run once as configured and once with backlash set, taken up by the moves that turn
+ the wheel round, which the estimate must include. Reports the errors and checks them against the step interval and
+ the longest pass.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include <algorithm>
+
+const int CHANGES = 30;
+const uint32_t SHORT_PASS_US = 250;
+const uint32_t LONG_PASS_US = 5000;           //a request being handled
+const uint32_t LONG_PASS_PER_MILLE = 20;
+const int BACKLASH_STEPS = 25;
+
+FilterWheel* fw = &filterWheels[0];
+uint32_t transID = 0;
+uint32_t seed = 12345;
+
+uint32_t random32( void )
+{
+  //xorshift32
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+void loopPass( void )
+{
+  hostLoopPass( ( random32() % 1000 < LONG_PASS_PER_MILLE )? LONG_PASS_US : 1 + random32() % SHORT_PASS_US );
+}
+
+String form( const String& fields )
+{
+  return String( "ClientID=1&ClientTransactionID=" ) + ( ++transID ) + "&" + fields;
+}
+
+long long moveEta( const String& parameters )
+{
+  const auto& reply = server.hostRequest( HTTP_PUT, "/api/v1/filterwheel/0/action", form( "Action=MoveETA&Parameters=" + parameters ).c_str() );
+  CHECK_EQ( reply.code, 200 );
+  CHECK_EQ( jsonField( reply.body, "ErrorNumber" ), 0 );
+  return jsonField( reply.body, "Value" );
+}
+
+long long position( void )
+{
+  const auto& reply = server.hostRequest( HTTP_GET, String( "/api/v1/filterwheel/0/Position?" ) + form( "" ) );
+  return jsonField( reply.body, "Value" );
+}
+
+struct Errors
+{
+  std::vector<int> full;
+  std::vector<int> remaining;
+  int sketchMax = 0;
+  int reversals = 0;      //moves that took up backlash
+};
+
+void report( const char* name, std::vector<int> v )
+{
+  std::sort( v.begin(), v.end() );
+  printf( "eta sim: %-28s error min %5d ms, median %5d ms, max %5d ms\n", name, v.front(), v[v.size() / 2], v.back() );
+}
+
+Errors run( bool backlash )
+{
+  Errors errors;
+  int filter = fw->currentFilterId;
+
+  fw->motion.setBacklash( backlash? BACKLASH_STEPS : 0 );
+  fw->etaMaxErrorMs = 0;
+  for( int i = 0; i < CHANGES; i++ )
+  {
+    int next = ( filter + 1 + random32() % ( fw->filtersPerWheel - 1 ) ) % fw->filtersPerWheel;
+    long long eta = moveEta( String( next ) );
+    uint64_t start = host::nowMicros();
+    const auto& reply = server.hostRequest( HTTP_PUT, "/api/v1/filterwheel/0/Position", form( "Position=" + String( next ) ).c_str() );
+    CHECK_EQ( jsonField( reply.body, "ErrorNumber" ), 0 );
+    errors.reversals += ( fw->motion.getBacklashUsed() != 0 );
+
+    //Part way through, the time left
+    uint64_t checkAt = start + ( eta * 1000 ) * ( 1 + random32() % 8 ) / 10;
+    while( host::nowMicros() < checkAt )
+      loopPass();
+    CHECK( fw->motion.isMoving() );
+    long long left = moveEta( "" );
+    uint64_t asked = host::nowMicros();
+
+    while( position() != next )
+      loopPass();
+    uint64_t end = host::nowMicros();
+    errors.full.push_back( (int) ( ( end - start ) / 1000 ) - (int) eta );
+    errors.remaining.push_back( (int) ( ( end - asked ) / 1000 ) - (int) left );
+    filter = next;
+  }
+  errors.sketchMax = fw->etaMaxErrorMs;
+  return errors;
+}
+
+void check( const char* name, const Errors& errors )
+{
+  //Late by up to a tick and the longest pass, never early by more than a tick
+  int late = (int) fw->motion.getStepInterval() + (int) LONG_PASS_US / 1000 + 1;
+  int early = -(int) fw->motion.getStepInterval();
+  std::string label = std::string( name ) + " to filter";
+  report( label.c_str(), errors.full );
+  label = std::string( name ) + " time left";
+  report( label.c_str(), errors.remaining );
+  printf( "eta sim: %-28s sketch's EtaMaxErrorMs %d ms, %d of %d moves took up backlash\n", name, errors.sketchMax, errors.reversals, CHANGES );
+  for( int e : errors.full )
+    CHECK( e >= early && e <= late );
+  //The time left counts whole ticks from the next one, so it can be over by a tick, and by another while a tick
+  //waits for the loop to step it
+  for( int e : errors.remaining )
+    CHECK( e >= early * 2 && e <= late );
+  CHECK( errors.sketchMax <= late );
+}
+
+int main( void )
+{
+  const char* errMsg = "";
+
+  hostBoot();
+  CHECK_EQ( fwSetConnected( fw, 1, true, &errMsg ), 0 );
+  Errors errors = run( false );
+  check( "as configured", errors );
+  CHECK_EQ( errors.reversals, 0 );
+  errors = run( true );
+  check( "backlash set", errors );
+  CHECK( errors.reversals > 0 && errors.reversals < CHANGES );
+  return testResult( "eta_sim_test" );
+}
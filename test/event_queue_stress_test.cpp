@@ -0,0 +1,157 @@
+/*
+ The event ring under a real second thread. A producer thread stands in for the interrupts and timer callbacks,
+ pushing 20M numbered events as fast as the ring takes them, while the main thread drains batches as the loop does.
+ Every event must arrive once, in order, with its timestamp no earlier than the one before. Reports the event rate,
+ how often the producer found the ring full, the high water mark and the time events spent queued.
+ Then the sketch with wheel 0's encoder fitted ( StepperModel.h ), its loop held up part way through a move for long
+ enough that the step timer fires several times over the ring's size while encoder edges keep arriving. The edges
+ must all be counted, the ticks must not overflow the ring, and the loop must step once when it gets going again,
+ not make up the missed ticks in a burst, then finish the move.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include "StepperModel.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+const uint32_t EVENTS = ( getenv( "STRESS_EVENTS" ) != NULL )? (uint32_t) atol( getenv( "STRESS_EVENTS" ) ) : 20000000;
+
+const int ENCODER_COUNTS = 585;
+
+StepperModel model;
+std::atomic<bool> producerDone( false );
+uint32_t producerRetries = 0;
+uint32_t producerLevel = 0xFFFFFFFF;
+
+//Sequence number carried in the type and source bytes
+void producer( void )
+{
+  for( uint32_t seq = 0; seq < EVENTS; seq++ )
+  {
+    //A full ring drops the event, the producer here retries it so the consumer can check nothing else is lost
+    while( !pushEventFromTask( (uint8_t) ( seq >> 8 ), (uint8_t) seq ) )
+    {
+      producerRetries++;
+      std::this_thread::yield();
+    }
+  }
+  //Every push put the interrupt level back
+  producerLevel = hostInterruptLevel;
+  producerDone = true;
+}
+
+//The loop held up mid-move, the encoder counting edges and the step timer firing the while
+void stalledLoop( void )
+{
+  const char* errMsg = "";
+  FilterWheel* fw = &filterWheels[0];
+  int target = 0;
+
+  hostBoot();
+  CHECK_EQ( fwSetConnected( fw, 1, true, &errMsg ), 0 );
+  beginWheelEncoder( &fw->encoder, ENCODER_PIN, ENCODER_COUNTS );
+  model.attach( DIRN_PIN, STEP_PIN, ENABLE_PIN, HALF_STEP_PIN, fw->motion.getPosition() );
+  model.microstepsPerRev = microstepsPerRevolution;
+  model.fitEncoder( ENCODER_PIN, ENCODER_COUNTS );
+  syncWheelEncoder( &fw->encoder, fw->motion.getPosition() );
+
+  target = ( fw->currentFilterId + fw->filtersPerWheel / 2 ) % fw->filtersPerWheel;
+  CHECK_EQ( fwSetPosition( fw, 1, target, &errMsg ), 0 );
+  CHECK( hostRunUntil( [fw]() { return fw->motion.isMoving() && model.pulses >= 20; }, 10000 ) );
+
+  uint32_t overflows = eventQueue.overflows;
+  uint32_t edges = fw->encoder.edges;
+  uint32_t pulses = model.pulses;
+  uint32_t stallMs = 4 * EVENT_QUEUE_SIZE * fw->motion.getStepInterval();
+  uint32_t raised = 0;
+  for( uint32_t ms = 0; ms < stallMs; ms++ )
+  {
+    hostAdvanceMicros( 1000 );
+    hostServiceTimers();
+    //Edges spaced well outside the glitch filter
+    if( ms % 2 == 0 )
+    {
+      hostRaiseInterrupt( ENCODER_PIN, HIGH );
+      hostRaiseInterrupt( ENCODER_PIN, LOW );
+      raised++;
+    }
+  }
+  printf( "event queue: loop held up %u ms mid-move, %u encoder edges raised, %u counted, %u events queued, %u overflows\n",
+          stallMs, raised, fw->encoder.edges - edges, eventQueue.head - eventQueue.tail, eventQueue.overflows - overflows );
+  CHECK( raised > EVENT_QUEUE_SIZE );
+  CHECK_EQ( fw->encoder.edges - edges, raised );
+  CHECK_EQ( eventQueue.overflows, overflows );
+  CHECK( eventQueue.head - eventQueue.tail <= (uint32_t) FILTERWHEEL_COUNT );
+  CHECK_EQ( model.pulses, pulses );
+
+  //The raised edges didn't come from the wheel turning - take them out before the loop compares it with the steps
+  syncWheelEncoder( &fw->encoder, fw->motion.getPosition() );
+  hostLoopPass();
+  CHECK_EQ( model.pulses, pulses + 1 );
+  CHECK( hostRunUntil( [fw, target]() { return !fw->motion.isMoving() && fw->currentFilterId == target; }, 60000 ) );
+  CHECK( !fw->encoder.fault );
+  CHECK_EQ( fw->motion.getPosition(), fw->filterPositions[target] * MICROSTEPS_PER_STEP );
+  CHECK_EQ( eventQueue.overflows, overflows );
+}
+
+int main( void )
+{
+  Event batch[EVENT_BATCH_SIZE];
+  uint32_t received = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t timeReversed = 0;
+  uint32_t lastCycles = 0;
+  uint32_t emptyPolls = 0;
+  std::vector<uint32_t> latencyUs;
+  latencyUs.reserve( EVENTS / 64 + 1 );
+
+  auto start = std::chrono::steady_clock::now();
+  std::thread thread( producer );
+  while( received < EVENTS )
+  {
+    int count = drainEvents( batch, EVENT_BATCH_SIZE );
+    if( count == 0 )
+    {
+      if( producerDone && eventQueue.head == eventQueue.tail )
+        break;
+      emptyPolls++;
+      std::this_thread::yield();
+      continue;
+    }
+    uint32_t now = ESP.getCycleCount();
+    for( int i = 0; i < count; i++ )
+    {
+      uint16_t expected = (uint16_t) received;
+      if( ( ( batch[i].type << 8 ) | batch[i].source ) != expected )
+        outOfOrder++;
+      if( received > 0 && (int32_t) ( batch[i].cycles - lastCycles ) < 0 )
+        timeReversed++;
+      lastCycles = batch[i].cycles;
+      if( ( received & 63 ) == 0 )
+        latencyUs.push_back( ( now - batch[i].cycles ) / ESP.getCpuFreqMHz() );
+      received++;
+    }
+  }
+  thread.join();
+  double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+  std::sort( latencyUs.begin(), latencyUs.end() );
+  printf( "event queue: %u events in %.2f s ( %.1fM/s ), producer found the ring full %u times, high water %u of %u\n",
+          received, secs, received / secs / 1e6, producerRetries, eventQueue.highWater, EVENT_QUEUE_SIZE );
+  printf( "event queue: queued time p50 %u us, p99 %u us, max %u us, %u empty polls\n",
+          latencyUs[latencyUs.size() / 2], latencyUs[latencyUs.size() * 99 / 100], latencyUs.back(), emptyPolls );
+
+  CHECK_EQ( received, EVENTS );
+  CHECK_EQ( outOfOrder, 0 );
+  CHECK_EQ( timeReversed, 0 );
+  CHECK_EQ( eventQueue.processed, EVENTS );
+  CHECK_EQ( eventQueue.overflows, producerRetries );
+  CHECK_EQ( eventQueue.head, eventQueue.tail );
+  CHECK( eventQueue.highWater <= EVENT_QUEUE_SIZE );
+  CHECK_EQ( producerLevel, 0 );
+
+  stalledLoop();
+  return testResult( "event_queue_stress_test" );
+}
@@ -0,0 +1,215 @@
+/*
+ Focus offsets ( FocuserLink.h ) against the stand-in focuser ( FocuserStub.h ) on the virtual clock.
+ The focuser must be looked up when the settings are applied and never during a change, and its receive buffer only
+ allocated while the link is enabled. The Position PUT must only queue the offset - no connect in the handler - and a
+ change must make all its requests, the IsMoving polls included, on one connection, opened from the loop and then kept
+ for the next change. A focuser that closes the idle connection, closes it while a request is on its way, closes after
+ each reply, answers HTTP/1.0 without a length or answers in chunks must all still complete the change. Then a
+ relative focuser, and one that can't be reached, which fails the offset but not the filter change and is given up on
+ after FOCUS_MAX_FAILURES changes until the settings are applied again.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include "FocuserStub.h"
+
+const uint16_t FOCUSER_PORT = 4100;
+const uint16_t RELATIVE_FOCUSER_PORT = 4101;
+const uint16_t NO_FOCUSER_PORT = 4102;
+const int FOCUSER_STEPS_PER_SEC = 200;
+
+FilterWheel* fw = &filterWheels[0];
+FocuserStub focuser( FOCUSER_PORT, FOCUSER_STEPS_PER_SEC, false );
+FocuserStub relativeFocuser( RELATIVE_FOCUSER_PORT, FOCUSER_STEPS_PER_SEC, true );
+uint32_t transID = 0;
+
+void configure( const std::string& json )
+{
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  CHECK_EQ( server.hostRequest( HTTP_PUT, "/filterwheel/0/Config", json, "application/json" ).code, 200 );
+}
+
+int offsetChange( int from, int to ) { return ( to * 2 ) % 5 * 150 - ( from * 2 ) % 5 * 150; }
+
+int position( void )
+{
+  PGM_P errMsg = PSTR("");
+  int filterId = 0;
+  fwGetPosition( fw, &filterId, &errMsg );
+  return filterId;
+}
+
+//Change filter, the PUT must make no connect and the change no lookup. Returns the virtual ms to Position reading the filter.
+uint32_t change( int filterId )
+{
+  char body[96];
+  uint32_t lookups = host::dnsLookups;
+  uint32_t connects = host::connects;
+
+  snprintf( body, sizeof( body ), "ClientID=1&ClientTransactionID=%u&Position=%d", ++transID, filterId );
+  uint64_t start = host::nowMicros();
+  const auto& reply = server.hostRequest( HTTP_PUT, "/api/v1/filterwheel/0/Position", body );
+  CHECK_EQ( reply.code, 200 );
+  CHECK_EQ( jsonField( reply.body, "ErrorNumber" ), 0 );
+  CHECK_EQ( host::dnsLookups, lookups );
+  CHECK_EQ( host::connects, connects );
+  CHECK( hostRunUntil( [filterId]() { focuser.service(); relativeFocuser.service(); return position() == filterId; }, 60000 ) );
+  CHECK_EQ( host::dnsLookups, lookups );
+  return (uint32_t) ( ( host::nowMicros() - start ) / 1000 );
+}
+
+int main( void )
+{
+  PGM_P errMsg = PSTR("");
+  std::string offsets;
+  std::string json;
+  uint32_t lookups = 0;
+  uint32_t connects = 0;
+  uint32_t requests = 0;
+  uint32_t errors = 0;
+
+  hostBoot();
+  focuser.begin();
+  relativeFocuser.begin();
+  CHECK_EQ( fwSetConnected( fw, 1, true, &errMsg ), 0 );
+
+  //Chunked bodies, whole and cut short
+  char chunks[] = "5\r\n{\"Val\r\n9\r\nue\":true}\r\n0\r\n\r\n";
+  CHECK_EQ( focuserChunks( chunks, false ), 14 );
+  for( size_t cut = 0; cut < strlen( chunks ) - 1; cut++ )
+  {
+    std::string part( chunks, cut );
+    CHECK_EQ( focuserChunks( &part[0], false ), -1 );
+  }
+  CHECK_EQ( focuserChunks( chunks, true ), 14 );
+  CHECK( strcmp( chunks, "{\"Value\":true}" ) == 0 );
+
+  //Offsets far enough apart that the focuser is polled many times each change. Looked up as the settings are applied.
+  CHECK( fw->focuser.rx == NULL );
+  for( int i = 0; i < fw->filtersPerWheel; i++ )
+    offsets += ( ( i > 0 )? "," : "" ) + std::to_string( ( i * 2 ) % 5 * 150 );
+  lookups = host::dnsLookups;
+  configure( "{\"FocusOffsets\":[" + offsets + "],\"FocuserEnabled\":true,\"FocuserHost\":\"127.0.0.1\",\"FocuserPort\":" +
+             std::to_string( focuser.connectPort() ) + ",\"FocuserDevice\":0,\"FocuserRelative\":false}" );
+  CHECK_EQ( host::dnsLookups, lookups + 1 );
+  CHECK( fw->focuser.resolved );
+  CHECK( fw->focuser.rx != NULL );
+
+  //One connection for the whole change, opened from the loop
+  connects = host::connects;
+  uint32_t ms = change( 1 );
+  CHECK_EQ( host::connects, connects + 1 );
+  CHECK_EQ( focuser.accepted, 1 );
+  CHECK_EQ( focuser.position(), 300 );
+  CHECK_EQ( fw->focuser.lastError, 0 );
+  //position, move and the IsMoving polls, one every FOCUS_POLL_MS
+  CHECK( focuser.requests >= 2 + 300 * 1000 / FOCUSER_STEPS_PER_SEC / FOCUS_POLL_MS );
+  printf( "focuser link: change 0 -> 1 in %u ms, %u focuser requests on %u connection\n", ms, focuser.requests, focuser.accepted );
+
+  //The next change reuses the connection
+  change( 2 );
+  CHECK_EQ( host::connects, connects + 1 );
+  CHECK_EQ( focuser.accepted, 1 );
+  CHECK_EQ( focuser.position(), 600 );
+  CHECK_EQ( fw->focuser.connects, 1 );
+
+  //The focuser closes the idle connection - connected again
+  focuser.dropConnections();
+  hostRunFor( 10 );
+  change( 0 );
+  CHECK_EQ( host::connects, connects + 2 );
+  CHECK_EQ( focuser.position(), 0 );
+  CHECK_EQ( fw->focuser.lastError, 0 );
+
+  //Closed as the first request of a change reaches it - sent again on a new connection
+  focuser.dropNext = true;
+  change( 1 );
+  CHECK( !focuser.dropNext );
+  CHECK_EQ( host::connects, connects + 3 );
+  CHECK_EQ( focuser.position(), 300 );
+  CHECK_EQ( fw->focuser.lastError, 0 );
+  CHECK_EQ( fw->focuser.errors, 0 );
+
+  //Connection: close after each reply
+  focuser.mode = FocuserStub::CLOSE_EACH;
+  connects = host::connects;
+  requests = focuser.requests;
+  change( 2 );
+  CHECK_EQ( focuser.position(), 600 );
+  CHECK_EQ( fw->focuser.lastError, 0 );
+  //The first request went on the connection kept from the last change
+  CHECK_EQ( host::connects - connects, focuser.requests - requests - 1 );
+
+  //HTTP/1.0 200 without a Content-Length, ended by closing
+  focuser.mode = FocuserStub::HTTP_10;
+  connects = host::connects;
+  requests = focuser.requests;
+  change( 3 );
+  CHECK_EQ( focuser.position(), 150 );
+  CHECK_EQ( fw->focuser.lastError, 0 );
+  CHECK_EQ( fw->focuser.errors, 0 );
+  CHECK_EQ( host::connects - connects, focuser.requests - requests );
+
+  //Chunked replies, framed by their last chunk - the connection is kept
+  focuser.mode = FocuserStub::CHUNKED;
+  change( 4 );
+  connects = host::connects;
+  requests = focuser.requests;
+  change( 0 );
+  CHECK_EQ( focuser.position(), 0 );
+  CHECK_EQ( fw->focuser.lastError, 0 );
+  CHECK_EQ( fw->focuser.errors, 0 );
+  CHECK_EQ( host::connects, connects );
+  CHECK( focuser.requests - requests >= 2 );
+
+  //A relative focuser on a new port is looked up again and moved by the offset change, its position not read
+  focuser.mode = FocuserStub::KEEP_ALIVE;
+  lookups = host::dnsLookups;
+  configure( "{\"FocuserPort\":" + std::to_string( relativeFocuser.connectPort() ) + ",\"FocuserRelative\":true}" );
+  CHECK_EQ( host::dnsLookups, lookups + 1 );
+  connects = host::connects;
+  change( 3 );
+  CHECK_EQ( host::connects, connects + 1 );
+  CHECK_EQ( relativeFocuser.moves, 1 );
+  CHECK_EQ( relativeFocuser.lastMove, 150 );
+  CHECK_EQ( relativeFocuser.position(), 150 );
+  CHECK_EQ( fw->focuser.lastError, 0 );
+  change( 1 );
+  CHECK_EQ( relativeFocuser.lastMove, 150 );
+  CHECK_EQ( relativeFocuser.position(), 300 );
+  CHECK_EQ( relativeFocuser.accepted, 1 );
+
+  //Nothing listening - the offset fails, the filter change still completes. The address looked up is kept.
+  configure( "{\"FocuserPort\":" + std::to_string( hostPort( NO_FOCUSER_PORT ) ) + "}" );
+  errors = fw->focuser.errors;
+  lookups = host::dnsLookups;
+  change( 2 );
+  CHECK_EQ( fw->focuser.errors, errors + 1 );
+  CHECK( fw->focuser.lastError != 0 );
+  CHECK( !focuserBusy( &fw->focuser ) );
+  CHECK( fw->focuser.resolved );
+  CHECK( !fw->focuser.suspended );
+
+  //Given up on after FOCUS_MAX_FAILURES in a row - later changes don't try it
+  for( int i = 1; i < FOCUS_MAX_FAILURES; i++ )
+    change( ( i % 2 )? 0 : 2 );
+  CHECK_EQ( fw->focuser.errors, errors + FOCUS_MAX_FAILURES );
+  CHECK( fw->focuser.suspended );
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  CHECK( server.hostRequest( HTTP_GET, "/filterwheel/0/Metrics" ).body.find( "\"FocuserSuspended\":true" ) != std::string::npos );
+  connects = host::connects;
+  change( 4 );
+  CHECK_EQ( host::connects, connects );
+  CHECK_EQ( fw->focuser.errors, errors + FOCUS_MAX_FAILURES );
+
+  //Applying the settings again clears it
+  configure( "{\"FocuserPort\":" + std::to_string( relativeFocuser.connectPort() ) + "}" );
+  CHECK( !fw->focuser.suspended );
+  change( 3 );
+  CHECK_EQ( fw->focuser.lastError, 0 );
+  CHECK_EQ( relativeFocuser.lastMove, offsetChange( 4, 3 ) );
+
+  //Turned off, the receive buffer is freed
+  configure( "{\"FocuserEnabled\":false}" );
+  CHECK( fw->focuser.rx == NULL );
+  return testResult( "focuser_link_test" );
+}
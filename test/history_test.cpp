@@ -0,0 +1,158 @@
+/*
+ The move journal ( MoveJournal.h ) read back through GET /filterwheel/{n}/History after more moves than the ring
+ holds. Wheel 0 makes MOVES random filter changes with backlash set, then wheel 1 a few, so the ring has wrapped and
+ is shared. Every page of wheel 0's history must list its newest moves first, the ones wheel 1 pushed out gone, with
+ the filters, steps, direction, backlash taken up and ClientID of each and the duration the host measured. The
+ P50, P90 and max for each filter pair must be those of the durations listed. Then times recordMove().
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include <chrono>
+#include <map>
+#include <algorithm>
+
+const int MOVES = 150;
+const int WHEEL_1_MOVES = 5;
+const int BACKLASH_STEPS = 10;
+const int PAGE_SIZE = 32;
+const int TIMED_RECORDS = 1000000;
+
+struct Move
+{
+  int from;
+  int to;
+  int steps;
+  bool ccw;
+  int backlash;
+  uint32_t clientID;
+  uint32_t durationMs;
+};
+
+uint32_t seed = 2463534242u;
+
+uint32_t random32( void )
+{
+  //xorshift32
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+//Change filter on the wheel and note the move as the journal should have it
+Move change( FilterWheel* fw, uint32_t clientID )
+{
+  PGM_P errMsg = PSTR("");
+  Move move;
+  move.from = fw->currentFilterId;
+  move.to = ( fw->currentFilterId + 1 + random32() % ( fw->filtersPerWheel - 1 ) ) % fw->filtersPerWheel;
+  move.clientID = clientID;
+  uint64_t start = host::nowMicros();
+  CHECK_EQ( fwSetPosition( fw, clientID, move.to, &errMsg ), 0 );
+  CHECK( hostRunUntil( [fw, move]() { return !fw->motion.isMoving() && fw->currentFilterId == move.to; }, 60000 ) );
+  move.durationMs = (uint32_t) ( ( host::nowMicros() - start ) / 1000 );
+  move.steps = fw->moveSteps;
+  move.ccw = ( fw->motion.getDirection() == DIRN_CCW );
+  move.backlash = fw->motion.getBacklashUsed();
+  return move;
+}
+
+std::string history( int device, int page )
+{
+  char uri[96];
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  snprintf( uri, sizeof( uri ), "/filterwheel/%d/History?Page=%d&PageSize=%d", device, page, PAGE_SIZE );
+  const auto& reply = server.hostRequest( HTTP_GET, uri );
+  CHECK_EQ( reply.code, 200 );
+  return reply.body;
+}
+
+int main( void )
+{
+  PGM_P errMsg = PSTR("");
+  std::vector<Move> moves;
+  std::map<int, std::vector<int>> listed;   //from << 4 | to, durations from the pages
+  int backlashMoves = 0;
+  int page = 0;
+  size_t next = 0;
+
+  hostBoot();
+  CHECK_EQ( fwSetConnected( &filterWheels[0], 1, true, &errMsg ), 0 );
+  CHECK_EQ( fwSetConnected( &filterWheels[1], 2, true, &errMsg ), 0 );
+  //Wheel 0 stepped every 2 ms to keep the run short
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  CHECK_EQ( server.hostRequest( HTTP_PUT, "/filterwheel/0/Config", "{\"Backlash\":" + std::to_string( BACKLASH_STEPS ) + ",\"StepInterval\":2}",
+                                "application/json" ).code, 200 );
+
+  for( int i = 0; i < MOVES; i++ )
+  {
+    moves.push_back( change( &filterWheels[0], 1 ) );
+    backlashMoves += ( moves.back().backlash != 0 );
+  }
+  for( int i = 0; i < WHEEL_1_MOVES; i++ )
+    change( &filterWheels[1], 2 );
+  CHECK( backlashMoves > 0 );
+  CHECK_EQ( moveJournal.count, (uint32_t) ( MOVES + WHEEL_1_MOVES ) );
+
+  //Wheel 0's newest first, as many as the ring still holds
+  int held = JOURNAL_SIZE - WHEEL_1_MOVES;
+  for( page = 0; ; page++ )
+  {
+    DynamicJsonBuffer buffer;
+    JsonObject& root = buffer.parseObject( history( 0, page ).c_str() );
+    CHECK( root.success() );
+    CHECK_EQ( root["Total"].as<int>(), held );
+    JsonArray& records = root["Records"];
+    if( records.size() == 0 )
+      break;
+    for( size_t i = 0; i < records.size(); i++ )
+    {
+      JsonObject& r = records[i];
+      const Move& m = moves[ MOVES - 1 - next ];
+      CHECK_EQ( r["From"].as<int>(), m.from );
+      CHECK_EQ( r["To"].as<int>(), m.to );
+      CHECK_EQ( r["Steps"].as<int>(), m.steps );
+      CHECK( String( r["Direction"].as<const char*>() ) == ( m.ccw? "CCW" : "CW" ) );
+      CHECK_EQ( r["Backlash"].as<int>(), m.backlash );
+      CHECK_EQ( r["ClientID"].as<uint32_t>(), m.clientID );
+      //Recorded in hundredths, from the loop pass that started the move to the one that saw it end
+      CHECK( abs( r["DurationMs"].as<int>() - (int) m.durationMs ) <= 20 );
+      listed[ ( m.from << 4 ) | m.to ].push_back( r["DurationMs"].as<int>() );
+      next++;
+    }
+  }
+  CHECK_EQ( (int) next, held );
+  CHECK_EQ( page, ( held + PAGE_SIZE - 1 ) / PAGE_SIZE );
+
+  //Percentiles for each pair, from the durations listed
+  DynamicJsonBuffer buffer;
+  JsonObject& root = buffer.parseObject( history( 0, 0 ).c_str() );
+  JsonArray& pairs = root["Pairs"];
+  CHECK_EQ( pairs.size(), listed.size() );
+  for( size_t i = 0; i < pairs.size(); i++ )
+  {
+    JsonObject& p = pairs[i];
+    std::vector<int> d = listed[ ( p["From"].as<int>() << 4 ) | p["To"].as<int>() ];
+    std::sort( d.begin(), d.end() );
+    CHECK_EQ( p["Count"].as<int>(), (int) d.size() );
+    CHECK_EQ( p["P50Ms"].as<int>(), d[ ( d.size() - 1 ) * 50 / 100 ] );
+    CHECK_EQ( p["P90Ms"].as<int>(), d[ ( d.size() - 1 ) * 90 / 100 ] );
+    CHECK_EQ( p["MaxMs"].as<int>(), d.back() );
+  }
+  printf( "history: %d moves on wheel 0, %d on wheel 1, %d of wheel 0's held over %d pages, %u pairs, %d moves took up backlash\n",
+          MOVES, WHEEL_1_MOVES, held, page, (unsigned) listed.size(), backlashMoves );
+
+  //Wheel 1's own
+  DynamicJsonBuffer buffer1;
+  JsonObject& root1 = buffer1.parseObject( history( 1, 0 ).c_str() );
+  CHECK_EQ( root1["Total"].as<int>(), WHEEL_1_MOVES );
+
+  //The cost of recording a move, against a loop pass
+  auto start = std::chrono::steady_clock::now();
+  for( int i = 0; i < TIMED_RECORDS; i++ )
+    recordMove( 0, i % 5, ( i + 1 ) % 5, 820, 4000, 0, 1, 0 );
+  double ns = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count() / TIMED_RECORDS;
+  printf( "history: recordMove %.1f ns a move, a loop pass is %u us\n", ns, LOOP_PASS_US );
+  CHECK( ns < LOOP_PASS_US * 1000.0 / 100 );
+  return testResult( "history_test" );
+}
@@ -0,0 +1,185 @@
+/*
+ Host stand-in for the parts of the ESP8266 Arduino core the sketch uses, so the firmware can be built and run on Linux.
+ Flash and RAM are the same memory here - PROGMEM, F() and the _P functions just pass through.
+ Time runs from the host clock, or from a virtual clock the tests advance themselves ( hostUseVirtualTime() ).
+ Pin writes are passed to hostPinHook so a test can model what is wired to them, and tests raise interrupts with hostRaiseInterrupt().
+*/
+#if !defined _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <algorithm>
+#include <functional>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+//Flash strings
+class __FlashStringHelper;
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define F(s) ( reinterpret_cast<const __FlashStringHelper*>( PSTR(s) ) )
+#define FPSTR(p) ( reinterpret_cast<const __FlashStringHelper*>( p ) )
+#define pgm_read_byte(p) ( *(const uint8_t*)(p) )
+#define pgm_read_word(p) ( *(const uint16_t*)(p) )
+#define pgm_read_dword(p) ( *(const uint32_t*)(p) )
+#define pgm_read_ptr(p) ( *(const void* const*)(p) )
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcasecmp_P strcasecmp
+#define strncasecmp_P strncasecmp
+#define strstr_P strstr
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+#define DEC 10
+#define HEX 16
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+
+using std::min;
+using std::max;
+template<class T, class L, class H> T constrain( T value, L low, H high ) { return ( value < low )? low : ( value > high )? high : value; }
+inline bool isDigit( int c ) { return isdigit( c ) != 0; }
+inline bool isAlpha( int c ) { return isalpha( c ) != 0; }
+inline bool isSpace( int c ) { return isspace( c ) != 0; }
+
+/*
+ * Host clock - microseconds since start, from the steady clock or the virtual one.
+ * Switching between them keeps time moving forwards from where it was.
+ */
+namespace host
+{
+  inline bool virtualTime = false;
+  inline uint64_t virtualMicros = 0;
+  inline std::chrono::steady_clock::time_point realBase = std::chrono::steady_clock::now();
+  inline uint64_t realOffset = 0;
+  inline bool serialOutput = ( getenv( "HOST_SERIAL" ) != NULL );
+
+  inline uint64_t nowMicros( void )
+  {
+    if( virtualTime )
+      return virtualMicros;
+    return realOffset + std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - realBase ).count();
+  }
+}
+
+inline void hostUseVirtualTime( bool enable )
+{
+  uint64_t now = host::nowMicros();
+  host::virtualTime = enable;
+  host::virtualMicros = now;
+  host::realBase = std::chrono::steady_clock::now();
+  host::realOffset = now;
+}
+
+inline void hostAdvanceMicros( uint64_t us )
+{
+  if( host::virtualTime )
+    host::virtualMicros += us;
+  else
+    std::this_thread::sleep_for( std::chrono::microseconds( us ) );
+}
+
+inline unsigned long millis( void ) { return (unsigned long) (uint32_t) ( host::nowMicros() / 1000 ); }
+inline unsigned long micros( void ) { return (unsigned long) (uint32_t) host::nowMicros(); }
+inline void delay( unsigned long ms ) { hostAdvanceMicros( (uint64_t) ms * 1000 ); }
+inline void delayMicroseconds( unsigned int us ) { hostAdvanceMicros( us ); }
+inline void yield( void ) {}
+
+//Pins and interrupts
+namespace host
+{
+  const int PIN_COUNT = 17;
+  inline uint8_t pinModes[PIN_COUNT];
+  inline uint8_t pinValues[PIN_COUNT];
+  inline void (*pinHook)( uint8_t pin, uint8_t value ) = NULL;
+  inline void (*interruptHandlers[PIN_COUNT])( void );
+  inline int interruptModes[PIN_COUNT];
+}
+
+inline void pinMode( uint8_t pin, uint8_t mode )
+{
+  if( pin < host::PIN_COUNT )
+    host::pinModes[pin] = mode;
+}
+
+inline void digitalWrite( uint8_t pin, uint8_t value )
+{
+  if( pin >= host::PIN_COUNT )
+    return;
+  host::pinValues[pin] = value;
+  if( host::pinHook != NULL )
+    host::pinHook( pin, value );
+}
+
+inline int digitalRead( uint8_t pin ) { return ( pin < host::PIN_COUNT )? host::pinValues[pin] : LOW; }
+#define GPIP(pin) digitalRead( pin )
+inline uint8_t digitalPinToInterrupt( uint8_t pin ) { return pin; }
+
+inline void attachInterrupt( uint8_t pin, void (*handler)( void ), int mode )
+{
+  if( pin >= host::PIN_COUNT )
+    return;
+  host::interruptHandlers[pin] = handler;
+  host::interruptModes[pin] = mode;
+}
+
+inline void detachInterrupt( uint8_t pin )
+{
+  if( pin < host::PIN_COUNT )
+    host::interruptHandlers[pin] = NULL;
+}
+
+//Set an input pin, running its handler as the interrupt would
+inline void hostRaiseInterrupt( uint8_t pin, uint8_t value )
+{
+  uint8_t old = host::pinValues[pin];
+  int mode = host::interruptModes[pin];
+  host::pinValues[pin] = value;
+  if( host::interruptHandlers[pin] == NULL || old == value )
+    return;
+  if( mode == CHANGE || ( mode == RISING && value == HIGH ) || ( mode == FALLING && value == LOW ) )
+    host::interruptHandlers[pin]();
+}
+
+//No interrupts pre-empt the loop on the host, the interrupt level is only tracked - per thread, as a thread
+//standing in for interrupts runs at its own level
+inline thread_local uint32_t hostInterruptLevel = 0;
+inline uint32_t xt_rsil( uint32_t level ) { uint32_t old = hostInterruptLevel; hostInterruptLevel = level; return old; }
+inline void xt_wsr_ps( uint32_t state ) { hostInterruptLevel = state; }
+inline void noInterrupts( void ) { xt_rsil( 15 ); }
+inline void interrupts( void ) { xt_rsil( 0 ); }
+
+//NTP is left alone, time() is the host's
+inline void configTime( int, int, const char*, const char* = NULL, const char* = NULL ) {}
+
+#include "WString.h"
+#include "Print.h"
+#include "IPAddress.h"
+#endif
@@ -0,0 +1,568 @@
+/*
+ Host subset of the ArduinoJson 5 API the sketch uses - DynamicJsonBuffer, JsonObject, JsonArray and JsonVariant,
+ with the same writer output ( compact, keys in insertion order ) and a parser for the documents it receives.
+ Strings are always copied into the buffer, where ArduinoJson 5 keeps a pointer to a const char* value.
+*/
+#if !defined _HOST_ARDUINOJSON_H_
+#define _HOST_ARDUINOJSON_H_
+#include "Arduino.h"
+#include <deque>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+class JsonArray;
+class JsonObject;
+class DynamicJsonBuffer;
+
+class JsonVariant
+{
+  public:
+    enum Type { UNDEFINED, NUL, BOOLEAN, INTEGER, FLOAT, STRING, ARRAY, OBJECT };
+
+    JsonVariant( void ) {}
+    static JsonVariant null( void ) { JsonVariant v; v.type = NUL; return v; }
+    static JsonVariant boolean( bool b ) { JsonVariant v; v.type = BOOLEAN; v.i = b; return v; }
+    static JsonVariant integer( int64_t i ) { JsonVariant v; v.type = INTEGER; v.i = i; return v; }
+    static JsonVariant real( double f ) { JsonVariant v; v.type = FLOAT; v.f = f; return v; }
+    static JsonVariant string( const char* s ) { JsonVariant v; v.type = ( s == NULL )? NUL : STRING; v.s = s; return v; }
+    static JsonVariant array( JsonArray* a ) { JsonVariant v; v.type = ARRAY; v.a = a; return v; }
+    static JsonVariant object( JsonObject* o ) { JsonVariant v; v.type = OBJECT; v.o = o; return v; }
+
+    bool success( void ) const { return type != UNDEFINED; }
+    Type getType( void ) const { return type; }
+
+    template<class T> T as( void ) const { return As<T>::get( *this ); }
+    template<class T> bool is( void ) const { return As<T>::is( *this ); }
+    operator JsonArray&( void ) const;
+    operator JsonObject&( void ) const;
+
+    size_t printTo( std::string& out ) const;
+
+  private:
+    Type type = UNDEFINED;
+    int64_t i = 0;
+    double f = 0;
+    const char* s = NULL;
+    JsonArray* a = NULL;
+    JsonObject* o = NULL;
+
+    int64_t asInteger( void ) const
+    {
+      switch( type )
+      {
+        case BOOLEAN:
+        case INTEGER: return i;
+        case FLOAT: return (int64_t) f;
+        case STRING: return strtoll( s, NULL, 10 );
+        default: return 0;
+      }
+    }
+    double asFloat( void ) const
+    {
+      switch( type )
+      {
+        case BOOLEAN:
+        case INTEGER: return (double) i;
+        case FLOAT: return f;
+        case STRING: return strtod( s, NULL );
+        default: return 0;
+      }
+    }
+
+    template<class T, class Enable = void> struct As;
+    template<class T> struct As<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+    {
+      static T get( const JsonVariant& v ) { return (T) v.asInteger(); }
+      static bool is( const JsonVariant& v ) { return v.type == INTEGER; }
+    };
+    template<class T> struct As<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+    {
+      static T get( const JsonVariant& v ) { return (T) v.asFloat(); }
+      static bool is( const JsonVariant& v ) { return v.type == INTEGER || v.type == FLOAT; }
+    };
+    template<class T> struct As<T, typename std::enable_if<std::is_same<T, bool>::value>::type>
+    {
+      static bool get( const JsonVariant& v ) { return ( v.type == STRING )? strcmp( v.s, "true" ) == 0 : v.asInteger() != 0; }
+      static bool is( const JsonVariant& v ) { return v.type == BOOLEAN; }
+    };
+    template<class T> struct As<T, typename std::enable_if<std::is_same<T, const char*>::value || std::is_same<T, char*>::value>::type>
+    {
+      static T get( const JsonVariant& v ) { return ( v.type == STRING )? (T) v.s : NULL; }
+      static bool is( const JsonVariant& v ) { return v.type == STRING; }
+    };
+    template<class T> struct As<T, typename std::enable_if<std::is_same<T, String>::value>::type>
+    {
+      static String get( const JsonVariant& v )
+      {
+        std::string out;
+        if( v.type == STRING )
+          return String( v.s );
+        if( v.type == UNDEFINED || v.type == NUL )
+          return String();
+        v.printTo( out );
+        return String( out );
+      }
+      static bool is( const JsonVariant& v ) { return v.type == STRING; }
+    };
+    template<class T> struct As<T, typename std::enable_if<std::is_same<typename std::remove_reference<T>::type, JsonArray>::value>::type>
+    {
+      static bool is( const JsonVariant& v ) { return v.type == ARRAY; }
+    };
+    template<class T> struct As<T, typename std::enable_if<std::is_same<typename std::remove_reference<T>::type, JsonObject>::value>::type>
+    {
+      static bool is( const JsonVariant& v ) { return v.type == OBJECT; }
+    };
+};
+
+//Reads of a missing key or index see this
+inline const JsonVariant jsonUndefined;
+
+class JsonContainer
+{
+  public:
+    explicit JsonContainer( DynamicJsonBuffer* b ) : buffer( b ) {}
+    bool success( void ) const { return buffer != NULL; }
+    size_t printTo( String& out ) const { std::string s; write( s ); out = String( s ); return s.size(); }
+    size_t printTo( char* buf, size_t size ) const
+    {
+      std::string s;
+      write( s );
+      if( size == 0 ) return 0;
+      size_t n = std::min( s.size(), size - 1 );
+      memcpy( buf, s.data(), n );
+      buf[n] = '\0';
+      return n;
+    }
+    size_t printTo( Print& out ) const { std::string s; write( s ); return out.write( (const uint8_t*) s.data(), s.size() ); }
+    size_t measureLength( void ) const { std::string s; write( s ); return s.size(); }
+    virtual void write( std::string& out ) const = 0;
+  protected:
+    virtual ~JsonContainer( void ) {}
+    DynamicJsonBuffer* buffer;
+
+    const char* dup( const char* s ) const;
+    JsonVariant value( const char* s ) const { return JsonVariant::string( dup( s ) ); }
+    JsonVariant value( char* s ) const { return JsonVariant::string( dup( s ) ); }
+    JsonVariant value( const String& s ) const { return JsonVariant::string( dup( s.c_str() ) ); }
+    JsonVariant value( const __FlashStringHelper* s ) const { return JsonVariant::string( dup( reinterpret_cast<const char*>( s ) ) ); }
+    JsonVariant value( bool b ) const { return JsonVariant::boolean( b ); }
+    JsonVariant value( float f ) const { return JsonVariant::real( f ); }
+    JsonVariant value( double f ) const { return JsonVariant::real( f ); }
+    JsonVariant value( const JsonArray& a ) const { return JsonVariant::array( const_cast<JsonArray*>( &a ) ); }
+    JsonVariant value( const JsonObject& o ) const { return JsonVariant::object( const_cast<JsonObject*>( &o ) ); }
+    JsonVariant value( const JsonVariant& v ) const { return v; }
+    template<class T> typename std::enable_if<std::is_integral<T>::value, JsonVariant>::type value( T i ) const { return JsonVariant::integer( (int64_t) i ); }
+};
+
+class JsonObjectSubscript;
+
+class JsonObject : public JsonContainer
+{
+  public:
+    explicit JsonObject( DynamicJsonBuffer* b ) : JsonContainer( b ) {}
+    static JsonObject& invalid( void ) { static JsonObject none( NULL ); return none; }
+
+    template<class K, class T> bool set( const K& key, const T& v )
+    {
+      if( buffer == NULL )
+        return false;
+      JsonVariant* slot = find( keyText( key ) );
+      if( slot != NULL )
+        *slot = value( v );
+      else
+        members.push_back( std::make_pair( dup( keyText( key ) ), value( v ) ) );
+      return true;
+    }
+    template<class T, class K> T get( const K& key ) const { return get( keyText( key ) ).template as<T>(); }
+    template<class T, class K> bool is( const K& key ) const { return get( keyText( key ) ).template is<T>(); }
+    template<class K> bool containsKey( const K& key ) const { return get( keyText( key ) ).success(); }
+    template<class K> void remove( const K& key )
+    {
+      for( auto it = members.begin(); it != members.end(); ++it )
+        if( strcmp( it->first, keyText( key ) ) == 0 )
+        {
+          members.erase( it );
+          return;
+        }
+    }
+    size_t size( void ) const { return members.size(); }
+
+    template<class K> JsonObjectSubscript operator[]( const K& key );
+    template<class K> const JsonVariant& operator[]( const K& key ) const { return get( keyText( key ) ); }
+    template<class K> JsonArray& createNestedArray( const K& key );
+    template<class K> JsonObject& createNestedObject( const K& key );
+
+    const JsonVariant& get( const char* key ) const
+    {
+      for( const auto& m : members )
+        if( strcmp( m.first, key ) == 0 )
+          return m.second;
+      return jsonUndefined;
+    }
+    void write( std::string& out ) const override
+    {
+      bool first = true;
+      out += '{';
+      for( const auto& m : members )
+      {
+        if( !first ) out += ',';
+        first = false;
+        writeString( out, m.first );
+        out += ':';
+        m.second.printTo( out );
+      }
+      out += '}';
+    }
+
+    static void writeString( std::string& out, const char* s )
+    {
+      out += '"';
+      for( ; *s != '\0'; s++ )
+      {
+        switch( *s )
+        {
+          case '"': out += "\\\""; break;
+          case '\\': out += "\\\\"; break;
+          case '\b': out += "\\b"; break;
+          case '\f': out += "\\f"; break;
+          case '\n': out += "\\n"; break;
+          case '\r': out += "\\r"; break;
+          case '\t': out += "\\t"; break;
+          default: out += *s; break;
+        }
+      }
+      out += '"';
+    }
+
+  private:
+    friend class JsonParser;
+    std::vector<std::pair<const char*, JsonVariant>> members;
+
+    JsonVariant* find( const char* key )
+    {
+      for( auto& m : members )
+        if( strcmp( m.first, key ) == 0 )
+          return &m.second;
+      return NULL;
+    }
+    static const char* keyText( const char* key ) { return key; }
+    static const char* keyText( char* key ) { return key; }
+    static const char* keyText( const String& key ) { return key.c_str(); }
+    static const char* keyText( const __FlashStringHelper* key ) { return reinterpret_cast<const char*>( key ); }
+};
+
+class JsonArray : public JsonContainer
+{
+  public:
+    explicit JsonArray( DynamicJsonBuffer* b ) : JsonContainer( b ) {}
+    static JsonArray& invalid( void ) { static JsonArray none( NULL ); return none; }
+
+    template<class T> bool add( const T& v )
+    {
+      if( buffer == NULL )
+        return false;
+      elements.push_back( value( v ) );
+      return true;
+    }
+    size_t size( void ) const { return elements.size(); }
+    const JsonVariant& operator[]( size_t i ) const { return ( i < elements.size() )? elements[i] : jsonUndefined; }
+    template<class T> T get( size_t i ) const { return ( *this )[i].template as<T>(); }
+    template<class T> bool is( size_t i ) const { return ( *this )[i].template is<T>(); }
+    JsonArray& createNestedArray( void );
+    JsonObject& createNestedObject( void );
+
+    void write( std::string& out ) const override
+    {
+      out += '[';
+      for( size_t i = 0; i < elements.size(); i++ )
+      {
+        if( i > 0 ) out += ',';
+        elements[i].printTo( out );
+      }
+      out += ']';
+    }
+
+  private:
+    friend class JsonParser;
+    std::vector<JsonVariant> elements;
+};
+
+//root["key"] - assigns to the key, or reads it
+class JsonObjectSubscript
+{
+  public:
+    JsonObjectSubscript( JsonObject& o, const char* k ) : object( o ), key( k ) {}
+    template<class T> JsonObjectSubscript& operator=( const T& v ) { object.set( key.c_str(), v ); return *this; }
+    JsonObjectSubscript& operator=( const JsonObjectSubscript& other ) { object.set( key.c_str(), other.variant() ); return *this; }
+    template<class T> T as( void ) const { return variant().template as<T>(); }
+    template<class T> bool is( void ) const { return variant().template is<T>(); }
+    bool success( void ) const { return variant().success(); }
+    operator JsonArray&( void ) const { return variant(); }
+    operator JsonObject&( void ) const { return variant(); }
+    const JsonVariant& variant( void ) const { return object.get( key.c_str() ); }
+  private:
+    JsonObject& object;
+    std::string key;
+};
+
+template<class K> JsonObjectSubscript JsonObject::operator[]( const K& key ) { return JsonObjectSubscript( *this, keyText( key ) ); }
+
+class DynamicJsonBuffer
+{
+  public:
+    DynamicJsonBuffer( size_t = 0 ) {}
+    DynamicJsonBuffer( const DynamicJsonBuffer& ) = delete;
+
+    JsonObject& createObject( void ) { objects.emplace_back( new JsonObject( this ) ); return *objects.back(); }
+    JsonArray& createArray( void ) { arrays.emplace_back( new JsonArray( this ) ); return *arrays.back(); }
+    const char* strdup( const char* s ) { if( s == NULL ) return NULL; strings.emplace_back( s ); return strings.back().c_str(); }
+    const char* strdup( const String& s ) { return strdup( s.c_str() ); }
+    const char* strdup( const __FlashStringHelper* s ) { return strdup( reinterpret_cast<const char*>( s ) ); }
+    JsonObject& parseObject( const char* json );
+    JsonObject& parseObject( const String& json ) { return parseObject( json.c_str() ); }
+    JsonArray& parseArray( const char* json );
+    JsonArray& parseArray( const String& json ) { return parseArray( json.c_str() ); }
+    size_t size( void ) const { return objects.size() + arrays.size() + strings.size(); }
+
+  private:
+    std::deque<std::unique_ptr<JsonObject>> objects;
+    std::deque<std::unique_ptr<JsonArray>> arrays;
+    std::deque<std::string> strings;
+};
+
+template<size_t CAPACITY> class StaticJsonBuffer : public DynamicJsonBuffer {};
+
+inline const char* JsonContainer::dup( const char* s ) const { return ( buffer == NULL )? s : buffer->strdup( s ); }
+
+inline JsonArray& JsonArray::createNestedArray( void )
+{
+  if( buffer == NULL ) return JsonArray::invalid();
+  JsonArray& a = buffer->createArray();
+  add( a );
+  return a;
+}
+inline JsonObject& JsonArray::createNestedObject( void )
+{
+  if( buffer == NULL ) return JsonObject::invalid();
+  JsonObject& o = buffer->createObject();
+  add( o );
+  return o;
+}
+template<class K> JsonArray& JsonObject::createNestedArray( const K& key )
+{
+  if( buffer == NULL ) return JsonArray::invalid();
+  JsonArray& a = buffer->createArray();
+  set( key, a );
+  return a;
+}
+template<class K> JsonObject& JsonObject::createNestedObject( const K& key )
+{
+  if( buffer == NULL ) return JsonObject::invalid();
+  JsonObject& o = buffer->createObject();
+  set( key, o );
+  return o;
+}
+
+inline JsonVariant::operator JsonArray&( void ) const { return ( type == ARRAY )? *a : JsonArray::invalid(); }
+inline JsonVariant::operator JsonObject&( void ) const { return ( type == OBJECT )? *o : JsonObject::invalid(); }
+
+inline size_t JsonVariant::printTo( std::string& out ) const
+{
+  size_t start = out.size();
+  char buf[32];
+  switch( type )
+  {
+    case UNDEFINED:
+    case NUL: out += "null"; break;
+    case BOOLEAN: out += ( i )? "true" : "false"; break;
+    case INTEGER: out += std::to_string( i ); break;
+    case FLOAT:
+      snprintf( buf, sizeof( buf ), "%.9g", f );
+      out += buf;
+      break;
+    case STRING: JsonObject::writeString( out, s ); break;
+    case ARRAY: a->write( out ); break;
+    case OBJECT: o->write( out ); break;
+  }
+  return out.size() - start;
+}
+
+//Recursive descent parser into a buffer
+class JsonParser
+{
+  public:
+    JsonParser( DynamicJsonBuffer* b, const char* json ) : buffer( b ), p( json ) {}
+
+    bool parseValue( JsonVariant& v, int depth )
+    {
+      skip();
+      if( depth > 16 )
+        return false;
+      switch( *p )
+      {
+        case '{':
+        {
+          JsonObject& o = buffer->createObject();
+          v = JsonVariant::object( &o );
+          return parseObjectBody( o, depth );
+        }
+        case '[':
+        {
+          JsonArray& a = buffer->createArray();
+          v = JsonVariant::array( &a );
+          return parseArrayBody( a, depth );
+        }
+        case '"':
+        case '\'':
+        {
+          std::string s;
+          if( !parseString( s ) )
+            return false;
+          v = JsonVariant::string( buffer->strdup( s.c_str() ) );
+          return true;
+        }
+        default:
+          return parseLiteral( v );
+      }
+    }
+
+    bool parseObjectBody( JsonObject& o, int depth )
+    {
+      p++;
+      skip();
+      if( *p == '}' ) { p++; return true; }
+      for( ;; )
+      {
+        std::string key;
+        JsonVariant v;
+        skip();
+        if( !parseString( key ) )
+          return false;
+        skip();
+        if( *p++ != ':' )
+          return false;
+        if( !parseValue( v, depth + 1 ) )
+          return false;
+        o.members.push_back( std::make_pair( buffer->strdup( key.c_str() ), v ) );
+        skip();
+        if( *p == ',' ) { p++; continue; }
+        if( *p == '}' ) { p++; return true; }
+        return false;
+      }
+    }
+
+    bool parseArrayBody( JsonArray& a, int depth )
+    {
+      p++;
+      skip();
+      if( *p == ']' ) { p++; return true; }
+      for( ;; )
+      {
+        JsonVariant v;
+        if( !parseValue( v, depth + 1 ) )
+          return false;
+        a.elements.push_back( v );
+        skip();
+        if( *p == ',' ) { p++; continue; }
+        if( *p == ']' ) { p++; return true; }
+        return false;
+      }
+    }
+
+    void skip( void ) { while( *p != '\0' && isspace( (unsigned char) *p ) ) p++; }
+    const char* position( void ) const { return p; }
+
+  private:
+    DynamicJsonBuffer* buffer;
+    const char* p;
+
+    bool parseString( std::string& s )
+    {
+      char quote = *p;
+      if( quote != '"' && quote != '\'' )
+        return false;
+      p++;
+      while( *p != quote )
+      {
+        if( *p == '\0' )
+          return false;
+        if( *p == '\\' )
+        {
+          p++;
+          switch( *p )
+          {
+            case 'b': s += '\b'; break;
+            case 'f': s += '\f'; break;
+            case 'n': s += '\n'; break;
+            case 'r': s += '\r'; break;
+            case 't': s += '\t'; break;
+            case 'u':
+            {
+              unsigned int c = 0;
+              if( sscanf( p + 1, "%4x", &c ) != 1 )
+                return false;
+              if( c < 0x80 ) s += (char) c;
+              else if( c < 0x800 ) { s += (char) ( 0xC0 | ( c >> 6 ) ); s += (char) ( 0x80 | ( c & 0x3F ) ); }
+              else { s += (char) ( 0xE0 | ( c >> 12 ) ); s += (char) ( 0x80 | ( ( c >> 6 ) & 0x3F ) ); s += (char) ( 0x80 | ( c & 0x3F ) ); }
+              p += 4;
+              break;
+            }
+            case '\0': return false;
+            default: s += *p; break;
+          }
+          p++;
+        }
+        else
+          s += *p++;
+      }
+      p++;
+      return true;
+    }
+
+    bool parseLiteral( JsonVariant& v )
+    {
+      const char* start = p;
+      char* end = NULL;
+      if( strncmp( p, "true", 4 ) == 0 ) { p += 4; v = JsonVariant::boolean( true ); return true; }
+      if( strncmp( p, "false", 5 ) == 0 ) { p += 5; v = JsonVariant::boolean( false ); return true; }
+      if( strncmp( p, "null", 4 ) == 0 ) { p += 4; v = JsonVariant::null(); return true; }
+      if( *p != '-' && !isdigit( (unsigned char) *p ) )
+        return false;
+      long long i = strtoll( start, &end, 10 );
+      if( *end == '.' || *end == 'e' || *end == 'E' )
+      {
+        double f = strtod( start, &end );
+        v = JsonVariant::real( f );
+      }
+      else
+        v = JsonVariant::integer( i );
+      p = end;
+      return true;
+    }
+};
+
+inline JsonObject& DynamicJsonBuffer::parseObject( const char* json )
+{
+  JsonVariant v;
+  if( json == NULL )
+    return JsonObject::invalid();
+  JsonParser parser( this, json );
+  parser.skip();
+  if( *parser.position() != '{' || !parser.parseValue( v, 0 ) )
+    return JsonObject::invalid();
+  return v;
+}
+
+inline JsonArray& DynamicJsonBuffer::parseArray( const char* json )
+{
+  JsonVariant v;
+  if( json == NULL )
+    return JsonArray::invalid();
+  JsonParser parser( this, json );
+  parser.skip();
+  if( *parser.position() != '[' || !parser.parseValue( v, 0 ) )
+    return JsonArray::invalid();
+  return v;
+}
+#endif
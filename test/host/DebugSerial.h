@@ -0,0 +1,10 @@
+/*
+ Host stand-in for the shared debug macros - Serial, which only prints with HOST_SERIAL set.
+*/
+#if !defined _HOST_DEBUGSERIAL_H_
+#define _HOST_DEBUGSERIAL_H_
+#define DEBUGS1(x) Serial.print(x)
+#define DEBUGSL1(x) Serial.println(x)
+#define DEBUGS2(x,y) Serial.print(x,y)
+#define DEBUGSL2(x,y) Serial.println(x,y)
+#endif
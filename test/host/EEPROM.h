@@ -0,0 +1,41 @@
+/*
+ Host EEPROM - the RAM copy the core keeps, with commit() counting the flash sector writes it would make.
+ Unwritten bytes read back as 0xFF, like erased flash.
+*/
+#if !defined _HOST_EEPROM_H_
+#define _HOST_EEPROM_H_
+#include "Arduino.h"
+#include <vector>
+
+class EEPROMClass
+{
+  public:
+    void begin( size_t size ) { data.resize( size, 0xFF ); }
+    uint8_t read( int address ) const { return ( address >= 0 && address < (int) data.size() )? data[address] : 0xFF; }
+    void write( int address, uint8_t value )
+    {
+      if( address < 0 || address >= (int) data.size() )
+        return;
+      dirty |= ( data[address] != value );
+      data[address] = value;
+    }
+    //The core skips the flash write when nothing has changed
+    bool commit( void )
+    {
+      if( dirty )
+        commits++;
+      dirty = false;
+      return true;
+    }
+    size_t length( void ) const { return data.size(); }
+    uint8_t* getDataPtr( void ) { dirty = true; return data.data(); }
+    void hostErase( void ) { std::fill( data.begin(), data.end(), 0xFF ); dirty = false; }
+
+    uint32_t commits = 0;
+  private:
+    std::vector<uint8_t> data;
+    bool dirty = false;
+};
+
+inline EEPROMClass EEPROM;
+#endif
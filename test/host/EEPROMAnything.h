@@ -0,0 +1,48 @@
+/*
+ Host copy of the EEPROM helpers from the EEPROMAnything library.
+*/
+#if !defined _HOST_EEPROMANYTHING_H_
+#define _HOST_EEPROMANYTHING_H_
+#include "EEPROM.h"
+
+template <class T> int EEPROMWriteAnything( int ee, const T& value )
+{
+  const uint8_t* p = (const uint8_t*) (const void*) &value;
+  unsigned int i;
+  for( i = 0; i < sizeof( value ); i++ )
+    EEPROM.write( ee++, *p++ );
+  return i;
+}
+
+template <class T> int EEPROMReadAnything( int ee, T& value )
+{
+  uint8_t* p = (uint8_t*) (void*) &value;
+  unsigned int i;
+  for( i = 0; i < sizeof( value ); i++ )
+    *p++ = EEPROM.read( ee++ );
+  return i;
+}
+
+//Writes the string and its terminator, up to maxLength bytes in all
+inline int EEPROMWriteString( int ee, const char* value, int maxLength )
+{
+  int i = 0;
+  for( i = 0; i < maxLength - 1 && value[i] != '\0'; i++ )
+    EEPROM.write( ee + i, (uint8_t) value[i] );
+  EEPROM.write( ee + i, '\0' );
+  return i;
+}
+
+inline int EEPROMReadString( int ee, char* value, int maxLength )
+{
+  int i = 0;
+  for( i = 0; i < maxLength - 1; i++ )
+  {
+    value[i] = (char) EEPROM.read( ee + i );
+    if( value[i] == '\0' )
+      break;
+  }
+  value[i] = '\0';
+  return i;
+}
+#endif
@@ -0,0 +1,538 @@
+/*
+ Host ESP8266WebServer - the request parsing, routing and reply of the core's server, serving one request per handleClient()
+ either from requests a test queues in-process or from a connection accepted on the loopback socket.
+ As in the core's 2.x server every reply closes the connection, argument names are case sensitive, and a body that isn't
+ a url-encoded form is passed to the handler as the "plain" argument.
+ In-process requests go through the same parser as the socket ones - hostQueue() takes the raw request, hostRequest()
+ builds one, queues it and serves it, and the reply is kept in hostLastResponse().
+*/
+#if !defined _HOST_ESP8266WEBSERVER_H_
+#define _HOST_ESP8266WEBSERVER_H_
+#include "ESP8266WiFi.h"
+#include <vector>
+#include <deque>
+#include <memory>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+#define HTTP_UPLOAD_BUFLEN 2048
+#define HTTP_MAX_DATA_WAIT 5000
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+
+struct HTTPUpload
+{
+  HTTPUploadStatus status;
+  String filename;
+  String name;
+  String type;
+  size_t totalSize;
+  size_t currentSize;
+  uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+class Uri
+{
+  public:
+    Uri( const char* uri ) : _uri( uri ) {}
+    Uri( const String& uri ) : _uri( uri ) {}
+    virtual ~Uri( void ) {}
+    virtual Uri* clone( void ) const { return new Uri( _uri ); }
+    virtual bool canHandle( const String& requestUri, std::vector<String>& pathArgs ) { pathArgs.clear(); return _uri == requestUri; }
+  protected:
+    String _uri;
+};
+
+class ESP8266WebServer;
+
+class RequestHandler
+{
+  public:
+    virtual ~RequestHandler( void ) {}
+    virtual bool canHandle( HTTPMethod method, const String& uri ) { (void) method; (void) uri; return false; }
+    virtual bool canUpload( const String& uri ) { (void) uri; return false; }
+    virtual bool handle( ESP8266WebServer& server, HTTPMethod method, const String& uri ) { (void) server; (void) method; (void) uri; return false; }
+    virtual void upload( ESP8266WebServer& server, const String& uri, HTTPUpload& upload ) { (void) server; (void) uri; (void) upload; }
+    RequestHandler* next( void ) { return _next; }
+    void next( RequestHandler* r ) { _next = r; }
+    const String& pathArg( unsigned int i ) const { static const String none; return ( i < pathArgs.size() )? pathArgs[i] : none; }
+  protected:
+    std::vector<String> pathArgs;
+  private:
+    RequestHandler* _next = NULL;
+};
+
+class ESP8266WebServer
+{
+  public:
+    typedef std::function<void( void )> THandlerFunction;
+
+    struct Response
+    {
+      int code = 0;
+      String contentType;
+      std::string body;
+      std::vector<std::pair<String, String>> headers;
+    };
+
+    ESP8266WebServer( int port = 80 ) : listener( (uint16_t) port ) {}
+
+    void begin( void ) { listener.begin(); }
+    void on( const Uri& uri, THandlerFunction fn ) { on( uri, HTTP_ANY, fn ); }
+    void on( const Uri& uri, HTTPMethod method, THandlerFunction fn ) { on( uri, method, fn, THandlerFunction() ); }
+    void on( const Uri& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn )
+    {
+      addHandler( new FunctionRequestHandler( fn, ufn, uri, method ) );
+    }
+    void addHandler( RequestHandler* handler )
+    {
+      if( lastHandler == NULL )
+        firstHandler = handler;
+      else
+        lastHandler->next( handler );
+      lastHandler = handler;
+    }
+    void onNotFound( THandlerFunction fn ) { notFoundHandler = fn; }
+
+    void handleClient( void )
+    {
+      std::string raw;
+      if( !queued.empty() )
+      {
+        raw = queued.front();
+        queued.pop_front();
+        current = WiFiClient();
+        serve( raw );
+        return;
+      }
+      if( !listener.hasClient() )
+        return;
+      current = listener.available();
+      if( readRequest( raw ) )
+        serve( raw );
+      current.stop();
+    }
+
+    //Request
+    String arg( const String& name ) const
+    {
+      for( const auto& a : currentArgs )
+        if( a.first == name )
+          return a.second;
+      return String();
+    }
+    String arg( int i ) const { return ( i >= 0 && i < (int) currentArgs.size() )? currentArgs[i].second : String(); }
+    String argName( int i ) const { return ( i >= 0 && i < (int) currentArgs.size() )? currentArgs[i].first : String(); }
+    int args( void ) const { return (int) currentArgs.size(); }
+    bool hasArg( const String& name ) const
+    {
+      for( const auto& a : currentArgs )
+        if( a.first == name )
+          return true;
+      return false;
+    }
+    const String& pathArg( unsigned int i ) const
+    {
+      static const String none;
+      return ( currentHandler != NULL )? currentHandler->pathArg( i ) : none;
+    }
+    const String& uri( void ) const { return currentUri; }
+    HTTPMethod method( void ) const { return currentMethod; }
+    String header( const String& name ) const
+    {
+      for( const auto& h : currentHeaders )
+        if( h.first.equalsIgnoreCase( name ) )
+          return h.second;
+      return String();
+    }
+    bool hasHeader( const String& name ) const
+    {
+      for( const auto& h : currentHeaders )
+        if( h.first.equalsIgnoreCase( name ) )
+          return true;
+      return false;
+    }
+    void collectHeaders( const char* headerKeys[], size_t count )
+    {
+      collected.clear();
+      for( size_t i = 0; i < count; i++ )
+        collected.push_back( String( headerKeys[i] ) );
+    }
+    HTTPUpload& upload( void ) { return *currentUpload; }
+    WiFiClient client( void ) { return current; }
+
+    //Reply
+    void sendHeader( const String& name, const String& value, bool first = false )
+    {
+      if( first )
+        pendingHeaders.insert( pendingHeaders.begin(), std::make_pair( name, value ) );
+      else
+        pendingHeaders.push_back( std::make_pair( name, value ) );
+    }
+    void send( int code, const char* contentType = NULL, const String& content = String( "" ) )
+    {
+      reply( code, ( contentType == NULL )? "text/html" : contentType, std::string( content.c_str(), content.length() ) );
+    }
+    void send( int code, char* contentType, const String& content ) { send( code, (const char*) contentType, content ); }
+    void send( int code, const String& contentType, const String& content ) { send( code, contentType.c_str(), content ); }
+    void send_P( int code, PGM_P contentType, PGM_P content ) { reply( code, contentType, std::string( content ) ); }
+    void send_P( int code, PGM_P contentType, PGM_P content, size_t length ) { reply( code, contentType, std::string( content, length ) ); }
+
+    //Host side
+    void hostQueue( const std::string& raw ) { queued.push_back( raw ); }
+    size_t hostPending( void ) const { return queued.size(); }
+    const Response& hostLastResponse( void ) const { return lastResponse; }
+    uint32_t hostServed( void ) const { return served; }
+
+    static std::string hostBuildRequest( HTTPMethod method, const String& uriAndQuery, const std::string& body = std::string(),
+                                         const char* contentType = "application/x-www-form-urlencoded",
+                                         const std::vector<std::pair<String, String>>& headers = {} )
+    {
+      std::string raw = methodName( method );
+      raw += " ";
+      raw += uriAndQuery.c_str();
+      raw += " HTTP/1.1\r\nHost: localhost\r\n";
+      for( const auto& h : headers )
+        raw += std::string( h.first.c_str() ) + ": " + h.second.c_str() + "\r\n";
+      if( !body.empty() || method == HTTP_PUT || method == HTTP_POST )
+      {
+        if( contentType != NULL )
+          raw += std::string( "Content-Type: " ) + contentType + "\r\n";
+        raw += "Content-Length: " + std::to_string( body.size() ) + "\r\n";
+      }
+      raw += "\r\n";
+      raw += body;
+      return raw;
+    }
+
+    //Serve a request now, in-process
+    const Response& hostRequest( HTTPMethod method, const String& uriAndQuery, const std::string& body = std::string(),
+                                 const char* contentType = "application/x-www-form-urlencoded",
+                                 const std::vector<std::pair<String, String>>& headers = {} )
+    {
+      hostQueue( hostBuildRequest( method, uriAndQuery, body, contentType, headers ) );
+      handleClient();
+      return lastResponse;
+    }
+
+    //POST a file as a multipart form, the way a browser or curl -F sends it
+    const Response& hostUpload( const String& uriAndQuery, const char* field, const char* filename, const std::string& data )
+    {
+      const char* boundary = "----hostboundary7MA4YWxkTrZu0gW";
+      std::string body = std::string( "--" ) + boundary + "\r\nContent-Disposition: form-data; name=\"" + field +
+                         "\"; filename=\"" + filename + "\"\r\nContent-Type: application/octet-stream\r\n\r\n" +
+                         data + "\r\n--" + boundary + "--\r\n";
+      std::string type = std::string( "multipart/form-data; boundary=" ) + boundary;
+      return hostRequest( HTTP_POST, uriAndQuery, body, type.c_str() );
+    }
+
+    static const char* methodName( HTTPMethod method )
+    {
+      static const char* const names[] = { "ANY", "GET", "HEAD", "POST", "PUT", "PATCH", "DELETE", "OPTIONS" };
+      return names[method];
+    }
+
+  private:
+    class FunctionRequestHandler : public RequestHandler
+    {
+      public:
+        FunctionRequestHandler( THandlerFunction f, THandlerFunction uf, const Uri& u, HTTPMethod m )
+          : fn( f ), ufn( uf ), uri( u.clone() ), method( m ) {}
+        bool canHandle( HTTPMethod requestMethod, const String& requestUri ) override
+        {
+          if( method != HTTP_ANY && method != requestMethod )
+            return false;
+          return uri->canHandle( requestUri, pathArgs );
+        }
+        bool canUpload( const String& requestUri ) override
+        {
+          return ufn && method == HTTP_POST && uri->canHandle( requestUri, pathArgs );
+        }
+        bool handle( ESP8266WebServer& server, HTTPMethod requestMethod, const String& requestUri ) override
+        {
+          (void) server;
+          if( !canHandle( requestMethod, requestUri ) )
+            return false;
+          fn();
+          return true;
+        }
+        void upload( ESP8266WebServer& server, const String& requestUri, HTTPUpload& upload ) override
+        {
+          (void) server;
+          (void) upload;
+          if( canUpload( requestUri ) )
+            ufn();
+        }
+      private:
+        THandlerFunction fn;
+        THandlerFunction ufn;
+        std::unique_ptr<Uri> uri;
+        HTTPMethod method;
+    };
+
+    WiFiServer listener;
+    WiFiClient current;
+    RequestHandler* firstHandler = NULL;
+    RequestHandler* lastHandler = NULL;
+    RequestHandler* currentHandler = NULL;
+    THandlerFunction notFoundHandler;
+    std::deque<std::string> queued;
+    std::vector<String> collected;
+
+    HTTPMethod currentMethod = HTTP_GET;
+    String currentUri;
+    std::vector<std::pair<String, String>> currentArgs;
+    std::vector<std::pair<String, String>> currentHeaders;
+    std::vector<std::pair<String, String>> pendingHeaders;
+    std::unique_ptr<HTTPUpload> currentUpload{ new HTTPUpload() };
+    Response lastResponse;
+    bool replied = false;
+    uint32_t served = 0;
+
+    //Collect a whole request from the accepted connection
+    bool readRequest( std::string& raw )
+    {
+      uint8_t buf[2048];
+      size_t headerEnd = std::string::npos;
+      size_t wanted = 0;
+      unsigned long start = millis();
+      struct pollfd pfd;
+
+      while( millis() - start < HTTP_MAX_DATA_WAIT )
+      {
+        int n = current.read( buf, sizeof( buf ) );
+        if( n > 0 )
+          raw.append( (const char*) buf, n );
+        else
+        {
+          if( !current.connected() )
+            return false;
+          pfd.fd = current.fd();
+          pfd.events = POLLIN;
+          poll( &pfd, 1, 10 );
+        }
+        if( headerEnd == std::string::npos && ( headerEnd = raw.find( "\r\n\r\n" ) ) != std::string::npos )
+        {
+          const char* length = strcasestr( raw.c_str(), "\r\nContent-Length:" );
+          wanted = headerEnd + 4;
+          if( length != NULL && length < raw.c_str() + headerEnd )
+            wanted += strtoul( length + 17, NULL, 10 );
+        }
+        if( headerEnd != std::string::npos && raw.size() >= wanted )
+          return true;
+      }
+      return false;
+    }
+
+    static String urlDecode( const std::string& s )
+    {
+      std::string out;
+      for( size_t i = 0; i < s.size(); i++ )
+      {
+        if( s[i] == '+' )
+          out += ' ';
+        else if( s[i] == '%' && i + 2 < s.size() )
+        {
+          out += (char) strtol( s.substr( i + 1, 2 ).c_str(), NULL, 16 );
+          i += 2;
+        }
+        else
+          out += s[i];
+      }
+      return String( out );
+    }
+
+    void parseArguments( const std::string& data )
+    {
+      size_t pos = 0;
+      while( pos < data.size() )
+      {
+        size_t end = data.find( '&', pos );
+        if( end == std::string::npos )
+          end = data.size();
+        std::string pair = data.substr( pos, end - pos );
+        size_t eq = pair.find( '=' );
+        if( !pair.empty() )
+        {
+          if( eq == std::string::npos )
+            currentArgs.push_back( std::make_pair( urlDecode( pair ), String() ) );
+          else
+            currentArgs.push_back( std::make_pair( urlDecode( pair.substr( 0, eq ) ), urlDecode( pair.substr( eq + 1 ) ) ) );
+        }
+        pos = end + 1;
+      }
+    }
+
+    //Form fields become arguments, a file part goes to the upload handler in HTTP_UPLOAD_BUFLEN chunks
+    void parseMultipart( const std::string& body, const std::string& boundary )
+    {
+      std::string delimiter = "--" + boundary;
+      size_t pos = body.find( delimiter );
+      HTTPUpload& up = *currentUpload;
+
+      while( pos != std::string::npos )
+      {
+        pos += delimiter.size();
+        if( body.compare( pos, 2, "--" ) == 0 )
+          break;
+        pos += 2;
+        size_t partHeaderEnd = body.find( "\r\n\r\n", pos );
+        if( partHeaderEnd == std::string::npos )
+          break;
+        std::string partHeaders = body.substr( pos, partHeaderEnd - pos );
+        size_t dataStart = partHeaderEnd + 4;
+        size_t next = body.find( "\r\n" + delimiter, dataStart );
+        if( next == std::string::npos )
+          break;
+        std::string name = headerParam( partHeaders, "name=\"" );
+        std::string filename = headerParam( partHeaders, "filename=\"" );
+        if( filename.empty() && partHeaders.find( "filename=" ) == std::string::npos )
+          currentArgs.push_back( std::make_pair( String( name ), String( body.substr( dataStart, next - dataStart ) ) ) );
+        else if( currentHandler != NULL && currentHandler->canUpload( currentUri ) )
+        {
+          up.filename = String( filename );
+          up.name = String( name );
+          up.type = String( "application/octet-stream" );
+          up.totalSize = 0;
+          up.currentSize = 0;
+          up.status = UPLOAD_FILE_START;
+          currentHandler->upload( *this, currentUri, up );
+          for( size_t at = dataStart; at < next; at += HTTP_UPLOAD_BUFLEN )
+          {
+            up.currentSize = std::min( (size_t) HTTP_UPLOAD_BUFLEN, next - at );
+            memcpy( up.buf, body.data() + at, up.currentSize );
+            up.totalSize += up.currentSize;
+            up.status = UPLOAD_FILE_WRITE;
+            currentHandler->upload( *this, currentUri, up );
+          }
+          up.currentSize = 0;
+          up.status = UPLOAD_FILE_END;
+          currentHandler->upload( *this, currentUri, up );
+        }
+        pos = next + 2;
+      }
+    }
+
+    static std::string headerParam( const std::string& headers, const char* key )
+    {
+      size_t at = headers.find( key );
+      if( at == std::string::npos )
+        return std::string();
+      at += strlen( key );
+      return headers.substr( at, headers.find( '"', at ) - at );
+    }
+
+    void serve( const std::string& raw )
+    {
+      size_t lineEnd = raw.find( "\r\n" );
+      size_t headerEnd = raw.find( "\r\n\r\n" );
+      std::string line = raw.substr( 0, lineEnd );
+      std::string target;
+      std::string body;
+      String contentType;
+      HTTPMethod m = HTTP_GET;
+
+      currentArgs.clear();
+      currentHeaders.clear();
+      pendingHeaders.clear();
+      currentHandler = NULL;
+      replied = false;
+      served++;
+
+      //Request line
+      size_t sp1 = line.find( ' ' );
+      size_t sp2 = line.find( ' ', sp1 + 1 );
+      std::string methodText = line.substr( 0, sp1 );
+      target = line.substr( sp1 + 1, sp2 - sp1 - 1 );
+      for( int i = HTTP_GET; i <= HTTP_OPTIONS; i++ )
+        if( methodText == methodName( (HTTPMethod) i ) )
+          m = (HTTPMethod) i;
+      currentMethod = m;
+      size_t query = target.find( '?' );
+      currentUri = String( target.substr( 0, query ) );
+
+      //Headers - only the collected ones are kept, as the core does
+      size_t pos = lineEnd + 2;
+      while( pos < headerEnd )
+      {
+        size_t end = raw.find( "\r\n", pos );
+        std::string h = raw.substr( pos, end - pos );
+        size_t colon = h.find( ':' );
+        if( colon != std::string::npos )
+        {
+          String name( h.substr( 0, colon ) );
+          String value( h.substr( colon + 1 ) );
+          value.trim();
+          if( name.equalsIgnoreCase( "Content-Type" ) )
+            contentType = value;
+          for( const auto& key : collected )
+            if( key.equalsIgnoreCase( name ) )
+              currentHeaders.push_back( std::make_pair( key, value ) );
+        }
+        pos = end + 2;
+      }
+      if( headerEnd != std::string::npos )
+        body = raw.substr( headerEnd + 4 );
+
+      for( RequestHandler* h = firstHandler; h != NULL && currentHandler == NULL; h = h->next() )
+        if( h->canHandle( m, currentUri ) )
+          currentHandler = h;
+
+      if( query != std::string::npos )
+        parseArguments( target.substr( query + 1 ) );
+      if( contentType.startsWith( "multipart/form-data" ) )
+        parseMultipart( body, std::string( contentType.c_str() + contentType.indexOf( "boundary=" ) + 9 ) );
+      else if( contentType.startsWith( "application/x-www-form-urlencoded" ) )
+        parseArguments( body );
+      else if( !body.empty() )
+        currentArgs.push_back( std::make_pair( String( "plain" ), String( body ) ) );
+
+      if( currentHandler == NULL || !currentHandler->handle( *this, m, currentUri ) )
+      {
+        if( notFoundHandler )
+          notFoundHandler();
+        else
+          send( 404, "text/plain", String( "Not found: " ) + currentUri );
+      }
+      if( !replied )
+        send( 500, "text/plain", String( "No reply" ) );
+    }
+
+    void reply( int code, const char* contentType, const std::string& content )
+    {
+      std::string head = "HTTP/1.1 " + std::to_string( code ) + " " + statusText( code ) + "\r\n";
+      head += std::string( "Content-Type: " ) + contentType + "\r\n";
+      head += "Content-Length: " + std::to_string( content.size() ) + "\r\n";
+      for( const auto& h : pendingHeaders )
+        head += std::string( h.first.c_str() ) + ": " + h.second.c_str() + "\r\n";
+      head += "Connection: close\r\n\r\n";
+
+      lastResponse.code = code;
+      lastResponse.contentType = contentType;
+      lastResponse.body = content;
+      lastResponse.headers = pendingHeaders;
+      pendingHeaders.clear();
+      replied = true;
+      if( current.connected() )
+      {
+        current.write( (const uint8_t*) head.data(), head.size() );
+        current.write( (const uint8_t*) content.data(), content.size() );
+      }
+    }
+
+    static const char* statusText( int code )
+    {
+      switch( code )
+      {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 409: return "Conflict";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        default: return "";
+      }
+    }
+};
+#endif
@@ -0,0 +1,298 @@
+/*
+ Host WiFi over POSIX sockets on the loopback interface.
+ The station is always connected. Servers listen on 127.0.0.1 at their port plus host::portOffset ( HOST_PORT_OFFSET,
+ default 20000 ) so the tests need no privileges - hostPort() gives the port a test should connect to.
+ Clients connect to the port they are given. Copies of a WiFiClient share the connection, as in the core.
+ hostByName() and connect() by name count their lookups in host::dnsLookups.
+*/
+#if !defined _HOST_ESP8266WIFI_H_
+#define _HOST_ESP8266WIFI_H_
+#include "Arduino.h"
+#include "Esp.h"
+#include <memory>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+enum WiFiMode_t { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA };
+enum WiFiSleepType_t { WIFI_NONE_SLEEP = 0, WIFI_LIGHT_SLEEP = 1, WIFI_MODEM_SLEEP = 2 };
+enum wl_status_t { WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL, WL_SCAN_COMPLETED, WL_CONNECTED, WL_CONNECT_FAILED, WL_CONNECTION_LOST, WL_DISCONNECTED };
+
+namespace host
+{
+  inline uint16_t portOffset = ( getenv( "HOST_PORT_OFFSET" ) != NULL )? (uint16_t) atoi( getenv( "HOST_PORT_OFFSET" ) ) : 20000;
+  inline uint32_t dnsLookups = 0;
+  inline uint32_t connects = 0;
+  inline WiFiSleepType_t sleepMode = WIFI_NONE_SLEEP;
+  inline uint32_t sleepModeChanges = 0;
+
+  inline void setNonBlocking( int fd )
+  {
+    fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+  }
+
+  inline bool resolve( const char* name, IPAddress& address )
+  {
+    struct addrinfo hints;
+    struct addrinfo* result = NULL;
+    dnsLookups++;
+    if( address.fromString( name ) )
+      return true;
+    memset( &hints, 0, sizeof( hints ) );
+    hints.ai_family = AF_INET;
+    if( getaddrinfo( name, NULL, &hints, &result ) != 0 || result == NULL )
+      return false;
+    address = IPAddress( (uint32_t) ( (struct sockaddr_in*) result->ai_addr )->sin_addr.s_addr );
+    freeaddrinfo( result );
+    return true;
+  }
+
+  inline struct sockaddr_in socketAddress( IPAddress address, uint16_t port )
+  {
+    struct sockaddr_in sa;
+    memset( &sa, 0, sizeof( sa ) );
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons( port );
+    sa.sin_addr.s_addr = (uint32_t) address;
+    return sa;
+  }
+}
+
+inline uint16_t hostPort( uint16_t port ) { return port + host::portOffset; }
+
+class ESP8266WiFiClass
+{
+  public:
+    bool mode( WiFiMode_t ) { return true; }
+    bool hostname( const char* name ) { hostName = name; return true; }
+    String hostname( void ) { return hostName; }
+    wl_status_t begin( const char*, const char* = NULL ) { return WL_CONNECTED; }
+    wl_status_t status( void ) { return WL_CONNECTED; }
+    String SSID( void ) { return String( "host" ); }
+    int32_t RSSI( void ) { return -50; }
+    IPAddress localIP( void ) { return IPAddress( 127, 0, 0, 1 ); }
+    IPAddress dnsIP( uint8_t = 0 ) { return IPAddress( 127, 0, 0, 53 ); }
+    bool setSleepMode( WiFiSleepType_t type, uint8_t = 0 )
+    {
+      host::sleepMode = type;
+      host::sleepModeChanges++;
+      return true;
+    }
+    WiFiSleepType_t getSleepMode( void ) { return host::sleepMode; }
+    int hostByName( const char* name, IPAddress& address ) { return host::resolve( name, address )? 1 : 0; }
+    int hostByName( const char* name, IPAddress& address, uint32_t ) { return hostByName( name, address ); }
+  private:
+    String hostName;
+};
+
+inline ESP8266WiFiClass WiFi;
+
+class WiFiClient : public Stream
+{
+  public:
+    WiFiClient( void ) {}
+    explicit WiFiClient( int fd ) : conn( std::make_shared<Connection>( fd ) ) {}
+
+    int connect( IPAddress address, uint16_t port )
+    {
+      struct sockaddr_in sa = host::socketAddress( address, port );
+      struct pollfd pfd;
+      int fd = socket( AF_INET, SOCK_STREAM, 0 );
+      int err = 0;
+      socklen_t len = sizeof( err );
+
+      stop();
+      host::connects++;
+      host::setNonBlocking( fd );
+      if( ::connect( fd, (struct sockaddr*) &sa, sizeof( sa ) ) < 0 && errno != EINPROGRESS )
+      {
+        close( fd );
+        return 0;
+      }
+      pfd.fd = fd;
+      pfd.events = POLLOUT;
+      if( poll( &pfd, 1, (int) timeoutMs ) != 1 || getsockopt( fd, SOL_SOCKET, SO_ERROR, &err, &len ) < 0 || err != 0 )
+      {
+        close( fd );
+        return 0;
+      }
+      conn = std::make_shared<Connection>( fd );
+      return 1;
+    }
+    int connect( const char* name, uint16_t port )
+    {
+      IPAddress address;
+      if( !host::resolve( name, address ) )
+        return 0;
+      return connect( address, port );
+    }
+    int connect( const String& name, uint16_t port ) { return connect( name.c_str(), port ); }
+
+    uint8_t connected( void )
+    {
+      char c;
+      if( !conn || conn->fd < 0 )
+        return 0;
+      if( available() > 0 )
+        return 1;
+      ssize_t n = recv( conn->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT );
+      if( n == 0 || ( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK ) )
+        return 0;
+      return 1;
+    }
+    operator bool( void ) { return connected(); }
+    bool operator==( const WiFiClient& other ) const { return conn == other.conn; }
+    uint8_t status( void ) { return connected()? 4 : 0; }
+
+    int available( void ) override
+    {
+      int n = 0;
+      if( !conn || conn->fd < 0 || ioctl( conn->fd, FIONREAD, &n ) < 0 )
+        return 0;
+      return n;
+    }
+    int read( void ) override
+    {
+      uint8_t c;
+      return ( read( &c, 1 ) == 1 )? c : -1;
+    }
+    int read( uint8_t* buf, size_t size )
+    {
+      if( !conn || conn->fd < 0 )
+        return -1;
+      ssize_t n = recv( conn->fd, buf, size, MSG_DONTWAIT );
+      return ( n < 0 )? 0 : (int) n;
+    }
+    int read( char* buf, size_t size ) { return read( (uint8_t*) buf, size ); }
+    int peek( void ) override
+    {
+      uint8_t c;
+      if( !conn || conn->fd < 0 || recv( conn->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT ) != 1 )
+        return -1;
+      return c;
+    }
+
+    using Print::write;
+    size_t write( uint8_t c ) override { return write( &c, 1 ); }
+    size_t write( const uint8_t* buf, size_t size ) override
+    {
+      size_t sent = 0;
+      struct pollfd pfd;
+      if( !conn || conn->fd < 0 )
+        return 0;
+      while( sent < size )
+      {
+        ssize_t n = send( conn->fd, buf + sent, size - sent, MSG_NOSIGNAL | MSG_DONTWAIT );
+        if( n > 0 )
+        {
+          sent += n;
+          continue;
+        }
+        if( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK )
+          break;
+        pfd.fd = conn->fd;
+        pfd.events = POLLOUT;
+        if( poll( &pfd, 1, (int) timeoutMs ) != 1 )
+          break;
+      }
+      return sent;
+    }
+    int availableForWrite( void ) { return ( conn && conn->fd >= 0 )? 1460 : 0; }
+    void flush( void ) override {}
+
+    void stop( void )
+    {
+      if( conn && conn->fd >= 0 )
+      {
+        close( conn->fd );
+        conn->fd = -1;
+      }
+      conn.reset();
+    }
+    void setNoDelay( bool noDelay )
+    {
+      int flag = noDelay;
+      if( conn && conn->fd >= 0 )
+        setsockopt( conn->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof( flag ) );
+    }
+    IPAddress remoteIP( void ) { return peer().first; }
+    uint16_t remotePort( void ) { return peer().second; }
+    int fd( void ) const { return ( conn )? conn->fd : -1; }
+
+  private:
+    struct Connection
+    {
+      int fd;
+      explicit Connection( int f ) : fd( f ) {}
+      ~Connection( void ) { if( fd >= 0 ) close( fd ); }
+    };
+    std::shared_ptr<Connection> conn;
+
+    std::pair<IPAddress, uint16_t> peer( void )
+    {
+      struct sockaddr_in sa;
+      socklen_t len = sizeof( sa );
+      if( !conn || conn->fd < 0 || getpeername( conn->fd, (struct sockaddr*) &sa, &len ) < 0 )
+        return std::make_pair( IPAddress(), (uint16_t) 0 );
+      return std::make_pair( IPAddress( (uint32_t) sa.sin_addr.s_addr ), ntohs( sa.sin_port ) );
+    }
+};
+
+class WiFiServer
+{
+  public:
+    WiFiServer( uint16_t p ) : port( p ) {}
+    ~WiFiServer( void ) { if( listenFd >= 0 ) close( listenFd ); }
+
+    void begin( void )
+    {
+      struct sockaddr_in sa = host::socketAddress( IPAddress( 127, 0, 0, 1 ), hostPort( port ) );
+      int flag = 1;
+      listenFd = socket( AF_INET, SOCK_STREAM, 0 );
+      setsockopt( listenFd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof( flag ) );
+      if( bind( listenFd, (struct sockaddr*) &sa, sizeof( sa ) ) < 0 || listen( listenFd, 8 ) < 0 )
+      {
+        fprintf( stderr, "WiFiServer: can't listen on port %u\n", hostPort( port ) );
+        close( listenFd );
+        listenFd = -1;
+        return;
+      }
+      host::setNonBlocking( listenFd );
+    }
+    void setNoDelay( bool nd ) { noDelay = nd; }
+    bool hasClient( void )
+    {
+      if( pending >= 0 )
+        return true;
+      if( listenFd < 0 )
+        return false;
+      pending = ::accept( listenFd, NULL, NULL );
+      return pending >= 0;
+    }
+    WiFiClient available( void )
+    {
+      int fd = -1;
+      if( !hasClient() )
+        return WiFiClient();
+      fd = pending;
+      pending = -1;
+      WiFiClient client( fd );
+      client.setNoDelay( noDelay );
+      return client;
+    }
+    WiFiClient accept( void ) { return available(); }
+
+  private:
+    uint16_t port;
+    int listenFd = -1;
+    int pending = -1;
+    bool noDelay = false;
+};
+#endif
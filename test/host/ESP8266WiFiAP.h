@@ -0,0 +1,2 @@
+//Host stand-in - the soft AP isn't used
+#include "ESP8266WiFi.h"
@@ -0,0 +1,2 @@
+//Host stand-in - see ESP8266WiFi.h
+#include "ESP8266WiFi.h"
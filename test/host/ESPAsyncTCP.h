@@ -0,0 +1,208 @@
+/*
+ Host AsyncClient ( ESPAsyncTCP ) over a non-blocking POSIX socket. connect() only starts the connection and counts
+ it in host::connects - the connect, data and disconnect callbacks run from hostServiceTimers() between loop passes,
+ as lwIP runs them on the device. A connection the far end closes is closed here and onDisconnect called, as the
+ library does. Writes are copied, as with the library's default ASYNC_WRITE_FLAG_COPY.
+*/
+#if !defined _HOST_ESPASYNCTCP_H_
+#define _HOST_ESPASYNCTCP_H_
+#include "ESP8266WiFi.h"
+#include "ets_sys.h"
+#include <functional>
+#include <vector>
+
+class AsyncClient;
+typedef std::function<void( void*, AsyncClient* )> AcConnectHandler;
+typedef std::function<void( void*, AsyncClient*, void* data, size_t len )> AcDataHandler;
+typedef std::function<void( void*, AsyncClient*, int8_t error )> AcErrorHandler;
+
+const int8_t ERR_ABRT = -13;
+const int8_t ERR_RST = -14;
+const int8_t ERR_CONN = -11;
+
+namespace host
+{
+  inline std::vector<AsyncClient*>& asyncClients( void )
+  {
+    static std::vector<AsyncClient*> clients;
+    return clients;
+  }
+  void pollAsyncClients( void );
+}
+
+class AsyncClient
+{
+  public:
+    AsyncClient( void ) {}
+    ~AsyncClient( void )
+    {
+      std::vector<AsyncClient*>& clients = host::asyncClients();
+      clients.erase( std::remove( clients.begin(), clients.end(), this ), clients.end() );
+      if( fd >= 0 )
+        ::close( fd );
+    }
+
+    bool connect( IPAddress address, uint16_t port )
+    {
+      static bool polled = false;
+      struct sockaddr_in sa = host::socketAddress( address, port );
+      std::vector<AsyncClient*>& clients = host::asyncClients();
+
+      if( fd >= 0 )
+        return false;
+      if( !polled )
+      {
+        host::pollers.push_back( host::pollAsyncClients );
+        polled = true;
+      }
+      if( std::find( clients.begin(), clients.end(), this ) == clients.end() )
+        clients.push_back( this );
+      host::connects++;
+      fd = socket( AF_INET, SOCK_STREAM, 0 );
+      host::setNonBlocking( fd );
+      setNoDelay( noDelay );
+      pending = true;
+      if( ::connect( fd, (struct sockaddr*) &sa, sizeof( sa ) ) < 0 && errno != EINPROGRESS )
+      {
+        //Reported from the next poll, as lwIP reports it from its error callback
+        failed = true;
+      }
+      return true;
+    }
+
+    void close( bool now = false ) { closeSocket( true ); }
+    int8_t abort( void )
+    {
+      closeSocket( true );
+      return ERR_ABRT;
+    }
+
+    bool connected( void ) { return fd >= 0 && !pending; }
+    bool connecting( void ) { return fd >= 0 && pending; }
+    bool disconnected( void ) { return fd < 0; }
+    bool freeable( void ) { return fd < 0; }
+
+    size_t space( void ) { return ( connected() )? 2920 : 0; }
+    size_t add( const char* data, size_t size, uint8_t apiflags = 0 )
+    {
+      if( !connected() )
+        return 0;
+      tx.insert( tx.end(), data, data + size );
+      return size;
+    }
+    bool send( void )
+    {
+      size_t sent = 0;
+      while( connected() && sent < tx.size() )
+      {
+        ssize_t n = ::send( fd, tx.data() + sent, tx.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT );
+        if( n <= 0 )
+          break;
+        sent += n;
+      }
+      tx.erase( tx.begin(), tx.begin() + sent );
+      return sent > 0;
+    }
+    size_t write( const char* data, size_t size, uint8_t apiflags = 0 )
+    {
+      size_t added = add( data, size, apiflags );
+      if( added > 0 )
+        send();
+      return added;
+    }
+    size_t write( const char* data ) { return write( data, strlen( data ) ); }
+
+    void setNoDelay( bool nd )
+    {
+      int flag = nd;
+      noDelay = nd;
+      if( fd >= 0 )
+        setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof( flag ) );
+    }
+    bool getNoDelay( void ) { return noDelay; }
+
+    void onConnect( AcConnectHandler cb, void* arg = NULL ) { connectCb = cb; connectArg = arg; }
+    void onDisconnect( AcConnectHandler cb, void* arg = NULL ) { disconnectCb = cb; disconnectArg = arg; }
+    void onData( AcDataHandler cb, void* arg = NULL ) { dataCb = cb; dataArg = arg; }
+    void onError( AcErrorHandler cb, void* arg = NULL ) { errorCb = cb; errorArg = arg; }
+
+    //Run the callbacks for whatever the socket has to report
+    void hostPoll( void )
+    {
+      char buf[536];
+      struct pollfd pfd;
+      int err = 0;
+      socklen_t len = sizeof( err );
+      ssize_t n = 0;
+
+      if( fd < 0 )
+        return;
+      if( pending )
+      {
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        if( !failed && poll( &pfd, 1, 0 ) != 1 )
+          return;
+        if( failed || getsockopt( fd, SOL_SOCKET, SO_ERROR, &err, &len ) < 0 || err != 0 )
+        {
+          fail( ERR_CONN );
+          return;
+        }
+        pending = false;
+        if( connectCb )
+          connectCb( connectArg, this );
+      }
+      send();
+      //Each segment as lwIP would hand it over
+      while( fd >= 0 && ( n = recv( fd, buf, sizeof( buf ), MSG_DONTWAIT ) ) > 0 )
+        if( dataCb )
+          dataCb( dataArg, this, buf, (size_t) n );
+      if( fd >= 0 && n == 0 )
+        closeSocket( true );
+      else if( fd >= 0 && n < 0 && errno != EAGAIN && errno != EWOULDBLOCK )
+        fail( ERR_RST );
+    }
+
+  private:
+    int fd = -1;
+    bool pending = false;
+    bool failed = false;
+    bool noDelay = false;
+    std::vector<char> tx;
+    AcConnectHandler connectCb;
+    void* connectArg = NULL;
+    AcConnectHandler disconnectCb;
+    void* disconnectArg = NULL;
+    AcDataHandler dataCb;
+    void* dataArg = NULL;
+    AcErrorHandler errorCb;
+    void* errorArg = NULL;
+
+    void closeSocket( bool notify )
+    {
+      if( fd < 0 )
+        return;
+      ::close( fd );
+      fd = -1;
+      pending = false;
+      failed = false;
+      tx.clear();
+      if( notify && disconnectCb )
+        disconnectCb( disconnectArg, this );
+    }
+
+    void fail( int8_t error )
+    {
+      if( errorCb )
+        errorCb( errorArg, this, error );
+      closeSocket( true );
+    }
+};
+
+inline void host::pollAsyncClients( void )
+{
+  std::vector<AsyncClient*> clients = asyncClients();
+  for( AsyncClient* client : clients )
+    client->hostPoll();
+}
+#endif
@@ -0,0 +1,40 @@
+/*
+ Host EspClass. The cycle counter runs at the nominal 80MHz from the host clock, heap figures come from the
+ counters below so a test can set them, and restart() is only counted.
+*/
+#if !defined _HOST_ESP_H_
+#define _HOST_ESP_H_
+#include "Arduino.h"
+
+//The linker symbol RamReport.h reads
+extern "C" { char _heap_start; }
+
+namespace host
+{
+  inline uint32_t freeHeap = 40000;
+  inline uint32_t maxFreeBlock = 32000;
+  inline int restarts = 0;
+}
+
+class EspClass
+{
+  public:
+    void restart( void ) { host::restarts++; }
+    uint32_t getCycleCount( void )
+    {
+      if( host::virtualTime )
+        return (uint32_t) ( host::virtualMicros * 80 );
+      return (uint32_t) ( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() * 80 / 1000 );
+    }
+    uint8_t getCpuFreqMHz( void ) { return 80; }
+    uint32_t getFreeHeap( void ) { return host::freeHeap; }
+    uint32_t getMaxFreeBlockSize( void ) { return host::maxFreeBlock; }
+    uint8_t getHeapFragmentation( void ) { return (uint8_t) ( 100 - ( host::maxFreeBlock * 100 ) / std::max( host::freeHeap, (uint32_t) 1 ) ); }
+    uint32_t getChipId( void ) { return 0x00C0FFEE; }
+    uint32_t getFreeSketchSpace( void ) { return 0x100000; }
+    uint32_t getSketchSize( void ) { return 0x60000; }
+    String getResetReason( void ) { return String( "External System" ); }
+};
+
+inline EspClass ESP;
+#endif
@@ -0,0 +1,5 @@
+//Host stand-in - no GDB stub
+#if !defined _HOST_GDBSTUB_H_
+#define _HOST_GDBSTUB_H_
+inline void gdbstub_init( void ) {}
+#endif
@@ -0,0 +1,25 @@
+/*
+ Checks for the host tests - a failed check is reported and counted, testResult() gives the exit code.
+*/
+#if !defined _HOST_HOSTCHECK_H_
+#define _HOST_HOSTCHECK_H_
+#include <stdio.h>
+
+namespace hostTest
+{
+  inline int checks = 0;
+  inline int failures = 0;
+}
+
+#define CHECK(cond) do { hostTest::checks++; if( !( cond ) ) { hostTest::failures++; \
+  printf( "%s:%d: CHECK( %s ) failed\n", __FILE__, __LINE__, #cond ); } } while( 0 )
+#define CHECK_EQ(a, b) do { long long _a = (long long) ( a ), _b = (long long) ( b ); hostTest::checks++; if( _a != _b ) { hostTest::failures++; \
+  printf( "%s:%d: CHECK_EQ( %s, %s ) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b ); } } while( 0 )
+
+//Summary line, and the exit code for main()
+inline int testResult( const char* name )
+{
+  printf( "%s: %d checks, %d failed\n", name, hostTest::checks, hostTest::failures );
+  return ( hostTest::failures == 0 )? 0 : 1;
+}
+#endif
@@ -0,0 +1,53 @@
+/*
+ Loop helpers shared by the host tests and benchmarks that build the sketch - include after the sketch.
+ hostBoot() runs setup() on the virtual clock, hostRunFor() and hostRunUntil() then run the loop with the soft timers
+ serviced between passes, each pass taking passUs of virtual time.
+*/
+#if !defined _HOST_HOSTTEST_H_
+#define _HOST_HOSTTEST_H_
+#include <functional>
+#include "HostCheck.h"
+
+const uint32_t LOOP_PASS_US = 50;
+
+inline void hostBoot( void )
+{
+  hostUseVirtualTime( true );
+  setup();
+}
+
+inline void hostLoopPass( uint32_t passUs = LOOP_PASS_US )
+{
+  hostServiceTimers();
+  loop();
+  hostAdvanceMicros( passUs );
+}
+
+inline void hostRunFor( uint32_t ms, uint32_t passUs = LOOP_PASS_US )
+{
+  uint64_t end = host::nowMicros() + (uint64_t) ms * 1000;
+  while( host::nowMicros() < end )
+    hostLoopPass( passUs );
+}
+
+//Returns false if done() didn't become true within timeoutMs
+inline bool hostRunUntil( std::function<bool( void )> done, uint32_t timeoutMs, uint32_t passUs = LOOP_PASS_US )
+{
+  uint64_t end = host::nowMicros() + (uint64_t) timeoutMs * 1000;
+  while( !done() )
+  {
+    if( host::nowMicros() >= end )
+      return false;
+    hostLoopPass( passUs );
+  }
+  return true;
+}
+
+//A field of a JSON reply
+inline long long jsonField( const std::string& body, const char* key )
+{
+  DynamicJsonBuffer buffer;
+  JsonObject& root = buffer.parseObject( body.c_str() );
+  return root[key].as<long long>();
+}
+#endif
@@ -0,0 +1,42 @@
+/*
+ Host IPAddress - an IPv4 address held in network byte order, as the core does.
+*/
+#if !defined _HOST_IPADDRESS_H_
+#define _HOST_IPADDRESS_H_
+
+class IPAddress
+{
+  public:
+    IPAddress( void ) { bytes[0] = bytes[1] = bytes[2] = bytes[3] = 0; }
+    IPAddress( uint8_t a, uint8_t b, uint8_t c, uint8_t d ) { bytes[0] = a; bytes[1] = b; bytes[2] = c; bytes[3] = d; }
+    IPAddress( uint32_t address ) { memcpy( bytes, &address, 4 ); }
+
+    operator uint32_t( void ) const { uint32_t address; memcpy( &address, bytes, 4 ); return address; }
+    bool operator==( const IPAddress& other ) const { return memcmp( bytes, other.bytes, 4 ) == 0; }
+    bool operator!=( const IPAddress& other ) const { return !( *this == other ); }
+    uint8_t operator[]( int i ) const { return bytes[i]; }
+    bool isSet( void ) const { return (uint32_t) *this != 0; }
+
+    bool fromString( const char* s )
+    {
+      unsigned int a, b, c, d;
+      char extra;
+      if( s == NULL || sscanf( s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra ) != 4 || a > 255 || b > 255 || c > 255 || d > 255 )
+        return false;
+      *this = IPAddress( a, b, c, d );
+      return true;
+    }
+    bool fromString( const String& s ) { return fromString( s.c_str() ); }
+    String toString( void ) const
+    {
+      char buf[16];
+      snprintf( buf, sizeof( buf ), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3] );
+      return String( buf );
+    }
+
+  private:
+    uint8_t bytes[4];
+};
+
+inline const IPAddress INADDR_NONE( 0, 0, 0, 0 );
+#endif
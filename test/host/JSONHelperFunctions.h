@@ -0,0 +1,19 @@
+/*
+ Host copy of the shared Alpaca response helpers.
+*/
+#if !defined _HOST_JSONHELPERFUNCTIONS_H_
+#define _HOST_JSONHELPERFUNCTIONS_H_
+#include "ArduinoJson.h"
+
+//The fields every Alpaca response carries
+inline void jsonResponseBuilder( JsonObject& root, unsigned int clientID, unsigned int transID, const String& name, int errNum, const String& errMsg )
+{
+  root["ClientID"] = clientID;
+  root["ClientTransactionID"] = transID;
+  root["Name"] = name;
+  root["ErrorNumber"] = errNum;
+  root["ErrorMessage"] = errMsg;
+}
+
+inline void debugURI( String& message ) { (void) message; }
+#endif
@@ -0,0 +1,90 @@
+/*
+ Host Print, Stream and Serial. Serial output is dropped unless HOST_SERIAL is set in the environment.
+*/
+#if !defined _HOST_PRINT_H_
+#define _HOST_PRINT_H_
+
+class Print
+{
+  public:
+    virtual ~Print( void ) {}
+    virtual size_t write( uint8_t c ) = 0;
+    virtual size_t write( const uint8_t* buf, size_t size )
+    {
+      size_t n = 0;
+      while( n < size && write( buf[n] ) == 1 )
+        n++;
+      return n;
+    }
+    size_t write( const char* s ) { return ( s == NULL )? 0 : write( (const uint8_t*) s, strlen( s ) ); }
+    size_t write( const char* buf, size_t size ) { return write( (const uint8_t*) buf, size ); }
+
+    size_t print( const char* s ) { return write( s ); }
+    size_t print( const __FlashStringHelper* s ) { return write( reinterpret_cast<const char*>( s ) ); }
+    size_t print( const String& s ) { return write( s.c_str(), s.length() ); }
+    size_t print( char c ) { return write( (uint8_t) c ); }
+    size_t print( unsigned char v, int base = DEC ) { return print( String( v, (unsigned char) base ) ); }
+    size_t print( int v, int base = DEC ) { return print( String( v, (unsigned char) base ) ); }
+    size_t print( unsigned int v, int base = DEC ) { return print( String( v, (unsigned char) base ) ); }
+    size_t print( long v, int base = DEC ) { return print( String( v, (unsigned char) base ) ); }
+    size_t print( unsigned long v, int base = DEC ) { return print( String( v, (unsigned char) base ) ); }
+    size_t print( double v, int places = 2 ) { return print( String( v, (unsigned char) places ) ); }
+    size_t println( void ) { return write( "\r\n" ); }
+    template<class T> size_t println( const T& v ) { size_t n = print( v ); return n + println(); }
+    template<class T> size_t println( const T& v, int base ) { size_t n = print( v, base ); return n + println(); }
+
+    size_t printf( const char* format, ... ) __attribute__ ((format (printf, 2, 3)))
+    {
+      char buf[1024];
+      va_list args;
+      va_start( args, format );
+      int n = vsnprintf( buf, sizeof( buf ), format, args );
+      va_end( args );
+      return write( buf, std::min( (size_t) std::max( n, 0 ), sizeof( buf ) - 1 ) );
+    }
+    template<class... A> size_t printf_P( const char* format, A... args ) { return printf( format, args... ); }
+    virtual void flush( void ) {}
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available( void ) = 0;
+    virtual int read( void ) = 0;
+    virtual int peek( void ) = 0;
+    void setTimeout( unsigned long ms ) { timeoutMs = ms; }
+    size_t readBytes( uint8_t* buf, size_t size )
+    {
+      size_t n = 0;
+      unsigned long start = millis();
+      while( n < size && millis() - start < timeoutMs )
+      {
+        int c = read();
+        if( c < 0 ) { yield(); continue; }
+        buf[n++] = (uint8_t) c;
+      }
+      return n;
+    }
+    size_t readBytes( char* buf, size_t size ) { return readBytes( (uint8_t*) buf, size ); }
+  protected:
+    unsigned long timeoutMs = 1000;
+};
+
+enum SerialConfig { SERIAL_8N1 };
+enum SerialMode { SERIAL_FULL, SERIAL_RX_ONLY, SERIAL_TX_ONLY };
+
+class HardwareSerial : public Stream
+{
+  public:
+    void begin( unsigned long, SerialConfig = SERIAL_8N1, SerialMode = SERIAL_FULL ) {}
+    using Print::write;
+    size_t write( uint8_t c ) override { if( host::serialOutput ) fputc( c, stderr ); return 1; }
+    size_t write( const uint8_t* buf, size_t size ) override { if( host::serialOutput ) fwrite( buf, 1, size, stderr ); return size; }
+    int available( void ) override { return 0; }
+    int read( void ) override { return -1; }
+    int peek( void ) override { return -1; }
+    void setDebugOutput( bool ) {}
+};
+
+inline HardwareSerial Serial;
+#endif
@@ -0,0 +1,11 @@
+//Host stand-in for the private network settings
+#if !defined _HOST_SKYBADGERSTRINGS_H_
+#define _HOST_SKYBADGERSTRINGS_H_
+const char* ssid1 = "host";
+const char* password1 = "host";
+const char* timeServer1 = "0.pool.ntp.org";
+const char* timeServer2 = "1.pool.ntp.org";
+const char* timeServer3 = "2.pool.ntp.org";
+#define TZ_SEC 0
+#define DST_SEC 0
+#endif
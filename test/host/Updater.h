@@ -0,0 +1,73 @@
+/*
+ Host Updater - a simulated flash writer. The image is kept in memory and the flash time is modelled from
+ the sector erases and page programs the writes would need, so a test can see what an update costs the device.
+ As in the core, end( false ) abandons an image that doesn't fill the size given to begin(), end( true ) installs it.
+*/
+#if !defined _HOST_UPDATER_H_
+#define _HOST_UPDATER_H_
+#include "Arduino.h"
+#include <vector>
+
+const uint32_t FLASH_SECTOR_SIZE = 4096;
+const uint32_t FLASH_ERASE_US = 40000;   //per 4K sector
+const uint32_t FLASH_PAGE_SIZE = 256;
+const uint32_t FLASH_PROGRAM_US = 700;   //per 256 byte page
+
+class UpdaterClass
+{
+  public:
+    bool begin( size_t size )
+    {
+      image.clear();
+      maxSize = size;
+      installed = false;
+      running = ( size > 0 );
+      error = ( running )? "" : "Not enough space";
+      flashUs = 0;
+      return running;
+    }
+    size_t write( uint8_t* data, size_t length )
+    {
+      if( !running )
+        return 0;
+      if( image.size() + length > maxSize )
+      {
+        error = "Not enough space";
+        return 0;
+      }
+      //Erase each new sector as the image reaches it, programme each page
+      uint32_t sectorsBefore = ( image.size() + FLASH_SECTOR_SIZE - 1 ) / FLASH_SECTOR_SIZE;
+      image.insert( image.end(), data, data + length );
+      uint32_t sectorsAfter = ( image.size() + FLASH_SECTOR_SIZE - 1 ) / FLASH_SECTOR_SIZE;
+      flashUs += ( sectorsAfter - sectorsBefore ) * FLASH_ERASE_US;
+      flashUs += ( ( length + FLASH_PAGE_SIZE - 1 ) / FLASH_PAGE_SIZE ) * FLASH_PROGRAM_US;
+      return length;
+    }
+    bool end( bool evenIfRemaining = false )
+    {
+      if( !running )
+        return false;
+      running = false;
+      if( !evenIfRemaining && image.size() != maxSize )
+      {
+        error = "Premature end";
+        return false;
+      }
+      installed = true;
+      return true;
+    }
+    bool isRunning( void ) const { return running; }
+    bool hasError( void ) const { return error.length() > 0; }
+    String getErrorString( void ) const { return error; }
+
+    std::vector<uint8_t> image;
+    bool installed = false;
+    uint64_t flashUs = 0;
+  private:
+    size_t maxSize = 0;
+    bool running = false;
+    String error;
+};
+
+inline UpdaterClass Update;
+#endif
@@ -0,0 +1,133 @@
+/*
+ Host String - the Arduino String interface the sketch uses, over std::string.
+*/
+#if !defined _HOST_WSTRING_H_
+#define _HOST_WSTRING_H_
+
+class String
+{
+  public:
+    String( void ) {}
+    String( const char* s ) { if( s != NULL ) str = s; }
+    String( const char* s, unsigned int n ) { if( s != NULL ) str.assign( s, n ); }
+    String( const __FlashStringHelper* s ) { if( s != NULL ) str = reinterpret_cast<const char*>( s ); }
+    String( const std::string& s ) : str( s ) {}
+    explicit String( char c ) : str( 1, c ) {}
+    explicit String( unsigned char v, unsigned char base = 10 ) { fromNumber( v, base ); }
+    explicit String( int v, unsigned char base = 10 ) { fromNumber( v, base ); }
+    explicit String( unsigned int v, unsigned char base = 10 ) { fromNumber( v, base ); }
+    explicit String( long v, unsigned char base = 10 ) { fromNumber( v, base ); }
+    explicit String( unsigned long v, unsigned char base = 10 ) { fromNumber( v, base ); }
+    explicit String( float v, unsigned char places = 2 ) { fromFloat( v, places ); }
+    explicit String( double v, unsigned char places = 2 ) { fromFloat( v, places ); }
+
+    unsigned int length( void ) const { return (unsigned int) str.size(); }
+    const char* c_str( void ) const { return str.c_str(); }
+    bool reserve( unsigned int size ) { str.reserve( size ); return true; }
+    bool isEmpty( void ) const { return str.empty(); }
+
+    bool concat( const String& s ) { str += s.str; return true; }
+    bool concat( const char* s ) { if( s != NULL ) str += s; return true; }
+    bool concat( const char* s, unsigned int n ) { str.append( s, n ); return true; }
+    bool concat( const __FlashStringHelper* s ) { return concat( reinterpret_cast<const char*>( s ) ); }
+    bool concat( char c ) { str += c; return true; }
+    bool concat( int v ) { return concat( String( v ) ); }
+    bool concat( unsigned int v ) { return concat( String( v ) ); }
+    bool concat( long v ) { return concat( String( v ) ); }
+    bool concat( unsigned long v ) { return concat( String( v ) ); }
+    bool concat( float v ) { return concat( String( v ) ); }
+    bool concat( double v ) { return concat( String( v ) ); }
+    template<class T> String& operator+=( const T& v ) { concat( v ); return *this; }
+
+    bool equals( const String& s ) const { return str == s.str; }
+    bool equals( const char* s ) const { return s != NULL && str == s; }
+    bool equalsIgnoreCase( const String& s ) const { return str.size() == s.str.size() && strcasecmp( str.c_str(), s.str.c_str() ) == 0; }
+    bool startsWith( const String& s ) const { return str.compare( 0, s.str.size(), s.str ) == 0; }
+    bool endsWith( const String& s ) const { return str.size() >= s.str.size() && str.compare( str.size() - s.str.size(), s.str.size(), s.str ) == 0; }
+    int compareTo( const String& s ) const { return str.compare( s.str ); }
+    bool operator==( const String& s ) const { return str == s.str; }
+    bool operator!=( const String& s ) const { return str != s.str; }
+    bool operator==( const char* s ) const { return equals( s ); }
+    bool operator!=( const char* s ) const { return !equals( s ); }
+    bool operator<( const String& s ) const { return str < s.str; }
+
+    char charAt( unsigned int i ) const { return ( i < str.size() )? str[i] : '\0'; }
+    char operator[]( unsigned int i ) const { return charAt( i ); }
+    char& operator[]( unsigned int i ) { return str[i]; }
+    void setCharAt( unsigned int i, char c ) { if( i < str.size() ) str[i] = c; }
+    int indexOf( char c, unsigned int from = 0 ) const { return found( str.find( c, from ) ); }
+    int indexOf( const String& s, unsigned int from = 0 ) const { return found( str.find( s.str, from ) ); }
+    int lastIndexOf( char c ) const { return found( str.rfind( c ) ); }
+    String substring( unsigned int from ) const { return ( from < str.size() )? String( str.substr( from ) ) : String(); }
+    String substring( unsigned int from, unsigned int to ) const
+    {
+      if( from > to ) std::swap( from, to );
+      if( from >= str.size() ) return String();
+      return String( str.substr( from, to - from ) );
+    }
+
+    void toLowerCase( void ) { for( char& c : str ) c = (char) tolower( (unsigned char) c ); }
+    void toUpperCase( void ) { for( char& c : str ) c = (char) toupper( (unsigned char) c ); }
+    void trim( void )
+    {
+      size_t start = str.find_first_not_of( " \t\r\n" );
+      if( start == std::string::npos ) { str.clear(); return; }
+      str = str.substr( start, str.find_last_not_of( " \t\r\n" ) - start + 1 );
+    }
+    void replace( const String& from, const String& to )
+    {
+      size_t at = 0;
+      if( from.str.empty() ) return;
+      while( ( at = str.find( from.str, at ) ) != std::string::npos )
+      {
+        str.replace( at, from.str.size(), to.str );
+        at += to.str.size();
+      }
+    }
+    void remove( unsigned int index ) { if( index < str.size() ) str.erase( index ); }
+    void remove( unsigned int index, unsigned int count ) { if( index < str.size() ) str.erase( index, count ); }
+
+    long toInt( void ) const { return atol( str.c_str() ); }
+    float toFloat( void ) const { return (float) atof( str.c_str() ); }
+    void getBytes( unsigned char* buf, unsigned int size ) const { toCharArray( (char*) buf, size ); }
+    void toCharArray( char* buf, unsigned int size ) const
+    {
+      if( size == 0 ) return;
+      size_t n = std::min( (size_t) size - 1, str.size() );
+      memcpy( buf, str.data(), n );
+      buf[n] = '\0';
+    }
+
+  private:
+    std::string str;
+
+    static int found( size_t at ) { return ( at == std::string::npos )? -1 : (int) at; }
+    template<class T> void fromNumber( T v, unsigned char base )
+    {
+      char buf[70];
+      if( base == 10 )
+        snprintf( buf, sizeof( buf ), ( (T) -1 < 0 )? "%lld" : "%llu", (long long) v );
+      else
+        snprintf( buf, sizeof( buf ), ( base == 16 )? "%llx" : "%llo", (unsigned long long) v );
+      str = buf;
+    }
+    void fromFloat( double v, unsigned char places )
+    {
+      char buf[64];
+      snprintf( buf, sizeof( buf ), "%.*f", places, v );
+      str = buf;
+    }
+};
+
+inline String operator+( const String& a, const String& b ) { String r( a ); r.concat( b ); return r; }
+inline String operator+( const String& a, const char* b ) { String r( a ); r.concat( b ); return r; }
+inline String operator+( const char* a, const String& b ) { String r( a ); r.concat( b ); return r; }
+inline String operator+( const String& a, const __FlashStringHelper* b ) { String r( a ); r.concat( b ); return r; }
+inline String operator+( const String& a, char b ) { String r( a ); r.concat( b ); return r; }
+inline String operator+( const String& a, int b ) { String r( a ); r.concat( b ); return r; }
+inline String operator+( const String& a, unsigned int b ) { String r( a ); r.concat( b ); return r; }
+inline String operator+( const String& a, long b ) { String r( a ); r.concat( b ); return r; }
+inline String operator+( const String& a, unsigned long b ) { String r( a ); r.concat( b ); return r; }
+
+inline const String emptyString;
+#endif
@@ -0,0 +1,104 @@
+/*
+ Host WiFiUDP - a non-blocking datagram socket bound to 127.0.0.1 at the port plus host::portOffset.
+*/
+#if !defined _HOST_WIFIUDP_H_
+#define _HOST_WIFIUDP_H_
+#include "ESP8266WiFi.h"
+
+class WiFiUDP : public Stream
+{
+  public:
+    ~WiFiUDP( void ) { stop(); }
+
+    uint8_t begin( uint16_t port )
+    {
+      struct sockaddr_in sa = host::socketAddress( IPAddress( 127, 0, 0, 1 ), hostPort( port ) );
+      stop();
+      fd = socket( AF_INET, SOCK_DGRAM, 0 );
+      if( bind( fd, (struct sockaddr*) &sa, sizeof( sa ) ) < 0 )
+      {
+        fprintf( stderr, "WiFiUDP: can't bind port %u\n", hostPort( port ) );
+        stop();
+        return 0;
+      }
+      host::setNonBlocking( fd );
+      return 1;
+    }
+    void stop( void )
+    {
+      if( fd >= 0 )
+        close( fd );
+      fd = -1;
+    }
+
+    int parsePacket( void )
+    {
+      struct sockaddr_in sa;
+      socklen_t len = sizeof( sa );
+      rxCount = rxRead = 0;
+      if( fd < 0 )
+        return 0;
+      ssize_t n = recvfrom( fd, rx, sizeof( rx ), MSG_DONTWAIT, (struct sockaddr*) &sa, &len );
+      if( n <= 0 )
+        return 0;
+      rxCount = (int) n;
+      remote = IPAddress( (uint32_t) sa.sin_addr.s_addr );
+      remotePortNumber = ntohs( sa.sin_port );
+      return rxCount;
+    }
+    int available( void ) override { return rxCount - rxRead; }
+    int read( void ) override { return ( rxRead < rxCount )? rx[rxRead++] : -1; }
+    int read( uint8_t* buf, size_t size )
+    {
+      int n = std::min( (int) size, available() );
+      memcpy( buf, rx + rxRead, n );
+      rxRead += n;
+      return n;
+    }
+    int read( char* buf, size_t size ) { return read( (uint8_t*) buf, size ); }
+    int peek( void ) override { return ( rxRead < rxCount )? rx[rxRead] : -1; }
+    IPAddress remoteIP( void ) { return remote; }
+    uint16_t remotePort( void ) { return remotePortNumber; }
+
+    int beginPacket( IPAddress address, uint16_t port )
+    {
+      txAddress = address;
+      txPort = port;
+      txCount = 0;
+      return 1;
+    }
+    int beginPacket( const char* name, uint16_t port )
+    {
+      IPAddress address;
+      return host::resolve( name, address )? beginPacket( address, port ) : 0;
+    }
+    using Print::write;
+    size_t write( uint8_t c ) override { return write( &c, 1 ); }
+    size_t write( const uint8_t* buf, size_t size ) override
+    {
+      size_t n = std::min( size, sizeof( tx ) - txCount );
+      memcpy( tx + txCount, buf, n );
+      txCount += n;
+      return n;
+    }
+    int endPacket( void )
+    {
+      struct sockaddr_in sa = host::socketAddress( txAddress, txPort );
+      if( fd < 0 )
+        return 0;
+      return sendto( fd, tx, txCount, 0, (struct sockaddr*) &sa, sizeof( sa ) ) == (ssize_t) txCount;
+    }
+
+  private:
+    int fd = -1;
+    uint8_t rx[1472];
+    int rxCount = 0;
+    int rxRead = 0;
+    IPAddress remote;
+    uint16_t remotePortNumber = 0;
+    uint8_t tx[1472];
+    size_t txCount = 0;
+    IPAddress txAddress;
+    uint16_t txPort = 0;
+};
+#endif
@@ -0,0 +1,96 @@
+/*
+ Host SHA-256 with the BearSSL interface the core bundles.
+*/
+#if !defined _HOST_BEARSSL_HASH_H_
+#define _HOST_BEARSSL_HASH_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef struct
+{
+  uint32_t state[8];
+  uint64_t count;
+  uint8_t buf[64];
+} br_sha256_context;
+
+#define br_sha256_SIZE 32
+
+inline void br_sha256_block( br_sha256_context* ctx, const uint8_t* block )
+{
+  static const uint32_t k[64] = {
+    0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+    0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+    0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+    0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+    0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+    0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+    0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+    0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2 };
+  uint32_t w[64], s[8], t1, t2;
+  int i;
+  #define ROR(x,n) ( ( (x) >> (n) ) | ( (x) << ( 32 - (n) ) ) )
+  for( i = 0; i < 16; i++ )
+    w[i] = ( (uint32_t) block[i*4] << 24 ) | ( (uint32_t) block[i*4+1] << 16 ) | ( (uint32_t) block[i*4+2] << 8 ) | block[i*4+3];
+  for( i = 16; i < 64; i++ )
+    w[i] = w[i-16] + ( ROR( w[i-15], 7 ) ^ ROR( w[i-15], 18 ) ^ ( w[i-15] >> 3 ) ) + w[i-7] + ( ROR( w[i-2], 17 ) ^ ROR( w[i-2], 19 ) ^ ( w[i-2] >> 10 ) );
+  memcpy( s, ctx->state, sizeof( s ) );
+  for( i = 0; i < 64; i++ )
+  {
+    t1 = s[7] + ( ROR( s[4], 6 ) ^ ROR( s[4], 11 ) ^ ROR( s[4], 25 ) ) + ( ( s[4] & s[5] ) ^ ( ~s[4] & s[6] ) ) + k[i] + w[i];
+    t2 = ( ROR( s[0], 2 ) ^ ROR( s[0], 13 ) ^ ROR( s[0], 22 ) ) + ( ( s[0] & s[1] ) ^ ( s[0] & s[2] ) ^ ( s[1] & s[2] ) );
+    memmove( &s[1], &s[0], 7 * sizeof( uint32_t ) );
+    s[4] += t1;
+    s[0] = t1 + t2;
+  }
+  #undef ROR
+  for( i = 0; i < 8; i++ )
+    ctx->state[i] += s[i];
+}
+
+inline void br_sha256_init( br_sha256_context* ctx )
+{
+  static const uint32_t iv[8] = { 0x6a09e667,0xbb67ae85,0x3c6ef372,0xa54ff53a,0x510e527f,0x9b05688c,0x1f83d9ab,0x5be0cd19 };
+  memcpy( ctx->state, iv, sizeof( iv ) );
+  ctx->count = 0;
+}
+
+inline void br_sha256_update( br_sha256_context* ctx, const void* data, size_t len )
+{
+  const uint8_t* p = (const uint8_t*) data;
+  while( len > 0 )
+  {
+    size_t used = ctx->count % 64;
+    size_t n = ( len < 64 - used )? len : 64 - used;
+    memcpy( ctx->buf + used, p, n );
+    ctx->count += n;
+    p += n;
+    len -= n;
+    if( ctx->count % 64 == 0 )
+      br_sha256_block( ctx, ctx->buf );
+  }
+}
+
+inline void br_sha256_out( const br_sha256_context* src, void* out )
+{
+  br_sha256_context ctx = *src;
+  uint64_t bits = ctx.count * 8;
+  uint8_t pad = 0x80;
+  uint8_t zero = 0;
+  uint8_t length[8];
+  int i;
+  br_sha256_update( &ctx, &pad, 1 );
+  while( ctx.count % 64 != 56 )
+    br_sha256_update( &ctx, &zero, 1 );
+  for( i = 0; i < 8; i++ )
+    length[i] = (uint8_t) ( bits >> ( 56 - i * 8 ) );
+  br_sha256_update( &ctx, length, 8 );
+  for( i = 0; i < 8; i++ )
+  {
+    ( (uint8_t*) out )[i*4] = (uint8_t) ( ctx.state[i] >> 24 );
+    ( (uint8_t*) out )[i*4+1] = (uint8_t) ( ctx.state[i] >> 16 );
+    ( (uint8_t*) out )[i*4+2] = (uint8_t) ( ctx.state[i] >> 8 );
+    ( (uint8_t*) out )[i*4+3] = (uint8_t) ctx.state[i];
+  }
+}
+#endif
@@ -0,0 +1,4 @@
+//Host stand-in
+#if !defined _HOST_COREDECLS_H_
+#define _HOST_COREDECLS_H_
+#endif
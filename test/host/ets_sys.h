@@ -0,0 +1,79 @@
+/*
+ Host ETSTimer. Timers fire from hostServiceTimers(), which the test calls between loop passes - as on the device,
+ where the soft timers run between passes of the loop. A timer that fell behind fires once per missed period.
+ The network stand-ins whose callbacks lwIP would run, as AsyncClient's, add themselves to host::pollers and are
+ polled there too.
+*/
+#if !defined _HOST_ETS_SYS_H_
+#define _HOST_ETS_SYS_H_
+#include "Arduino.h"
+#include <vector>
+#include <functional>
+
+typedef void ETSTimerFunc( void* arg );
+typedef struct _ETSTIMER_
+{
+  ETSTimerFunc* func;
+  void* arg;
+  uint64_t periodUs;
+  uint64_t dueUs;
+  bool repeat;
+  bool armed;
+} ETSTimer;
+
+namespace host
+{
+  inline std::vector<ETSTimer*> timers;
+  inline std::vector<std::function<void( void )>> pollers;
+}
+
+inline void ets_timer_setfn( ETSTimer* timer, ETSTimerFunc* func, void* arg )
+{
+  timer->func = func;
+  timer->arg = arg;
+  timer->armed = false;
+  if( std::find( host::timers.begin(), host::timers.end(), timer ) == host::timers.end() )
+    host::timers.push_back( timer );
+}
+
+inline void ets_timer_arm_new( ETSTimer* timer, uint32_t time, bool repeat, bool isMicros )
+{
+  timer->periodUs = ( isMicros )? time : (uint64_t) time * 1000;
+  timer->dueUs = host::nowMicros() + timer->periodUs;
+  timer->repeat = repeat;
+  timer->armed = true;
+}
+
+inline void ets_timer_disarm( ETSTimer* timer ) { timer->armed = false; }
+
+//Fire the timers that are due, returns the number of callbacks run
+inline int hostServiceTimers( void )
+{
+  uint64_t now = host::nowMicros();
+  int fired = 0;
+  for( size_t i = 0; i < host::timers.size(); i++ )
+  {
+    ETSTimer* timer = host::timers[i];
+    while( timer->armed && timer->dueUs <= now )
+    {
+      timer->armed = timer->repeat;
+      timer->dueUs += timer->periodUs;
+      timer->func( timer->arg );
+      fired++;
+    }
+  }
+  for( size_t i = 0; i < host::pollers.size(); i++ )
+    host::pollers[i]();
+  return fired;
+}
+
+//Time of the next timer due, or UINT64_MAX if none are armed
+inline uint64_t hostNextTimerDue( void )
+{
+  uint64_t next = UINT64_MAX;
+  for( ETSTimer* timer : host::timers )
+    if( timer->armed && timer->dueUs < next )
+      next = timer->dueUs;
+  return next;
+}
+#endif
@@ -0,0 +1,5 @@
+//Host stand-in - the os_timer names are the ets_timer ones
+#if !defined _HOST_OSAPI_H_
+#define _HOST_OSAPI_H_
+#include "ets_sys.h"
+#endif
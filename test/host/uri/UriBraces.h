@@ -0,0 +1,36 @@
+/*
+ Host UriBraces - a path with {} segments, each matching one path segment that is returned by pathArg().
+*/
+#if !defined _HOST_URIBRACES_H_
+#define _HOST_URIBRACES_H_
+#include "../ESP8266WebServer.h"
+
+class UriBraces : public Uri
+{
+  public:
+    explicit UriBraces( const char* uri ) : Uri( uri ) {}
+    explicit UriBraces( const String& uri ) : Uri( uri ) {}
+    Uri* clone( void ) const override { return new UriBraces( _uri ); }
+
+    bool canHandle( const String& requestUri, std::vector<String>& pathArgs ) override
+    {
+      const char* pattern = _uri.c_str();
+      const char* request = requestUri.c_str();
+      pathArgs.clear();
+      while( *pattern != '\0' )
+      {
+        if( pattern[0] == '{' && pattern[1] == '}' )
+        {
+          const char* end = strchr( request, '/' );
+          size_t n = ( end == NULL )? strlen( request ) : (size_t) ( end - request );
+          pathArgs.push_back( String( request, (unsigned int) n ) );
+          request += n;
+          pattern += 2;
+        }
+        else if( *pattern++ != *request++ )
+          return false;
+      }
+      return *request == '\0';
+    }
+};
+#endif
@@ -0,0 +1,5 @@
+//Host stand-in - nothing from the SDK interface is used on the host
+#if !defined _HOST_USER_INTERFACE_H_
+#define _HOST_USER_INTERFACE_H_
+#include "Arduino.h"
+#endif
@@ -0,0 +1,96 @@
+/*
+ Mode switching on a driver with a half step pin, against the single mode stepping it replaced.
+ Drives wheel 0 round a sequence of filter changes three ways - full steps only, full step slews with a half step
+ approach, and half steps only - with the motor modelled from the pins ( StepperModel.h ).
+ Checks no mode loses position, and reports the move times and the rotor's error from the target when each move ends.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include "StepperModel.h"
+
+//No free GPIO on the ESP-12 board - the simulated driver's half step line is on GPIO1 ( TX ), as if debug serial were off
+const int SIM_HALF_STEP_PIN = 1;
+const int SEQUENCE[] = { 2, 4, 1, 3, 0, 3, 1, 4, 2, 0 };
+
+struct Mode
+{
+  const char* name;
+  int halfStepPin;
+  int slewMode;
+  int approachSteps;
+};
+
+struct Result
+{
+  uint32_t totalMs = 0;
+  double worstError = 0.0;
+  double meanError = 0.0;
+  int lost = 0;
+  uint32_t halfPulses = 0;
+  uint32_t pulses = 0;
+};
+
+StepperModel model;
+
+Result run( const Mode& mode )
+{
+  Result result;
+  FilterWheel* fw = &filterWheels[0];
+  const char* errMsg = "";
+
+  fw->hardware.begin( 0, DIRN_PIN, STEP_PIN, ENABLE_PIN, mode.halfStepPin );
+  fw->motion.begin( &fw->hardware, microstepsPerRevolution, stepIntervalMs );
+  fw->motion.setSlewMode( mode.slewMode );
+  fw->motion.setApproachSteps( mode.approachSteps );
+  model.attach( DIRN_PIN, STEP_PIN, ENABLE_PIN, mode.halfStepPin, fw->motion.getPosition() );
+
+  for( int filter : SEQUENCE )
+  {
+    uint32_t start = millis();
+    CHECK_EQ( fwSetPosition( fw, 1, filter, &errMsg ), 0 );
+    CHECK( hostRunUntil( [&]() { model.advance( LOOP_PASS_US ); return fw->currentFilterId == filter && !fw->motion.isMoving(); }, 60000 ) );
+    result.totalMs += millis() - start;
+    double error = fabs( model.error() );
+    result.worstError = std::max( result.worstError, error );
+    result.meanError += error / ( sizeof( SEQUENCE ) / sizeof( SEQUENCE[0] ) );
+    //The pulses the driver saw put the wheel where the engine thinks it is
+    if( model.wrapped( microstepsPerRevolution ) != fw->motion.getPosition() ||
+        fw->motion.getPosition() != fw->filterPositions[filter] * MICROSTEPS_PER_STEP )
+      result.lost++;
+  }
+  result.pulses = model.pulses;
+  result.halfPulses = model.halfPulses;
+  return result;
+}
+
+int main( void )
+{
+  const Mode modes[] = {
+    { "full only", NO_PIN, STEP_FULL, 0 },
+    { "full+half", SIM_HALF_STEP_PIN, STEP_FULL, defaultApproachSteps },
+    { "half only", SIM_HALF_STEP_PIN, STEP_HALF, 0 },
+  };
+  Result results[3];
+  const char* errMsg = "";
+
+  hostBoot();
+  fwSetConnected( &filterWheels[0], 1, true, &errMsg );
+  for( int i = 0; i < 3; i++ )
+  {
+    results[i] = run( modes[i] );
+    printf( "mode switch: %-10s %6u ms for %zu moves, end error mean %.2f worst %.2f microsteps, %u pulses ( %u half ), %d lost\n",
+            modes[i].name, results[i].totalMs, sizeof( SEQUENCE ) / sizeof( SEQUENCE[0] ), results[i].meanError,
+            results[i].worstError, results[i].pulses, results[i].halfPulses, results[i].lost );
+    CHECK_EQ( results[i].lost, 0 );
+  }
+
+  //The half step approach costs a few ticks a move over full steps, and lands closer
+  CHECK( results[1].totalMs > results[0].totalMs );
+  CHECK( results[1].totalMs < results[0].totalMs * 11 / 10 );
+  CHECK( results[1].worstError < results[0].worstError * 0.75 );
+  //and is much quicker than half stepping all the way
+  CHECK( results[1].totalMs * 3 < results[2].totalMs * 2 );
+  CHECK( results[1].halfPulses > 0 );
+  CHECK_EQ( results[0].halfPulses, 0 );
+  return testResult( "mode_switch_test" );
+}
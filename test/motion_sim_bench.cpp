@@ -0,0 +1,51 @@
+/*
+ Capacity of MotionEngine on the discrete-event simulator, and the step timing the loop gives it.
+ Reports simulated steps and moves per second of host time, and the worst difference between the time between two
+ step pulses and the step interval, with an idle loop and with loops busy handling requests part of the time.
+*/
+#include "MotionSim.h"
+#include "HostCheck.h"
+#include <chrono>
+#include <algorithm>
+
+const int MICROSTEPS_PER_REV = 4096;
+const uint32_t STEP_INTERVAL_MS = 10;
+const int MOVES = 20000;
+
+struct Load
+{
+  const char* name;
+  uint32_t busyUs;
+  uint32_t busyPerMille;
+};
+
+void run( const char* driver, bool halfStep, const Load& load )
+{
+  MotionSim sim( halfStep, MICROSTEPS_PER_REV, STEP_INTERVAL_MS );
+  sim.busyUs = load.busyUs;
+  sim.busyPerMille = load.busyPerMille;
+  auto start = std::chrono::steady_clock::now();
+  for( int i = 0; i < MOVES; i++ )
+    sim.moveTo( sim.random() % MICROSTEPS_PER_REV );
+  double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  printf( "motion sim: %-9s %-14s %6.1fM steps/s, %7.0f moves/s, worst step interval error %5llu us\n",
+          driver, load.name, sim.hw.pulses / secs / 1e6, MOVES / secs, (unsigned long long) sim.hw.worstIntervalErrorUs );
+  CHECK( sim.hw.pulses > 0 );
+  //The error is bounded by the longest loop pass
+  CHECK( sim.hw.worstIntervalErrorUs <= std::max( sim.passUs, load.busyUs ) * 2 );
+}
+
+int main( void )
+{
+  const Load loads[] = {
+    { "idle loop", 0, 0 },
+    { "4ms requests", 4000, 20 },
+    { "15ms requests", 15000, 20 },
+  };
+  for( const Load& load : loads )
+  {
+    run( "full step", false, load );
+    run( "half step", true, load );
+  }
+  return testResult( "motion_sim_bench" );
+}
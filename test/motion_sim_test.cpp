@@ -0,0 +1,112 @@
+/*
+ MotionEngine on the discrete-event simulator ( MotionSim.h ), built without the sketch or the Arduino stand-ins.
+ Random moves on full step and half step drivers in each step mode must end on the target with the driver agreeing
+ with the engine, take the pulses estimateMoveMs() predicts, and replay identically from the same seed.
+ A full step driver given odd positions must settle on the nearest full step rather than hunting round it.
+ With backlash set, only a move that turns round takes it up, in extra pulses that leave the position alone.
+*/
+#include "MotionSim.h"
+#include "HostCheck.h"
+
+const int MICROSTEPS_PER_REV = 4096;
+const uint32_t STEP_INTERVAL_MS = 10;
+const int RANDOM_MOVES = 20000;
+
+struct Config
+{
+  bool halfStep;
+  int slewMode;
+  int approachSteps;
+};
+
+//Final position, pulses and time over a run of random moves
+uint64_t randomMoves( const Config& c, uint64_t seed, bool check )
+{
+  MotionSim sim( c.halfStep, MICROSTEPS_PER_REV, STEP_INTERVAL_MS );
+  uint64_t digest = 0;
+  sim.seed = seed;
+  sim.busyUs = 4000;
+  sim.busyPerMille = 20;
+  sim.engine.setSlewMode( c.slewMode );
+  sim.engine.setApproachSteps( c.approachSteps );
+  for( int i = 0; i < RANDOM_MOVES; i++ )
+  {
+    int target = sim.random() % MICROSTEPS_PER_REV;
+    int from = sim.engine.getPosition();
+    uint64_t pulses = sim.hw.pulses;
+    uint32_t estimate = sim.engine.estimateMoveMs( from, target );
+    uint64_t us = sim.moveTo( target );
+    digest = digest * 31 + sim.engine.getPosition() * 7 + sim.hw.pulses + us;
+    if( !check )
+      continue;
+    CHECK_EQ( sim.engine.getPosition(), sim.engine.snapToStep( target ) );
+    CHECK_EQ( sim.hw.position, sim.engine.getPosition() );
+    CHECK_EQ( sim.engine.getDistanceToGo(), 0 );
+    //One pulse per tick and a tick to finish, when a move was needed
+    uint64_t moved = sim.hw.pulses - pulses;
+    CHECK_EQ( ( moved > 0 )? ( moved + 1 ) * STEP_INTERVAL_MS : 0, estimate );
+    if( !c.halfStep )
+      CHECK_EQ( sim.engine.getPosition() % MICROSTEPS_PER_STEP, 0 );
+  }
+  return digest;
+}
+
+int main( void )
+{
+  const Config configs[] = {
+    { false, STEP_FULL, 0 },
+    { true, STEP_FULL, 8 },
+    { true, STEP_FULL, 0 },
+    { true, STEP_HALF, 0 },
+  };
+
+  for( const Config& c : configs )
+  {
+    uint64_t digest = randomMoves( c, 12345, true );
+    //Deterministic - the same seed replays the same moves to the microsecond
+    CHECK_EQ( randomMoves( c, 12345, false ), digest );
+  }
+
+  //A full step driver restored to an odd position, or sent to one, lands on a full step and stays there
+  MotionSim sim( false, MICROSTEPS_PER_REV, STEP_INTERVAL_MS );
+  sim.engine.setPosition( 819 );
+  CHECK_EQ( sim.engine.getPosition(), 820 );
+  sim.hw.position = sim.engine.getPosition();
+  sim.moveTo( 818 );
+  CHECK_EQ( sim.engine.getPosition(), 818 );
+  CHECK_EQ( sim.hw.pulses, 1 );
+  sim.moveTo( 819 );
+  CHECK_EQ( sim.engine.getPosition(), 820 );
+  //The sketch's loop re-issues a move whenever the position isn't the target - it must not need another
+  sim.moveTo( 820 );
+  CHECK_EQ( sim.hw.pulses, 2 );
+  CHECK_EQ( sim.hw.position, 820 );
+  sim.engine.setPosition( -1 );
+  CHECK_EQ( sim.engine.getPosition(), MICROSTEPS_PER_REV - 2 );
+
+  //A half step driver keeps the odd position
+  MotionSim halfSim( true, MICROSTEPS_PER_REV, STEP_INTERVAL_MS );
+  halfSim.engine.setPosition( 819 );
+  CHECK_EQ( halfSim.engine.getPosition(), 819 );
+
+  //Backlash is taken up turning round, and estimated
+  const int backlash = 5;
+  const bool drivers[] = { false, true };
+  for( bool halfStep : drivers )
+  {
+    MotionSim bSim( halfStep, MICROSTEPS_PER_REV, STEP_INTERVAL_MS );
+    bSim.engine.setBacklash( backlash );
+    const int targets[][2] = { { 100, 0 }, { 300, 0 }, { 240, backlash }, { 200, 0 }, { 260, backlash } };
+    for( const auto& t : targets )
+    {
+      int from = bSim.engine.getPosition();
+      uint64_t pulses = bSim.hw.pulses;
+      uint32_t estimate = bSim.engine.estimateMoveMs( from, t[0] );
+      bSim.moveTo( t[0] );
+      CHECK_EQ( bSim.engine.getPosition(), t[0] );
+      CHECK_EQ( bSim.engine.getBacklashUsed(), t[1] );
+      CHECK_EQ( ( bSim.hw.pulses - pulses + 1 ) * STEP_INTERVAL_MS, estimate );
+    }
+  }
+  return testResult( "motion_sim_test" );
+}
@@ -0,0 +1,127 @@
+/*
+ Both wheels moving at once, polled together. Each round sends wheel 0 and wheel 1 to new filters from their own
+ connected clients, then polls Position on both every POLL_US through the server's request queue until both report
+ their targets. The wheels must both get there, with their moves overlapping, and a poll must be answered within a
+ couple of loop passes however much stepping those passes do. Reports the queued to answered latency per wheel on the
+ virtual clock, where each step pulse and direction change costs its driver delays, and checks the per-wheel
+ request counts in Metrics.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include <deque>
+#include <algorithm>
+
+const int ROUNDS = 12;
+const uint32_t POLL_US = 20000;
+//Two polls are queued together, so the second waits a pass. Each pass can step both wheels ( a 200us pulse each )
+//and turn both round ( 200us each ).
+const uint32_t PASS_MAX_US = LOOP_PASS_US + FILTERWHEEL_COUNT * 400;
+const uint32_t LATENCY_MAX_US = 2 * PASS_MAX_US;
+
+struct Poll
+{
+  int device;
+  uint64_t queued;
+};
+
+uint32_t seed = 2166136261u;
+uint32_t transID = 0;
+
+uint32_t random32( void )
+{
+  //xorshift32
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+uint32_t percentile( std::vector<uint32_t> v, int pc )
+{
+  std::sort( v.begin(), v.end() );
+  return v[ ( v.size() - 1 ) * pc / 100 ];
+}
+
+String form( int device )
+{
+  return String( "ClientID=" ) + ( device + 1 ) + "&ClientTransactionID=" + ( ++transID );
+}
+
+int main( void )
+{
+  PGM_P errMsg = PSTR("");
+  std::deque<Poll> pending;
+  std::vector<uint32_t> latencyUs[FILTERWHEEL_COUNT];
+  uint32_t polls[FILTERWHEEL_COUNT] = { 0 };
+  uint32_t overlapPasses = 0;
+  int target[FILTERWHEEL_COUNT];
+  int reported[FILTERWHEEL_COUNT];
+  int d = 0;
+
+  CHECK( FILTERWHEEL_COUNT >= 2 );
+  hostBoot();
+  for( d = 0; d < FILTERWHEEL_COUNT; d++ )
+    CHECK_EQ( fwSetConnected( &filterWheels[d], d + 1, true, &errMsg ), 0 );
+
+  for( int round = 0; round < ROUNDS; round++ )
+  {
+    for( d = 0; d < FILTERWHEEL_COUNT; d++ )
+    {
+      FilterWheel* fw = &filterWheels[d];
+      target[d] = ( fw->currentFilterId + 1 + random32() % ( fw->filtersPerWheel - 1 ) ) % fw->filtersPerWheel;
+      reported[d] = -1;
+      const auto& reply = server.hostRequest( HTTP_PUT, String( "/api/v1/filterwheel/" ) + d + "/Position",
+                                              ( form( d ) + "&Position=" + target[d] ).c_str() );
+      CHECK_EQ( reply.code, 200 );
+      CHECK_EQ( jsonField( reply.body, "ErrorNumber" ), 0 );
+    }
+
+    uint64_t nextPoll = host::nowMicros();
+    uint64_t timeout = host::nowMicros() + 60000000ull;
+    while( ( reported[0] != target[0] || reported[1] != target[1] ) && host::nowMicros() < timeout )
+    {
+      if( host::nowMicros() >= nextPoll )
+      {
+        for( d = 0; d < FILTERWHEEL_COUNT; d++ )
+        {
+          server.hostQueue( ESP8266WebServer::hostBuildRequest( HTTP_GET, String( "/api/v1/filterwheel/" ) + d + "/Position?" + form( d ) ) );
+          pending.push_back( { d, host::nowMicros() } );
+        }
+        nextPoll += POLL_US;
+      }
+      uint32_t served = server.hostServed();
+      hostLoopPass();
+      if( filterWheels[0].motion.isMoving() && filterWheels[1].motion.isMoving() )
+        overlapPasses++;
+      //One request is served a pass, in the order queued
+      if( server.hostServed() != served )
+      {
+        Poll poll = pending.front();
+        pending.pop_front();
+        const auto& reply = server.hostLastResponse();
+        CHECK_EQ( reply.code, 200 );
+        latencyUs[poll.device].push_back( (uint32_t) ( host::nowMicros() - poll.queued ) );
+        reported[poll.device] = (int) jsonField( reply.body, "Value" );
+        polls[poll.device]++;
+      }
+    }
+    for( d = 0; d < FILTERWHEEL_COUNT; d++ )
+    {
+      CHECK_EQ( reported[d], target[d] );
+      CHECK_EQ( filterWheels[d].currentFilterId, target[d] );
+      CHECK_EQ( filterWheels[d].motion.getPosition(), filterWheels[d].filterPositions[target[d]] * MICROSTEPS_PER_STEP );
+    }
+  }
+
+  for( d = 0; d < FILTERWHEEL_COUNT; d++ )
+  {
+    printf( "multi wheel: wheel %d %5u polls, latency p50 %5u us, p99 %5u us, max %5u us ( bound %u us )\n", d, polls[d],
+            percentile( latencyUs[d], 50 ), percentile( latencyUs[d], 99 ), percentile( latencyUs[d], 100 ), LATENCY_MAX_US );
+    CHECK( percentile( latencyUs[d], 100 ) <= LATENCY_MAX_US );
+    //Metrics times the requests the loop serves - the polls, the PUTs above were served directly
+    CHECK_EQ( filterWheels[d].requestCount, polls[d] );
+  }
+  printf( "multi wheel: both wheels moving for %u loop passes\n", overlapPasses );
+  CHECK( overlapPasses > 0 );
+  return testResult( "multi_wheel_test" );
+}
@@ -0,0 +1,146 @@
+/*
+ Dashboards polling Position far above the rate limit while the connected client drives the wheel.
+ The server handles one request at a time in arrival order, each taking a modelled time on the ESP8266 - a full JSON
+ reply costs much more than a 429. Checks the connected client is never turned away, GET or PUT, and that the
+ dashboards are held to their rate. Reports the connected client's latency on a quiet network, under the flood, and
+ under the same flood with nothing limited ( the dashboards sending the connected client's ID ).
+ Requests are served in arrival order, so the connected client still queues behind the 429s - limiting only keeps
+ that queue short.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include <deque>
+#include <algorithm>
+
+const uint32_t RUN_MS = 10000;
+const int DASHBOARDS = 6;
+const uint32_t DASHBOARD_POLL_US = 4000;       //250 requests/s each
+const uint32_t CONTROLLER_POLL_US = 50000;
+const uint32_t CONTROLLER_MOVE_US = 2000000;
+const uint32_t SERVE_FULL_US = 3000;           //parse, build JSON and send
+const uint32_t SERVE_REJECT_US = 300;          //short 429 reply
+const uint32_t CONTROLLER_ID = 1;
+
+struct Request
+{
+  uint64_t arrival;
+  uint32_t clientID;
+  bool dashboard;
+  bool put;
+};
+
+struct Result
+{
+  std::vector<uint32_t> controllerUs;
+  uint32_t controllerRejected = 0;
+  uint32_t dashboardServed = 0;
+  uint32_t dashboardRejected = 0;
+};
+
+uint32_t percentile( std::vector<uint32_t> v, int pc )
+{
+  if( v.empty() )
+    return 0;
+  std::sort( v.begin(), v.end() );
+  return v[ ( v.size() - 1 ) * pc / 100 ];
+}
+
+Result run( int dashboards, bool limited )
+{
+  Result result;
+  std::deque<Request> pending;
+  uint64_t start = host::nowMicros();
+  uint64_t end = start + (uint64_t) RUN_MS * 1000;
+  uint64_t nextDashboard = start;
+  uint64_t nextPoll = start;
+  uint64_t nextMove = start;
+  uint64_t busyUntil = start;
+  uint32_t transID = 0;
+  int target = 0;
+  char body[96];
+
+  while( host::nowMicros() < end )
+  {
+    uint64_t now = host::nowMicros();
+    if( dashboards > 0 && now >= nextDashboard )
+    {
+      for( int i = 0; i < dashboards; i++ )
+        pending.push_back( { now, limited? (uint32_t) ( 100 + i ) : CONTROLLER_ID, true, false } );
+      nextDashboard += DASHBOARD_POLL_US;
+    }
+    if( now >= nextPoll )
+    {
+      pending.push_back( { now, CONTROLLER_ID, false, false } );
+      nextPoll += CONTROLLER_POLL_US;
+    }
+    if( now >= nextMove )
+    {
+      pending.push_back( { now, CONTROLLER_ID, false, true } );
+      nextMove += CONTROLLER_MOVE_US;
+    }
+
+    if( now >= busyUntil && !pending.empty() )
+    {
+      Request r = pending.front();
+      pending.pop_front();
+      if( r.put )
+      {
+        target = ( target + 2 ) % filterWheels[0].filtersPerWheel;
+        snprintf( body, sizeof( body ), "ClientID=%u&ClientTransactionID=%u&Position=%d", r.clientID, ++transID, target );
+        server.hostRequest( HTTP_PUT, "/api/v1/filterwheel/0/Position", body );
+      }
+      else
+      {
+        snprintf( body, sizeof( body ), "/api/v1/filterwheel/0/Position?ClientID=%u&ClientTransactionID=%u", r.clientID, ++transID );
+        server.hostRequest( HTTP_GET, body );
+      }
+      bool rejected = ( server.hostLastResponse().code == 429 );
+      busyUntil = now + ( rejected? SERVE_REJECT_US : SERVE_FULL_US );
+      if( !r.dashboard )
+      {
+        result.controllerUs.push_back( (uint32_t) ( busyUntil - r.arrival ) );
+        result.controllerRejected += rejected;
+      }
+      else if( rejected )
+        result.dashboardRejected++;
+      else
+        result.dashboardServed++;
+    }
+    hostLoopPass();
+  }
+  return result;
+}
+
+void report( const char* name, const Result& r )
+{
+  printf( "flood: %-10s controller p50 %5u us, p99 %6u us, max %6u us, %u rejected; dashboards %u served, %u rejected\n",
+          name, percentile( r.controllerUs, 50 ), percentile( r.controllerUs, 99 ),
+          percentile( r.controllerUs, 100 ), r.controllerRejected, r.dashboardServed, r.dashboardRejected );
+}
+
+int main( void )
+{
+  hostBoot();
+  server.hostRequest( HTTP_PUT, "/api/v1/filterwheel/0/connected", "ClientID=1&ClientTransactionID=1&Connected=true" );
+
+  Result quiet = run( 0, true );
+  Result flood = run( DASHBOARDS, true );
+  Result unlimited = run( DASHBOARDS, false );
+  report( "quiet", quiet );
+  report( "flooded", flood );
+  report( "unlimited", unlimited );
+
+  CHECK_EQ( quiet.controllerRejected, 0 );
+  CHECK_EQ( flood.controllerRejected, 0 );
+  CHECK( flood.controllerUs.size() >= RUN_MS * 1000 / CONTROLLER_POLL_US );
+  //Each dashboard gets its burst and then the sustained rate, the rest are turned away
+  uint32_t allowed = DASHBOARDS * ( ADMISSION_BURST + RUN_MS / ADMISSION_REFILL_MS + 1 );
+  CHECK( flood.dashboardServed <= allowed );
+  CHECK( flood.dashboardServed >= allowed * 9 / 10 );
+  CHECK( flood.dashboardRejected > flood.dashboardServed );
+  //Limiting keeps the queue the connected client waits in short - no longer than the dashboards' opening bursts -
+  //unlimited it grows without bound
+  CHECK( percentile( flood.controllerUs, 100 ) < DASHBOARDS * ADMISSION_BURST * SERVE_FULL_US + 2 * SERVE_FULL_US );
+  CHECK( percentile( flood.controllerUs, 99 ) * 10 < percentile( unlimited.controllerUs, 99 ) );
+  return testResult( "polling_flood_test" );
+}
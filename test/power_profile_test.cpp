@@ -0,0 +1,101 @@
+/*
+ Power profiles on the virtual clock. Every request wakes the radio and is counted under the profile, whether or not
+ its route reaches a wheel - the management API and unknown routes included. Under each profile the controller is left
+ idle past the hold time, then sent CMD_ECHO frames from a UDP client: the first must wake it and be answered, the
+ echo must answer for any device. The host has no radio to wake, so the wake latency itself is only measured on the
+ rig, by test/wake_latency.py timing the same echoes.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+
+const IPAddress LOOPBACK( 127, 0, 0, 1 );
+
+WiFiUDP client;
+uint16_t transID = 0;
+
+void setProfile( const char* name )
+{
+  std::string body = std::string( "{\"PowerProfile\":\"" ) + name + "\"}";
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  CHECK_EQ( server.hostRequest( HTTP_PUT, "/filterwheel/0/Config", body, "application/json" ).code, 200 );
+}
+
+//Serve one queued request from the loop, as a request arriving over the network is
+void requestFromLoop( HTTPMethod method, const char* uri )
+{
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  server.hostQueue( ESP8266WebServer::hostBuildRequest( method, uri ) );
+  hostLoopPass();
+  CHECK_EQ( server.hostPending(), 0 );
+}
+
+void idle( void )
+{
+  hostRunFor( POWER_ACTIVE_HOLD_MS + 1000 );
+}
+
+void echo( uint8_t device )
+{
+  BinaryFrame request;
+  BinaryFrame reply;
+  memset( &request, 0, sizeof( request ) );
+  request.magic = BINARY_MAGIC;
+  request.command = CMD_ECHO;
+  request.device = device;
+  request.clientID = 77;
+  request.transID = ++transID;
+  request.value = (int16_t) ( transID * 3 );
+
+  client.beginPacket( LOOPBACK, hostPort( BINARY_PROTOCOL_PORT ) );
+  client.write( (const uint8_t*) &request, sizeof( request ) );
+  client.endPacket();
+  CHECK( hostRunUntil( []() { return client.parsePacket() == sizeof( BinaryFrame ); }, 1000 ) );
+  client.read( (uint8_t*) &reply, sizeof( reply ) );
+  CHECK_EQ( reply.command, CMD_ECHO );
+  CHECK_EQ( reply.transID, request.transID );
+  CHECK_EQ( reply.value, request.value );
+  CHECK_EQ( reply.error, 0 );
+}
+
+int main( void )
+{
+  hostBoot();
+  CHECK( client.begin( BINARY_PROTOCOL_PORT + 2 ) );
+
+  //Requests that don't reach a wheel wake the radio and are counted
+  setProfile( "Balanced" );
+  const char* const routes[] = { "/management/apiversions", "/no/such/route", "/api/v1/filterwheel/9/Position" };
+  for( const char* route : routes )
+  {
+    idle();
+    CHECK( !powerState.active );
+    CHECK_EQ( host::sleepMode, WIFI_MODEM_SLEEP );
+    uint32_t wakes = powerState.stats[POWER_BALANCED].wakes;
+    uint32_t requests = powerState.stats[POWER_BALANCED].requests;
+    requestFromLoop( HTTP_GET, route );
+    CHECK( powerState.active );
+    CHECK_EQ( host::sleepMode, WIFI_NONE_SLEEP );
+    CHECK_EQ( powerState.stats[POWER_BALANCED].wakes, wakes + 1 );
+    CHECK_EQ( powerState.stats[POWER_BALANCED].requests, requests + 1 );
+  }
+
+  //The echo answers for any device number, it doesn't touch a wheel
+  echo( 200 );
+
+  const char* const names[] = { "Performance", "Balanced", "LowPower" };
+  const WiFiSleepType_t idleModes[] = { WIFI_NONE_SLEEP, WIFI_MODEM_SLEEP, WIFI_LIGHT_SLEEP };
+  for( int profile = 0; profile < POWER_PROFILE_COUNT; profile++ )
+  {
+    setProfile( names[profile] );
+    idle();
+    CHECK_EQ( powerState.active, profile == POWER_PERFORMANCE );
+    CHECK_EQ( host::sleepMode, idleModes[profile] );
+    uint32_t wakes = powerState.stats[profile].wakes;
+    echo( 0 );
+    CHECK( powerState.active );
+    CHECK_EQ( host::sleepMode, WIFI_NONE_SLEEP );
+    echo( 0 );
+    CHECK_EQ( powerState.stats[profile].wakes, wakes + ( ( profile == POWER_PERFORMANCE )? 0 : 1 ) );
+  }
+  return testResult( "power_profile_test" );
+}
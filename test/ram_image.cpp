@@ -0,0 +1,14 @@
+/*
+ The sketch linked on its own for the RAM report ( make ram ), booted and run for a pass so nothing it uses is
+ dropped. The host image's sections hold the sketch and the stand-in core, so compare them between changes - the
+ device's own figures come from the firmware ELF ( ELF= ) or Metrics.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+
+int main( void )
+{
+  hostBoot();
+  hostLoopPass();
+  return 0;
+}
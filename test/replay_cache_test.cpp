@@ -0,0 +1,122 @@
+/*
+ The replay cache ( ReplayCache.h ) under retries. A client that reuses a ClientTransactionID with a new Position has
+ sent a new request - it must move the wheel, not be answered with the reply to the old one. A true retry must be
+ answered with the stored reply and change nothing.
+ Then 100k Position PUTs from several clients: new requests, retries of each client's latest request, and reused ids
+ with new values mixed at random. Every retry must read back byte for byte as the original, nothing else is replayed.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include <chrono>
+
+const int LOAD_REQUESTS = 100000;
+const int CLIENTS = 4;
+
+FilterWheel* fw = &filterWheels[0];
+uint32_t seed = 2463534242u;
+
+uint32_t random32( void )
+{
+  //xorshift32
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+const ESP8266WebServer::Response& putPosition( uint32_t clientID, uint32_t transID, int position )
+{
+  char body[96];
+  //Spaced out so the rate limit isn't reached by the clients that aren't connected
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  snprintf( body, sizeof( body ), "ClientID=%u&ClientTransactionID=%u&Position=%d", clientID, transID, position );
+  return server.hostRequest( HTTP_PUT, "/api/v1/filterwheel/0/Position", body );
+}
+
+struct Sent
+{
+  uint32_t transID = 0;
+  int position = 0;
+  int code = 0;
+  std::string body;
+};
+
+int main( void )
+{
+  const char* errMsg = "";
+  int filterId = 0;
+
+  hostBoot();
+  CHECK_EQ( fwSetConnected( fw, 1, true, &errMsg ), 0 );
+
+  //A reused id with a new Position is run
+  CHECK_EQ( putPosition( 1, 7, 1 ).code, 200 );
+  CHECK( hostRunUntil( []() { return fw->currentFilterId == 1 && !fw->motion.isMoving(); }, 60000 ) );
+  std::string first = putPosition( 1, 7, 1 ).body;
+  CHECK_EQ( replayCache.replays, 1 );
+  std::string reused = putPosition( 1, 7, 3 ).body;
+  CHECK( reused != first );
+  CHECK_EQ( replayCache.replays, 1 );
+  CHECK( hostRunUntil( []() { return fw->currentFilterId == 3 && !fw->motion.isMoving(); }, 60000 ) );
+  CHECK_EQ( fwGetPosition( fw, &filterId, &errMsg ), 0 );
+  CHECK_EQ( filterId, 3 );
+
+  //Its retry is replayed and doesn't move the wheel again
+  CHECK( putPosition( 1, 7, 3 ).body == reused );
+  CHECK_EQ( replayCache.replays, 2 );
+  hostRunFor( 100 );
+  CHECK( !fw->motion.isMoving() );
+  CHECK_EQ( fw->targetFilterId, 3 );
+
+  //The same ids and Position to another property is a different request
+  CHECK_EQ( server.hostRequest( HTTP_PUT, "/api/v1/filterwheel/0/connected", "ClientID=1&ClientTransactionID=7&Connected=true" ).code, 200 );
+  CHECK_EQ( replayCache.replays, 2 );
+
+  //Load
+  Sent latest[CLIENTS];
+  uint32_t retries = 0;
+  uint32_t changed = 0;
+  uint32_t mismatched = 0;
+  uint32_t replaysBefore = replayCache.replays;
+  uint32_t nextTransID = 100;
+  auto start = std::chrono::steady_clock::now();
+  for( int i = 0; i < LOAD_REQUESTS; i++ )
+  {
+    int c = random32() % CLIENTS;
+    Sent* sent = &latest[c];
+    uint32_t roll = random32() % 10;
+    if( sent->transID != 0 && roll < 3 )
+    {
+      //A retry of the latest request
+      const auto& reply = putPosition( c + 1, sent->transID, sent->position );
+      retries++;
+      if( reply.code != sent->code || reply.body != sent->body )
+        mismatched++;
+      continue;
+    }
+    if( sent->transID != 0 && roll < 4 )
+    {
+      //The same id with a new Position
+      sent->position = ( sent->position + 1 + random32() % ( fw->filtersPerWheel - 1 ) ) % fw->filtersPerWheel;
+      changed++;
+    }
+    else
+    {
+      sent->transID = nextTransID++;
+      sent->position = random32() % fw->filtersPerWheel;
+    }
+    const auto& reply = putPosition( c + 1, sent->transID, sent->position );
+    //A new reply carries a new ServerTransactionID
+    if( reply.body == sent->body )
+      mismatched++;
+    sent->code = reply.code;
+    sent->body = reply.body;
+  }
+  double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  printf( "replay cache: %d requests in %.2f s, %u retries replayed, %u reused ids with new values run, %u stored\n",
+          LOAD_REQUESTS, secs, replayCache.replays - replaysBefore, changed, replayCache.stores );
+  CHECK_EQ( mismatched, 0 );
+  CHECK_EQ( replayCache.replays - replaysBefore, retries );
+  CHECK( changed > 0 );
+  return testResult( "replay_cache_test" );
+}
@@ -0,0 +1,99 @@
+/*
+ Cached property responses must read exactly as a freshly built one would - same fields in the same order,
+ with this request's ClientID and ClientTransactionID and the next ServerTransactionID spliced in.
+ Reconfiguring a wheel makes its cached responses stale, and the setup form PUTs are saved to EEPROM.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include <regex>
+
+const char* const cachedPaths[] = { "description", "driverinfo", "driveraersion", "name", "Names", "FocusOffsets" };
+
+//The body with the three transaction id values replaced
+std::string withIds( const std::string& body, const char* clientID, const char* transID, const char* serverID )
+{
+  std::string out = std::regex_replace( body, std::regex( "\"ClientID\":-?[0-9]+" ), std::string( "\"ClientID\":" ) + clientID );
+  out = std::regex_replace( out, std::regex( "\"ClientTransactionID\":-?[0-9]+" ), std::string( "\"ClientTransactionID\":" ) + transID );
+  return std::regex_replace( out, std::regex( "\"ServerTransactionID\":-?[0-9]+" ), std::string( "\"ServerTransactionID\":" ) + serverID );
+}
+
+const ESP8266WebServer::Response& get( int device, const char* path, const char* query )
+{
+  char uri[128];
+  //Spaced out so the rate limit isn't reached
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  snprintf( uri, sizeof( uri ), "/api/v1/filterwheel/%d/%s%s", device, path, query );
+  return server.hostRequest( HTTP_GET, uri );
+}
+
+int main( void )
+{
+  hostBoot();
+
+  for( int device = 0; device < FILTERWHEEL_COUNT; device++ )
+  {
+    ResponseCache* cache = &filterWheels[device].responseCache;
+    for( const char* path : cachedPaths )
+    {
+      uint32_t hits = cache->hits;
+      uint32_t misses = cache->misses;
+
+      //First request builds and stores the response
+      std::string built = get( device, path, "?ClientID=7&ClientTransactionID=100" ).body;
+      CHECK_EQ( cache->misses, misses + 1 );
+      long long serverID = jsonField( built, "ServerTransactionID" );
+
+      //Repeats are served from the cache with their own ids
+      const ESP8266WebServer::Response& r1 = get( device, path, "?ClientID=12&ClientTransactionID=4294967295" );
+      CHECK_EQ( r1.code, 200 );
+      CHECK( r1.body == withIds( built, "12", "4294967295", std::to_string( serverID + 1 ).c_str() ) );
+      const ESP8266WebServer::Response& r2 = get( device, path, "?ClientTransactionID=3" );
+      CHECK( r2.body == withIds( built, "0", "3", std::to_string( serverID + 2 ).c_str() ) );
+      const ESP8266WebServer::Response& r3 = get( device, path, "" );
+      CHECK( r3.body == withIds( built, "0", "0", std::to_string( serverID + 3 ).c_str() ) );
+      CHECK_EQ( cache->hits, hits + 3 );
+      CHECK_EQ( cache->misses, misses + 1 );
+
+      //A response built now, uncached, matches what the cache sent
+      invalidateResponseCache( cache );
+      std::string rebuilt = get( device, path, "?ClientID=12&ClientTransactionID=4294967295" ).body;
+      CHECK( rebuilt == withIds( built, "12", "4294967295", std::to_string( serverID + 4 ).c_str() ) );
+      CHECK_EQ( cache->misses, misses + 2 );
+    }
+  }
+
+  //Reconfiguring the wheel makes its cached responses stale
+  std::string before = get( 0, "name", "?ClientID=1&ClientTransactionID=1" ).body;
+  std::string names = get( 0, "Names", "?ClientID=1&ClientTransactionID=2" ).body;
+  get( 1, "name", "?ClientID=1&ClientTransactionID=2" );
+  const ESP8266WebServer::Response& put = server.hostRequest( HTTP_PUT, "/filterwheel/0/Config?ClientID=1",
+    "{\"WheelName\":\"Renamed\",\"FilterCount\":3,\"Names\":[\"L\",\"R\",\"G\"],\"FocusOffsets\":[0,10,20]}", "application/json" );
+  CHECK_EQ( put.code, 200 );
+  std::string after = get( 0, "name", "?ClientID=1&ClientTransactionID=3" ).body;
+  CHECK( after != before );
+  CHECK( after.find( "\"Value\":\"Renamed\"" ) != std::string::npos );
+  CHECK( get( 0, "Names", "?ClientID=1&ClientTransactionID=4" ).body.find( "\"Value\":[\"L\",\"R\",\"G\"]" ) != std::string::npos );
+  CHECK( names.find( "\"L\"" ) == std::string::npos );
+  //Device 1's cache is separate and still current
+  uint32_t hits = filterWheels[1].responseCache.hits;
+  get( 1, "name", "?ClientID=1&ClientTransactionID=5" );
+  CHECK_EQ( filterWheels[1].responseCache.hits, hits + 1 );
+
+  //The setup page's form PUTs are saved as well as applied, and read back after a restart
+  uint32_t commits = eepromCommits;
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  CHECK_EQ( server.hostRequest( HTTP_PUT, "/filterwheel/0/FilterNames", "filterName0=Ha&filterName1=O3&filterName2=S2" ).code, 200 );
+  CHECK_EQ( eepromCommits, commits + 1 );
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  CHECK_EQ( server.hostRequest( HTTP_PUT, "/filterwheel/0/FocusOffsets", "filterOffset0=5&filterOffset1=15&filterOffset2=25" ).code, 200 );
+  CHECK_EQ( eepromCommits, commits + 2 );
+  CHECK( get( 0, "Names", "?ClientID=1&ClientTransactionID=6" ).body.find( "\"Value\":[\"Ha\",\"O3\",\"S2\"]" ) != std::string::npos );
+  strcpy( filterWheels[0].filterNames[1], "x" );
+  filterWheels[0].focusOffsets[2] = 0;
+  setupFromEeprom();
+  CHECK( String( filterWheels[0].filterNames[1] ) == "O3" );
+  CHECK_EQ( filterWheels[0].focusOffsets[0], 5 );
+  CHECK_EQ( filterWheels[0].focusOffsets[2], 25 );
+
+  return testResult( "response_cache_test" );
+}
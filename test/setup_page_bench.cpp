@@ -0,0 +1,264 @@
+/*
+ The setup page served the old way, built as HTML on every request, against the pre-gzipped page from SetupPage.h.
+ A setup session opens the page and submits the wheel name, filter count, names and offsets forms. The old page is
+ the original setupFormBuilder ( adapted to the FilterWheel fields ) on bench routes, each form submit answered with
+ the whole page built again. The new page is GET / then GET Config, each form a Config PUT answered with the
+ settings as JSON, and a later visit revalidates the page against its ETag ( 304 ) and fetches Config again.
+ Reports bytes on the wire and handler time per session and for the page request alone.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include <chrono>
+
+const int SESSIONS = 1000;
+
+struct Totals
+{
+  uint32_t requests = 0;
+  uint64_t bytes = 0;
+  uint32_t failed = 0;
+  uint64_t hostNs = 0;
+};
+
+//The old server side page, as setupFormBuilder built it
+String& legacySetupFormBuilder( FilterWheel* fw, String& htmlForm, String& errMsg )
+{
+  int i=0;
+
+  htmlForm = "<html><head></head><meta></meta><body>\n";
+  if( errMsg != NULL && errMsg.length() > 0 )
+  {
+    htmlForm +="<div class=\"errorHeader\" bgcolor='A02222'><b>";
+    htmlForm.concat( errMsg );
+    htmlForm += "</b></div>";
+  }
+  //Hostname
+  htmlForm += "<h1> Enter new hostname for filter wheel</h1>\n";
+  htmlForm += "<form action=\"http://";
+  htmlForm.concat( hostname );
+  htmlForm += "/filterwheel/0/Hostname\" method=\"PUT\" id=\"hostname\" >\n";
+  htmlForm += "Changing the hostname will cause the filter to reboot and may change the address!\n<br>";
+  htmlForm += "<input type=\"text\" name=\"hostname\" value=\"";
+  htmlForm.concat( hostname );
+  htmlForm += "\">\n";
+  htmlForm += "<input type=\"submit\" value=\"submit\">\n</form>\n";
+
+  //Wheelname
+  htmlForm += "<h1> Enter new descriptive name for filter wheel</h1>\n";
+  htmlForm += "<form action=\"http://";
+  htmlForm.concat( fw->wheelName );
+  htmlForm += "/filterwheel/0/Wheelname\" method=\"PUT\" id=\"wheelname\" >\n";
+  htmlForm += "<input type=\"text\" name=\"wheelname\" value=\"";
+  htmlForm.concat( fw->wheelName );
+  htmlForm += "\">\n";
+  htmlForm += "<input type=\"submit\" value=\"submit\">\n</form>\n";
+
+  //Number of filters
+  htmlForm += "<h1> Enter number of filters in wheel</h1>\n";
+  htmlForm += "<form action=\"http://";
+  htmlForm.concat( hostname );
+  htmlForm += "/filterwheel/0/FilterCount\" method=\"PUT\" id=\"filtercount\" >\n";
+  htmlForm += "<input type=\"text\" name=\"filtersPerWheel\" value=\"";
+  htmlForm.concat( fw->filtersPerWheel );
+  htmlForm += "\">\n";
+  htmlForm += "<input type=\"submit\" value=\"submit\">\n</form>\n";
+
+  //Filter names by position
+  htmlForm += "<h1> Enter filter name for each filter </h1>\n";
+  htmlForm += "<form action=\"http://";
+  htmlForm.concat( hostname );
+  htmlForm += "/filterwheel/0/FilterNames\" method=\"PUT\" id=\"filternames\" >\n";
+  htmlForm += "<ol>\n";
+  for ( i=0; i< fw->filtersPerWheel; i++ )
+  {
+    htmlForm += "<li>Filter name <input type=\"text\" name=\"filtername_";
+    htmlForm.concat( i );
+    htmlForm += "\" value=\"" + String( fw->filterNames[i] ) + "\"></li>\n";
+  }
+  htmlForm += "</ol>\n";
+  htmlForm += "<input type=\"submit\" value=\"submit\">\n</form>\n";
+
+  //Filter focus offsets by position
+  htmlForm += "<h1> Enter focuser offset for each filter </h1>\n";
+  htmlForm += "<form action=\"http://";
+  htmlForm.concat( hostname );
+  htmlForm += "/filterwheel/0/FocusOffsets\" method=\"PUT\" id=\"offsets\">\n";
+  htmlForm += "<ol>\n";
+  for ( i=0; i< fw->filtersPerWheel; i++ )
+  {
+    htmlForm += "<li> Filter <input type=\"text\" name=\"focusoffset_";
+    htmlForm.concat( i );
+    htmlForm += "\" value=\"";
+    htmlForm.concat( fw->focusOffsets[i] );
+    htmlForm += "\"></li>\n";
+  }
+  htmlForm += "</ol>\n";
+  htmlForm += "<input type=\"submit\" value=\"submit\">\n</form>\n";
+  htmlForm += "</body>\n</html>\n";
+  return htmlForm;
+}
+
+void legacySendPage( void )
+{
+  String output = "";
+  String err = "";
+  output = legacySetupFormBuilder( &filterWheels[0], output, err );
+  server.send( 200, "text/html", output );
+}
+
+//The old form handlers applied the setting and answered with the page built again, the wheel name and filter count
+//were saved to EEPROM
+void handleLegacyWheelname( void )
+{
+  strcpy( filterWheels[0].wheelName, server.arg("wheelname").c_str() );
+  saveToEeprom();
+  legacySendPage();
+}
+
+void handleLegacyFilterCount( void )
+{
+  FilterConfig cfg;
+  if( stageFilterConfig( &filterWheels[0], &cfg, server.arg("filtersPerWheel").toInt() ) )
+    commitFilterConfig( &filterWheels[0], &cfg );
+  saveToEeprom();
+  legacySendPage();
+}
+
+void handleLegacyFilterNames( void )
+{
+  for( int i = 0; i < filterWheels[0].filtersPerWheel; i++ )
+    strcpy( filterWheels[0].filterNames[i], server.arg( String( "filterName" ) + i ).c_str() );
+  legacySendPage();
+}
+
+void handleLegacyFocusOffsets( void )
+{
+  for( int i = 0; i < filterWheels[0].filtersPerWheel; i++ )
+    filterWheels[0].focusOffsets[i] = server.arg( String( "filterOffset" ) + i ).toInt();
+  legacySendPage();
+}
+
+const ESP8266WebServer::Response& send( Totals* t, HTTPMethod method, const char* uri, const std::string& body = std::string(),
+                                        const char* contentType = "application/x-www-form-urlencoded",
+                                        const std::vector<std::pair<String, String>>& headers = {} )
+{
+  //Spaced out so the rate limit isn't reached
+  hostAdvanceMicros( ADMISSION_REFILL_MS * 1000 );
+  std::string raw = ESP8266WebServer::hostBuildRequest( method, uri, body, contentType, headers );
+  auto start = std::chrono::steady_clock::now();
+  server.hostQueue( raw );
+  server.handleClient();
+  t->hostNs += std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+  const ESP8266WebServer::Response& r = server.hostLastResponse();
+  t->requests++;
+  t->bytes += raw.size() + r.body.size();
+  for( const auto& h : r.headers )
+    t->bytes += h.first.length() + h.second.length() + 4;
+  if( r.code != 200 && r.code != 304 )
+    t->failed++;
+  return r;
+}
+
+int filterCount( int session ) { return 4 + ( session % 2 ); }
+
+std::string namesForm( int session )
+{
+  std::string body;
+  for( int i = 0; i < filterCount( session ); i++ )
+    body += ( i ? "&" : "" ) + std::string( "filterName" ) + std::to_string( i ) + "=F" + std::to_string( session + i );
+  return body;
+}
+
+std::string offsetsForm( int session )
+{
+  std::string body;
+  for( int i = 0; i < filterCount( session ); i++ )
+    body += ( i ? "&" : "" ) + std::string( "filterOffset" ) + std::to_string( i ) + "=" + std::to_string( ( session + i ) % 100 );
+  return body;
+}
+
+void legacySession( Totals* page, Totals* t, int session )
+{
+  send( page, HTTP_GET, "/legacy/setup" );
+  send( t, HTTP_PUT, "/legacy/Wheelname", "wheelname=W" + std::to_string( session ) );
+  send( t, HTTP_PUT, "/legacy/FilterCount", "filtersPerWheel=" + std::to_string( filterCount( session ) ) );
+  send( t, HTTP_PUT, "/legacy/FilterNames", namesForm( session ) );
+  send( t, HTTP_PUT, "/legacy/FocusOffsets", offsetsForm( session ) );
+}
+
+//The page's script PUTs each form to Config as JSON
+void configSession( Totals* page, Totals* t, int session, bool revisit )
+{
+  int count = filterCount( session );
+  std::string names = "{\"Names\":[";
+  std::string offsets = "{\"FocusOffsets\":[";
+  for( int i = 0; i < count; i++ )
+  {
+    names += ( i ? ",\"F" : "\"F" ) + std::to_string( session + i ) + "\"";
+    offsets += ( i ? "," : "" ) + std::to_string( ( session + i ) % 100 );
+  }
+  names += "]}";
+  offsets += "]}";
+
+  if( revisit )
+    CHECK_EQ( send( page, HTTP_GET, "/", "", "", { { "If-None-Match", setupPageETag } } ).code, 304 );
+  else
+    CHECK_EQ( send( page, HTTP_GET, "/" ).code, 200 );
+  send( t, HTTP_GET, "/filterwheel/0/Config" );
+  send( t, HTTP_PUT, "/filterwheel/0/Config", "{\"WheelName\":\"W" + std::to_string( session ) + "\"}", "application/json" );
+  send( t, HTTP_PUT, "/filterwheel/0/Config", "{\"FilterCount\":" + std::to_string( count ) + "}", "application/json" );
+  send( t, HTTP_PUT, "/filterwheel/0/Config", names, "application/json" );
+  send( t, HTTP_PUT, "/filterwheel/0/Config", offsets, "application/json" );
+}
+
+bool applied( int session )
+{
+  FilterWheel* fw = &filterWheels[0];
+  if( fw->filtersPerWheel != filterCount( session ) || String( fw->wheelName ) != ( "W" + std::to_string( session ) ).c_str() )
+    return false;
+  for( int i = 0; i < fw->filtersPerWheel; i++ )
+    if( String( fw->filterNames[i] ) != ( "F" + std::to_string( session + i ) ).c_str() || fw->focusOffsets[i] != ( session + i ) % 100 )
+      return false;
+  return true;
+}
+
+void report( const char* name, const Totals& page, const Totals& forms )
+{
+  printf( "setup page: %-14s page %5.0f bytes %6.1f us, session %.1f requests %6.0f bytes %7.1f us, %u failed\n", name,
+          (double) page.bytes / SESSIONS, page.hostNs / 1000.0 / SESSIONS, (double) ( page.requests + forms.requests ) / SESSIONS,
+          (double) ( page.bytes + forms.bytes ) / SESSIONS, ( page.hostNs + forms.hostNs ) / 1000.0 / SESSIONS,
+          page.failed + forms.failed );
+}
+
+int main( void )
+{
+  Totals legacyPage, legacyForms, firstPage, firstForms, revisitPage, revisitForms;
+  int legacyApplied = 0;
+  int configApplied = 0;
+
+  hostBoot();
+  server.on( "/legacy/setup",        HTTP_GET, legacySendPage );
+  server.on( "/legacy/Wheelname",    HTTP_PUT, handleLegacyWheelname );
+  server.on( "/legacy/FilterCount",  HTTP_PUT, handleLegacyFilterCount );
+  server.on( "/legacy/FilterNames",  HTTP_PUT, handleLegacyFilterNames );
+  server.on( "/legacy/FocusOffsets", HTTP_PUT, handleLegacyFocusOffsets );
+
+  for( int session = 0; session < SESSIONS * 3; session += 3 )
+  {
+    legacySession( &legacyPage, &legacyForms, session );
+    legacyApplied += applied( session );
+    configSession( &firstPage, &firstForms, session + 1, false );
+    configApplied += applied( session + 1 );
+    configSession( &revisitPage, &revisitForms, session + 2, true );
+    configApplied += applied( session + 2 );
+  }
+
+  report( "old, built", legacyPage, legacyForms );
+  report( "new, gzipped", firstPage, firstForms );
+  report( "new, revisited", revisitPage, revisitForms );
+  CHECK_EQ( legacyApplied, SESSIONS );
+  CHECK_EQ( configApplied, SESSIONS * 2 );
+  CHECK_EQ( legacyPage.failed + legacyForms.failed + firstPage.failed + firstForms.failed + revisitPage.failed + revisitForms.failed, 0 );
+  CHECK( firstPage.bytes < legacyPage.bytes );
+  return testResult( "setup_page_bench" );
+}
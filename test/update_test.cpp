@@ -0,0 +1,129 @@
+/*
+ Firmware update through the simulated flash writer. Only an image whose SHA-256 matches is installed, updates are
+ refused while a wheel moves, and a gzip compressed image is written as-is. Reports what the compressed image saves
+ in transfer size and in time over a modelled WiFi upload rate.
+*/
+#include "../ESP8266_AscomFW.ino"
+#include "HostTest.h"
+#include <fstream>
+#include <iterator>
+#include <zlib.h>
+
+const size_t IMAGE_SIZE = 420 * 1024;        //a typical sketch image
+const uint32_t LINK_BYTES_PER_SEC = 60000;   //sustained HTTP upload rate to an ESP8266
+
+//Stand-in firmware - the start of this executable, code compresses much as the sketch's does
+std::string pseudoImage( void )
+{
+  std::ifstream in( "/proc/self/exe", std::ios::binary );
+  std::string image( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>() );
+  image.resize( IMAGE_SIZE, '\xFF' );
+  return image;
+}
+
+//gzip -9
+std::string gzip( const std::string& data )
+{
+  z_stream zs;
+  std::string out( compressBound( data.size() ) + 32, '\0' );
+  memset( &zs, 0, sizeof( zs ) );
+  deflateInit2( &zs, 9, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY );
+  zs.next_in = (Bytef*) data.data();
+  zs.avail_in = data.size();
+  zs.next_out = (Bytef*) &out[0];
+  zs.avail_out = out.size();
+  deflate( &zs, Z_FINISH );
+  out.resize( zs.total_out );
+  deflateEnd( &zs );
+  return out;
+}
+
+std::string sha256Hex( const std::string& data )
+{
+  br_sha256_context ctx;
+  uint8_t digest[32];
+  char hex[65];
+  br_sha256_init( &ctx );
+  br_sha256_update( &ctx, data.data(), data.size() );
+  br_sha256_out( &ctx, digest );
+  for( int i = 0; i < 32; i++ )
+    sprintf( &hex[i*2], "%02x", digest[i] );
+  return std::string( hex );
+}
+
+std::string state( void )
+{
+  DynamicJsonBuffer buffer;
+  const ESP8266WebServer::Response& r = server.hostRequest( HTTP_GET, "/update/status" );
+  return std::string( buffer.parseObject( r.body.c_str() )["State"].as<const char*>() );
+}
+
+const ESP8266WebServer::Response& upload( const std::string& image, const std::string& hash )
+{
+  String uri = String( "/update?sha256=" ) + hash.c_str() + "&size=" + String( (unsigned long) image.size() );
+  return server.hostUpload( uri, "image", "fw.bin", image );
+}
+
+//Link time plus the flash time the writer needed, in msecs
+double updateMs( size_t bytes )
+{
+  return bytes * 1000.0 / LINK_BYTES_PER_SEC + Update.flashUs / 1000.0;
+}
+
+int main( void )
+{
+  hostBoot();
+  std::string image = pseudoImage();
+  std::string packed = gzip( image );
+  int restarts = host::restarts;
+
+  //Plain image with its hash is installed
+  upload( image, sha256Hex( image ) );
+  CHECK( state() == "Complete" );
+  CHECK( Update.installed );
+  CHECK( std::string( Update.image.begin(), Update.image.end() ) == image );
+  CHECK_EQ( firmwareUpdate.compressed, false );
+  CHECK_EQ( host::restarts, restarts + 1 );
+  double plainMs = updateMs( image.size() );
+  uint64_t plainFlashUs = Update.flashUs;
+
+  //Compressed image is written as received, for eboot to inflate
+  upload( packed, sha256Hex( packed ) );
+  CHECK( state() == "Complete" );
+  CHECK( Update.installed );
+  CHECK( std::string( Update.image.begin(), Update.image.end() ) == packed );
+  CHECK_EQ( firmwareUpdate.compressed, true );
+  CHECK_EQ( firmwareUpdate.bytesReceived, packed.size() );
+  CHECK( Update.flashUs < plainFlashUs );
+  double packedMs = updateMs( packed.size() );
+  uint64_t packedFlashUs = Update.flashUs;
+
+  //Hash of another image - nothing installed, no restart
+  restarts = host::restarts;
+  upload( packed, sha256Hex( image ) );
+  CHECK( state() == "Failed" );
+  CHECK( !Update.installed );
+  CHECK( firmwareUpdate.errMsg.indexOf( "mismatch" ) >= 0 );
+  CHECK_EQ( host::restarts, restarts );
+
+  //Missing hash
+  upload( packed, "" );
+  CHECK( state() == "Failed" );
+  CHECK( !Update.installed );
+
+  //Refused while the wheel is moving
+  server.hostRequest( HTTP_PUT, "/api/v1/filterwheel/0/connected", "ClientID=1&ClientTransactionID=1&Connected=true" );
+  server.hostRequest( HTTP_PUT, "/api/v1/filterwheel/0/Position", "ClientID=1&ClientTransactionID=2&Position=2" );
+  CHECK( hostRunUntil( []() { return filterWheels[0].motion.isMoving(); }, 100 ) );
+  upload( packed, sha256Hex( packed ) );
+  CHECK( state() == "Failed" );
+  CHECK( firmwareUpdate.errMsg.indexOf( "moving" ) >= 0 );
+  CHECK( !Update.installed );
+  CHECK_EQ( host::restarts, restarts );
+
+  printf( "update: image %zu bytes, gzip %zu bytes ( %.0f%% smaller )\n", image.size(), packed.size(),
+          100.0 - packed.size() * 100.0 / image.size() );
+  printf( "update: at %u bytes/s plain %.0f ms, gzip %.0f ms, %.0f ms saved ( flash writes %.0f ms vs %.0f ms )\n",
+          LINK_BYTES_PER_SEC, plainMs, packedMs, plainMs - packedMs, plainFlashUs / 1000.0, packedFlashUs / 1000.0 );
+  return testResult( "update_test" );
+}
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""
+Wake latency of each WiFi power profile, measured from a client on the rig.
+For each profile: set it through the Config document, leave the controller idle past the active hold time so the
+radio sleeps, then time CMD_ECHO frames over UDP - the first one wakes the radio, the ones straight after find it awake.
+The difference is what the profile costs a client that has been quiet. An echo not answered within --timeout is
+counted as lost, a lost first echo being a wake the client gave up on.
+    python3 test/wake_latency.py espFwl01 [--idle 35] [--echoes 5] [--rounds 3]
+Nothing else may talk to the controller while it runs, or the radio won't get to sleep.
+"""
+import argparse
+import json
+import socket
+import statistics
+import struct
+import time
+import urllib.request
+
+BINARY_PORT = 4030
+BINARY_MAGIC = 0xFB
+CMD_ECHO = 5
+FRAME = struct.Struct("<BBBBIHhH")
+PROFILES = ["Performance", "Balanced", "LowPower"]
+CLIENT_ID = 4242
+
+
+def get_profile(host, port):
+    with urllib.request.urlopen("http://%s:%d/filterwheel/0/Config" % (host, port), timeout=10) as reply:
+        return json.load(reply)["PowerProfile"]
+
+
+def set_profile(host, port, profile):
+    body = json.dumps({"PowerProfile": profile}).encode()
+    request = urllib.request.Request("http://%s:%d/filterwheel/0/Config" % (host, port), data=body, method="PUT",
+                                     headers={"Content-Type": "application/json"})
+    with urllib.request.urlopen(request, timeout=10) as reply:
+        reply.read()
+
+
+def echo_ms(sock, address, trans_id, timeout):
+    """Round trip in ms, None if no reply came within timeout - a late reply is skipped by the next echo."""
+    frame = FRAME.pack(BINARY_MAGIC, CMD_ECHO, 0, 0, CLIENT_ID, trans_id, trans_id & 0x7FFF, 0)
+    start = time.perf_counter()
+    sock.sendto(frame, address)
+    while True:
+        left = timeout - (time.perf_counter() - start)
+        if left <= 0:
+            return None
+        sock.settimeout(left)
+        try:
+            data, _ = sock.recvfrom(64)
+        except socket.timeout:
+            return None
+        if len(data) == FRAME.size and FRAME.unpack(data)[5] == trans_id:
+            return (time.perf_counter() - start) * 1000.0
+
+
+def median(times):
+    return statistics.median(times) if times else float("nan")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Time the radio waking under each power profile")
+    parser.add_argument("host")
+    parser.add_argument("--http-port", type=int, default=80)
+    parser.add_argument("--port", type=int, default=BINARY_PORT)
+    parser.add_argument("--idle", type=float, default=35.0, help="seconds idle before the first echo, past the 30s hold")
+    parser.add_argument("--echoes", type=int, default=5, help="echoes straight after the first")
+    parser.add_argument("--rounds", type=int, default=3)
+    parser.add_argument("--timeout", type=float, default=2.0)
+    args = parser.parse_args()
+
+    address = (socket.gethostbyname(args.host), args.port)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    trans_id = 0
+    configured = get_profile(args.host, args.http_port)
+    for profile in PROFILES:
+        set_profile(args.host, args.http_port, profile)
+        first = []
+        awake = []
+        lost_wakes = 0
+        lost_awake = 0
+        for _ in range(args.rounds):
+            time.sleep(args.idle)
+            trans_id = (trans_id + 1) & 0xFFFF
+            ms = echo_ms(sock, address, trans_id, args.timeout)
+            if ms is None:
+                lost_wakes += 1
+            else:
+                first.append(ms)
+            for _ in range(args.echoes):
+                trans_id = (trans_id + 1) & 0xFFFF
+                ms = echo_ms(sock, address, trans_id, args.timeout)
+                if ms is None:
+                    lost_awake += 1
+                else:
+                    awake.append(ms)
+        print("%-12s first echo after idle: median %7.1f ms, max %7.1f ms   awake: median %6.1f ms   wake cost %7.1f ms"
+              "   lost %d of %d wakes, %d of %d awake"
+              % (profile, median(first), max(first, default=float("nan")), median(awake), median(first) - median(awake),
+                 lost_wakes, args.rounds, lost_awake, args.rounds * args.echoes))
+    set_profile(args.host, args.http_port, configured)
+
+
+if __name__ == "__main__":
+    main()